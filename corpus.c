@@ -0,0 +1,521 @@
+#include <stdio.h>    // For console and file I/O
+#include <stdlib.h>   // For memory allocation (malloc, realloc, free), strtod
+#include <string.h>   // For strlen, strncpy, strrchr
+#include <ctype.h>    // For isspace
+
+#include "corpus.h"
+#include "corpus_cache.h"
+#include "corpus_io.h"
+#include "result_cache.h"
+#include "tap_augment.h"
+
+#define CORPUS_MAX_LINE_LEN (8192)
+
+// --- Manifest Parsing Helpers ---
+
+// Returns the next whitespace separated token of *cursor (NUL-terminated in place), or NULL at the end of the line.
+static char* next_token(char** cursor) {
+    char* p = *cursor;
+    while (*p && isspace((unsigned char)*p)) p++;
+    if (*p == '\0' || *p == '#') {
+        *cursor = p;
+        return NULL;
+    }
+    char* token = p;
+    while (*p && !isspace((unsigned char)*p)) p++;
+    if (*p) *p++ = '\0';
+    *cursor = p;
+    return token;
+}
+
+static int is_absolute_path(const char* path) {
+    return (path[0] == '/') || (path[0] == '\\') || (path[0] != '\0' && path[1] == ':');
+}
+
+// Resolves a manifest entry against the manifest directory.
+static int resolve_path(char* out, size_t out_size, const char* manifest_path, const char* entry) {
+    const char* slash = strrchr(manifest_path, '/');
+    const char* backslash = strrchr(manifest_path, '\\');
+    if (backslash > slash) slash = backslash;
+
+    int written;
+    if (is_absolute_path(entry) || !slash) {
+        written = snprintf(out, out_size, "%s", entry);
+    } else {
+        written = snprintf(out, out_size, "%.*s%s", (int)(slash - manifest_path + 1), manifest_path, entry);
+    }
+    return (written < 0 || (size_t)written >= out_size) ? -1 : 0;
+}
+
+// Parses "<seconds>:<S|D>" into a label.
+static int parse_label(const char* token, tap_label_t* label) {
+    char* end = NULL;
+    double time_s = strtod(token, &end);
+    if (end == token || *end != ':' || time_s < 0.0) return -1;
+    if (end[1] == 'S' && end[2] == '\0') {
+        label->type = TAP_SINGLE;
+    } else if (end[1] == 'D' && end[2] == '\0') {
+        label->type = TAP_DOUBLE;
+    } else {
+        return -1;
+    }
+    label->time_s = (float)time_s;
+    return 0;
+}
+
+/**
+ * @brief Reads a corpus manifest and decodes every listed recording into memory.
+ * @param corpus Corpus to fill. On failure it is left empty.
+ * @param manifest_path Path to the manifest text file, or to a corpus cache file which is mapped instead.
+ * @return 0 on success, -1 if the manifest or any recording could not be read.
+ */
+int corpus_load(corpus_t* corpus, const char* manifest_path) {
+    return corpus_load_io(corpus, manifest_path, NULL, NULL);
+}
+
+/**
+ * @brief corpus_load() with control over how the recordings are read (see corpus_io.h).
+ * @param io NULL for the defaults.
+ * @param io_stats Optional; receives the read statistics (zero files for a corpus cache).
+ */
+int corpus_load_io(corpus_t* corpus, const char* manifest_path, const corpus_io_options_t* io, corpus_io_stats_t* io_stats) {
+    if (io_stats) memset(io_stats, 0, sizeof(*io_stats));
+    if (corpus_cache_is_cache(manifest_path)) {
+        return corpus_cache_map(corpus, manifest_path);
+    }
+    memset(corpus, 0, sizeof(*corpus));
+
+    FILE* manifest = fopen(manifest_path, "r");
+    if (!manifest) {
+        fprintf(stderr, "Error: Could not open corpus manifest %s\n", manifest_path);
+        return -1;
+    }
+
+    char* line = (char*)malloc(CORPUS_MAX_LINE_LEN);
+    if (!line) {
+        fprintf(stderr, "Error: Memory allocation failed for manifest line buffer.\n");
+        fclose(manifest);
+        return -1;
+    }
+
+    int capacity = 0;
+    int line_no = 0;
+    int status = 0;
+    while (status == 0 && fgets(line, CORPUS_MAX_LINE_LEN, manifest)) {
+        line_no++;
+        if (!strchr(line, '\n') && !feof(manifest)) {
+            fprintf(stderr, "Error: %s:%d: line too long\n", manifest_path, line_no);
+            status = -1;
+            break;
+        }
+
+        char* cursor = line;
+        char* entry = next_token(&cursor);
+        if (!entry) continue; // Blank or comment line
+
+        if (corpus->num_files == capacity) {
+            int new_capacity = capacity ? capacity * 2 : 16;
+            corpus_file_t* grown = (corpus_file_t*)realloc(corpus->files, new_capacity * sizeof(corpus_file_t));
+            if (!grown) {
+                fprintf(stderr, "Error: Memory allocation failed for corpus index.\n");
+                status = -1;
+                break;
+            }
+            corpus->files = grown;
+            capacity = new_capacity;
+        }
+
+        corpus_file_t* file = &corpus->files[corpus->num_files];
+        memset(file, 0, sizeof(*file));
+        corpus->num_files++;
+
+        if (resolve_path(file->path, sizeof(file->path), manifest_path, entry) != 0) {
+            fprintf(stderr, "Error: %s:%d: path too long\n", manifest_path, line_no);
+            status = -1;
+            break;
+        }
+
+        char* token;
+        while ((token = next_token(&cursor)) != NULL) {
+            tap_label_t label;
+            if (parse_label(token, &label) != 0) {
+                fprintf(stderr, "Error: %s:%d: invalid label '%s' (expected <seconds>:<S|D>)\n", manifest_path, line_no, token);
+                status = -1;
+                break;
+            }
+            tap_label_t* grown = (tap_label_t*)realloc(file->labels, (file->num_labels + 1) * sizeof(tap_label_t));
+            if (!grown) {
+                fprintf(stderr, "Error: Memory allocation failed for corpus labels.\n");
+                status = -1;
+                break;
+            }
+            file->labels = grown;
+            file->labels[file->num_labels++] = label;
+        }
+        if (status != 0) break;
+    }
+
+    free(line);
+    fclose(manifest);
+
+    if (status == 0 && corpus->num_files == 0) {
+        fprintf(stderr, "Error: Corpus manifest %s lists no recordings\n", manifest_path);
+        status = -1;
+    }
+    // Stereo recordings carry both mics; mono recordings feed both detector inputs, as the CLI does
+    if (status == 0) {
+        status = corpus_io_load_files(corpus->files, corpus->num_files, io, io_stats);
+    }
+    for (int i = 0; status == 0 && i < corpus->num_files; i++) {
+        corpus->total_labels += corpus->files[i].num_labels;
+        corpus->total_duration_s += (double)corpus->files[i].num_samples / corpus->files[i].samplerate;
+    }
+    if (status != 0) {
+        corpus_free(corpus);
+    }
+    return status;
+}
+
+void corpus_free(corpus_t* corpus) {
+    for (int i = 0; i < corpus->num_files; i++) {
+        free(corpus->files[i].owned_data);
+        free(corpus->files[i].labels);
+    }
+    free(corpus->files);
+    if (corpus->mapped_base) {
+        corpus_cache_unmap(corpus->mapped_base, corpus->mapped_size);
+    }
+    memset(corpus, 0, sizeof(*corpus));
+}
+
+// Identifies the audio of a recording independent of its path: samples of both mics and the sample rate.
+uint64_t corpus_hash_audio(const corpus_file_t* file) {
+    size_t bytes = (size_t)file->num_samples * sizeof(fixed_point_t);
+    uint64_t hash = result_cache_hash_bytes(file->mic1, bytes, file->samplerate);
+    if (file->mic2 != file->mic1) {
+        hash = result_cache_hash_bytes(file->mic2, bytes, hash);
+    }
+    return hash;
+}
+
+// Appends one detector event, growing the array as needed.
+static int append_event(tap_event_t** events, int* num_events, int* capacity, long block, const tap_detect_ctx_t* ctx,
+                        tap_detection_result_e result) {
+    if (*num_events == *capacity) {
+        int new_capacity = *capacity ? *capacity * 2 : 16;
+        tap_event_t* grown = (tap_event_t*)realloc(*events, new_capacity * sizeof(tap_event_t));
+        if (!grown) {
+            fprintf(stderr, "Error: Memory allocation failed for detector events.\n");
+            return -1;
+        }
+        *events = grown;
+        *capacity = new_capacity;
+    }
+    (*events)[*num_events].block = block;
+    (*events)[*num_events].origin_block = (long)ctx->event_origin_block - 1; // Context counts blocks from 1
+    (*events)[*num_events].type = result;
+    (*num_events)++;
+    return 0;
+}
+
+/**
+ * @brief Runs a fresh detector instance over one recording, frame by frame, exactly like the CLI does.
+ * @param file The decoded recording.
+ * @param cfg Detector configuration, NULL for the defaults.
+ * @param augment Augmentation chain the recording is replayed through, NULL (or an empty chain) for none.
+ * @param events_out Receives a newly allocated event array (NULL if there are no events). The caller frees it.
+ * @param num_events_out Receives the number of events.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int corpus_run_file(const corpus_file_t* file, const tap_detect_config_t* cfg, const tap_augment_chain_t* augment,
+                    tap_event_t** events_out, int* num_events_out) {
+    tap_detect_ctx_t ctx;
+    tap_detect_init(&ctx, cfg);
+
+    tap_event_t* events = NULL;
+    int num_events = 0;
+    int capacity = 0;
+    int status = 0;
+
+    if (!augment || augment->num_ops == 0) {
+        // Unaugmented: the detector reads the decoded samples in place
+        long block = 0;
+        for (long idx = 0; status == 0 && idx < file->num_samples; idx += MAX_AUDIO_FRAME_SIZE, block++) {
+            long frame_len = MAX_AUDIO_FRAME_SIZE;
+            if (idx + frame_len > file->num_samples) {
+                frame_len = file->num_samples - idx;
+            }
+            if (frame_len < 2) {
+                break;
+            }
+
+            tap_detection_result_e result = tap_detect_process(&ctx, &file->mic1[idx], &file->mic2[idx], (int)frame_len);
+            if (result != TAP_NONE) {
+                status = append_event(&events, &num_events, &capacity, block, &ctx, result);
+            }
+        }
+    } else {
+        // Augmented: frames are produced one at a time into stack buffers
+        int mic1_frame[MAX_AUDIO_FRAME_SIZE];
+        int mic2_frame[MAX_AUDIO_FRAME_SIZE];
+        tap_augment_source_t source;
+        tap_augment_source_init(&source, augment, file->mic1, file->mic2, file->num_samples,
+                                file->content_hash ^ tap_augment_hash(augment));
+
+        long block = 0;
+        int frame_len;
+        while (status == 0 && (frame_len = tap_augment_next_frame(&source, mic1_frame, mic2_frame, MAX_AUDIO_FRAME_SIZE)) >= 2) {
+            tap_detection_result_e result = tap_detect_process(&ctx, mic1_frame, mic2_frame, frame_len);
+            if (result != TAP_NONE) {
+                status = append_event(&events, &num_events, &capacity, block, &ctx, result);
+            }
+            block++;
+        }
+    }
+
+    if (status != 0) {
+        free(events);
+        return -1;
+    }
+    *events_out = events;
+    *num_events_out = num_events;
+    return 0;
+}
+
+/**
+ * @brief Matches detector events against the labels of a recording and accumulates the result into score.
+ * Every event is matched greedily to the earliest unused label of the same type whose onset is within tolerance_s
+ * of the event's origin. Unmatched events count as false positives, unmatched labels as misses.
+ * @param sample_offset Source sample at which the evaluated stream started (see tap_augment_sample_offset()).
+ */
+void corpus_score_file(const corpus_file_t* file, const tap_event_t* events, int num_events, long sample_offset,
+                       float tolerance_s, corpus_score_t* score) {
+    unsigned char* used = (unsigned char*)calloc(file->num_labels > 0 ? file->num_labels : 1, 1);
+    int matched = 0;
+
+    for (int e = 0; used && e < num_events; e++) {
+        float origin_s = (float)(((double)events[e].origin_block * MAX_AUDIO_FRAME_SIZE + sample_offset) / file->samplerate);
+        for (int l = 0; l < file->num_labels; l++) {
+            float distance = origin_s - file->labels[l].time_s;
+            if (distance < 0) distance = -distance;
+            if (!used[l] && file->labels[l].type == events[e].type && distance <= tolerance_s) {
+                used[l] = 1;
+                matched++;
+                break;
+            }
+        }
+    }
+    free(used);
+
+    score->labels += file->num_labels;
+    score->detections += num_events;
+    score->matched += matched;
+    score->duration_s += (double)file->num_samples / file->samplerate;
+}
+
+// Returns the events of one recording, from the result cache when the pair was evaluated before.
+// An augmented replay is cached as different audio: the chain hash is folded into the content hash.
+static int corpus_events_for_file(const corpus_file_t* file, const tap_detect_config_t* cfg, uint64_t config_hash,
+                                  const tap_augment_chain_t* augment, result_cache_t* results,
+                                  tap_event_t** events_out, int* num_events_out) {
+    uint64_t audio_hash = file->content_hash;
+    uint64_t augment_hash = tap_augment_hash(augment);
+    if (augment_hash != 0) {
+        audio_hash = result_cache_hash_bytes(&augment_hash, sizeof(augment_hash), audio_hash);
+    }
+    if (results) {
+        int found = result_cache_lookup(results, audio_hash, config_hash, events_out, num_events_out);
+        if (found != 0) return found > 0 ? 0 : -1;
+    }
+    if (corpus_run_file(file, cfg, augment, events_out, num_events_out) != 0) return -1;
+    if (results) {
+        result_cache_store(results, audio_hash, config_hash, *events_out, *num_events_out); // Failure only costs a re-run
+    }
+    return 0;
+}
+
+// Called with the score of every recording as evaluate_files() goes through the corpus.
+typedef void (*corpus_file_score_fn)(const corpus_file_t* file, const corpus_score_t* score);
+
+// Runs (or looks up) and scores every recording of the corpus into total; on_file may be NULL.
+static int evaluate_files(const corpus_t* corpus, const tap_detect_config_t* cfg, const tap_augment_chain_t* augment,
+                          float tolerance_s, result_cache_t* results, corpus_file_score_fn on_file, corpus_score_t* total) {
+    uint64_t config_hash = result_cache_hash_config(cfg);
+    long sample_offset = tap_augment_sample_offset(augment);
+
+    memset(total, 0, sizeof(*total));
+    for (int i = 0; i < corpus->num_files; i++) {
+        const corpus_file_t* file = &corpus->files[i];
+        tap_event_t* events = NULL;
+        int num_events = 0;
+        if (corpus_events_for_file(file, cfg, config_hash, augment, results, &events, &num_events) != 0) {
+            return -1;
+        }
+        corpus_score_t score;
+        memset(&score, 0, sizeof(score));
+        corpus_score_file(file, events, num_events, sample_offset, tolerance_s, &score);
+        free(events);
+        if (on_file) on_file(file, &score);
+
+        total->labels += score.labels;
+        total->detections += score.detections;
+        total->matched += score.matched;
+        total->duration_s += score.duration_s;
+    }
+    return 0;
+}
+
+/**
+ * @brief Evaluates one detector configuration over the whole corpus.
+ * Every recording is processed by a fresh detector context, so this function is safe to call concurrently
+ * from several threads on the same corpus.
+ * @param augment Augmentation chain every recording is replayed through, NULL for none.
+ * @param results Optional result cache; pairs found there are scored without running the detector.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int corpus_evaluate(const corpus_t* corpus, const tap_detect_config_t* cfg, const tap_augment_chain_t* augment,
+                    float tolerance_s, result_cache_t* results, corpus_score_t* score) {
+    tap_detect_config_t defaults;
+    if (!cfg) {
+        tap_detect_config_default(&defaults);
+        cfg = &defaults;
+    }
+    return evaluate_files(corpus, cfg, augment, tolerance_s, results, NULL, score);
+}
+
+double corpus_score_recall(const corpus_score_t* score) {
+    return score->labels > 0 ? (double)score->matched / score->labels : 0.0;
+}
+
+double corpus_score_fp_per_hour(const corpus_score_t* score) {
+    return score->duration_s > 0.0 ? (score->detections - score->matched) * 3600.0 / score->duration_s : 0.0;
+}
+
+double corpus_score_f1(const corpus_score_t* score) {
+    int denominator = score->labels + score->detections;
+    return denominator > 0 ? 2.0 * score->matched / denominator : 0.0;
+}
+
+// --- Command Line Front-End ---
+
+#define CORPUS_MAX_AUGMENT_VARIANTS (64)
+
+static void print_evaluate_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s --evaluate <corpus_manifest|corpus_cache> [options]\n", prog);
+    fprintf(stderr, "  --min X / --max X       peak thresholds in Q2.29 float units (default: %.4f / %.4f)\n",
+            Q_TO_FLOAT(TRANSIENT_THRESHOLD_MIN_FXP), Q_TO_FLOAT(TRANSIENT_THRESHOLD_MAX_FXP));
+    fprintf(stderr, "  --cooldown N            cooldown in blocks (default: %d)\n", TAP_COOLDOWN_BLOCKS);
+    fprintf(stderr, "  --window N              double-tap window in blocks (default: %d)\n", TAP_DOUBLE_TAP_WINDOW_BLOCKS);
+    fprintf(stderr, "  --tolerance S           label matching tolerance in seconds (default: %.3f)\n", CORPUS_DEFAULT_TOLERANCE_S);
+    fprintf(stderr, "  --result-cache FILE     reuse and extend stored per-file results\n");
+    fprintf(stderr, "  --augment SPEC          also replay the corpus through an augmentation chain, e.g.\n");
+    fprintf(stderr, "                          gain=0.5,noise=0.002,shift=96,delay=2 (repeatable, see tap_augment.h)\n");
+    fprintf(stderr, "  --io MODE               how recordings are read: auto (default), uring or pread\n");
+    fprintf(stderr, "  --io-threads N          decode threads while loading (default: online CPUs)\n");
+}
+
+// One row of the per-recording table.
+static void print_file_row(const corpus_file_t* file, const corpus_score_t* score) {
+    printf("%6d | %8d | %7d | %s\n", score->labels, score->detections, score->matched, file->path);
+}
+
+/**
+ * @brief Entry point of "--evaluate": scores one configuration per recording and over the whole corpus.
+ * With --augment, the corpus is additionally replayed through every given chain and one summary row is
+ * printed per variant instead of the per-recording table.
+ */
+int corpus_evaluate_cli(int argc, char* argv[]) {
+    if (argc < 3) {
+        print_evaluate_usage(argv[0]);
+        return 1;
+    }
+    tap_detect_config_t cfg;
+    tap_detect_config_default(&cfg);
+    float tolerance_s = CORPUS_DEFAULT_TOLERANCE_S;
+    const char* result_cache_path = NULL;
+    static tap_augment_chain_t variants[CORPUS_MAX_AUGMENT_VARIANTS + 1]; // [0] is the unaugmented corpus
+    int num_variants = 1;
+    memset(&variants[0], 0, sizeof(variants[0]));
+    corpus_io_options_t io;
+    corpus_io_options_default(&io);
+
+    for (int i = 3; i < argc; i += 2) {
+        const char* opt = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!value) {
+            fprintf(stderr, "Error: Missing value for %s\n", opt);
+            return 1;
+        }
+        if (strcmp(opt, "--min") == 0) cfg.threshold_min = FLOAT_TO_Q(atof(value));
+        else if (strcmp(opt, "--max") == 0) cfg.threshold_max = FLOAT_TO_Q(atof(value));
+        else if (strcmp(opt, "--cooldown") == 0) cfg.cooldown_blocks = atoi(value);
+        else if (strcmp(opt, "--window") == 0) cfg.double_tap_window_blocks = atoi(value);
+        else if (strcmp(opt, "--tolerance") == 0) tolerance_s = (float)atof(value);
+        else if (strcmp(opt, "--result-cache") == 0) result_cache_path = value;
+        else if (strcmp(opt, "--io-threads") == 0) io.threads = atoi(value);
+        else if (strcmp(opt, "--io") == 0) {
+            if (corpus_io_mode_parse(value, &io.mode) != 0) return 1;
+        }
+        else if (strcmp(opt, "--augment") == 0) {
+            if (num_variants > CORPUS_MAX_AUGMENT_VARIANTS) {
+                fprintf(stderr, "Error: At most %d augmentation chains are supported\n", CORPUS_MAX_AUGMENT_VARIANTS);
+                return 1;
+            }
+            if (tap_augment_parse(&variants[num_variants], value) != 0) return 1;
+            num_variants++;
+        } else {
+            fprintf(stderr, "Error: Unknown option %s\n", opt);
+            print_evaluate_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    corpus_t corpus;
+    corpus_io_stats_t io_stats;
+    if (corpus_load_io(&corpus, argv[2], &io, &io_stats) != 0) {
+        fprintf(stderr, "Failed to load corpus from %s. Exiting.\n", argv[2]);
+        return 1;
+    }
+    // Load statistics go to stderr so the evaluation table on stdout stays unchanged
+    if (io_stats.files > 0) {
+        fprintf(stderr, "Loaded %d recordings (%.1f MB) in %.3f s via %s, %ld syscalls\n", io_stats.files,
+                io_stats.bytes / 1e6, io_stats.seconds, corpus_io_mode_name(io_stats.mode), io_stats.syscalls);
+    }
+    result_cache_t* results = NULL;
+    if (result_cache_path && !(results = result_cache_open(result_cache_path))) {
+        corpus_free(&corpus);
+        return 1;
+    }
+
+    printf("--- Evaluation (thresholds %.5f..%.5f, cooldown %d, window %d) ---\n",
+           Q_TO_FLOAT(cfg.threshold_min), Q_TO_FLOAT(cfg.threshold_max), cfg.cooldown_blocks, cfg.double_tap_window_blocks);
+
+    int status = 0;
+    corpus_score_t total;
+    if (num_variants == 1) {
+        printf("Labels | Detected | Matched | Recording\n");
+        status = evaluate_files(&corpus, &cfg, NULL, tolerance_s, results, print_file_row, &total) == 0 ? 0 : 1;
+        if (status == 0) {
+            printf("Total: %d labels, %d detections, recall %.4f, %.2f false positives/hour, F1 %.4f\n",
+                   total.labels, total.detections, corpus_score_recall(&total), corpus_score_fp_per_hour(&total), corpus_score_f1(&total));
+        }
+    } else {
+        printf("Recall | FP/hour  | F1     | Augmentation\n");
+        for (int v = 0; status == 0 && v < num_variants; v++) {
+            if (evaluate_files(&corpus, &cfg, &variants[v], tolerance_s, results, NULL, &total) != 0) {
+                status = 1;
+                break;
+            }
+            printf("%.4f | %8.2f | %.4f | %s\n", corpus_score_recall(&total), corpus_score_fp_per_hour(&total),
+                   corpus_score_f1(&total), v == 0 ? "(none)" : variants[v].spec);
+        }
+    }
+    if (results) {
+        long hits, misses, entries;
+        result_cache_stats(results, &hits, &misses, &entries);
+        printf("Result cache: %ld reused, %ld evaluated, %ld stored\n", hits, misses, entries);
+        result_cache_close(results);
+    }
+    corpus_free(&corpus);
+    return status;
+}
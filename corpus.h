@@ -0,0 +1,94 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+#include <stdint.h>
+#include <stddef.h>
+
+#include "tap_detect.h"
+#include "wav_io.h"
+
+// --- Labelled Corpus ---
+// A corpus is described by a text manifest with one recording per line:
+//
+//     # comment
+//     recordings/tap_01.wav  1.250:D  5.270:S
+//
+// followed by the ground-truth taps as <onset time in seconds>:<S|D>. For a double tap the onset is the first tap.
+// Relative paths are resolved against the directory of the manifest. Recordings are 16-bit PCM, mono or
+// stereo (left = mic1, right = mic2).
+// Each recording is decoded once by corpus_load() (many files at a time, see corpus_io.h) and kept in memory for the lifetime of the corpus,
+// so repeated evaluations (e.g., a parameter search) never touch the WAV files again.
+// corpus_load() also accepts a corpus cache file (see corpus_cache.h), which is mapped instead of decoded.
+
+#define CORPUS_MAX_PATH_LEN       (512)
+#define CORPUS_DEFAULT_TOLERANCE_S (0.050f) /* max distance between a labelled onset and a detected one. */
+
+typedef struct
+{
+    float                  time_s; // Onset of the (first) tap in seconds
+    tap_detection_result_e type;   // TAP_SINGLE or TAP_DOUBLE
+} tap_label_t;
+
+typedef struct
+{
+    char                 path[CORPUS_MAX_PATH_LEN];
+    uint32_t             samplerate;
+    long                 num_samples;
+    const fixed_point_t* mic1;       // Q2.29 samples of the first microphone
+    const fixed_point_t* mic2;       // Q2.29 samples of the second microphone (== mic1 for mono recordings)
+    fixed_point_t*       owned_data; // Decoded buffer owned by the corpus, NULL if the samples live elsewhere
+    tap_label_t*         labels;
+    int                  num_labels;
+    uint64_t             content_hash; // Hash of the samples, identifies the audio in the result cache
+} corpus_file_t;
+
+typedef struct
+{
+    corpus_file_t* files;
+    int            num_files;
+    int            total_labels;
+    double         total_duration_s;
+    void*          mapped_base; // Corpus cache mapping the samples point into, NULL for a decoded manifest
+    size_t         mapped_size;
+} corpus_t;
+
+// A detector event, with the time of the tap it refers to (not the block in which it was reported).
+typedef struct
+{
+    long                   block;        // Block in which the detector reported the event (0-based)
+    long                   origin_block; // Block of the (first) tap the event refers to (0-based)
+    tap_detection_result_e type;
+} tap_event_t;
+
+// Detection score of one recording or accumulated over a corpus.
+typedef struct
+{
+    int    labels;     // Ground-truth taps
+    int    detections; // Events reported by the detector
+    int    matched;    // Events matching a label of the same type within the tolerance
+    double duration_s; // Audio duration that was evaluated
+} corpus_score_t;
+
+typedef struct corpus_io_options_s corpus_io_options_t;
+typedef struct corpus_io_stats_s   corpus_io_stats_t;
+
+int  corpus_load(corpus_t* corpus, const char* manifest_path);
+int  corpus_load_io(corpus_t* corpus, const char* manifest_path, const corpus_io_options_t* io, corpus_io_stats_t* io_stats);
+void corpus_free(corpus_t* corpus);
+
+typedef struct result_cache result_cache_t;
+typedef struct tap_augment_chain tap_augment_chain_t;
+
+uint64_t corpus_hash_audio(const corpus_file_t* file);
+int  corpus_run_file(const corpus_file_t* file, const tap_detect_config_t* cfg, const tap_augment_chain_t* augment,
+                     tap_event_t** events_out, int* num_events_out);
+void corpus_score_file(const corpus_file_t* file, const tap_event_t* events, int num_events, long sample_offset,
+                       float tolerance_s, corpus_score_t* score);
+int  corpus_evaluate(const corpus_t* corpus, const tap_detect_config_t* cfg, const tap_augment_chain_t* augment,
+                     float tolerance_s, result_cache_t* results, corpus_score_t* score);
+int  corpus_evaluate_cli(int argc, char* argv[]);
+
+double corpus_score_recall(const corpus_score_t* score);
+double corpus_score_fp_per_hour(const corpus_score_t* score);
+double corpus_score_f1(const corpus_score_t* score);
+
+#endif // !CORPUS_H
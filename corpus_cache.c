@@ -0,0 +1,298 @@
+#include <stdio.h>    // For file I/O
+#include <stdlib.h>   // For memory allocation
+#include <string.h>   // For memcmp, memcpy, memset, strcmp
+#ifdef _WIN32
+#include <windows.h>  // For CreateFileMapping, MapViewOfFile
+#else
+#include <fcntl.h>    // For open
+#include <sys/mman.h> // For mmap, munmap, madvise
+#include <sys/stat.h> // For fstat
+#include <unistd.h>   // For close
+#endif
+
+#include "corpus_cache.h"
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint64_t padded_samples(uint64_t num_samples) {
+    return (num_samples + MAX_AUDIO_FRAME_SIZE - 1) / MAX_AUDIO_FRAME_SIZE * MAX_AUDIO_FRAME_SIZE;
+}
+
+static int write_zeros(FILE* file, uint64_t count) {
+    static const char zeros[CORPUS_CACHE_ALIGNMENT * 16] = { 0 };
+    while (count > 0) {
+        size_t chunk = count > sizeof(zeros) ? sizeof(zeros) : (size_t)count;
+        if (fwrite(zeros, 1, chunk, file) != chunk) return -1;
+        count -= chunk;
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes a loaded corpus into a cache file.
+ * @return 0 on success, -1 on failure (a partially written file is removed).
+ */
+int corpus_cache_write(const corpus_t* corpus, const char* cache_path) {
+    corpus_cache_entry_t* index = (corpus_cache_entry_t*)calloc(corpus->num_files, sizeof(corpus_cache_entry_t));
+    if (!index) {
+        fprintf(stderr, "Error: Memory allocation failed for cache index.\n");
+        return -1;
+    }
+
+    // Lay out the file: header, index, labels, then the aligned sample arrays
+    corpus_cache_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CORPUS_CACHE_MAGIC, sizeof(header.magic));
+    header.version = CORPUS_CACHE_VERSION;
+    header.q_bits = Q_BITS;
+    header.frame_size = MAX_AUDIO_FRAME_SIZE;
+    header.num_files = (uint32_t)corpus->num_files;
+    header.num_labels = (uint32_t)corpus->total_labels;
+    header.index_offset = sizeof(corpus_cache_header_t);
+    header.labels_offset = header.index_offset + (uint64_t)corpus->num_files * sizeof(corpus_cache_entry_t);
+
+    uint64_t offset = align_up(header.labels_offset + (uint64_t)corpus->total_labels * sizeof(corpus_cache_label_t), CORPUS_CACHE_ALIGNMENT);
+    uint32_t label_cursor = 0;
+    for (int i = 0; i < corpus->num_files; i++) {
+        const corpus_file_t* file = &corpus->files[i];
+        corpus_cache_entry_t* entry = &index[i];
+        memcpy(entry->path, file->path, sizeof(entry->path));
+        entry->samplerate = file->samplerate;
+        entry->num_channels = (file->mic2 == file->mic1) ? 1 : 2;
+        entry->num_samples = (uint64_t)file->num_samples;
+        entry->first_label = label_cursor;
+        entry->num_labels = (uint32_t)file->num_labels;
+        entry->content_hash = file->content_hash;
+        label_cursor += (uint32_t)file->num_labels;
+
+        uint64_t array_bytes = align_up(padded_samples(entry->num_samples) * sizeof(fixed_point_t), CORPUS_CACHE_ALIGNMENT);
+        entry->mic1_offset = offset;
+        offset += array_bytes;
+        entry->mic2_offset = entry->mic1_offset;
+        if (entry->num_channels == 2) {
+            entry->mic2_offset = offset;
+            offset += array_bytes;
+        }
+    }
+    header.file_size = offset;
+
+    FILE* out = fopen(cache_path, "wb");
+    if (!out) {
+        fprintf(stderr, "Error: Could not open file for writing %s\n", cache_path);
+        free(index);
+        return -1;
+    }
+
+    int status = 0;
+    uint64_t written = 0;
+    if (fwrite(&header, sizeof(header), 1, out) != 1 ||
+        (corpus->num_files > 0 && fwrite(index, sizeof(corpus_cache_entry_t), corpus->num_files, out) != (size_t)corpus->num_files)) {
+        status = -1;
+    }
+    written = header.labels_offset;
+
+    for (int i = 0; status == 0 && i < corpus->num_files; i++) {
+        const corpus_file_t* file = &corpus->files[i];
+        for (int l = 0; l < file->num_labels; l++) {
+            corpus_cache_label_t label = { file->labels[l].time_s, (uint32_t)file->labels[l].type };
+            if (fwrite(&label, sizeof(label), 1, out) != 1) status = -1;
+            written += sizeof(label);
+        }
+    }
+
+    for (int i = 0; status == 0 && i < corpus->num_files; i++) {
+        const corpus_file_t* file = &corpus->files[i];
+        const corpus_cache_entry_t* entry = &index[i];
+        const fixed_point_t* arrays[2] = { file->mic1, file->mic2 };
+        const uint64_t offsets[2] = { entry->mic1_offset, entry->mic2_offset };
+        for (uint32_t ch = 0; status == 0 && ch < entry->num_channels; ch++) {
+            uint64_t data_bytes = entry->num_samples * sizeof(fixed_point_t);
+            uint64_t array_bytes = align_up(padded_samples(entry->num_samples) * sizeof(fixed_point_t), CORPUS_CACHE_ALIGNMENT);
+            if (write_zeros(out, offsets[ch] - written) != 0 ||
+                fwrite(arrays[ch], 1, (size_t)data_bytes, out) != data_bytes ||
+                write_zeros(out, array_bytes - data_bytes) != 0) {
+                status = -1;
+            }
+            written = offsets[ch] + array_bytes;
+        }
+    }
+
+    if (fclose(out) != 0) status = -1;
+    if (status != 0) {
+        fprintf(stderr, "Error: Could not write corpus cache %s\n", cache_path);
+        remove(cache_path);
+    }
+    free(index);
+    return status;
+}
+
+int corpus_cache_is_cache(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return 0;
+    char magic[8];
+    int is_cache = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, CORPUS_CACHE_MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return is_cache;
+}
+
+// --- Platform Mapping ---
+
+// Maps a whole file read-only; release with corpus_cache_unmap(). Returns NULL for missing or empty files.
+void* corpus_cache_map_readonly(const char* path, size_t* size_out) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) return NULL;
+    void* base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping); // The view keeps the mapping alive
+    *size_out = (size_t)size.QuadPart;
+    return base;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file referenced
+    if (base == MAP_FAILED) return NULL;
+    madvise(base, (size_t)st.st_size, MADV_WILLNEED);
+    *size_out = (size_t)st.st_size;
+    return base;
+#endif
+}
+
+void corpus_cache_unmap(void* base, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(base);
+#else
+    munmap(base, size);
+#endif
+}
+
+static int entry_in_bounds(const corpus_cache_entry_t* entry, uint64_t file_size) {
+    uint64_t bytes = entry->num_samples * sizeof(fixed_point_t);
+    return entry->samplerate > 0 && (entry->num_channels == 1 || entry->num_channels == 2) &&
+           entry->mic1_offset % CORPUS_CACHE_ALIGNMENT == 0 && entry->mic2_offset % CORPUS_CACHE_ALIGNMENT == 0 &&
+           entry->mic1_offset <= file_size && bytes <= file_size - entry->mic1_offset &&
+           entry->mic2_offset <= file_size && bytes <= file_size - entry->mic2_offset &&
+           memchr(entry->path, '\0', sizeof(entry->path)) != NULL;
+}
+
+/**
+ * @brief Maps a cache file and fills corpus with recordings whose samples point into the mapping.
+ * The mapping is released by corpus_free().
+ * @return 0 on success, -1 if the file cannot be mapped or is not a compatible cache.
+ */
+int corpus_cache_map(corpus_t* corpus, const char* cache_path) {
+    memset(corpus, 0, sizeof(*corpus));
+
+    size_t size = 0;
+    unsigned char* base = (unsigned char*)corpus_cache_map_readonly(cache_path, &size);
+    if (!base) {
+        fprintf(stderr, "Error: Could not map corpus cache %s\n", cache_path);
+        return -1;
+    }
+    corpus->mapped_base = base;
+    corpus->mapped_size = size;
+
+    const corpus_cache_header_t* header = (const corpus_cache_header_t*)base;
+    if (size < sizeof(*header) || memcmp(header->magic, CORPUS_CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != CORPUS_CACHE_VERSION || header->file_size != size) {
+        fprintf(stderr, "Error: %s is not a valid corpus cache (version %d expected)\n", cache_path, CORPUS_CACHE_VERSION);
+        corpus_free(corpus);
+        return -1;
+    }
+    if (header->q_bits != Q_BITS || header->frame_size != MAX_AUDIO_FRAME_SIZE) {
+        fprintf(stderr, "Error: Corpus cache %s was built for Q%u and %u-sample frames; rebuild it\n",
+                cache_path, header->q_bits, header->frame_size);
+        corpus_free(corpus);
+        return -1;
+    }
+    if (header->index_offset + (uint64_t)header->num_files * sizeof(corpus_cache_entry_t) > size ||
+        header->labels_offset + (uint64_t)header->num_labels * sizeof(corpus_cache_label_t) > size) {
+        fprintf(stderr, "Error: Corpus cache %s is truncated\n", cache_path);
+        corpus_free(corpus);
+        return -1;
+    }
+
+    const corpus_cache_entry_t* index = (const corpus_cache_entry_t*)(base + header->index_offset);
+    const corpus_cache_label_t* labels = (const corpus_cache_label_t*)(base + header->labels_offset);
+
+    corpus->files = (corpus_file_t*)calloc(header->num_files > 0 ? header->num_files : 1, sizeof(corpus_file_t));
+    if (!corpus->files) {
+        fprintf(stderr, "Error: Memory allocation failed for corpus index.\n");
+        corpus_free(corpus);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < header->num_files; i++) {
+        const corpus_cache_entry_t* entry = &index[i];
+        if (!entry_in_bounds(entry, size) || (uint64_t)entry->first_label + entry->num_labels > header->num_labels) {
+            fprintf(stderr, "Error: Corpus cache %s has a corrupt index entry %u\n", cache_path, i);
+            corpus_free(corpus);
+            return -1;
+        }
+
+        corpus_file_t* file = &corpus->files[corpus->num_files++];
+        memcpy(file->path, entry->path, sizeof(file->path));
+        file->samplerate = entry->samplerate;
+        file->num_samples = (long)entry->num_samples;
+        file->mic1 = (const fixed_point_t*)(base + entry->mic1_offset);
+        file->mic2 = (const fixed_point_t*)(base + entry->mic2_offset);
+        file->content_hash = entry->content_hash;
+
+        if (entry->num_labels > 0) {
+            file->labels = (tap_label_t*)malloc(entry->num_labels * sizeof(tap_label_t));
+            if (!file->labels) {
+                fprintf(stderr, "Error: Memory allocation failed for corpus labels.\n");
+                corpus_free(corpus);
+                return -1;
+            }
+            for (uint32_t l = 0; l < entry->num_labels; l++) {
+                file->labels[l].time_s = labels[entry->first_label + l].time_s;
+                file->labels[l].type = (tap_detection_result_e)labels[entry->first_label + l].type;
+            }
+            file->num_labels = (int)entry->num_labels;
+        }
+
+        corpus->total_labels += file->num_labels;
+        corpus->total_duration_s += (double)file->num_samples / file->samplerate;
+    }
+    return 0;
+}
+
+/**
+ * @brief Entry point of "--build-cache <manifest> <cache file>".
+ */
+int corpus_cache_cli(int argc, char* argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s --build-cache <corpus_manifest> <cache_file>\n", argv[0]);
+        return 1;
+    }
+
+    corpus_t corpus;
+    if (corpus_load(&corpus, argv[2]) != 0) {
+        fprintf(stderr, "Failed to load corpus from %s. Exiting.\n", argv[2]);
+        return 1;
+    }
+    int status = corpus_cache_write(&corpus, argv[3]);
+    if (status == 0) {
+        printf("Corpus cache saved to: %s (%d recordings, %d labelled taps, %.1f s of audio)\n",
+               argv[3], corpus.num_files, corpus.total_labels, corpus.total_duration_s);
+    }
+    corpus_free(&corpus);
+    return status == 0 ? 0 : 1;
+}
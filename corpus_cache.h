@@ -0,0 +1,65 @@
+#ifndef CORPUS_CACHE_H
+#define CORPUS_CACHE_H
+#include <stdint.h>
+#include <stddef.h>
+
+#include "corpus.h"
+
+// --- Decoded Corpus Cache ---
+// A corpus decoded once into a single file that is memory-mapped on later runs. Sample data is stored already
+// converted to Q2.29, each recording starting on a CORPUS_CACHE_ALIGNMENT boundary and zero-padded to a whole
+// number of MAX_AUDIO_FRAME_SIZE frames, so the detector reads frames straight from the page cache.
+//
+// Layout (host byte order):
+//     corpus_cache_header_t
+//     corpus_cache_entry_t[num_files]
+//     corpus_cache_label_t[num_labels]
+//     sample arrays (aligned, frame padded)
+//
+// The cache does not track changes to the source WAV files; rebuild it when the corpus changes.
+
+#define CORPUS_CACHE_MAGIC     "TAPCACHE"
+#define CORPUS_CACHE_VERSION   (2)
+#define CORPUS_CACHE_ALIGNMENT (64) /* cache line; also satisfies any SIMD load alignment. */
+
+typedef struct
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t q_bits;       // Must match Q_BITS of the reader
+    uint32_t frame_size;   // MAX_AUDIO_FRAME_SIZE the arrays are padded for
+    uint32_t num_files;
+    uint32_t num_labels;
+    uint32_t reserved;
+    uint64_t index_offset;
+    uint64_t labels_offset;
+    uint64_t file_size;
+} corpus_cache_header_t;
+
+typedef struct
+{
+    char     path[CORPUS_MAX_PATH_LEN];
+    uint32_t samplerate;
+    uint32_t num_channels;
+    uint64_t num_samples;
+    uint64_t mic1_offset;
+    uint64_t mic2_offset;  // Equal to mic1_offset for mono recordings
+    uint32_t first_label;
+    uint32_t num_labels;
+    uint64_t content_hash; // corpus_hash_audio() of the recording, so mapped runs never rehash the samples
+} corpus_cache_entry_t;
+
+typedef struct
+{
+    float    time_s;
+    uint32_t type;
+} corpus_cache_label_t;
+
+int  corpus_cache_write(const corpus_t* corpus, const char* cache_path);
+int  corpus_cache_is_cache(const char* path);
+int  corpus_cache_map(corpus_t* corpus, const char* cache_path);
+void* corpus_cache_map_readonly(const char* path, size_t* size_out);
+void corpus_cache_unmap(void* base, size_t size);
+int  corpus_cache_cli(int argc, char* argv[]);
+
+#endif // !CORPUS_CACHE_H
@@ -0,0 +1,596 @@
+#include <stdio.h>     // For error messages
+#include <stdlib.h>    // For malloc, realloc, free
+#include <string.h>    // For memset, memcpy, strcmp
+#include <errno.h>     // For EINTR
+#include <stdatomic.h> // For the shared file index of the fallback
+#include <pthread.h>   // For the decode workers
+#include <fcntl.h>     // For open, O_RDONLY
+#include <sys/stat.h>  // For fstat
+#ifdef _WIN32
+#include <windows.h>   // For GetSystemInfo
+#else
+#include <unistd.h>    // For pread, close, sysconf
+#endif
+#ifdef __linux__
+#include <sys/mman.h>      // For mmap of the rings
+#include <sys/syscall.h>   // For __NR_io_uring_setup, __NR_io_uring_enter, __NR_io_uring_register
+#include <linux/io_uring.h>
+#endif
+
+#include "corpus_io.h"
+#include "tap_clock.h"
+#include "wav_io.h"
+
+#define CORPUS_IO_MAX_THREADS  (64)
+#define CORPUS_IO_QUEUE_DEPTH  (64)          /* default files in flight. */
+#define CORPUS_IO_FIRST_READ   (256 * 1024)  /* bytes read before the header is known; small recordings fit whole. */
+#define CORPUS_IO_WAV_HEADER   (44)
+
+static const char* const mode_names[CORPUS_IO_MODE_COUNT] = { "auto", "uring", "pread" };
+
+void corpus_io_options_default(corpus_io_options_t* options) {
+    options->mode = CORPUS_IO_AUTO;
+    options->threads = 0;
+    options->queue_depth = CORPUS_IO_QUEUE_DEPTH;
+}
+
+const char* corpus_io_mode_name(corpus_io_mode_e mode) {
+    return (mode >= 0 && mode < CORPUS_IO_MODE_COUNT) ? mode_names[mode] : "?";
+}
+
+int corpus_io_mode_parse(const char* name, corpus_io_mode_e* mode) {
+    for (int m = 0; m < CORPUS_IO_MODE_COUNT; m++) {
+        if (strcmp(name, mode_names[m]) == 0) {
+            *mode = (corpus_io_mode_e)m;
+            return 0;
+        }
+    }
+    fprintf(stderr, "Error: Unknown I/O mode '%s' (expected auto, uring or pread)\n", name);
+    return -1;
+}
+
+static int online_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+// --- Decode Workers ---
+// Files that are completely read wait in `ready` (each file is queued at most once, so it never wraps) until a
+// worker decodes them. `outstanding` counts files the reader has started and no worker has finished, which bounds
+// the raw buffers held in memory to the queue depth.
+
+typedef struct {
+    unsigned char* data;
+    size_t         len;
+    size_t         capacity;
+    size_t         needed;   // Bytes to read, known once the header has arrived (0 before)
+    int            fd;
+} io_buffer_t;
+
+typedef struct {
+    corpus_file_t*   files;
+    io_buffer_t*     buffers;
+    int              num_files;
+    int*             ready;
+    int              ready_head;
+    int              ready_tail;
+    int              outstanding;
+    bool             reading_done;
+    pthread_mutex_t  lock;
+    pthread_cond_t   work_ready;
+    pthread_cond_t   progress;
+    atomic_int       next_file;  // pread fallback: next file a worker reads itself
+    atomic_int       failed;
+    atomic_long      syscalls;
+    atomic_ullong    bytes;
+    bool             read_in_workers;
+} io_batch_t;
+
+// Decodes one read file into its corpus entry and releases the raw bytes.
+static void decode_file(io_batch_t* batch, int index) {
+    corpus_file_t* file = &batch->files[index];
+    io_buffer_t* buffer = &batch->buffers[index];
+    file->owned_data = decode_wav_mics_fx(buffer->data, buffer->len, file->path, &file->samplerate,
+                                          &file->num_samples, &file->mic2);
+    free(buffer->data);
+    buffer->data = NULL;
+    if (!file->owned_data) {
+        atomic_store(&batch->failed, 1);
+        return;
+    }
+    file->mic1 = file->owned_data;
+    file->content_hash = corpus_hash_audio(file);
+}
+
+#ifndef _WIN32
+/**
+ * @brief Reads a whole file with open/fstat/pread/close into buffer.
+ * @return 0, or -1 if the file could not be opened (reported). Read errors leave a short buffer for the decoder to report.
+ */
+static int pread_file(io_batch_t* batch, const char* path, io_buffer_t* buffer) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open WAV file %s\n", path);
+        return -1;
+    }
+    struct stat st;
+    size_t size = (fstat(fd, &st) == 0 && st.st_size > 0) ? (size_t)st.st_size : 0;
+    long calls = 3;
+    buffer->data = malloc(size + 1);
+    buffer->len = 0;
+    while (buffer->data && buffer->len < size) {
+        ssize_t n = pread(fd, buffer->data + buffer->len, size - buffer->len, (off_t)buffer->len);
+        calls++;
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        buffer->len += (size_t)n;
+    }
+    close(fd);
+    atomic_fetch_add(&batch->syscalls, calls);
+    atomic_fetch_add(&batch->bytes, (unsigned long long)buffer->len);
+    if (!buffer->data) {
+        fprintf(stderr, "Error: Memory allocation failed for %s.\n", path);
+        return -1;
+    }
+    return 0;
+}
+#endif
+
+static void* decode_worker(void* arg) {
+    io_batch_t* batch = arg;
+    if (batch->read_in_workers) {
+        for (;;) {
+            int i = atomic_fetch_add(&batch->next_file, 1);
+            if (i >= batch->num_files) break;
+#ifdef _WIN32
+            corpus_file_t* file = &batch->files[i];
+            file->owned_data = read_wav_mics_fx(file->path, &file->samplerate, &file->num_samples, &file->mic2);
+            if (!file->owned_data) {
+                atomic_store(&batch->failed, 1);
+                continue;
+            }
+            file->mic1 = file->owned_data;
+            file->content_hash = corpus_hash_audio(file);
+#else
+            if (pread_file(batch, batch->files[i].path, &batch->buffers[i]) != 0) {
+                atomic_store(&batch->failed, 1);
+                continue;
+            }
+            decode_file(batch, i);
+#endif
+        }
+        return NULL;
+    }
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        while (batch->ready_head == batch->ready_tail && !batch->reading_done) {
+            pthread_cond_wait(&batch->work_ready, &batch->lock);
+        }
+        if (batch->ready_head == batch->ready_tail) {
+            pthread_mutex_unlock(&batch->lock);
+            break;
+        }
+        int i = batch->ready[batch->ready_head++];
+        pthread_mutex_unlock(&batch->lock);
+
+        decode_file(batch, i);
+
+        pthread_mutex_lock(&batch->lock);
+        batch->outstanding--;
+        pthread_cond_signal(&batch->progress);
+        pthread_mutex_unlock(&batch->lock);
+    }
+    return NULL;
+}
+
+#ifdef __linux__
+// --- io_uring Reader ---
+
+typedef struct {
+    int                  fd;
+    unsigned             entries;
+    unsigned*            sq_head;
+    unsigned*            sq_tail;
+    unsigned*            sq_mask;
+    unsigned*            sq_array;
+    unsigned*            cq_head;
+    unsigned*            cq_tail;
+    unsigned*            cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void*                sq_ring;
+    size_t               sq_ring_bytes;
+    void*                cq_ring;
+    size_t               cq_ring_bytes;
+    size_t               sqes_bytes;
+    unsigned             sqe_tail;   // Local tail; published to *sq_tail before every io_uring_enter()
+} uring_t;
+
+enum { URING_OP_OPEN = 1, URING_OP_READ = 2, URING_OP_CLOSE = 3 };
+
+static void uring_exit(uring_t* ring) {
+    if (ring->sqes) munmap(ring->sqes, ring->sqes_bytes);
+    if (ring->cq_ring && ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_bytes);
+    if (ring->sq_ring) munmap(ring->sq_ring, ring->sq_ring_bytes);
+    if (ring->fd >= 0) close(ring->fd);
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+// Checks that the kernel implements every operation the reader uses (openat, read and close need Linux 5.6).
+static bool uring_supports_ops(int fd) {
+    size_t bytes = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = calloc(1, bytes);
+    if (!probe) return false;
+    bool ok = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+    const int ops[] = { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE };
+    for (int i = 0; ok && i < 3; i++) {
+        ok = ops[i] <= probe->last_op && (probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    return ok;
+}
+
+/**
+ * @brief Creates a ring with at least `entries` submission slots and maps its queues.
+ * @return 0, or -1 if io_uring is not available (nothing reported; the caller falls back).
+ */
+static int uring_init(uring_t* ring, unsigned entries) {
+    memset(ring, 0, sizeof(*ring));
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        ring->fd = -1;
+        return -1;
+    }
+    if (!uring_supports_ops(ring->fd)) {
+        uring_exit(ring);
+        return -1;
+    }
+    ring->entries = params.sq_entries;
+    ring->sq_ring_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_bytes = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_bytes > ring->sq_ring_bytes) ring->sq_ring_bytes = ring->cq_ring_bytes;
+        ring->cq_ring_bytes = ring->sq_ring_bytes;
+    }
+    ring->sq_ring = mmap(NULL, ring->sq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        ring->sq_ring = NULL;
+        uring_exit(ring);
+        return -1;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            ring->cq_ring = NULL;
+            uring_exit(ring);
+            return -1;
+        }
+    }
+    ring->sqes_bytes = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        uring_exit(ring);
+        return -1;
+    }
+    unsigned char* sq = ring->sq_ring;
+    unsigned char* cq = ring->cq_ring;
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    ring->sqe_tail = *ring->sq_tail;
+    return 0;
+}
+
+static int uring_enter(uring_t* ring, unsigned wait);
+
+// Returns a cleared submission slot. The ring is sized so it does not fill up between two io_uring_enter() calls;
+// if it does anyway, the queued operations are submitted early.
+static struct io_uring_sqe* uring_get_sqe(uring_t* ring, uint64_t user_data) {
+    if (ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->entries) uring_enter(ring, 0);
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sqe_tail - head >= ring->entries) return NULL;
+    unsigned index = ring->sqe_tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+    ring->sqe_tail++;
+    return sqe;
+}
+
+// Submits every queued operation and waits for at least `wait` completions. Returns 0, or -1 on error.
+static int uring_enter(uring_t* ring, unsigned wait) {
+    __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+    unsigned to_submit = ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    for (;;) {
+        long n = syscall(__NR_io_uring_enter, ring->fd, to_submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (n >= 0) return 0;
+        if (errno != EINTR) return -1;
+    }
+}
+
+typedef struct {
+    io_batch_t* batch;
+    uring_t     ring;
+    int         ops_in_flight;   // Submitted operations without a completion yet
+} uring_reader_t;
+
+static uint64_t op_data(int index, int op) {
+    return ((uint64_t)index << 2) | (uint64_t)op;
+}
+
+static void queue_read(uring_reader_t* reader, int index) {
+    io_buffer_t* buffer = &reader->batch->buffers[index];
+    size_t want = (buffer->needed ? buffer->needed : buffer->capacity) - buffer->len;
+    struct io_uring_sqe* sqe = uring_get_sqe(&reader->ring, op_data(index, URING_OP_READ));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = buffer->fd;
+    sqe->addr = (uint64_t)(uintptr_t)(buffer->data + buffer->len);
+    sqe->len = (unsigned)(want > 0x7ffff000u ? 0x7ffff000u : want);
+    sqe->off = buffer->len;
+    reader->ops_in_flight++;
+}
+
+// Queues the file for the workers and closes its descriptor through the ring.
+static void finish_read(uring_reader_t* reader, int index) {
+    io_batch_t* batch = reader->batch;
+    io_buffer_t* buffer = &batch->buffers[index];
+    struct io_uring_sqe* sqe = uring_get_sqe(&reader->ring, op_data(index, URING_OP_CLOSE));
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = buffer->fd;
+    reader->ops_in_flight++;
+    buffer->fd = -1;
+    atomic_fetch_add(&batch->bytes, (unsigned long long)buffer->len);
+
+    pthread_mutex_lock(&batch->lock);
+    batch->ready[batch->ready_tail++] = index;
+    pthread_cond_signal(&batch->work_ready);
+    pthread_mutex_unlock(&batch->lock);
+}
+
+// Ends a file that could not be read at all; it never reaches the workers.
+static void drop_file(uring_reader_t* reader, int index) {
+    io_batch_t* batch = reader->batch;
+    free(batch->buffers[index].data);
+    batch->buffers[index].data = NULL;
+    atomic_store(&batch->failed, 1);
+    pthread_mutex_lock(&batch->lock);
+    batch->outstanding--;
+    pthread_mutex_unlock(&batch->lock);
+}
+
+static void start_file(uring_reader_t* reader, int index) {
+    io_batch_t* batch = reader->batch;
+    io_buffer_t* buffer = &batch->buffers[index];
+    buffer->capacity = CORPUS_IO_FIRST_READ;
+    buffer->data = malloc(buffer->capacity);
+    buffer->fd = -1;
+    pthread_mutex_lock(&batch->lock);
+    batch->outstanding++;
+    pthread_mutex_unlock(&batch->lock);
+    if (!buffer->data) {
+        fprintf(stderr, "Error: Memory allocation failed for %s.\n", batch->files[index].path);
+        drop_file(reader, index);
+        return;
+    }
+    struct io_uring_sqe* sqe = uring_get_sqe(&reader->ring, op_data(index, URING_OP_OPEN));
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)batch->files[index].path;
+    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    reader->ops_in_flight++;
+}
+
+// Once the header has arrived, works out how many bytes the decoder needs and grows the buffer to hold them.
+static void size_from_header(io_buffer_t* buffer) {
+    uint16_t channels;
+    uint32_t data_size;
+    memcpy(&channels, buffer->data + 22, sizeof(channels));
+    memcpy(&data_size, buffer->data + 40, sizeof(data_size));
+    size_t frame_bytes = (channels == 1 || channels == 2) ? channels * sizeof(int16_t) : 0;
+    // An unsupported header needs no more bytes: the decoder rejects it
+    buffer->needed = frame_bytes ? CORPUS_IO_WAV_HEADER + data_size / frame_bytes * frame_bytes : buffer->len;
+    if (buffer->needed > buffer->capacity) {
+        unsigned char* grown = realloc(buffer->data, buffer->needed);
+        if (grown) {
+            buffer->data = grown;
+            buffer->capacity = buffer->needed;
+        } else {
+            buffer->needed = buffer->len;  // Decoded as far as it got, which fails like a short file
+        }
+    }
+}
+
+static void on_completion(uring_reader_t* reader, uint64_t user_data, int res) {
+    io_batch_t* batch = reader->batch;
+    int index = (int)(user_data >> 2);
+    int op = (int)(user_data & 3);
+    io_buffer_t* buffer = &batch->buffers[index];
+    reader->ops_in_flight--;
+    switch (op) {
+    case URING_OP_OPEN:
+        if (res < 0) {
+            fprintf(stderr, "Error: Could not open WAV file %s\n", batch->files[index].path);
+            drop_file(reader, index);
+            return;
+        }
+        buffer->fd = res;
+        queue_read(reader, index);
+        return;
+    case URING_OP_READ:
+        // End of file or a read error: hand over what arrived and let the decoder report a short file
+        if (res <= 0) {
+            finish_read(reader, index);
+            return;
+        }
+        buffer->len += (size_t)res;
+        if (!buffer->needed && buffer->len >= CORPUS_IO_WAV_HEADER) size_from_header(buffer);
+        if ((buffer->needed && buffer->len >= buffer->needed) || buffer->len == buffer->capacity) {
+            finish_read(reader, index);
+        } else {
+            queue_read(reader, index);
+        }
+        return;
+    default:
+        return;  // Close: nothing left to do
+    }
+}
+
+/**
+ * @brief Reads every file through the ring on the calling thread; the decode workers are already running.
+ * @return 0, or -1 if the ring failed (remaining files are reported as failed).
+ */
+static int uring_read_all(uring_reader_t* reader, int queue_depth) {
+    io_batch_t* batch = reader->batch;
+    int next = 0;
+    int status = 0;
+    int batch_size = queue_depth >= 4 ? queue_depth / 4 : 1;
+    while (next < batch->num_files || reader->ops_in_flight > 0) {
+        // Start files while fewer than queue_depth are being read or waiting for a worker. When the workers are the
+        // bottleneck, wait until a quarter of the slots are free, so opens are still submitted in batches.
+        pthread_mutex_lock(&batch->lock);
+        int room = queue_depth - batch->outstanding;
+        if (room < batch_size && next < batch->num_files) {
+            if (reader->ops_in_flight == 0) {
+                while (queue_depth - batch->outstanding < batch_size) pthread_cond_wait(&batch->progress, &batch->lock);
+                room = queue_depth - batch->outstanding;
+            } else {
+                room = 0;
+            }
+        }
+        pthread_mutex_unlock(&batch->lock);
+        for (; room > 0 && next < batch->num_files; room--) start_file(reader, next++);
+        if (reader->ops_in_flight == 0) continue;
+
+        atomic_fetch_add(&batch->syscalls, 1);
+        if (uring_enter(&reader->ring, 1) != 0) {
+            fprintf(stderr, "Error: io_uring_enter failed (%s)\n", strerror(errno));
+            status = -1;
+            break;
+        }
+        unsigned head = *reader->ring.cq_head;
+        unsigned tail = __atomic_load_n(reader->ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            const struct io_uring_cqe* cqe = &reader->ring.cqes[head & *reader->ring.cq_mask];
+            on_completion(reader, cqe->user_data, cqe->res);
+        }
+        __atomic_store_n(reader->ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+    if (status != 0) atomic_store(&batch->failed, 1);
+    return status;
+}
+#endif
+
+/**
+ * @brief Reads and decodes the recordings of a corpus in parallel.
+ * @param options NULL for the defaults.
+ * @param stats Optional; receives the mode used, bytes read, syscall count and wall time.
+ * @return 0 on success, -1 if any recording failed.
+ */
+int corpus_io_load_files(corpus_file_t* files, int num_files, const corpus_io_options_t* options, corpus_io_stats_t* stats) {
+    corpus_io_options_t defaults;
+    if (!options) {
+        corpus_io_options_default(&defaults);
+        options = &defaults;
+    }
+    uint64_t start = tap_clock_now_ns();
+    int threads = options->threads > 0 ? options->threads : online_cpu_count();
+    if (threads > CORPUS_IO_MAX_THREADS) threads = CORPUS_IO_MAX_THREADS;
+    if (threads > num_files) threads = num_files > 0 ? num_files : 1;
+    int queue_depth = options->queue_depth > 0 ? options->queue_depth : CORPUS_IO_QUEUE_DEPTH;
+
+    io_batch_t batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.files = files;
+    batch.num_files = num_files;
+    batch.buffers = calloc(num_files > 0 ? num_files : 1, sizeof(io_buffer_t));
+    batch.ready = malloc((num_files > 0 ? num_files : 1) * sizeof(int));
+    if (!batch.buffers || !batch.ready) {
+        fprintf(stderr, "Error: Memory allocation failed for the corpus reader.\n");
+        free(batch.buffers);
+        free(batch.ready);
+        return -1;
+    }
+    atomic_init(&batch.next_file, 0);
+    atomic_init(&batch.failed, 0);
+    atomic_init(&batch.syscalls, 0);
+    atomic_init(&batch.bytes, 0);
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_cond_init(&batch.work_ready, NULL);
+    pthread_cond_init(&batch.progress, NULL);
+
+    corpus_io_mode_e mode = options->mode == CORPUS_IO_AUTO ? CORPUS_IO_URING : options->mode;
+#ifdef __linux__
+    uring_reader_t reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.batch = &batch;
+    reader.ring.fd = -1;
+    // Each file in flight has at most one open or read plus one close queued, and starts add one more
+    if (mode == CORPUS_IO_URING && uring_init(&reader.ring, (unsigned)queue_depth * 4) != 0) {
+        if (options->mode == CORPUS_IO_URING) fprintf(stderr, "Warning: io_uring is not available; reading with pread\n");
+        mode = CORPUS_IO_PREAD;
+    }
+#else
+    if (mode == CORPUS_IO_URING && options->mode == CORPUS_IO_URING) {
+        fprintf(stderr, "Warning: io_uring is not available; reading with pread\n");
+    }
+    mode = CORPUS_IO_PREAD;
+#endif
+    batch.read_in_workers = (mode == CORPUS_IO_PREAD);
+
+    pthread_t workers[CORPUS_IO_MAX_THREADS];
+    int started = 0;
+    for (; started < threads; started++) {
+        if (pthread_create(&workers[started], NULL, decode_worker, &batch) != 0) break;
+    }
+#ifdef __linux__
+    if (mode == CORPUS_IO_URING && started == 0) {
+        // Without a worker the ring would fill up with undecoded files: read and decode on this thread instead
+        uring_exit(&reader.ring);
+        mode = CORPUS_IO_PREAD;
+        batch.read_in_workers = true;
+    }
+    if (mode == CORPUS_IO_URING) {
+        uring_read_all(&reader, queue_depth);
+        uring_exit(&reader.ring);
+        pthread_mutex_lock(&batch.lock);
+        batch.reading_done = true;
+        pthread_cond_broadcast(&batch.work_ready);
+        pthread_mutex_unlock(&batch.lock);
+    }
+#endif
+    if (started == 0) decode_worker(&batch);  // Could not spawn any thread: read and decode on the caller's thread
+    for (int t = 0; t < started; t++) pthread_join(workers[t], NULL);
+
+    for (int i = 0; i < num_files; i++) free(batch.buffers[i].data);
+    free(batch.buffers);
+    free(batch.ready);
+    pthread_cond_destroy(&batch.progress);
+    pthread_cond_destroy(&batch.work_ready);
+    pthread_mutex_destroy(&batch.lock);
+    if (stats) {
+        stats->mode = mode;
+        stats->files = num_files;
+        stats->bytes = atomic_load(&batch.bytes);
+        stats->syscalls = atomic_load(&batch.syscalls);
+        stats->seconds = (double)(tap_clock_now_ns() - start) * 1e-9;
+    }
+    return atomic_load(&batch.failed) ? -1 : 0;
+}
@@ -0,0 +1,47 @@
+#ifndef CORPUS_IO_H
+#define CORPUS_IO_H
+#include <stdint.h>
+
+#include "corpus.h"
+
+// --- Batched Recording Reader ---
+// Loads the recordings of a corpus manifest without paying one blocking open/read/close round trip per file.
+// On Linux the reading thread drives an io_uring (raw syscalls, no liburing): it keeps up to queue_depth files in
+// flight, each as an open -> read(s) -> close sequence of ring operations, and submits and reaps a whole batch with
+// one io_uring_enter() call. Every completely read file goes to a pool of worker threads that decode it to Q2.29
+// and hash it, while the ring keeps reading. Where io_uring is unavailable (old kernel, seccomp, other platforms)
+// the workers read the files themselves with open/pread/close, so the reads still overlap.
+
+typedef enum
+{
+    CORPUS_IO_AUTO = 0, // io_uring when the kernel supports it, pread otherwise
+    CORPUS_IO_URING,
+    CORPUS_IO_PREAD,
+    CORPUS_IO_MODE_COUNT
+} corpus_io_mode_e;
+
+typedef struct corpus_io_options_s
+{
+    corpus_io_mode_e mode;
+    int              threads;     /* Decode workers, 0 for the online CPUs. */
+    int              queue_depth; /* Files read concurrently through the ring. */
+} corpus_io_options_t;
+
+typedef struct corpus_io_stats_s
+{
+    corpus_io_mode_e mode;        /* Mode actually used. */
+    int              files;
+    uint64_t         bytes;       /* File bytes read. */
+    long             syscalls;    /* io_uring_enter() calls, or open/pread/close calls of the fallback. */
+    double           seconds;
+} corpus_io_stats_t;
+
+void        corpus_io_options_default(corpus_io_options_t* options);
+const char* corpus_io_mode_name(corpus_io_mode_e mode);
+int         corpus_io_mode_parse(const char* name, corpus_io_mode_e* mode);
+
+// Reads and decodes files[i].path into owned_data/mic1/mic2/samplerate/num_samples/content_hash for every file.
+// Returns 0, or -1 if any recording failed (reported on stderr; the others may already be loaded).
+int corpus_io_load_files(corpus_file_t* files, int num_files, const corpus_io_options_t* options, corpus_io_stats_t* stats);
+
+#endif // !CORPUS_IO_H
@@ -1,23 +1,25 @@
 #include <stdio.h>    // For console I/O (printf, fprintf)
-#include <stdlib.h>   // For memory allocation (malloc, free), random numbers (rand, srand)
+#include <stdlib.h>   // For memory allocation (malloc, free)
 #include <stdint.h>   // For fixed-size integer types (uint32_t, int16_t, int32_t, int64_t)
-#include <string.h>   // For strncpy
+#include <string.h>   // For strcmp
 #include <math.h>     // For round()
 #include <limits.h>   // For INT16_MAX, INT16_MIN, INT32_MAX, INT32_MIN
-#include <time.h>     // For time() to seed random number generator
 
 #include "tap_detect.h" // Include the custom tap detection header
-
-// --- Fixed-Point Configuration ---
-// We'll use Q2.29 fixed-point format for 32-bit processing.
-// This means: 1 sign bit, 2 integer bits, 29 fractional bits.
-// The value range for a Q2.29 fixed_point_t (int32_t) is approximately -4.0 to +3.999...
-// This provides sufficient headroom for audio processing (audio typically normalized to -1.0 to 1.0).
-#define Q_FORMAT Q_BITS // Using Q_BITS from tap_detect.h for consistency (29)
-#define FIXED_POINT_ONE Q_ONE // Using Q_ONE from tap_detect.h for consistency (1 << 29)
-
-// Define the fixed_point_t type as a signed 32-bit integer for processing
-typedef int32_t fixed_point_t;
+#include "wav_io.h"     // WAV file reading/writing in Q2.29 fixed-point
+#include "tap_tune.h"   // Parameter auto-tuner over a labelled corpus
+#include "corpus_cache.h" // Decoded corpus cache
+#include "tap_synth.h"  // Deterministic synthetic tap recordings
+#include "tap_pipeline.h" // Read, detect, log and write path of the CLI
+#include "tap_opcount.h"  // Operation counts of the instrumented build
+#include "tap_stage_timer.h" // Per-stage timings of the instrumented build
+#include "tap_trace.h"    // Post-mortem trace of the detector state
+#include "tap_features.h" // Per-block feature traces
+#include "tap_memory.h"   // Memory footprint report
+#include "tap_stream.h"   // Real-time processing of raw PCM streams
+#include "tap_server.h"   // Multi-stream detection server
+#include "tap_replay.h"   // Device fleet replay against the server
+#include "tap_shm.h"      // Shared-memory ingest ring
 
 // --- Fixed-Point Utility Functions ---
 // Convert a float to fixed-point (Q_FORMAT)
@@ -56,235 +58,154 @@ fixed_point_t fixed_point_add(fixed_point_t a, fixed_point_t b) {
     return (fixed_point_t)sum;
 }
 
-// --- WAV Header Structure ---
-// Defines the standard RIFF WAV file header for 16-bit PCM mono audio.
-typedef struct {
-    char     riff[4];        // "RIFF" chunk ID
-    uint32_t overall_size;   // Size of the entire file in bytes minus 8 bytes
-    char     wave[4];        // "WAVE" format
-    char     fmt_chunk_marker[4]; // "fmt " subchunk 1 ID
-    uint32_t fmt_chunk_size; // Size of the fmt subchunk (16 for PCM)
-    uint16_t audio_format;   // Audio format (1 for PCM)
-    uint16_t num_channels;   // Number of channels (1 for mono, 2 for stereo)
-    uint32_t sample_rate;    // Sample rate in Hz
-    uint32_t byte_rate;      // Byte rate = sample_rate * num_channels * bits_per_sample/8
-    uint16_t block_align;    // Block align = num_channels * bits_per_sample/8
-    uint16_t bits_per_sample;// Bits per sample (16 for 16-bit PCM)
-    char     data_chunk_marker[4]; // "data" subchunk 2 ID
-    uint32_t data_size;      // Size of the data section in bytes
-} WavHeader;
-
-/**
- * @brief Reads 16-bit PCM mono audio data from a WAV file into a dynamically allocated fixed-point array (Q2.29).
- * @param filepath The path to the input WAV file.
- * @param samplerate_out Pointer to a uint32_t to store the sample rate read from the header.
- * @param num_samples_out Pointer to a long to store the total number of audio samples read.
- * @return A pointer to a newly allocated int32_t array containing the fixed-point audio data,
- * or NULL if an error occurs. The caller is responsible for freeing this memory.
- * Assumptions: Input WAV is 16-bit PCM, mono.
- */
-fixed_point_t* read_wav_data_fx(const char* filepath, uint32_t* samplerate_out, long* num_samples_out) {
-    FILE* file = fopen(filepath, "rb");
-    if (!file) {
-        fprintf(stderr, "Error: Could not open WAV file %s\n", filepath);
-        return NULL;
+// --- Main application function ---
+// This main function demonstrates how to process a WAV file frame by frame for tap detection.
+// Compile: gcc main.c tap_detect.c wav_io.c corpus.c corpus_cache.c corpus_io.c result_cache.c tap_augment.c tap_clock.c tap_opcount.c tap_pipeline.c tap_async.c tap_replay.c tap_rt.c tap_stage_timer.c tap_synth.c tap_trace.c tap_features.c tap_memory.c tap_metrics.c tap_server.c tap_shm.c tap_stream.c tap_tune.c -o tap_detector -lm -pthread
+// Run: ./tap_detector input_audio.wav [--metrics] [--trace trace.bin] [--trace-seconds 16]
+//      ./tap_detector input_audio.wav --features features.tfeat
+//      ./tap_detector --trace-print trace.bin
+//      ./tap_detector --features-scan features.tfeat... [--threshold 0.03]
+//      ./tap_detector --memory [--budget 1536]
+//      arecord -f S16_LE -c 2 -r 48000 -t raw | ./tap_detector --stream [--input -|fifo|unix:socket] [--json]
+//      ./tap_detector --serve unix:/tmp/tap.sock|tcp:7878 [--workers N] [--duration S]
+//      ./tap_detector --replay tcp:7878 rec.wav... [--devices N] [--jitter-ms J] [--loss P] [--server-pid PID]
+//      ./tap_detector --shm-ingest /dev/shm/tap.ring [--slots N]  and  ./tap_detector --shm-feed /dev/shm/tap.ring input.wav
+//      ./tap_detector --evaluate corpus_manifest.txt [--result-cache results.bin]
+//      ./tap_detector --tune corpus_manifest.txt [options]
+//      ./tap_detector --build-cache corpus_manifest.txt corpus.cache
+//      ./tap_detector --synth synthetic.wav --seed 1 --duration 600 --labels corpus_manifest.txt
+//      ./tap_detector --opcount input_audio.wav [--costs add=1,load=2] (build with -DTAP_DETECT_OPCOUNT)
+//      ./tap_detector --stage-times input_audio.wav... (build with -DTAP_DETECT_STAGE_TIMING)
+int main(int argc, char *argv[]) {
+    // Check command line arguments
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <input_wav_file> [--metrics] [--trace <trace_file>] [--trace-seconds N] [--features <feature_file>]\n", argv[0]);
+        fprintf(stderr, "       %s --tune <corpus_manifest|corpus_cache> [options]\n", argv[0]);
+        fprintf(stderr, "       %s --evaluate <corpus_manifest|corpus_cache> [options]\n", argv[0]);
+        fprintf(stderr, "       %s --build-cache <corpus_manifest> <cache_file>\n", argv[0]);
+        fprintf(stderr, "       %s --synth <output_wav|-|--detect> [options]\n", argv[0]);
+        fprintf(stderr, "       %s --opcount <input_wav> [options]\n", argv[0]);
+        fprintf(stderr, "       %s --stage-times <input_wav>... [options]\n", argv[0]);
+        fprintf(stderr, "       %s --trace-print <trace_file>\n", argv[0]);
+        fprintf(stderr, "       %s --features-scan <feature_file>... [--threshold X]\n", argv[0]);
+        fprintf(stderr, "       %s --memory [--budget BYTES]\n", argv[0]);
+        fprintf(stderr, "       %s --stream [--input -|PATH|unix:PATH] [options]\n", argv[0]);
+        fprintf(stderr, "       %s --serve unix:PATH|tcp:PORT [options]\n", argv[0]);
+        fprintf(stderr, "       %s --replay unix:PATH|tcp:PORT rec.wav... [options]\n", argv[0]);
+        fprintf(stderr, "       %s --shm-ingest RING [--slots N] | --shm-feed RING input.wav [--realtime]\n", argv[0]);
+        return 1;
     }
-
-    WavHeader header;
-    if (fread(&header, 1, sizeof(WavHeader), file) != sizeof(WavHeader)) {
-        fprintf(stderr, "Error: Could not read full WAV header from %s\n", filepath);
-        fclose(file);
-        return NULL;
+    if (strcmp(argv[1], "--tune") == 0) {
+        return tap_tune_cli(argc, argv);
     }
-
-    // Validate WAV format
-    if (strncmp(header.riff, "RIFF", 4) != 0 || strncmp(header.wave, "WAVE", 4) != 0 ||
-        strncmp(header.fmt_chunk_marker, "fmt ", 4) != 0 || strncmp(header.data_chunk_marker, "data", 4) != 0 ||
-        header.audio_format != 1 || header.num_channels != 1 || header.bits_per_sample != 16) {
-        fprintf(stderr, "Error: Unsupported WAV format. Requires 16-bit PCM mono. %s\n", filepath);
-        fclose(file);
-        return NULL;
+    if (strcmp(argv[1], "--evaluate") == 0) {
+        return corpus_evaluate_cli(argc, argv);
     }
-
-    *samplerate_out = header.sample_rate;
-    *num_samples_out = header.data_size / (header.bits_per_sample / 8);
-
-    fixed_point_t* audio_data_fx = (fixed_point_t*)malloc(*num_samples_out * sizeof(fixed_point_t));
-    if (!audio_data_fx) {
-        fprintf(stderr, "Error: Memory allocation failed for fixed-point audio data.\n");
-        fclose(file);
-        return NULL;
+    if (strcmp(argv[1], "--build-cache") == 0) {
+        return corpus_cache_cli(argc, argv);
     }
-
-    int16_t sample_int;
-    for (long i = 0; i < *num_samples_out; ++i) {
-        if (fread(&sample_int, sizeof(int16_t), 1, file) != 1) {
-             fprintf(stderr, "Error: Could not read sample %ld from WAV file.\n", i);
-             free(audio_data_fx);
-             fclose(file);
-             return NULL;
-        }
-        // Convert int16_t sample (Q0.15) to Q2.29 fixed-point.
-        // Shift left by (Q_FORMAT - 15) = (29 - 15) = 14 bits.
-        audio_data_fx[i] = ((fixed_point_t)sample_int << (Q_FORMAT - 15));
+    if (strcmp(argv[1], "--synth") == 0) {
+        return tap_synth_cli(argc, argv);
     }
-
-    fclose(file);
-    return audio_data_fx;
-}
-
-/**
- * @brief Writes a fixed-point (Q2.29) audio array to a 16-bit PCM mono WAV file.
- * @param filepath The path to the output WAV file.
- * @param audio_data_fx Pointer to the fixed-point audio data (normalized to [-Q_ONE, Q_ONE]).
- * @param num_samples The number of samples in the audio_data_fx array.
- * @param samplerate The sample rate of the audio in Hz.
- * Assumptions: Output WAV will be 16-bit PCM, mono.
- */
-void write_wav_data_fx(const char* filepath, const fixed_point_t* audio_data_fx, long num_samples, uint32_t samplerate) {
-    FILE* file = fopen(filepath, "wb");
-    if (!file) {
-        fprintf(stderr, "Error: Could not open file for writing %s\n", filepath);
-        return;
+    if (strcmp(argv[1], "--opcount") == 0) {
+        return tap_opcount_cli(argc, argv);
     }
-
-    WavHeader header;
-    // Fill in RIFF, WAVE, fmt, and data chunk markers
-    strncpy(header.riff, "RIFF", 4);
-    strncpy(header.wave, "WAVE", 4);
-    strncpy(header.fmt_chunk_marker, "fmt ", 4);
-    strncpy(header.data_chunk_marker, "data", 4);
-
-    // Set format parameters
-    header.audio_format = 1;      // PCM
-    header.num_channels = 1;      // Mono
-    header.sample_rate = samplerate;
-    header.bits_per_sample = 16;  // 16 bits per sample
-    header.byte_rate = header.sample_rate * header.num_channels * (header.bits_per_sample / 8);
-    header.block_align = header.num_channels * (header.bits_per_sample / 8);
-    header.fmt_chunk_size = 16;   // Size of the fmt subchunk for PCM
-    header.data_size = num_samples * header.num_channels * (header.bits_per_sample / 8);
-    header.overall_size = header.data_size + 36; // 36 bytes = size of header without data_size
-
-    // Write the WAV header to the file
-    fwrite(&header, 1, sizeof(WavHeader), file);
-
-    // Convert fixed-point samples back to 16-bit integers and write them
-    int16_t sample_int;
-    for (long i = 0; i < num_samples; ++i) {
-        // Convert Q2.29 fixed-point to 16-bit signed int (Q0.15)
-        // Shift right by (Q_FORMAT - 15) = (29 - 15) = 14 bits.
-        int32_t temp_val = audio_data_fx[i] >> (Q_FORMAT - 15);
-
-        // Clip to [-32768, 32767] range of int16_t.
-        if (temp_val > INT16_MAX) sample_int = INT16_MAX;
-        else if (temp_val < INT16_MIN) sample_int = INT16_MIN;
-        else sample_int = (int16_t)temp_val;
-
-        fwrite(&sample_int, sizeof(int16_t), 1, file);
+    if (strcmp(argv[1], "--stage-times") == 0) {
+        return tap_stage_timer_cli(argc, argv);
     }
-
-    fclose(file);
-}
-
-// --- Main application function ---
-// This main function demonstrates how to process a WAV file frame by frame for tap detection.
-// Compile: gcc audio_processor.c tap_detect.c -o tap_detector -lm
-// Run: ./tap_detector input_audio.wav
-int main(int argc, char *argv[]) {
-    // Seed the random number generator for the dummy tap detector
-    srand(time(NULL));
-
-    // Check command line arguments
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <input_wav_file>\n", argv[0]);
-        return 1;
+    if (strcmp(argv[1], "--trace-print") == 0) {
+        return tap_trace_print_cli(argc, argv);
     }
-    const char* input_wav_filepath = argv[1];
-    const char* output_binary_wav_filepath = "tap_detection_output.wav"; // Output file name
-
-    uint32_t samplerate;
-    long total_num_samples;
-    // Read the entire WAV file into a dynamically allocated buffer.
-    fixed_point_t* full_audio_data = read_wav_data_fx(input_wav_filepath, &samplerate, &total_num_samples);
-    if (!full_audio_data) {
-        fprintf(stderr, "Failed to load audio from %s. Exiting.\n", input_wav_filepath);
-        return 1;
+    if (strcmp(argv[1], "--features-scan") == 0) {
+        return tap_features_scan_cli(argc, argv);
     }
-
-    // Dynamically allocate a buffer for the binary tap detection output signal.
-    // This buffer will be filled with Q_ONE (1.0), Q_ONE/2 (0.5), or 0 based on detection.
-    fixed_point_t* tap_detection_output_fx = (fixed_point_t*)calloc(total_num_samples, sizeof(fixed_point_t));
-    if (!tap_detection_output_fx) {
-        fprintf(stderr, "Error: Memory allocation failed for tap_detection_output_fx buffer.\n");
-        free(full_audio_data);
-        return 1;
+    if (strcmp(argv[1], "--memory") == 0) {
+        return tap_memory_cli(argc, argv);
     }
+    if (strcmp(argv[1], "--stream") == 0) {
+        return tap_stream_cli(argc, argv);
+    }
+    if (strcmp(argv[1], "--serve") == 0) {
+        return tap_server_cli(argc, argv);
+    }
+    if (strcmp(argv[1], "--replay") == 0) {
+        return tap_replay_cli(argc, argv);
+    }
+    if (strcmp(argv[1], "--shm-ingest") == 0 || strcmp(argv[1], "--shm-feed") == 0) {
+        return tap_shm_cli(argc, argv);
+    }
+    const char* input_wav_filepath = argv[1];
+    const char* output_binary_wav_filepath = "tap_detection_output.wav"; // Output file name
 
-    printf("Processing WAV file: %s (Samplerate: %u Hz, Total Samples: %ld)\n",
-           input_wav_filepath, samplerate, total_num_samples);
-    printf("--- Tap Detection Log by Frame ---\n");
-    // MAX_AUDIO_FRAME_SIZE should be defined in tap_detect.h, assuming a value for now if not present.
-    // If MAX_AUDIO_FRAME_SIZE is not defined in tap_detect.h, please add it there.
-    // For this example, let's assume a default if it's not available yet.
-    #ifndef MAX_AUDIO_FRAME_SIZE
-    #define MAX_AUDIO_FRAME_SIZE 256 // Default frame size if not defined in tap_detect.h
-    #endif
-    printf("Frame Size: %d samples\n", MAX_AUDIO_FRAME_SIZE);
-    printf("----------------------------------\n");
-    printf("Frame | Start Time (s) | Tap Detected?\n");
-    printf("----------------------------------\n");
-
-    long frame_count = 0;
-    // Iterate through the full audio data in chunks (frames)
-    for (long current_sample_idx = 0; current_sample_idx < total_num_samples; current_sample_idx += MAX_AUDIO_FRAME_SIZE) {
-        long current_frame_len = MAX_AUDIO_FRAME_SIZE;
-        // Adjust frame length for the last chunk if it's smaller than MAX_AUDIO_FRAME_SIZE
-        if (current_sample_idx + current_frame_len > total_num_samples) {
-            current_frame_len = total_num_samples - current_sample_idx;
+    int print_metrics = 0;
+    const char* trace_path = NULL;
+    const char* features_path = NULL;
+    double trace_seconds = 16.0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--metrics") == 0) {
+            print_metrics = 1;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--features") == 0 && i + 1 < argc) {
+            features_path = argv[++i];
+        } else if (strcmp(argv[i], "--trace-seconds") == 0 && i + 1 < argc) {
+            trace_seconds = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+            return 1;
         }
+    }
 
-        // Check if the remaining frame is too small
-        if (current_frame_len < 2) { // Need at least 2 samples for DWT in a real scenario
-            break;
+    // Trace ring sized for the requested seconds at 48 kHz, rounded up to a power of two
+    tap_trace_t trace;
+    tap_trace_record_t* trace_records = NULL;
+    uint32_t trace_blocks = (uint32_t)(trace_seconds * 48000.0 / MAX_AUDIO_FRAME_SIZE + 0.5);
+    if (trace_path) {
+        uint32_t capacity = 1;
+        while (capacity < trace_blocks && capacity < (1u << 24)) capacity <<= 1;
+        trace_records = (tap_trace_record_t*)malloc(capacity * sizeof(tap_trace_record_t));
+        if (!trace_records || tap_trace_init(&trace, trace_records, capacity) != 0) {
+            fprintf(stderr, "Error: Memory allocation failed for the trace buffer.\n");
+            free(trace_records);
+            return 1;
         }
+    }
 
-        // Call the tap detection function for the current frame
-        tap_detection_result_e tap_detected_in_this_frame = tap_detect_status(
-                                                                &full_audio_data[current_sample_idx],
-                                                                &full_audio_data[current_sample_idx], // Dummy: second arg (processed_frame_out) not used by dummy
-                                                                current_frame_len);
-
-        // Log the result for the current frame
-        printf("%5ld | %14.3f | %d\n",
-               frame_count++,
-               (float)current_sample_idx / samplerate,
-               tap_detected_in_this_frame);
-
-        // Fill the output binary WAV buffer for this frame based on the enum result
-        fixed_point_t mapped_fill_value = 0; // Default to NO_TAP (0)
-        if (tap_detected_in_this_frame == TAP_SINGLE) {
-            mapped_fill_value = 1 << 16; // Represents 0.5 (half full scale)
-        } else if (tap_detected_in_this_frame == TAP_DOUBLE) {
-            mapped_fill_value = 1 << 31; // Represents 1.0 (full scale)
+    // Read, detect, log to stdout and write the binary detection signal
+    tap_features_writer_t features;
+    tap_features_writer_init(&features);
+    // --metrics also runs the shadow search behind lost_to_cooldown; it does not change the detections
+    tap_detect_config_t cfg;
+    tap_detect_config_default(&cfg);
+    cfg.shadow_search = print_metrics;
+    tap_pipeline_hooks_t hooks = { trace_path ? &trace : NULL, features_path ? &features : NULL, &cfg };
+    tap_pipeline_stats_t stats;
+    if (tap_pipeline_run(input_wav_filepath, output_binary_wav_filepath, stdout, &hooks, &stats) != 0) {
+        free(trace_records);
+        tap_features_writer_free(&features);
+        return 1;
+    }
+    if (features_path) {
+        int saved = tap_features_writer_save(&features, features_path, stats.samplerate);
+        tap_features_writer_free(&features);
+        if (saved != 0) {
+            free(trace_records);
+            return 1;
         }
-        // You can use different mapping for other enum values if you extend it
-        // else if (tap_detected_in_this_frame == TRIPLE_TAP) { ... }
-
-        for (long i = 0; i < current_frame_len; ++i) {
-            tap_detection_output_fx[current_sample_idx + i] = mapped_fill_value;
+    }
+    if (trace_path) {
+        uint32_t dump_blocks = (uint32_t)(trace_seconds * stats.samplerate / MAX_AUDIO_FRAME_SIZE + 0.5);
+        int dumped = tap_trace_dump(&trace, trace_path, dump_blocks > 0 ? dump_blocks : 1);
+        free(trace_records);
+        if (dumped < 0) return 1;
+        fprintf(stderr, "Trace: last %d blocks written to %s\n", dumped, trace_path);
+    }
+    // Detector counters go to stderr so the per-frame log on stdout stays unchanged
+    if (print_metrics) {
+        const uint32_t* fields = (const uint32_t*)&stats.metrics;
+        for (int i = 0; i < (int)TAP_DETECT_METRICS_FIELDS; i++) {
+            fprintf(stderr, "%-16s %u\n", tap_detect_metrics_name(i), fields[i]);
         }
     }
-    printf("----------------------------------\n");
-
-    // --- Write the binary tap detection output to a WAV file ---
-    write_wav_data_fx(output_binary_wav_filepath, tap_detection_output_fx, total_num_samples, samplerate);
-    printf("Binary tap detection output saved to: %s\n", output_binary_wav_filepath);
-
-    // Free all dynamically allocated buffers
-    free(full_audio_data);
-    free(tap_detection_output_fx);
-    printf("Processing complete.\n");
-
     return 0;
 }
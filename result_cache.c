@@ -0,0 +1,345 @@
+#include <stdio.h>    // For file I/O
+#include <stdlib.h>   // For memory allocation
+#include <string.h>   // For memcpy, memcmp, memset
+#include <pthread.h>  // For the table mutex
+#ifdef _WIN32
+#include <io.h>       // For _chsize_s, _fileno
+#else
+#include <unistd.h>   // For ftruncate
+#endif
+
+#include "result_cache.h"
+
+#define RECORD_MAGIC      (0x52534C54u) /* "TLSR" little-endian. */
+#define MAX_EVENTS_RECORD (1 << 24)     /* sanity bound while loading. */
+
+// On-disk record header, followed by num_events record_event_t.
+typedef struct {
+    uint32_t magic;
+    uint32_t version;          // TAP_DETECT_VERSION that produced the events
+    uint64_t audio_hash;
+    uint64_t config_hash;
+    uint32_t num_events;
+    uint32_t events_checksum;  // Low 32 bits of the hash of the event payload
+} record_header_t;
+
+typedef struct {
+    uint32_t block;
+    uint32_t origin_block;
+    uint32_t type;
+} record_event_t;
+
+typedef struct {
+    uint64_t     audio_hash;
+    uint64_t     config_hash;
+    tap_event_t* events;
+    int          num_events;
+    int          used;
+} cache_slot_t;
+
+struct result_cache {
+    FILE*           file;      // Opened for appending new records
+    cache_slot_t*   slots;     // Open addressing, linear probing, power-of-two size
+    size_t          num_slots;
+    size_t          num_entries;
+    long            hits;
+    long            misses;
+    pthread_mutex_t lock;
+};
+
+// --- Hashing ---
+// 64-bit multiply/xor-shift hash over 8-byte words. Not cryptographic; collisions only matter for accidental
+// equality of two different recordings or configurations, which at 64 bits is negligible for any corpus size.
+
+static uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t result_cache_hash_bytes(const void* data, size_t len, uint64_t seed) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t h = seed ^ (len * 0x9E3779B97F4A7C15ull);
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        h = (h ^ mix64(word)) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+        p += 8;
+        len -= 8;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p, len);
+    h ^= mix64(tail ^ len);
+    return mix64(h);
+}
+
+uint64_t result_cache_hash_config(const tap_detect_config_t* cfg) {
+    // Hash the fields explicitly so struct padding never leaks into the key; frame size and Q format change results too.
+    // shadow_search only adds a metric and is left out.
+    int32_t fields[6] = { cfg->threshold_min, cfg->threshold_max, cfg->cooldown_blocks, cfg->double_tap_window_blocks,
+                          MAX_AUDIO_FRAME_SIZE, Q_BITS };
+    return result_cache_hash_bytes(fields, sizeof(fields), 0x7A9D1C0FFEEull);
+}
+
+// --- In-Memory Table ---
+
+static size_t slot_index(const result_cache_t* cache, uint64_t audio_hash, uint64_t config_hash) {
+    return (size_t)(mix64(audio_hash ^ (config_hash * 0x9E3779B97F4A7C15ull)) & (cache->num_slots - 1));
+}
+
+static cache_slot_t* find_slot(result_cache_t* cache, uint64_t audio_hash, uint64_t config_hash) {
+    size_t i = slot_index(cache, audio_hash, config_hash);
+    while (cache->slots[i].used) {
+        if (cache->slots[i].audio_hash == audio_hash && cache->slots[i].config_hash == config_hash) break;
+        i = (i + 1) & (cache->num_slots - 1);
+    }
+    return &cache->slots[i];
+}
+
+static int grow_table(result_cache_t* cache) {
+    size_t new_num_slots = cache->num_slots ? cache->num_slots * 2 : 1024;
+    cache_slot_t* new_slots = (cache_slot_t*)calloc(new_num_slots, sizeof(cache_slot_t));
+    if (!new_slots) return -1;
+
+    cache_slot_t* old_slots = cache->slots;
+    size_t old_num_slots = cache->num_slots;
+    cache->slots = new_slots;
+    cache->num_slots = new_num_slots;
+    for (size_t i = 0; i < old_num_slots; i++) {
+        if (old_slots[i].used) {
+            *find_slot(cache, old_slots[i].audio_hash, old_slots[i].config_hash) = old_slots[i];
+        }
+    }
+    free(old_slots);
+    return 0;
+}
+
+// Inserts or replaces an entry. Takes ownership of events.
+static int table_put(result_cache_t* cache, uint64_t audio_hash, uint64_t config_hash, tap_event_t* events, int num_events) {
+    if ((cache->num_entries + 1) * 10 > cache->num_slots * 7 && grow_table(cache) != 0) {
+        free(events);
+        return -1;
+    }
+    cache_slot_t* slot = find_slot(cache, audio_hash, config_hash);
+    if (slot->used) {
+        free(slot->events);
+    } else {
+        cache->num_entries++;
+    }
+    slot->audio_hash = audio_hash;
+    slot->config_hash = config_hash;
+    slot->events = events;
+    slot->num_events = num_events;
+    slot->used = 1;
+    return 0;
+}
+
+// --- Loading ---
+
+static int load_records(result_cache_t* cache, FILE* file, long* valid_len_out) {
+    long valid_len = (long)strlen(RESULT_CACHE_MAGIC);
+    record_header_t header;
+    while (fread(&header, sizeof(header), 1, file) == 1) {
+        if (header.magic != RECORD_MAGIC || header.num_events > MAX_EVENTS_RECORD) break;
+
+        size_t payload = header.num_events * sizeof(record_event_t);
+        record_event_t* raw = (record_event_t*)malloc(payload > 0 ? payload : 1);
+        if (!raw) return -1;
+        if (payload > 0 && fread(raw, payload, 1, file) != 1) {
+            free(raw);
+            break;
+        }
+        if ((uint32_t)result_cache_hash_bytes(raw, payload, 0) != header.events_checksum) {
+            free(raw);
+            break;
+        }
+
+        // Records of other detector versions stay in the file but can never match
+        if (header.version == TAP_DETECT_VERSION) {
+            tap_event_t* events = NULL;
+            if (header.num_events > 0) {
+                events = (tap_event_t*)malloc(header.num_events * sizeof(tap_event_t));
+                if (!events) {
+                    free(raw);
+                    return -1;
+                }
+                for (uint32_t e = 0; e < header.num_events; e++) {
+                    events[e].block = raw[e].block;
+                    events[e].origin_block = raw[e].origin_block;
+                    events[e].type = (tap_detection_result_e)raw[e].type;
+                }
+            }
+            if (table_put(cache, header.audio_hash, header.config_hash, events, (int)header.num_events) != 0) {
+                free(raw);
+                return -1;
+            }
+        }
+        free(raw);
+        valid_len += (long)(sizeof(header) + payload);
+    }
+    *valid_len_out = valid_len;
+    return 0;
+}
+
+static int truncate_file(const char* path, long length) {
+    FILE* file = fopen(path, "r+b");
+    if (!file) return -1;
+#ifdef _WIN32
+    int status = _chsize_s(_fileno(file), length) == 0 ? 0 : -1;
+#else
+    int status = ftruncate(fileno(file), length) == 0 ? 0 : -1;
+#endif
+    fclose(file);
+    return status;
+}
+
+/**
+ * @brief Opens (or creates) a result cache file and loads its records.
+ * @return The cache, or NULL if the file cannot be read or created.
+ */
+result_cache_t* result_cache_open(const char* path) {
+    result_cache_t* cache = (result_cache_t*)calloc(1, sizeof(result_cache_t));
+    if (!cache || grow_table(cache) != 0) {
+        fprintf(stderr, "Error: Memory allocation failed for result cache.\n");
+        free(cache);
+        return NULL;
+    }
+    pthread_mutex_init(&cache->lock, NULL);
+
+    size_t magic_len = strlen(RESULT_CACHE_MAGIC);
+    FILE* existing = fopen(path, "rb");
+    if (existing) {
+        char magic[8];
+        long valid_len = 0;
+        int status = 0;
+        if (fread(magic, 1, magic_len, existing) != magic_len || memcmp(magic, RESULT_CACHE_MAGIC, magic_len) != 0) {
+            fprintf(stderr, "Error: %s is not a result cache file\n", path);
+            status = -1;
+        } else if (load_records(cache, existing, &valid_len) != 0) {
+            fprintf(stderr, "Error: Memory allocation failed while loading result cache %s\n", path);
+            status = -1;
+        }
+        fseek(existing, 0, SEEK_END);
+        long file_len = ftell(existing);
+        fclose(existing);
+
+        if (status == 0 && file_len > valid_len) {
+            fprintf(stderr, "Warning: Dropping %ld bytes of incomplete records at the end of %s\n", file_len - valid_len, path);
+            if (truncate_file(path, valid_len) != 0) status = -1;
+        }
+        if (status != 0) {
+            result_cache_close(cache);
+            return NULL;
+        }
+        cache->file = fopen(path, "ab");
+    } else {
+        cache->file = fopen(path, "wb");
+        if (cache->file && fwrite(RESULT_CACHE_MAGIC, 1, magic_len, cache->file) != magic_len) {
+            fclose(cache->file);
+            cache->file = NULL;
+        }
+    }
+
+    if (!cache->file) {
+        fprintf(stderr, "Error: Could not open result cache %s for writing\n", path);
+        result_cache_close(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void result_cache_close(result_cache_t* cache) {
+    if (!cache) return;
+    if (cache->file) fclose(cache->file);
+    for (size_t i = 0; i < cache->num_slots; i++) {
+        free(cache->slots[i].events);
+    }
+    free(cache->slots);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+/**
+ * @brief Looks up the events of a (recording, configuration) pair.
+ * @param events_out Receives a newly allocated copy of the events on a hit (NULL if there are none).
+ * @return 1 on a hit, 0 on a miss, -1 on allocation failure.
+ */
+int result_cache_lookup(result_cache_t* cache, uint64_t audio_hash, uint64_t config_hash, tap_event_t** events_out, int* num_events_out) {
+    pthread_mutex_lock(&cache->lock);
+    const cache_slot_t* slot = find_slot(cache, audio_hash, config_hash);
+    int status = 0;
+    if (slot->used) {
+        tap_event_t* copy = NULL;
+        if (slot->num_events > 0) {
+            copy = (tap_event_t*)malloc(slot->num_events * sizeof(tap_event_t));
+            if (copy) memcpy(copy, slot->events, slot->num_events * sizeof(tap_event_t));
+        }
+        if (slot->num_events > 0 && !copy) {
+            status = -1;
+        } else {
+            *events_out = copy;
+            *num_events_out = slot->num_events;
+            status = 1;
+            cache->hits++;
+        }
+    } else {
+        cache->misses++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return status;
+}
+
+/**
+ * @brief Adds the events of a (recording, configuration) pair to the table and appends them to the file.
+ * @return 0 on success, -1 on failure.
+ */
+int result_cache_store(result_cache_t* cache, uint64_t audio_hash, uint64_t config_hash, const tap_event_t* events, int num_events) {
+    size_t payload = (size_t)num_events * sizeof(record_event_t);
+    record_event_t* raw = (record_event_t*)malloc(payload > 0 ? payload : 1);
+    tap_event_t* copy = num_events > 0 ? (tap_event_t*)malloc(num_events * sizeof(tap_event_t)) : NULL;
+    if (!raw || (num_events > 0 && !copy)) {
+        free(raw);
+        free(copy);
+        return -1;
+    }
+    for (int e = 0; e < num_events; e++) {
+        raw[e].block = (uint32_t)events[e].block;
+        raw[e].origin_block = (uint32_t)events[e].origin_block;
+        raw[e].type = (uint32_t)events[e].type;
+        copy[e] = events[e];
+    }
+
+    record_header_t header;
+    header.magic = RECORD_MAGIC;
+    header.version = TAP_DETECT_VERSION;
+    header.audio_hash = audio_hash;
+    header.config_hash = config_hash;
+    header.num_events = (uint32_t)num_events;
+    header.events_checksum = (uint32_t)result_cache_hash_bytes(raw, payload, 0);
+
+    pthread_mutex_lock(&cache->lock);
+    int status = 0;
+    if (fwrite(&header, sizeof(header), 1, cache->file) != 1 ||
+        (payload > 0 && fwrite(raw, payload, 1, cache->file) != 1) ||
+        fflush(cache->file) != 0) {
+        fprintf(stderr, "Error: Could not append to result cache.\n");
+        status = -1;
+    }
+    if (table_put(cache, audio_hash, config_hash, copy, num_events) != 0) status = -1;
+    pthread_mutex_unlock(&cache->lock);
+
+    free(raw);
+    return status;
+}
+
+void result_cache_stats(result_cache_t* cache, long* hits_out, long* misses_out, long* entries_out) {
+    pthread_mutex_lock(&cache->lock);
+    *hits_out = cache->hits;
+    *misses_out = cache->misses;
+    *entries_out = (long)cache->num_entries;
+    pthread_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,31 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+#include <stdint.h>
+#include <stddef.h>
+
+#include "tap_detect.h"
+#include "corpus.h"
+
+// --- Detector Result Cache ---
+// Persists the event list of every (recording, configuration) pair that has been evaluated, keyed by
+// (audio content hash, detector config hash, TAP_DETECT_VERSION). A re-evaluation only runs the detector on
+// pairs it has not seen; everything else is scored from the cached events.
+//
+// The store is a single append-only file of checksummed records, loaded into an in-memory hash table on open.
+// A torn record at the end (e.g., after a crash) is dropped and the file is truncated before appending.
+// Lookups and inserts are serialised by a mutex, so one cache can be shared by several evaluation threads.
+
+#define RESULT_CACHE_MAGIC "TAPRSLT1"
+
+typedef struct result_cache result_cache_t;
+
+uint64_t result_cache_hash_bytes(const void* data, size_t len, uint64_t seed);
+uint64_t result_cache_hash_config(const tap_detect_config_t* cfg);
+
+result_cache_t* result_cache_open(const char* path);
+void result_cache_close(result_cache_t* cache);
+int  result_cache_lookup(result_cache_t* cache, uint64_t audio_hash, uint64_t config_hash, tap_event_t** events_out, int* num_events_out);
+int  result_cache_store(result_cache_t* cache, uint64_t audio_hash, uint64_t config_hash, const tap_event_t* events, int num_events);
+void result_cache_stats(result_cache_t* cache, long* hits_out, long* misses_out, long* entries_out);
+
+#endif // !RESULT_CACHE_H
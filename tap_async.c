@@ -0,0 +1,189 @@
+#include <stdio.h>    // For error messages
+#include <stdlib.h>   // For malloc, realloc, free
+#include <string.h>   // For memset, strerror
+#include <errno.h>    // For EINTR
+#ifndef _WIN32
+#include <poll.h>     // For poll
+#endif
+
+#include "tap_async.h"
+#include "tap_clock.h"
+
+void tap_async_executor_init(tap_async_executor_t* executor) {
+    memset(executor, 0, sizeof(*executor));
+}
+
+void tap_async_executor_free(tap_async_executor_t* executor) {
+    free(executor->poll_fds);
+    memset(executor, 0, sizeof(*executor));
+}
+
+void tap_async_wake(tap_async_task_t* task) {
+    if (task == NULL || task->queued || task->done) return;
+    tap_async_executor_t* executor = task->executor;
+    task->queued = true;
+    task->next_ready = NULL;
+    if (executor->ready_tail) {
+        executor->ready_tail->next_ready = task;
+    } else {
+        executor->ready_head = task;
+    }
+    executor->ready_tail = task;
+}
+
+void tap_async_spawn(tap_async_executor_t* executor, tap_async_task_t* task,
+                     tap_async_status_e (*resume)(tap_async_task_t* task), void* arg) {
+    memset(task, 0, sizeof(*task));
+    task->resume = resume;
+    task->arg = arg;
+    task->wait_fd = -1;
+    task->executor = executor;
+    task->next_task = executor->tasks;
+    executor->tasks = task;
+    executor->live++;
+    tap_async_wake(task);
+}
+
+static tap_async_task_t* pop_ready(tap_async_executor_t* executor) {
+    tap_async_task_t* task = executor->ready_head;
+    if (task) {
+        executor->ready_head = task->next_ready;
+        if (!executor->ready_head) executor->ready_tail = NULL;
+        task->queued = false;
+    }
+    return task;
+}
+
+/**
+ * @brief Waits until at least one task suspended on a descriptor can continue, and wakes those tasks.
+ * @return The number of tasks waiting on descriptors (0: nothing left to wait for), -1 if poll() failed.
+ */
+static int poll_descriptors(tap_async_executor_t* executor) {
+    int count = 0;
+    for (tap_async_task_t* task = executor->tasks; task; task = task->next_task) {
+        if (!task->done && !task->queued && task->wait_fd >= 0) count++;
+    }
+    if (count == 0) return 0;
+#ifdef _WIN32
+    // No poll() for arbitrary descriptors: the waiting tasks retry their reads and writes
+    for (tap_async_task_t* task = executor->tasks; task; task = task->next_task) {
+        if (!task->done && !task->queued && task->wait_fd >= 0) {
+            task->wait_fd = -1;
+            tap_async_wake(task);
+        }
+    }
+    return count;
+#else
+    if (count > executor->poll_capacity) {
+        void* grown = realloc(executor->poll_fds, (size_t)count * sizeof(struct pollfd));
+        if (!grown) {
+            fprintf(stderr, "Error: Memory allocation failed for %d poll descriptors\n", count);
+            return -1;
+        }
+        executor->poll_fds = grown;
+        executor->poll_capacity = count;
+    }
+    struct pollfd* fds = executor->poll_fds;
+    int n = 0;
+    for (tap_async_task_t* task = executor->tasks; task; task = task->next_task) {
+        if (task->done || task->queued || task->wait_fd < 0) continue;
+        fds[n].fd = task->wait_fd;
+        fds[n].events = (short)(((task->wait_events & TAP_ASYNC_IN) ? POLLIN : 0) | ((task->wait_events & TAP_ASYNC_OUT) ? POLLOUT : 0));
+        fds[n].revents = 0;
+        n++;
+    }
+    while (poll(fds, (nfds_t)n, -1) < 0) {
+        if (errno != EINTR) {
+            fprintf(stderr, "Error: poll failed (%s)\n", strerror(errno));
+            return -1;
+        }
+    }
+    // Same order as above; errors and hang-ups wake the task too, so it sees them on its next read or write
+    n = 0;
+    for (tap_async_task_t* task = executor->tasks; task; task = task->next_task) {
+        if (task->done || task->queued || task->wait_fd < 0) continue;
+        if (fds[n++].revents != 0) {
+            task->wait_fd = -1;
+            tap_async_wake(task);
+        }
+    }
+    return count;
+#endif
+}
+
+int tap_async_run(tap_async_executor_t* executor) {
+    while (executor->live > 0) {
+        tap_async_task_t* task;
+        while ((task = pop_ready(executor)) != NULL) {
+            task->wait_fd = -1;  // Set again by TAP_ASYNC_AWAIT_FD if the task suspends on a descriptor
+            uint64_t start_ns = tap_clock_now_ns();
+            tap_async_status_e status = task->resume(task);
+            task->busy_ns += tap_clock_now_ns() - start_ns;
+            if (status == TAP_ASYNC_DONE) {
+                task->done = true;
+                executor->live--;
+            } else if (status == TAP_ASYNC_READY) {
+                tap_async_wake(task);
+            }
+        }
+        if (executor->live == 0) break;
+        int waiting = poll_descriptors(executor);
+        if (waiting < 0) return -1;
+        if (waiting == 0) {
+            fprintf(stderr, "Error: %d task(s) wait on each other\n", executor->live);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// --- Channels ---
+
+int tap_async_chan_init(tap_async_chan_t* chan, size_t item_size, unsigned capacity) {
+    memset(chan, 0, sizeof(*chan));
+    chan->items = malloc(item_size * capacity);
+    if (!chan->items) return -1;
+    chan->item_size = item_size;
+    chan->capacity = capacity;
+    return 0;
+}
+
+void tap_async_chan_free(tap_async_chan_t* chan) {
+    free(chan->items);
+    chan->items = NULL;
+}
+
+void tap_async_chan_connect(tap_async_chan_t* chan, tap_async_task_t* producer, tap_async_task_t* consumer) {
+    chan->producer = producer;
+    chan->consumer = consumer;
+}
+
+void* tap_async_chan_slot(tap_async_chan_t* chan) {
+    if (chan->count == chan->capacity) return NULL;
+    return chan->items + (size_t)((chan->head + chan->count) % chan->capacity) * chan->item_size;
+}
+
+void tap_async_chan_push(tap_async_chan_t* chan) {
+    chan->count++;
+    tap_async_wake(chan->consumer);
+}
+
+void tap_async_chan_close(tap_async_chan_t* chan) {
+    chan->closed = true;
+    tap_async_wake(chan->consumer);
+}
+
+void* tap_async_chan_peek(tap_async_chan_t* chan) {
+    if (chan->count == 0) return NULL;
+    return chan->items + (size_t)chan->head * chan->item_size;
+}
+
+void tap_async_chan_pop(tap_async_chan_t* chan) {
+    chan->head = (chan->head + 1) % chan->capacity;
+    chan->count--;
+    tap_async_wake(chan->producer);
+}
+
+bool tap_async_chan_drained(const tap_async_chan_t* chan) {
+    return chan->closed && chan->count == 0;
+}
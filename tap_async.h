@@ -0,0 +1,131 @@
+#ifndef TAP_ASYNC_H
+#define TAP_ASYNC_H
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// --- Cooperative Stage Executor ---
+// Runs many small processing stages on one thread without callbacks. A stage is a stackless coroutine in the
+// protothread style: a function that is resumed from where it last returned, keeping its state in its own struct
+// (locals do not survive a suspension point). Stages hand fixed-size items to each other through bounded channels;
+// a stage that finds its input empty or its output full suspends, and the channel wakes it when that changes.
+// A stage waiting for a file descriptor suspends on it and the executor polls all such descriptors once nothing
+// else can run, so a slow source never stalls the stages of other streams on the same executor. For more threads,
+// run one executor per thread; a channel connects two stages of the same executor.
+//
+//   static tap_async_status_e count_stage(tap_async_task_t* task) {
+//       counter_t* c = task->arg;
+//       TAP_ASYNC_BEGIN(task);
+//       for (c->i = 0; c->i < 10; c->i++) {
+//           TAP_ASYNC_AWAIT(task, (c->slot = tap_async_chan_slot(&c->out)) != NULL);
+//           *(int*)c->slot = c->i;
+//           tap_async_chan_push(&c->out);
+//       }
+//       tap_async_chan_close(&c->out);
+//       TAP_ASYNC_END(task);
+//   }
+
+typedef enum
+{
+    TAP_ASYNC_READY = 0, // Suspended but runnable, e.g. after a yield
+    TAP_ASYNC_WAITING,   // Suspended until a channel or the polled descriptor wakes it
+    TAP_ASYNC_DONE
+} tap_async_status_e;
+
+#define TAP_ASYNC_IN  (1) /* Wait until the descriptor is readable. */
+#define TAP_ASYNC_OUT (2) /* Wait until the descriptor is writable. */
+
+typedef struct tap_async_task_s     tap_async_task_t;
+typedef struct tap_async_executor_s tap_async_executor_t;
+
+struct tap_async_task_s
+{
+    tap_async_status_e (*resume)(tap_async_task_t* task);
+    void*    arg;
+    int      line;        /* Resume point, 0 before the first run. */
+    int      wait_fd;     /* Descriptor the task is suspended on, -1 for none. */
+    int      wait_events; /* TAP_ASYNC_IN and/or TAP_ASYNC_OUT. */
+    bool     queued;
+    bool     done;
+    uint64_t busy_ns;     /* Time spent inside resume(). */
+    tap_async_executor_t* executor;
+    tap_async_task_t*     next_ready;
+    tap_async_task_t*     next_task;
+};
+
+struct tap_async_executor_s
+{
+    tap_async_task_t* ready_head;
+    tap_async_task_t* ready_tail;
+    tap_async_task_t* tasks;     /* Every spawned task, for the descriptor scan. */
+    int               live;      /* Spawned tasks that are not done. */
+    void*             poll_fds;  /* Scratch array for poll(), grown on demand. */
+    int               poll_capacity;
+};
+
+// Bounded single-producer, single-consumer queue of fixed-size items between two stages of one executor.
+typedef struct
+{
+    unsigned char*    items;
+    size_t            item_size;
+    unsigned          capacity;
+    unsigned          head;
+    unsigned          count;
+    bool              closed;   /* The producer is done; the consumer drains what is left. */
+    tap_async_task_t* producer;
+    tap_async_task_t* consumer;
+} tap_async_chan_t;
+
+// --- Coroutine Macros ---
+// The body of a stage goes between TAP_ASYNC_BEGIN and TAP_ASYNC_END. Suspension points are cases of a switch on
+// task->line, so there may be at most one per source line and none inside another switch statement.
+#if defined(__GNUC__) && __GNUC__ >= 7
+#define TAP_ASYNC_FALLTHROUGH __attribute__((fallthrough))
+#else
+#define TAP_ASYNC_FALLTHROUGH ((void)0)
+#endif
+
+#define TAP_ASYNC_BEGIN(task) switch ((task)->line) { case 0:
+#define TAP_ASYNC_END(task)   } (task)->line = -1; return TAP_ASYNC_DONE
+
+// Lets the other runnable tasks go first.
+#define TAP_ASYNC_YIELD(task) \
+    do { (task)->line = __LINE__; return TAP_ASYNC_READY; case __LINE__:; } while (0)
+
+// Suspends until cond holds; cond is re-evaluated whenever a channel of the task wakes it.
+#define TAP_ASYNC_AWAIT(task, cond) \
+    do { (task)->line = __LINE__; TAP_ASYNC_FALLTHROUGH; case __LINE__: if (!(cond)) return TAP_ASYNC_WAITING; } while (0)
+
+// Suspends until fd is ready for events (TAP_ASYNC_IN / TAP_ASYNC_OUT).
+#define TAP_ASYNC_AWAIT_FD(task, fd, events) \
+    do { (task)->wait_fd = (fd); (task)->wait_events = (events); (task)->line = __LINE__; return TAP_ASYNC_WAITING; \
+         case __LINE__:; } while (0)
+
+void tap_async_executor_init(tap_async_executor_t* executor);
+void tap_async_executor_free(tap_async_executor_t* executor);
+
+// Registers a task and makes it runnable; the task struct must outlive the run.
+void tap_async_spawn(tap_async_executor_t* executor, tap_async_task_t* task,
+                     tap_async_status_e (*resume)(tap_async_task_t* task), void* arg);
+
+// Runs until every task is done. Returns 0, or -1 if the remaining tasks wait on each other or polling failed.
+int tap_async_run(tap_async_executor_t* executor);
+
+// Makes a suspended task runnable again.
+void tap_async_wake(tap_async_task_t* task);
+
+int  tap_async_chan_init(tap_async_chan_t* chan, size_t item_size, unsigned capacity);
+void tap_async_chan_free(tap_async_chan_t* chan);
+void tap_async_chan_connect(tap_async_chan_t* chan, tap_async_task_t* producer, tap_async_task_t* consumer);
+
+// Producer: fill the slot returned by tap_async_chan_slot() (NULL while full), then push it; close when done.
+void* tap_async_chan_slot(tap_async_chan_t* chan);
+void  tap_async_chan_push(tap_async_chan_t* chan);
+void  tap_async_chan_close(tap_async_chan_t* chan);
+
+// Consumer: use the item returned by tap_async_chan_peek() (NULL while empty), then pop it.
+void* tap_async_chan_peek(tap_async_chan_t* chan);
+void  tap_async_chan_pop(tap_async_chan_t* chan);
+bool  tap_async_chan_drained(const tap_async_chan_t* chan);
+
+#endif // !TAP_ASYNC_H
@@ -0,0 +1,176 @@
+#include <stdio.h>    // For error messages, snprintf
+#include <stdlib.h>   // For strtod
+#include <string.h>   // For strncmp, strlen, memset
+
+#include "tap_augment.h"
+#include "result_cache.h"
+
+// Augmented samples saturate at +/-2.0 so the detector's (mic1 + mic2) sum cannot overflow 32 bits.
+#define AUGMENT_SAT_MAX ((int64_t)(1L << (Q_BITS + 1)) - 1)
+#define AUGMENT_SAT_MIN (-(int64_t)(1L << (Q_BITS + 1)))
+
+static const struct {
+    const char*      name;
+    tap_augment_op_e type;
+} op_names[] = {
+    { "gain", TAP_AUGMENT_GAIN }, { "dc", TAP_AUGMENT_DC }, { "noise", TAP_AUGMENT_NOISE },
+    { "clip", TAP_AUGMENT_CLIP }, { "shift", TAP_AUGMENT_SHIFT }, { "delay", TAP_AUGMENT_DELAY },
+};
+
+/**
+ * @brief Parses a chain spec such as "gain=0.5,noise=0.002,shift=96". An empty spec is the identity chain.
+ * @return 0 on success, -1 on a syntax error (reported on stderr).
+ */
+int tap_augment_parse(tap_augment_chain_t* chain, const char* spec) {
+    memset(chain, 0, sizeof(*chain));
+    snprintf(chain->spec, sizeof(chain->spec), "%s", spec);
+
+    const char* p = spec;
+    while (*p) {
+        size_t name_len = strcspn(p, "=,");
+        int type = -1;
+        for (size_t i = 0; i < sizeof(op_names) / sizeof(op_names[0]); i++) {
+            if (strlen(op_names[i].name) == name_len && strncmp(p, op_names[i].name, name_len) == 0) type = (int)op_names[i].type;
+        }
+        if (type < 0 || p[name_len] != '=') {
+            fprintf(stderr, "Error: Invalid augmentation '%.*s' in '%s'\n", (int)strcspn(p, ","), p, spec);
+            return -1;
+        }
+        char* end = NULL;
+        double value = strtod(p + name_len + 1, &end);
+        if (end == p + name_len + 1 || (*end != ',' && *end != '\0')) {
+            fprintf(stderr, "Error: Invalid value for '%.*s' in '%s'\n", (int)name_len, p, spec);
+            return -1;
+        }
+        if (chain->num_ops == TAP_AUGMENT_MAX_OPS) {
+            fprintf(stderr, "Error: More than %d augmentations in '%s'\n", TAP_AUGMENT_MAX_OPS, spec);
+            return -1;
+        }
+        if ((type == TAP_AUGMENT_CLIP || type == TAP_AUGMENT_NOISE) && value < 0.0) {
+            fprintf(stderr, "Error: '%.*s' must not be negative in '%s'\n", (int)name_len, p, spec);
+            return -1;
+        }
+        chain->ops[chain->num_ops].type = (tap_augment_op_e)type;
+        chain->ops[chain->num_ops].value = value;
+        chain->num_ops++;
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return 0;
+}
+
+// Identifies the chain in the result cache; the identity chain hashes to 0.
+uint64_t tap_augment_hash(const tap_augment_chain_t* chain) {
+    if (!chain || chain->num_ops == 0) return 0;
+    uint64_t hash = 0x5EED5EEDull;
+    for (int i = 0; i < chain->num_ops; i++) {
+        int32_t type = (int32_t)chain->ops[i].type;
+        hash = result_cache_hash_bytes(&type, sizeof(type), hash);
+        hash = result_cache_hash_bytes(&chain->ops[i].value, sizeof(double), hash);
+    }
+    return hash;
+}
+
+// Position of output sample 0 in the source recording, for mapping events back onto the labels.
+long tap_augment_sample_offset(const tap_augment_chain_t* chain) {
+    long shift = 0;
+    for (int i = 0; chain && i < chain->num_ops; i++) {
+        if (chain->ops[i].type == TAP_AUGMENT_SHIFT) shift += (long)chain->ops[i].value;
+    }
+    return shift;
+}
+
+/**
+ * @brief Starts replaying a recording through a chain. The source arrays are read in place and must outlive src.
+ * @param chain The chain, or NULL to replay the recording unchanged.
+ * @param seed Seeds the noise transforms; use a per-recording value so every file gets its own noise.
+ */
+void tap_augment_source_init(tap_augment_source_t* src, const tap_augment_chain_t* chain,
+                             const fixed_point_t* mic1, const fixed_point_t* mic2, long num_samples, uint64_t seed) {
+    memset(src, 0, sizeof(*src));
+    src->chain = chain;
+    src->mic1 = mic1;
+    src->mic2 = mic2;
+    src->num_samples = num_samples;
+    src->shift = tap_augment_sample_offset(chain);
+
+    long delay = 0;
+    for (int i = 0; chain && i < chain->num_ops; i++) {
+        if (chain->ops[i].type == TAP_AUGMENT_DELAY) delay += (long)chain->ops[i].value;
+    }
+    src->mic1_delay = delay < 0 ? -delay : 0;
+    src->mic2_delay = delay > 0 ? delay : 0;
+    src->out_samples = num_samples - src->shift;
+    if (src->out_samples < 0) src->out_samples = 0;
+    tap_rng_seed(&src->rng, seed);
+}
+
+// Copies out[0..len) = in[first..first+len), zero outside [0, num_samples).
+static void read_shifted(int* out, const fixed_point_t* in, long num_samples, long first, int len) {
+    for (int i = 0; i < len; i++) {
+        long idx = first + i;
+        out[i] = (idx >= 0 && idx < num_samples) ? in[idx] : 0;
+    }
+}
+
+static int saturate(int64_t value) {
+    if (value > AUGMENT_SAT_MAX) return (int)AUGMENT_SAT_MAX;
+    if (value < AUGMENT_SAT_MIN) return (int)AUGMENT_SAT_MIN;
+    return (int)value;
+}
+
+/**
+ * @brief Produces the next frame of the augmented stream.
+ * @return The number of samples written to each mic buffer (at most max_len), 0 at the end of the stream.
+ */
+int tap_augment_next_frame(tap_augment_source_t* src, int* mic1_out, int* mic2_out, int max_len) {
+    long remaining = src->out_samples - src->position;
+    int len = remaining < max_len ? (int)remaining : max_len;
+    if (len <= 0) return 0;
+
+    long base = src->position + src->shift;
+    read_shifted(mic1_out, src->mic1, src->num_samples, base - src->mic1_delay, len);
+    read_shifted(mic2_out, src->mic2, src->num_samples, base - src->mic2_delay, len);
+    src->position += len;
+
+    const tap_augment_chain_t* chain = src->chain;
+    for (int o = 0; chain && o < chain->num_ops; o++) {
+        const tap_augment_op_t* op = &chain->ops[o];
+        switch (op->type) {
+        case TAP_AUGMENT_GAIN: {
+            int64_t gain_q = (int64_t)(op->value * Q_ONE);
+            for (int i = 0; i < len; i++) {
+                mic1_out[i] = saturate((mic1_out[i] * gain_q) >> Q_BITS);
+                mic2_out[i] = saturate((mic2_out[i] * gain_q) >> Q_BITS);
+            }
+            break;
+        }
+        case TAP_AUGMENT_DC: {
+            int64_t dc_q = (int64_t)(op->value * Q_ONE);
+            for (int i = 0; i < len; i++) {
+                mic1_out[i] = saturate(mic1_out[i] + dc_q);
+                mic2_out[i] = saturate(mic2_out[i] + dc_q);
+            }
+            break;
+        }
+        case TAP_AUGMENT_NOISE: {
+            float rms_q = (float)(op->value * Q_ONE);
+            for (int i = 0; i < len; i++) {
+                mic1_out[i] = saturate(mic1_out[i] + (int64_t)(tap_rng_gauss(&src->rng) * rms_q));
+                mic2_out[i] = saturate(mic2_out[i] + (int64_t)(tap_rng_gauss(&src->rng) * rms_q));
+            }
+            break;
+        }
+        case TAP_AUGMENT_CLIP: {
+            int limit = saturate((int64_t)(op->value * Q_ONE));
+            for (int i = 0; i < len; i++) {
+                mic1_out[i] = FX_CLIP(mic1_out[i], -limit, limit);
+                mic2_out[i] = FX_CLIP(mic2_out[i], -limit, limit);
+            }
+            break;
+        }
+        default:
+            break; // Time transforms are applied through the read positions above
+        }
+    }
+    return len;
+}
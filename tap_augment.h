@@ -0,0 +1,72 @@
+#ifndef TAP_AUGMENT_H
+#define TAP_AUGMENT_H
+#include <stdint.h>
+
+#include "tap_detect.h"
+#include "tap_synth.h"
+#include "wav_io.h"
+
+// --- Streaming Augmentation ---
+// Replays a decoded recording under a chain of transforms, frame by frame, without materialising the augmented
+// signal. Time transforms (shift, inter-mic delay) only move read positions in the source arrays; value transforms
+// are applied in chain order to each frame as it is produced. A chain is written as a comma separated spec:
+//
+//     gain=0.5,dc=0.01,noise=0.002,clip=0.25,shift=96,delay=2
+//
+//     gain=G    multiply both mics by G
+//     dc=D      add D (Q2.29 float units) to both mics
+//     noise=R   add independent Gaussian noise of RMS R to each mic (seeded per recording)
+//     clip=L    saturate both mics to [-L, L]
+//     shift=N   start N samples later in the recording (N < 0 prepends |N| samples of silence),
+//               which moves the recording against the frame grid
+//     delay=N   delay mic2 by N samples relative to mic1 (N < 0 delays mic1)
+
+#define TAP_AUGMENT_MAX_OPS (16)
+
+typedef enum
+{
+    TAP_AUGMENT_GAIN = 0,
+    TAP_AUGMENT_DC,
+    TAP_AUGMENT_NOISE,
+    TAP_AUGMENT_CLIP,
+    TAP_AUGMENT_SHIFT,
+    TAP_AUGMENT_DELAY
+} tap_augment_op_e;
+
+typedef struct
+{
+    tap_augment_op_e type;
+    double           value;
+} tap_augment_op_t;
+
+typedef struct tap_augment_chain
+{
+    tap_augment_op_t ops[TAP_AUGMENT_MAX_OPS];
+    int              num_ops;
+    char             spec[256]; // Original spec, for reports
+} tap_augment_chain_t;
+
+// Frame source over one recording.
+typedef struct
+{
+    const tap_augment_chain_t* chain;
+    const fixed_point_t*       mic1;
+    const fixed_point_t*       mic2;
+    long                       num_samples;   // Source length
+    long                       shift;         // Output sample i reads source sample i + shift
+    long                       mic1_delay;
+    long                       mic2_delay;
+    long                       out_samples;   // Length of the augmented stream
+    long                       position;      // Next output sample
+    tap_rng_t                  rng;
+} tap_augment_source_t;
+
+int      tap_augment_parse(tap_augment_chain_t* chain, const char* spec);
+uint64_t tap_augment_hash(const tap_augment_chain_t* chain);
+long     tap_augment_sample_offset(const tap_augment_chain_t* chain);
+
+void tap_augment_source_init(tap_augment_source_t* src, const tap_augment_chain_t* chain,
+                             const fixed_point_t* mic1, const fixed_point_t* mic2, long num_samples, uint64_t seed);
+int  tap_augment_next_frame(tap_augment_source_t* src, int* mic1_out, int* mic2_out, int max_len);
+
+#endif // !TAP_AUGMENT_H
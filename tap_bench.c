@@ -0,0 +1,437 @@
+#include <stdio.h>    // For console output
+#include <stdlib.h>   // For memory allocation, qsort, atoi
+#include <string.h>   // For strcmp, strstr, memset
+
+#include "tap_bench.h"
+#include "tap_clock.h"
+#include "tap_detect.h"
+#include "tap_perf.h"
+#include "tap_stage_timer.h"
+#include "tap_synth.h"
+
+// --- Detector Stage Microbenchmarks ---
+// Times every stage of tap_detect_process() in isolation and the whole block path, on inputs that drive the
+// detector through its idle, start-up cooldown, post-tap cooldown and worst-case (peak on every other cD1
+// coefficient) paths.
+// Each case runs warm-up repetitions first, then times repetitions of a batch of blocks and reports the
+// median, 99th percentile and minimum time per block over the repetitions. With --perf, hardware counters
+// (see tap_perf.h) are collected over the timed repetitions and reported per block, with IPC and branch-miss rate.
+//
+// Compile: gcc -O2 tap_bench.c tap_bench_e2e.c tap_bench_wcet.c tap_clock.c tap_perf.c tap_pipeline.c tap_async.c tap_stage_timer.c tap_trace.c tap_features.c tap_detect.c wav_io.c corpus.c corpus_cache.c corpus_io.c result_cache.c tap_augment.c tap_synth.c -o tap_bench -lm -pthread
+// Run: ./tap_bench [options]
+//      ./tap_bench --e2e [options]
+//      ./tap_bench --wcet [options]
+//      ./tap_bench --stage-times recording.wav...
+
+#define BENCH_INPUT_BLOCKS   (64)   /* distinct input blocks cycled through by every case. */
+#define BENCH_DEFAULT_REPS   (200)
+#define BENCH_DEFAULT_WARMUP (20)
+#define BENCH_DEFAULT_BATCH  (1024) /* blocks per timed repetition. */
+#define BENCH_SEED           (0x7A9B0001ull)
+
+typedef enum
+{
+    BENCH_INPUT_IDLE = 0, // Low-level noise, no cD1 coefficient reaches the threshold
+    BENCH_INPUT_COOLDOWN, // Peak-rich input while the detector is held in start-up cooldown
+    BENCH_INPUT_POST_TAP, // Peak-rich input in a post-tap cooldown
+    BENCH_INPUT_SHADOW,   // The same with the opt-in shadow peak search (cfg.shadow_search) enabled
+    BENCH_INPUT_PEAKS,    // Every other cD1 coefficient is a local maximum within the thresholds
+    BENCH_INPUT_COUNT
+} bench_input_e;
+
+static const char* const input_names[BENCH_INPUT_COUNT] = { "idle", "cooldown", "post-tap", "shadow", "peaks" };
+
+typedef struct
+{
+    int mic1[BENCH_INPUT_BLOCKS][MAX_AUDIO_FRAME_SIZE];
+    int mic2[BENCH_INPUT_BLOCKS][MAX_AUDIO_FRAME_SIZE];
+    int mixed[BENCH_INPUT_BLOCKS][MAX_AUDIO_FRAME_SIZE];
+    int cd1[BENCH_INPUT_BLOCKS][MAX_CD1_LEN];
+    int cd_len;
+    int num_peaks[BENCH_INPUT_BLOCKS];
+} bench_data_t;
+
+typedef struct
+{
+    int                reps;
+    int                warmup;
+    int                batch;
+    const char*        filter;
+    const char*        format;
+    int                perf;
+    tap_detect_config_t cfg;
+} bench_options_t;
+
+typedef struct
+{
+    const char* stage;
+    const char* input;
+    double      median_ns;
+    double      p99_ns;
+    double      min_ns;
+    double      samples_per_s;
+    int         has_counter[TAP_PERF_COUNT];
+    double      counter_per_block[TAP_PERF_COUNT];
+} bench_result_t;
+
+typedef struct
+{
+    const bench_data_t* data;
+    tap_detect_ctx_t    ctx;
+    int                 out[MAX_AUDIO_FRAME_SIZE];
+    int                 cd_len;
+} bench_state_t;
+
+typedef void (*bench_fn)(bench_state_t* state, int block);
+
+static volatile int bench_sink; // Keeps results observable so the measured work is not optimised away
+
+// --- Statistics ---
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+void tap_bench_sort(double* values, int count) {
+    qsort(values, count, sizeof(double), compare_double);
+}
+
+// Nearest-rank percentile of a sorted array.
+double tap_bench_percentile(const double* sorted, int count, double p) {
+    int rank = (int)(p * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+// --- Inputs ---
+
+static void bench_data_init(bench_data_t* data, bench_input_e input, const tap_detect_config_t* cfg) {
+    tap_rng_t rng;
+    tap_rng_seed(&rng, BENCH_SEED + (uint64_t)input);
+
+    // Between the thresholds, so both range comparisons pass and only the neighbour comparison decides
+    int high = cfg->threshold_min + (int)(((int64_t)cfg->threshold_max - cfg->threshold_min) * 3 / 4);
+    int low = cfg->threshold_min + (int)(((int64_t)cfg->threshold_max - cfg->threshold_min) / 4);
+
+    for (int b = 0; b < BENCH_INPUT_BLOCKS; b++) {
+        for (int n = 0; n < MAX_AUDIO_FRAME_SIZE; n++) {
+            if (input == BENCH_INPUT_IDLE) {
+                data->mic1[b][n] = (int)(tap_rng_gauss(&rng) * 0.002f * Q_ONE);
+                data->mic2[b][n] = (int)(tap_rng_gauss(&rng) * 0.002f * Q_ONE);
+            } else {
+                // cD1[k] = x[2k+1] - x[2k] alternates between high and low, so every even k is a peak
+                int k = n >> 1;
+                int value = (n & 1) ? ((k & 1) ? low : high) : 0;
+                data->mic1[b][n] = value;
+                data->mic2[b][n] = value;
+            }
+        }
+        tap_detect_mix_mics(data->mic1[b], data->mic2[b], data->mixed[b], MAX_AUDIO_FRAME_SIZE);
+        tap_detect_haar_dwt_l1(data->mixed[b], MAX_AUDIO_FRAME_SIZE, data->cd1[b], &data->cd_len);
+        data->num_peaks[b] = 0;
+        int num_candidates = 0, num_rejected = 0;
+        tap_detect_find_peaks(data->cd1[b], data->cd_len, cfg->threshold_min, cfg->threshold_max, &data->num_peaks[b],
+                              &num_candidates, &num_rejected, NULL);
+    }
+}
+
+// --- Cases ---
+
+static void bench_mix(bench_state_t* state, int block) {
+    tap_detect_mix_mics(state->data->mic1[block], state->data->mic2[block], state->out, MAX_AUDIO_FRAME_SIZE);
+    bench_sink = state->out[block];
+}
+
+static void bench_haar(bench_state_t* state, int block) {
+    tap_detect_haar_dwt_l1(state->data->mixed[block], MAX_AUDIO_FRAME_SIZE, state->out, &state->cd_len);
+    bench_sink = state->out[block];
+}
+
+static void bench_find_peaks(bench_state_t* state, int block) {
+    int num_peaks = 0, num_candidates = 0, num_rejected = 0;
+    tap_detect_find_peaks(state->data->cd1[block], state->data->cd_len, state->ctx.cfg.threshold_min,
+                          state->ctx.cfg.threshold_max, &num_peaks, &num_candidates, &num_rejected, NULL);
+    bench_sink = num_peaks;
+}
+
+static void bench_sequence(bench_state_t* state, int block) {
+    state->ctx.current_block_cnt++; // tap_detect_process() advances the counter before the state machine
+    bench_sink = tap_detect_update_sequence(&state->ctx, state->data->num_peaks[block]);
+    state->ctx.cooldown_block_cnt = 0;
+}
+
+static void bench_process(bench_state_t* state, int block) {
+    bench_sink = tap_detect_process(&state->ctx, state->data->mic1[block], state->data->mic2[block], MAX_AUDIO_FRAME_SIZE);
+}
+
+typedef struct
+{
+    const char*   stage;
+    bench_fn      fn;
+    bench_input_e input;
+} bench_case_t;
+
+static const bench_case_t bench_cases[] = {
+    { "mix_mics",   bench_mix,        BENCH_INPUT_IDLE },
+    { "haar_dwt",   bench_haar,       BENCH_INPUT_IDLE },
+    { "find_peaks", bench_find_peaks, BENCH_INPUT_IDLE },
+    { "find_peaks", bench_find_peaks, BENCH_INPUT_PEAKS },
+    { "sequence",   bench_sequence,   BENCH_INPUT_IDLE },
+    { "sequence",   bench_sequence,   BENCH_INPUT_PEAKS },
+    { "process",    bench_process,    BENCH_INPUT_IDLE },
+    { "process",    bench_process,    BENCH_INPUT_COOLDOWN },
+    { "process",    bench_process,    BENCH_INPUT_POST_TAP },
+    { "process",    bench_process,    BENCH_INPUT_SHADOW },
+    { "process",    bench_process,    BENCH_INPUT_PEAKS },
+};
+
+// Puts a context into the steady state of the input: out of start-up cooldown, or held in (post-tap) cooldown for good.
+static void bench_state_init(bench_state_t* state, const bench_data_t* data, bench_input_e input, const tap_detect_config_t* cfg) {
+    memset(state, 0, sizeof(*state));
+    state->data = data;
+    tap_detect_config_t case_cfg = *cfg;
+    if (input == BENCH_INPUT_PEAKS) {
+        case_cfg.cooldown_blocks = 0; // Search for peaks in every block
+    }
+    case_cfg.shadow_search = (input == BENCH_INPUT_SHADOW);
+    tap_detect_init(&state->ctx, &case_cfg);
+    bool post_tap = input == BENCH_INPUT_POST_TAP || input == BENCH_INPUT_SHADOW;
+    state->ctx.cooldown_block_cnt = (input == BENCH_INPUT_COOLDOWN || post_tap) ? INT32_MAX : 0;
+    state->ctx.cooldown_after_tap = post_tap;
+}
+
+static void bench_run_case(const bench_case_t* bc, const bench_data_t* data, const bench_options_t* options,
+                           tap_perf_t* perf, double* samples_ns, bench_result_t* result) {
+    bench_state_t state;
+    bench_state_init(&state, data, bc->input, &options->cfg);
+    memset(result, 0, sizeof(*result));
+    tap_perf_reset(perf);
+
+    for (int rep = -options->warmup; rep < options->reps; rep++) {
+        if (rep >= 0) tap_perf_start(perf);
+        uint64_t start = tap_clock_now_ns();
+        for (int i = 0; i < options->batch; i++) {
+            bc->fn(&state, i & (BENCH_INPUT_BLOCKS - 1));
+        }
+        double elapsed = (double)(tap_clock_now_ns() - start);
+        if (rep >= 0) {
+            tap_perf_stop(perf);
+            samples_ns[rep] = elapsed / options->batch;
+        }
+    }
+
+    uint64_t counts[TAP_PERF_COUNT];
+    if (tap_perf_read(perf, counts) == 0) {
+        double blocks = (double)options->reps * options->batch;
+        for (int c = 0; c < TAP_PERF_COUNT; c++) {
+            result->has_counter[c] = tap_perf_available(perf, (tap_perf_counter_e)c);
+            result->counter_per_block[c] = counts[c] / blocks;
+        }
+    }
+
+    tap_bench_sort(samples_ns, options->reps);
+    result->stage = bc->stage;
+    result->input = input_names[bc->input];
+    result->median_ns = tap_bench_percentile(samples_ns, options->reps, 0.50);
+    result->p99_ns = tap_bench_percentile(samples_ns, options->reps, 0.99);
+    result->min_ns = samples_ns[0];
+    result->samples_per_s = result->median_ns > 0.0 ? MAX_AUDIO_FRAME_SIZE * 1e9 / result->median_ns : 0.0;
+}
+
+// --- Reporting ---
+
+static double result_ipc(const bench_result_t* r) {
+    return r->counter_per_block[TAP_PERF_CYCLES] > 0.0 ? r->counter_per_block[TAP_PERF_INSTRUCTIONS] / r->counter_per_block[TAP_PERF_CYCLES] : 0.0;
+}
+
+static double result_branch_miss_rate(const bench_result_t* r) {
+    return r->counter_per_block[TAP_PERF_BRANCHES] > 0.0 ? r->counter_per_block[TAP_PERF_BRANCH_MISSES] / r->counter_per_block[TAP_PERF_BRANCHES] : 0.0;
+}
+
+static int result_has_ipc(const bench_result_t* r) {
+    return r->has_counter[TAP_PERF_CYCLES] && r->has_counter[TAP_PERF_INSTRUCTIONS];
+}
+
+static int result_has_branch_miss_rate(const bench_result_t* r) {
+    return r->has_counter[TAP_PERF_BRANCHES] && r->has_counter[TAP_PERF_BRANCH_MISSES];
+}
+
+// Appends the available counters of one result as JSON fields.
+static void print_json_counters(const bench_result_t* r) {
+    for (int c = 0; c < TAP_PERF_COUNT; c++) {
+        if (r->has_counter[c]) printf(", \"%s_per_block\": %.2f", tap_perf_counter_name((tap_perf_counter_e)c), r->counter_per_block[c]);
+    }
+    if (result_has_ipc(r)) printf(", \"ipc\": %.3f", result_ipc(r));
+    if (result_has_branch_miss_rate(r)) printf(", \"branch_miss_rate\": %.5f", result_branch_miss_rate(r));
+}
+
+// Prints a counter column value, or "-" when the counter is unavailable.
+static void print_counter_cell(int available, const char* format, double value, int width) {
+    if (available) printf(format, width, value);
+    else printf("%*s", width, "-");
+}
+
+static void print_results(const bench_result_t* results, int count, const bench_options_t* options) {
+    if (strcmp(options->format, "json") == 0) {
+        printf("{\n  \"benchmark\": \"tap_detect_stages\",\n  \"detector_version\": %d,\n  \"frame_size\": %d,\n",
+               TAP_DETECT_VERSION, MAX_AUDIO_FRAME_SIZE);
+        printf("  \"reps\": %d,\n  \"warmup\": %d,\n  \"batch\": %d,\n  \"results\": [\n", options->reps, options->warmup, options->batch);
+        for (int i = 0; i < count; i++) {
+            printf("    {\"stage\": \"%s\", \"input\": \"%s\", \"ns_per_block_median\": %.2f, \"ns_per_block_p99\": %.2f, "
+                   "\"ns_per_block_min\": %.2f, \"samples_per_s\": %.0f",
+                   results[i].stage, results[i].input, results[i].median_ns, results[i].p99_ns, results[i].min_ns,
+                   results[i].samples_per_s);
+            print_json_counters(&results[i]);
+            printf("}%s\n", i + 1 < count ? "," : "");
+        }
+        printf("  ]\n}\n");
+    } else if (strcmp(options->format, "csv") == 0) {
+        printf("stage,input,ns_per_block_median,ns_per_block_p99,ns_per_block_min,samples_per_s");
+        if (options->perf) {
+            for (int c = 0; c < TAP_PERF_COUNT; c++) printf(",%s_per_block", tap_perf_counter_name((tap_perf_counter_e)c));
+            printf(",ipc,branch_miss_rate");
+        }
+        printf("\n");
+        for (int i = 0; i < count; i++) {
+            printf("%s,%s,%.2f,%.2f,%.2f,%.0f", results[i].stage, results[i].input, results[i].median_ns,
+                   results[i].p99_ns, results[i].min_ns, results[i].samples_per_s);
+            if (options->perf) {
+                // Unavailable counters are left empty
+                for (int c = 0; c < TAP_PERF_COUNT; c++) {
+                    if (results[i].has_counter[c]) printf(",%.2f", results[i].counter_per_block[c]);
+                    else printf(",");
+                }
+                if (result_has_ipc(&results[i])) printf(",%.3f", result_ipc(&results[i]));
+                else printf(",");
+                if (result_has_branch_miss_rate(&results[i])) printf(",%.5f", result_branch_miss_rate(&results[i]));
+                else printf(",");
+            }
+            printf("\n");
+        }
+    } else {
+        printf("--- Detector stage benchmark (%d reps x %d blocks of %d samples, %d warm-up reps) ---\n",
+               options->reps, options->batch, MAX_AUDIO_FRAME_SIZE, options->warmup);
+        printf("Stage      | Input    | ns/block median |     p99 |     min | Msamples/s\n");
+        for (int i = 0; i < count; i++) {
+            printf("%-10s | %-8s | %15.1f | %7.1f | %7.1f | %10.1f\n", results[i].stage, results[i].input,
+                   results[i].median_ns, results[i].p99_ns, results[i].min_ns, results[i].samples_per_s / 1e6);
+        }
+        if (options->perf) {
+            printf("--- Hardware counters per block ---\n");
+            printf("Stage      | Input    |   cycles |    instr |  IPC | branches | br-miss | miss rate | L1D miss | LLC miss\n");
+            for (int i = 0; i < count; i++) {
+                const bench_result_t* r = &results[i];
+                printf("%-10s | %-8s | ", r->stage, r->input);
+                print_counter_cell(r->has_counter[TAP_PERF_CYCLES], "%*.0f", r->counter_per_block[TAP_PERF_CYCLES], 8);
+                printf(" | ");
+                print_counter_cell(r->has_counter[TAP_PERF_INSTRUCTIONS], "%*.0f", r->counter_per_block[TAP_PERF_INSTRUCTIONS], 8);
+                printf(" | ");
+                print_counter_cell(result_has_ipc(r), "%*.2f", result_ipc(r), 4);
+                printf(" | ");
+                print_counter_cell(r->has_counter[TAP_PERF_BRANCHES], "%*.0f", r->counter_per_block[TAP_PERF_BRANCHES], 8);
+                printf(" | ");
+                print_counter_cell(r->has_counter[TAP_PERF_BRANCH_MISSES], "%*.2f", r->counter_per_block[TAP_PERF_BRANCH_MISSES], 7);
+                printf(" | ");
+                print_counter_cell(result_has_branch_miss_rate(r), "%*.4f", result_branch_miss_rate(r), 9);
+                printf(" | ");
+                print_counter_cell(r->has_counter[TAP_PERF_L1D_MISSES], "%*.2f", r->counter_per_block[TAP_PERF_L1D_MISSES], 8);
+                printf(" | ");
+                print_counter_cell(r->has_counter[TAP_PERF_LLC_MISSES], "%*.2f", r->counter_per_block[TAP_PERF_LLC_MISSES], 8);
+                printf("\n");
+            }
+        }
+    }
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "       %s --e2e [options]   (end-to-end CLI benchmark, see --e2e --help)\n", prog);
+    fprintf(stderr, "       %s --wcet [options]  (worst-case latency on adversarial frames, see --wcet --help)\n", prog);
+    fprintf(stderr, "       %s --stage-times <input_wav>... [--format text|csv]  (per-stage times on recordings)\n", prog);
+    fprintf(stderr, "  --reps N        timed repetitions per case (default: %d)\n", BENCH_DEFAULT_REPS);
+    fprintf(stderr, "  --warmup N      untimed repetitions before timing (default: %d)\n", BENCH_DEFAULT_WARMUP);
+    fprintf(stderr, "  --batch N       blocks per repetition (default: %d)\n", BENCH_DEFAULT_BATCH);
+    fprintf(stderr, "  --filter TEXT   only run cases whose \"stage/input\" contains TEXT\n");
+    fprintf(stderr, "  --format F      text, csv or json (default: text)\n");
+    fprintf(stderr, "  --perf          also collect hardware performance counters (Linux perf_event_open)\n");
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--e2e") == 0) {
+        return tap_bench_e2e_cli(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "--wcet") == 0) {
+        return tap_bench_wcet_cli(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "--stage-times") == 0) {
+        return tap_stage_timer_cli(argc, argv);
+    }
+    bench_options_t options;
+    memset(&options, 0, sizeof(options));
+    options.reps = BENCH_DEFAULT_REPS;
+    options.warmup = BENCH_DEFAULT_WARMUP;
+    options.batch = BENCH_DEFAULT_BATCH;
+    options.format = "text";
+    tap_detect_config_default(&options.cfg);
+
+    for (int i = 1; i < argc; i++) {
+        const char* opt = argv[i];
+        if (strcmp(opt, "--perf") == 0) {
+            options.perf = 1;
+            continue;
+        }
+        const char* value = (i + 1 < argc) ? argv[++i] : NULL;
+        if (!value) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (strcmp(opt, "--reps") == 0) options.reps = atoi(value);
+        else if (strcmp(opt, "--warmup") == 0) options.warmup = atoi(value);
+        else if (strcmp(opt, "--batch") == 0) options.batch = atoi(value);
+        else if (strcmp(opt, "--filter") == 0) options.filter = value;
+        else if (strcmp(opt, "--format") == 0) options.format = value;
+        else {
+            fprintf(stderr, "Error: Unknown option %s\n", opt);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.reps < 1 || options.warmup < 0 || options.batch < 1 ||
+        (strcmp(options.format, "text") != 0 && strcmp(options.format, "csv") != 0 && strcmp(options.format, "json") != 0)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    static bench_data_t data[BENCH_INPUT_COUNT];
+    for (int input = 0; input < BENCH_INPUT_COUNT; input++) {
+        bench_data_init(&data[input], (bench_input_e)input, &options.cfg);
+    }
+
+    const int num_cases = (int)(sizeof(bench_cases) / sizeof(bench_cases[0]));
+    bench_result_t results[sizeof(bench_cases) / sizeof(bench_cases[0])];
+    double* samples_ns = (double*)malloc(options.reps * sizeof(double));
+    if (!samples_ns) {
+        fprintf(stderr, "Error: Memory allocation failed for benchmark samples.\n");
+        return 1;
+    }
+
+    // Without --perf (or without counter support) the counters stay closed and every perf call is a no-op
+    tap_perf_t perf;
+    tap_perf_close(&perf);
+    if (options.perf) tap_perf_open(&perf);
+
+    int count = 0;
+    for (int c = 0; c < num_cases; c++) {
+        char name[64];
+        snprintf(name, sizeof(name), "%s/%s", bench_cases[c].stage, input_names[bench_cases[c].input]);
+        if (options.filter && !strstr(name, options.filter)) continue;
+        bench_run_case(&bench_cases[c], &data[bench_cases[c].input], &options, &perf, samples_ns, &results[count++]);
+    }
+    tap_perf_close(&perf);
+    free(samples_ns);
+
+    print_results(results, count, &options);
+    return 0;
+}
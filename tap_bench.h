@@ -0,0 +1,15 @@
+#ifndef TAP_BENCH_H
+#define TAP_BENCH_H
+
+// --- Benchmark Harness ---
+// tap_bench.c times the detector stages on synthetic blocks; tap_bench_e2e.c times the whole CLI path
+// (read, detect, log, write) on generated recordings and compares the results against a stored baseline;
+// tap_bench_wcet.c measures the worst-case latency of tap_detect_status() on adversarial frames.
+
+void   tap_bench_sort(double* values, int count);
+double tap_bench_percentile(const double* sorted, int count, double p);
+
+int tap_bench_e2e_cli(int argc, char* argv[]);
+int tap_bench_wcet_cli(int argc, char* argv[]);
+
+#endif // !TAP_BENCH_H
@@ -0,0 +1,351 @@
+#include <stdio.h>    // For console and file I/O
+#include <stdlib.h>   // For memory allocation, strtod, atoi
+#include <string.h>   // For strcmp, strstr, memset
+#ifdef _WIN32
+#include <windows.h>  // For GetProcessMemoryInfo
+#include <psapi.h>
+#else
+#include <sys/resource.h> // For getrusage
+#endif
+
+#include "tap_bench.h"
+#include "tap_clock.h"
+#include "tap_pipeline.h"
+#include "tap_synth.h"
+#include "wav_io.h"
+
+// --- End-to-End Benchmark ---
+// Generates synthetic stereo recordings of the requested durations (kept in --dir and reused by later runs),
+// runs the CLI path over each of them with the log going to the null device, and reports the real-time factor,
+// the peak resident set size and the median wall time of every pipeline stage. Results can be stored as JSON and
+// compared against a stored baseline; a stage that got slower than the tolerance allows is reported as a regression.
+
+#define E2E_MAX_DURATIONS     (16)
+#define E2E_DEFAULT_DURATIONS "60,600,3600"
+#define E2E_DEFAULT_REPS      (3)
+#define E2E_DEFAULT_TOLERANCE (0.10)
+#define E2E_SEED              (0xE2E0001ull)
+#define E2E_SYNTH_BLOCK       (4800)
+#define E2E_MIN_DELTA_S       (0.005)  /* slow-downs below this are timer noise, never regressions. */
+#define E2E_MIN_DELTA_KB      (1024.0)
+
+#ifdef _WIN32
+#define E2E_NULL_DEVICE "NUL"
+#else
+#define E2E_NULL_DEVICE "/dev/null"
+#endif
+
+typedef enum
+{
+    E2E_METRIC_TOTAL = 0,
+    E2E_METRIC_READ,
+    E2E_METRIC_DETECT,
+    E2E_METRIC_LOG,
+    E2E_METRIC_WRITE,
+    E2E_METRIC_PEAK_RSS,
+    E2E_METRIC_COUNT
+} e2e_metric_e;
+
+static const char* const metric_keys[E2E_METRIC_COUNT] = { "total_s", "read_s", "detect_s", "log_s", "write_s", "peak_rss_kb" };
+
+typedef struct
+{
+    double duration_s;
+    long   num_samples;
+    long   events;
+    double metric[E2E_METRIC_COUNT]; // Median over the repetitions (peak RSS: high-water mark after the runs)
+} e2e_result_t;
+
+// --- Helpers ---
+
+static double peak_rss_kb(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0.0;
+    return (double)counters.PeakWorkingSetSize / 1024.0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+#ifdef __APPLE__
+    return (double)usage.ru_maxrss / 1024.0; // Bytes on macOS
+#else
+    return (double)usage.ru_maxrss;          // Kilobytes on Linux
+#endif
+#endif
+}
+
+static int compare_duration(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Parses "60,600,3600" into ascending durations.
+static int parse_durations(const char* text, double* durations) {
+    int count = 0;
+    const char* p = text;
+    while (*p) {
+        char* end = NULL;
+        double value = strtod(p, &end);
+        if (end == p || value <= 0.0 || count == E2E_MAX_DURATIONS) return -1;
+        durations[count++] = value;
+        if (*end == ',') end++;
+        else if (*end != '\0') return -1;
+        p = end;
+    }
+    qsort(durations, count, sizeof(double), compare_duration);
+    return count;
+}
+
+// Returns 1 if path holds a WAV file of exactly the expected size.
+static int input_is_current(const char* path, uint64_t frames) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return 0;
+    int current = fseek(file, 0, SEEK_END) == 0 && (uint64_t)ftell(file) == 44 + frames * 2 * sizeof(int16_t);
+    fclose(file);
+    return current;
+}
+
+// Writes a deterministic stereo recording with the default synthesis settings.
+static int generate_input(const char* path, uint64_t frames) {
+    tap_synth_config_t cfg;
+    tap_synth_config_default(&cfg);
+    cfg.seed = E2E_SEED;
+
+    tap_synth_t* synth = (tap_synth_t*)malloc(sizeof(tap_synth_t));
+    int16_t* block = (int16_t*)malloc(E2E_SYNTH_BLOCK * 2 * sizeof(int16_t));
+    wav_writer_t writer;
+    int status = (synth && block && tap_synth_init(synth, &cfg) == 0) ? 0 : -1;
+    if (status == 0) status = wav_writer_open(&writer, path, cfg.samplerate, 2);
+    if (status == 0) {
+        for (uint64_t done = 0; status == 0 && done < frames; done += E2E_SYNTH_BLOCK) {
+            long count = (frames - done > E2E_SYNTH_BLOCK) ? E2E_SYNTH_BLOCK : (long)(frames - done);
+            tap_synth_render(synth, block, count, NULL, NULL);
+            status = wav_writer_write(&writer, block, count);
+        }
+        if (wav_writer_close(&writer) != 0) status = -1;
+    }
+    free(synth);
+    free(block);
+    return status;
+}
+
+static double median_of(double* values, int count) {
+    tap_bench_sort(values, count);
+    return tap_bench_percentile(values, count, 0.50);
+}
+
+// --- Measurement ---
+
+static int run_duration(double duration_s, const char* dir, int reps, e2e_result_t* result) {
+    char input_path[1024], output_path[1024];
+    snprintf(input_path, sizeof(input_path), "%s/tap_bench_e2e_%.0fs.wav", dir, duration_s);
+    snprintf(output_path, sizeof(output_path), "%s/tap_bench_e2e_out.wav", dir);
+
+    uint64_t frames = (uint64_t)(duration_s * 48000.0);
+    if (frames * 2 * sizeof(int16_t) > UINT32_MAX - 44) {
+        fprintf(stderr, "Error: %.0f s of stereo audio exceeds the 4 GiB WAV data limit of the CLI reader\n", duration_s);
+        return -1;
+    }
+    if (!input_is_current(input_path, frames)) {
+        fprintf(stderr, "Generating %s ...\n", input_path);
+        if (generate_input(input_path, frames) != 0) return -1;
+    }
+
+    FILE* null_log = fopen(E2E_NULL_DEVICE, "w");
+    if (!null_log) {
+        fprintf(stderr, "Error: Could not open %s\n", E2E_NULL_DEVICE);
+        return -1;
+    }
+
+    double samples[E2E_METRIC_COUNT - 1][64];
+    memset(result, 0, sizeof(*result));
+    result->duration_s = duration_s;
+    int status = 0;
+    for (int rep = 0; rep < reps; rep++) {
+        tap_pipeline_stats_t stats;
+        uint64_t start = tap_clock_now_ns();
+        if (tap_pipeline_run(input_path, output_path, null_log, NULL, &stats) != 0) {
+            status = -1;
+            break;
+        }
+        samples[E2E_METRIC_TOTAL][rep] = (double)(tap_clock_now_ns() - start) * 1e-9;
+        samples[E2E_METRIC_READ][rep] = stats.read_s;
+        samples[E2E_METRIC_DETECT][rep] = stats.detect_s;
+        samples[E2E_METRIC_LOG][rep] = stats.log_s;
+        samples[E2E_METRIC_WRITE][rep] = stats.write_s;
+        result->num_samples = stats.num_samples;
+        result->events = stats.events;
+    }
+    fclose(null_log);
+    remove(output_path);
+    if (status != 0) return -1;
+
+    for (int m = 0; m < E2E_METRIC_PEAK_RSS; m++) {
+        result->metric[m] = median_of(samples[m], reps);
+    }
+    // Durations run in ascending order, so the process high-water mark belongs to the current one
+    result->metric[E2E_METRIC_PEAK_RSS] = peak_rss_kb();
+    return 0;
+}
+
+// --- Reporting ---
+
+static double real_time_factor(const e2e_result_t* result) {
+    return result->metric[E2E_METRIC_TOTAL] / result->duration_s;
+}
+
+static int write_json(const char* path, const e2e_result_t* results, int count, int reps) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open %s for writing\n", path);
+        return -1;
+    }
+    fprintf(file, "{\n  \"benchmark\": \"tap_e2e\",\n  \"detector_version\": %d,\n  \"frame_size\": %d,\n  \"reps\": %d,\n  \"results\": [\n",
+            TAP_DETECT_VERSION, MAX_AUDIO_FRAME_SIZE, reps);
+    for (int i = 0; i < count; i++) {
+        // One result per line; compare mode relies on this layout
+        fprintf(file, "    {\"duration_s\": %.1f, \"samples\": %ld, \"events\": %ld, \"rtf\": %.6f",
+                results[i].duration_s, results[i].num_samples, results[i].events, real_time_factor(&results[i]));
+        for (int m = 0; m < E2E_METRIC_COUNT; m++) {
+            fprintf(file, ", \"%s\": %.6f", metric_keys[m], results[i].metric[m]);
+        }
+        fprintf(file, "}%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+static void print_table(const e2e_result_t* results, int count, int reps) {
+    printf("--- End-to-end CLI benchmark (median of %d runs) ---\n", reps);
+    printf("Duration (s) |      RTF | x real time |  total s |   read s | detect s |    log s |  write s | peak RSS MB\n");
+    for (int i = 0; i < count; i++) {
+        const e2e_result_t* r = &results[i];
+        double rtf = real_time_factor(r);
+        printf("%12.0f | %8.5f | %11.0f | %8.3f | %8.3f | %8.3f | %8.3f | %8.3f | %11.1f\n", r->duration_s, rtf,
+               rtf > 0.0 ? 1.0 / rtf : 0.0, r->metric[E2E_METRIC_TOTAL], r->metric[E2E_METRIC_READ],
+               r->metric[E2E_METRIC_DETECT], r->metric[E2E_METRIC_LOG], r->metric[E2E_METRIC_WRITE],
+               r->metric[E2E_METRIC_PEAK_RSS] / 1024.0);
+    }
+}
+
+// Reads "key": <number> from a JSON line.
+static int json_number(const char* line, const char* key, double* value) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char* p = strstr(line, pattern);
+    if (!p) return -1;
+    char* end = NULL;
+    *value = strtod(p + strlen(pattern), &end);
+    return end == p + strlen(pattern) ? -1 : 0;
+}
+
+/**
+ * @brief Compares results against a baseline written by --json.
+ * @return Number of regressions, or -1 if the baseline could not be read.
+ */
+static int compare_baseline(const char* path, const e2e_result_t* results, int count, double tolerance) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open baseline %s\n", path);
+        return -1;
+    }
+    printf("--- Comparison against %s (tolerance %.0f%%) ---\n", path, tolerance * 100.0);
+    printf("Duration (s) | Metric      |     Baseline |      Current |  Change | Status\n");
+
+    int regressions = 0, compared = 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), file)) {
+        double duration_s;
+        if (json_number(line, "duration_s", &duration_s) != 0) continue;
+        const e2e_result_t* current = NULL;
+        for (int i = 0; i < count; i++) {
+            if (results[i].duration_s == duration_s) current = &results[i];
+        }
+        if (!current) continue;
+
+        for (int m = 0; m < E2E_METRIC_COUNT; m++) {
+            double baseline;
+            if (json_number(line, metric_keys[m], &baseline) != 0) continue;
+            double delta = current->metric[m] - baseline;
+            double min_delta = (m == E2E_METRIC_PEAK_RSS) ? E2E_MIN_DELTA_KB : E2E_MIN_DELTA_S;
+            int regressed = delta > baseline * tolerance && delta > min_delta;
+            regressions += regressed;
+            printf("%12.0f | %-11s | %12.4f | %12.4f | %+6.1f%% | %s\n", duration_s, metric_keys[m], baseline,
+                   current->metric[m], baseline > 0.0 ? 100.0 * delta / baseline : 0.0, regressed ? "REGRESSION" : "ok");
+        }
+        compared++;
+    }
+    fclose(file);
+    if (compared == 0) {
+        fprintf(stderr, "Warning: Baseline %s has no durations in common with this run\n", path);
+    }
+    printf("%d regression(s)\n", regressions);
+    return regressions;
+}
+
+static void print_e2e_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s --e2e [options]\n", prog);
+    fprintf(stderr, "  --durations LIST    comma separated recording lengths in seconds (default: %s)\n", E2E_DEFAULT_DURATIONS);
+    fprintf(stderr, "  --reps N            runs per duration, the median is reported (default: %d)\n", E2E_DEFAULT_REPS);
+    fprintf(stderr, "  --dir DIR           where generated recordings are kept (default: .)\n");
+    fprintf(stderr, "  --json FILE         store the results as JSON\n");
+    fprintf(stderr, "  --compare FILE      compare against a stored JSON baseline; exit code 2 on regressions\n");
+    fprintf(stderr, "  --tolerance T       allowed relative slow-down before a regression is flagged (default: %.2f)\n", E2E_DEFAULT_TOLERANCE);
+}
+
+/**
+ * @brief Entry point of "tap_bench --e2e".
+ */
+int tap_bench_e2e_cli(int argc, char* argv[]) {
+    const char* durations_text = E2E_DEFAULT_DURATIONS;
+    const char* dir = ".";
+    const char* json_path = NULL;
+    const char* baseline_path = NULL;
+    double tolerance = E2E_DEFAULT_TOLERANCE;
+    int reps = E2E_DEFAULT_REPS;
+
+    for (int i = 2; i < argc; i += 2) {
+        const char* opt = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!value) {
+            print_e2e_usage(argv[0]);
+            return 1;
+        }
+        if (strcmp(opt, "--durations") == 0) durations_text = value;
+        else if (strcmp(opt, "--reps") == 0) reps = atoi(value);
+        else if (strcmp(opt, "--dir") == 0) dir = value;
+        else if (strcmp(opt, "--json") == 0) json_path = value;
+        else if (strcmp(opt, "--compare") == 0) baseline_path = value;
+        else if (strcmp(opt, "--tolerance") == 0) tolerance = atof(value);
+        else {
+            fprintf(stderr, "Error: Unknown option %s\n", opt);
+            print_e2e_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    double durations[E2E_MAX_DURATIONS];
+    int count = parse_durations(durations_text, durations);
+    if (count <= 0 || reps < 1 || reps > 64 || tolerance < 0.0) {
+        print_e2e_usage(argv[0]);
+        return 1;
+    }
+
+    e2e_result_t results[E2E_MAX_DURATIONS];
+    for (int i = 0; i < count; i++) {
+        if (run_duration(durations[i], dir, reps, &results[i]) != 0) {
+            return 1;
+        }
+    }
+
+    print_table(results, count, reps);
+    if (json_path && write_json(json_path, results, count, reps) != 0) {
+        return 1;
+    }
+    if (baseline_path) {
+        int regressions = compare_baseline(baseline_path, results, count, tolerance);
+        if (regressions < 0) return 1;
+        if (regressions > 0) return 2;
+    }
+    return 0;
+}
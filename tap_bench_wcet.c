@@ -0,0 +1,273 @@
+#include <stdio.h>    // For console output
+#include <stdlib.h>   // For memory allocation, atol
+#include <string.h>   // For strcmp, memset
+
+#include "tap_bench.h"
+#include "tap_clock.h"
+#include "tap_detect.h"
+
+// --- Worst-Case Execution Time Harness ---
+// Drives tap_detect_status() with a looping script of adversarial frames and records the latency of every
+// call in per-frame-kind histograms, reporting the maximum and the 99.99th percentile as an on-host proxy for
+// the per-block cycle budget on the wearable. The script follows the default configuration's cooldown and
+// double-tap window so state transitions land exactly on the window boundaries:
+//
+//     first tap -> cooldown -> near misses -> second tap exactly W blocks later         (double tap)
+//     first tap -> cooldown -> near misses -> second tap W + 1 blocks later             (late: single + new first tap)
+//              -> cooldown -> near misses -> timeout W + 1 blocks after the first tap (single by timeout)
+//
+// Cooldown blocks carry saturated full-scale frames; blocks searched for peaks without an expected tap carry
+// near misses, where every coefficient passes all but the last comparison of the peak test, and values just
+// outside the thresholds.
+
+#define WCET_DEFAULT_ITERATIONS (5000000L)
+#define WCET_DEFAULT_WARMUP     (10000L)
+#define WCET_HISTOGRAM_NS       (65536) /* 1 ns buckets; slower calls only update the maximum and the overflow count. */
+
+typedef enum
+{
+    WCET_FRAME_SILENCE = 0,  // Start-up cooldown
+    WCET_FRAME_ALT_PEAKS,    // Every other coefficient is a peak between the thresholds
+    WCET_FRAME_EDGE_PEAKS,   // Peaks exactly at threshold_min and threshold_max
+    WCET_FRAME_EDGE_OUTSIDE, // Peaks at threshold_min - 1 and threshold_max + 1, never counted
+    WCET_FRAME_NEAR_MISS,    // Rising ramp inside the thresholds: no coefficient exceeds its right neighbour
+    WCET_FRAME_SATURATED,    // Full-scale alternating samples on both mics
+    WCET_FRAME_COUNT
+} wcet_frame_e;
+
+static const char* const frame_names[WCET_FRAME_COUNT] = {
+    "silence", "alt_peaks", "edge_peaks", "edge_outside", "near_miss", "saturated"
+};
+
+typedef struct
+{
+    int mic1[WCET_FRAME_COUNT][MAX_AUDIO_FRAME_SIZE];
+    int mic2[WCET_FRAME_COUNT][MAX_AUDIO_FRAME_SIZE];
+} wcet_frames_t;
+
+typedef struct
+{
+    uint64_t counts[WCET_HISTOGRAM_NS];
+    uint64_t calls;
+    uint64_t overflow;
+    uint64_t max_ns;
+    double   sum_ns;
+} wcet_histogram_t;
+
+// --- Frames ---
+
+// Writes coefficient values as mic samples: cD1[k] = x[2k+1] - x[2k] with x[2k] = 0.
+static void set_coefficients(int* mic1, int* mic2, const int* cd1) {
+    for (int k = 0; k < MAX_AUDIO_FRAME_SIZE / 2; k++) {
+        mic1[2 * k] = mic2[2 * k] = 0;
+        mic1[2 * k + 1] = mic2[2 * k + 1] = cd1[k];
+    }
+}
+
+static void build_frames(wcet_frames_t* frames, const tap_detect_config_t* cfg) {
+    memset(frames, 0, sizeof(*frames));
+    int cd1[MAX_AUDIO_FRAME_SIZE / 2];
+    int range = cfg->threshold_max - cfg->threshold_min;
+
+    for (int k = 0; k < MAX_AUDIO_FRAME_SIZE / 2; k++) cd1[k] = cfg->threshold_min + ((k & 1) ? range / 4 : range * 3 / 4);
+    set_coefficients(frames->mic1[WCET_FRAME_ALT_PEAKS], frames->mic2[WCET_FRAME_ALT_PEAKS], cd1);
+
+    // Peaks exactly on the thresholds, separated by valleys just below threshold_min
+    for (int k = 0; k < MAX_AUDIO_FRAME_SIZE / 2; k++) {
+        cd1[k] = (k & 1) ? cfg->threshold_min - 1 : ((k & 2) ? cfg->threshold_max : cfg->threshold_min);
+    }
+    set_coefficients(frames->mic1[WCET_FRAME_EDGE_PEAKS], frames->mic2[WCET_FRAME_EDGE_PEAKS], cd1);
+
+    for (int k = 0; k < MAX_AUDIO_FRAME_SIZE / 2; k++) {
+        cd1[k] = (k & 1) ? cfg->threshold_min - 2 : ((k & 2) ? cfg->threshold_max + 1 : cfg->threshold_min - 1);
+    }
+    set_coefficients(frames->mic1[WCET_FRAME_EDGE_OUTSIDE], frames->mic2[WCET_FRAME_EDGE_OUTSIDE], cd1);
+
+    for (int k = 0; k < MAX_AUDIO_FRAME_SIZE / 2; k++) {
+        cd1[k] = cfg->threshold_min + (int)((int64_t)range * k / (MAX_AUDIO_FRAME_SIZE / 2));
+    }
+    // The last coefficient has no right neighbour; keep it below its left one so it is not a peak either
+    cd1[MAX_AUDIO_FRAME_SIZE / 2 - 1] = cd1[MAX_AUDIO_FRAME_SIZE / 2 - 2];
+    set_coefficients(frames->mic1[WCET_FRAME_NEAR_MISS], frames->mic2[WCET_FRAME_NEAR_MISS], cd1);
+
+    for (int n = 0; n < MAX_AUDIO_FRAME_SIZE; n++) {
+        int full_scale = (n & 1) ? (INT16_MAX << (Q_BITS - 15)) : (INT16_MIN * (1 << (Q_BITS - 15)));
+        frames->mic1[WCET_FRAME_SATURATED][n] = full_scale;
+        frames->mic2[WCET_FRAME_SATURATED][n] = full_scale;
+    }
+}
+
+// --- Script ---
+
+static void script_fill(wcet_frame_e* script, long from, long to, wcet_frame_e frame) {
+    for (long b = from; b < to; b++) script[b] = frame;
+}
+
+// Alternates the two non-detecting search frames.
+static void script_fill_misses(wcet_frame_e* script, long from, long to) {
+    for (long b = from; b < to; b++) script[b] = ((b - from) & 1) ? WCET_FRAME_EDGE_OUTSIDE : WCET_FRAME_NEAR_MISS;
+}
+
+/**
+ * @brief Builds one cycle of the adversarial script (see the top of this file).
+ * @return The cycle length in blocks.
+ */
+static long build_script(wcet_frame_e* script, const tap_detect_config_t* cfg) {
+    long cooldown = cfg->cooldown_blocks;
+    long window = cfg->double_tap_window_blocks;
+
+    // Double tap exactly at the window boundary
+    long s = 0;
+    script[s] = WCET_FRAME_ALT_PEAKS;
+    script_fill(script, s + 1, s + 1 + cooldown, WCET_FRAME_SATURATED);
+    script_fill_misses(script, s + 1 + cooldown, s + window);
+    script[s + window] = WCET_FRAME_EDGE_PEAKS;
+    script_fill(script, s + window + 1, s + window + 1 + cooldown, WCET_FRAME_SATURATED);
+
+    // Second tap one block too late: single tap plus a new first tap
+    long s2 = s + window + 1 + cooldown;
+    script[s2] = WCET_FRAME_ALT_PEAKS;
+    script_fill(script, s2 + 1, s2 + 1 + cooldown, WCET_FRAME_SATURATED);
+    script_fill_misses(script, s2 + 1 + cooldown, s2 + window + 1);
+    long s3 = s2 + window + 1;
+    script[s3] = WCET_FRAME_ALT_PEAKS;
+
+    // No second tap: single tap by timeout one block after the window
+    script_fill(script, s3 + 1, s3 + 1 + cooldown, WCET_FRAME_SATURATED);
+    script_fill_misses(script, s3 + 1 + cooldown, s3 + window + 2);
+    return s3 + window + 2;
+}
+
+// --- Statistics ---
+
+static void histogram_add(wcet_histogram_t* h, uint64_t ns) {
+    h->calls++;
+    h->sum_ns += (double)ns;
+    if (ns > h->max_ns) h->max_ns = ns;
+    if (ns < WCET_HISTOGRAM_NS) h->counts[ns]++;
+    else h->overflow++;
+}
+
+// Nearest-rank percentile; calls beyond the histogram range report the maximum.
+static double histogram_percentile(const wcet_histogram_t* h, double p) {
+    if (h->calls == 0) return 0.0;
+    uint64_t rank = (uint64_t)(p * (double)h->calls + 0.999999);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int ns = 0; ns < WCET_HISTOGRAM_NS; ns++) {
+        seen += h->counts[ns];
+        if (seen >= rank) return ns;
+    }
+    return (double)h->max_ns;
+}
+
+static uint64_t timer_overhead_ns(void) {
+    double samples[1001];
+    for (int i = 0; i < 1001; i++) {
+        uint64_t start = tap_clock_now_ns();
+        samples[i] = (double)(tap_clock_now_ns() - start);
+    }
+    tap_bench_sort(samples, 1001);
+    return (uint64_t)samples[500];
+}
+
+static void print_wcet_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s --wcet [options]\n", prog);
+    fprintf(stderr, "  --iterations N   timed calls of tap_detect_status() (default: %ld)\n", WCET_DEFAULT_ITERATIONS);
+    fprintf(stderr, "  --warmup N       untimed calls first (default: %ld)\n", WCET_DEFAULT_WARMUP);
+    fprintf(stderr, "  --format F       text or json (default: text)\n");
+}
+
+/**
+ * @brief Entry point of "tap_bench --wcet".
+ */
+int tap_bench_wcet_cli(int argc, char* argv[]) {
+    long iterations = WCET_DEFAULT_ITERATIONS;
+    long warmup = WCET_DEFAULT_WARMUP;
+    const char* format = "text";
+    for (int i = 2; i < argc; i += 2) {
+        const char* opt = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!value) {
+            print_wcet_usage(argv[0]);
+            return 1;
+        }
+        if (strcmp(opt, "--iterations") == 0) iterations = atol(value);
+        else if (strcmp(opt, "--warmup") == 0) warmup = atol(value);
+        else if (strcmp(opt, "--format") == 0) format = value;
+        else {
+            fprintf(stderr, "Error: Unknown option %s\n", opt);
+            print_wcet_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (iterations < 1 || warmup < 0 || (strcmp(format, "text") != 0 && strcmp(format, "json") != 0)) {
+        print_wcet_usage(argv[0]);
+        return 1;
+    }
+
+    // tap_detect_status() runs the firmware's static instance, which always uses the default configuration
+    tap_detect_config_t cfg;
+    tap_detect_config_default(&cfg);
+    static wcet_frames_t frames;
+    build_frames(&frames, &cfg);
+    wcet_frame_e* script = (wcet_frame_e*)malloc((3 * (cfg.double_tap_window_blocks + cfg.cooldown_blocks) + 8) * sizeof(wcet_frame_e));
+    wcet_histogram_t* histograms = (wcet_histogram_t*)calloc(WCET_FRAME_COUNT + 1, sizeof(wcet_histogram_t)); // [COUNT] = all
+    if (!script || !histograms) {
+        fprintf(stderr, "Error: Memory allocation failed for the WCET harness.\n");
+        free(script);
+        free(histograms);
+        return 1;
+    }
+    long cycle = build_script(script, &cfg);
+
+    // Start-up cooldown, then the script loops forever
+    long block = 0;
+    long events[3] = { 0, 0, 0 }; // none, single, double
+    for (long call = -warmup; call < iterations; call++, block++) {
+        wcet_frame_e frame = (block < TAP_STARTUP_COOLDOWN_BLOCKS) ? WCET_FRAME_SILENCE
+                                                                   : script[(block - TAP_STARTUP_COOLDOWN_BLOCKS) % cycle];
+        uint64_t start = tap_clock_now_ns();
+        tap_detection_result_e result = tap_detect_status(frames.mic1[frame], frames.mic2[frame], MAX_AUDIO_FRAME_SIZE);
+        uint64_t elapsed = tap_clock_now_ns() - start;
+        if (call < 0) continue;
+
+        histogram_add(&histograms[frame], elapsed);
+        histogram_add(&histograms[WCET_FRAME_COUNT], elapsed);
+        events[result == TAP_DOUBLE ? 2 : (result == TAP_SINGLE ? 1 : 0)]++;
+    }
+
+    uint64_t overhead = timer_overhead_ns();
+    long cycles_run = iterations / cycle;
+    if (strcmp(format, "json") == 0) {
+        printf("{\n  \"benchmark\": \"tap_wcet\",\n  \"detector_version\": %d,\n  \"frame_size\": %d,\n", TAP_DETECT_VERSION, MAX_AUDIO_FRAME_SIZE);
+        printf("  \"iterations\": %ld,\n  \"timer_overhead_ns\": %llu,\n  \"single_taps\": %ld,\n  \"double_taps\": %ld,\n  \"frames\": [\n",
+               iterations, (unsigned long long)overhead, events[1], events[2]);
+        for (int f = 0; f <= WCET_FRAME_COUNT; f++) {
+            const wcet_histogram_t* h = &histograms[f];
+            printf("    {\"frame\": \"%s\", \"calls\": %llu, \"mean_ns\": %.1f, \"p50_ns\": %.0f, \"p99_ns\": %.0f, "
+                   "\"p9999_ns\": %.0f, \"max_ns\": %llu}%s\n",
+                   f < WCET_FRAME_COUNT ? frame_names[f] : "all", (unsigned long long)h->calls,
+                   h->calls ? h->sum_ns / h->calls : 0.0, histogram_percentile(h, 0.50), histogram_percentile(h, 0.99),
+                   histogram_percentile(h, 0.9999), (unsigned long long)h->max_ns, f < WCET_FRAME_COUNT ? "," : "");
+        }
+        printf("  ]\n}\n");
+    } else {
+        printf("--- tap_detect_status() worst-case latency (%ld calls, script cycle %ld blocks) ---\n", iterations, cycle);
+        printf("Events: %ld single, %ld double (expected about %ld and %ld)\n", events[1], events[2], 2 * cycles_run, cycles_run);
+        printf("Frame        |     calls |  mean ns |   p50 |   p99 | p99.99 |    max\n");
+        for (int f = 0; f <= WCET_FRAME_COUNT; f++) {
+            const wcet_histogram_t* h = &histograms[f];
+            if (h->calls == 0) continue;
+            printf("%-12s | %9llu | %8.1f | %5.0f | %5.0f | %6.0f | %6llu\n", f < WCET_FRAME_COUNT ? frame_names[f] : "all",
+                   (unsigned long long)h->calls, h->sum_ns / h->calls, histogram_percentile(h, 0.50),
+                   histogram_percentile(h, 0.99), histogram_percentile(h, 0.9999), (unsigned long long)h->max_ns);
+        }
+        printf("Latencies include about %llu ns of timer overhead per call; max is sensitive to interrupts and preemption.\n",
+               (unsigned long long)overhead);
+    }
+
+    free(script);
+    free(histograms);
+    return 0;
+}
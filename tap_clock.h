@@ -0,0 +1,10 @@
+#ifndef TAP_CLOCK_H
+#define TAP_CLOCK_H
+#include <stdint.h>
+
+// --- Monotonic Clock ---
+// Wall-clock time source for benchmarks and stage timings, unaffected by system time changes.
+
+uint64_t tap_clock_now_ns(void);
+
+#endif // !TAP_CLOCK_H
@@ -1,22 +1,77 @@
 #include <stdio.h>   // For memory allocation (malloc, free), random numbers (rand, srand)
 #include "tap_detect.h"
+#include "tap_opcount.h"
+#include "tap_stage_timer.h"
+#include "tap_share.h"
+#include "tap_trace.h"
 
-// --- Static Buffers for DSP Operations ---
-// These buffers are allocated in static memory (e.g., .data or .bss section) at compile time.
-// They consume memory constantly but avoid runtime dynamic allocation overhead.
+// --- Static Detector Instance ---
+// The firmware runs a single detector through tap_detect_status(). Its context (including the DSP buffers)
+// is allocated in static memory (e.g., .data or .bss section) at compile time.
+// It consumes memory constantly but avoids runtime dynamic allocation overhead.
 
-static int coeff_cd1[MAX_CD1_LEN]                = { 0 };
-static int analysis_sig[MAX_SIG_LEN_SIZE]        = { 0 };
+static tap_detect_ctx_t default_ctx;
+static bool             default_ctx_initialized = false;
 
-typedef enum
+#ifdef TAP_DETECT_OPCOUNT
+uint32_t tap_detect_opcount[TAP_STAGE_COUNT][TAP_OP_COUNT];
+#endif
+
+// --- RAM Budget Check ---
+#ifdef TAP_DETECT_STAGE_TIMING
+#define CTX_INSTRUMENTATION_BYTES sizeof(((tap_detect_ctx_t *)0)->timing)
+#else
+#define CTX_INSTRUMENTATION_BYTES 0
+#endif
+#define FIRMWARE_STATIC_BYTES (sizeof(default_ctx) - CTX_INSTRUMENTATION_BYTES + sizeof(default_ctx_initialized))
+
+_Static_assert(FIRMWARE_STATIC_BYTES <= TAP_DETECT_RAM_BUDGET_BYTES,
+               "tap_detect static RAM exceeds TAP_DETECT_RAM_BUDGET_BYTES; see tap_detection_utility --memory");
+
+// Bytes of one detector context as built, including host-only instrumentation.
+size_t tap_detect_ctx_bytes(void)
+{
+    return sizeof(tap_detect_ctx_t);
+}
+
+// Static RAM of the firmware detector as checked against TAP_DETECT_RAM_BUDGET_BYTES.
+size_t tap_detect_static_bytes(void)
+{
+    return FIRMWARE_STATIC_BYTES;
+}
+
+// Peak test comparisons: on the coefficient already loaded, and on a neighbour that has to be loaded first
+#define PEAK_CMP(expr)      TAP_OP_EXPR(TAP_STAGE_PEAKS, TAP_OP_CMP, 1, expr)
+#define PEAK_CMP_LOAD(expr) TAP_OP_EXPR(TAP_STAGE_PEAKS, TAP_OP_LOAD, 1, PEAK_CMP(expr))
+// State machine test: a comparison after the given number of state loads and subtractions
+#define SEQ_TEST(loads, adds, expr) \
+    TAP_OP_EXPR(TAP_STAGE_SEQUENCE, TAP_OP_LOAD, loads, TAP_OP_EXPR(TAP_STAGE_SEQUENCE, TAP_OP_ADD, adds, TAP_OP_EXPR(TAP_STAGE_SEQUENCE, TAP_OP_CMP, 1, expr)))
+
+// --- Processing Stages ---
+// Each stage is also called in isolation by the benchmark harness (tap_bench.c).
+
+void tap_detect_mix_mics(const int *mic1_sig, const int *mic2_sig, int *out_sig, int sig_len)
 {
-    TAP_STATE_IDLE = 0,
-    TAP_STATE_WAITING_FOR_SECOND
-} tap_detection_state_e;
+    // Branch-free loop: two loads, one add, one shift and one store per sample
+    TAP_OPS(TAP_STAGE_MIX, TAP_OP_LOAD, 2 * sig_len);
+    TAP_OPS(TAP_STAGE_MIX, TAP_OP_ADD, sig_len);
+    TAP_OPS(TAP_STAGE_MIX, TAP_OP_SHIFT, sig_len);
+    TAP_OPS(TAP_STAGE_MIX, TAP_OP_STORE, sig_len);
+    for (int n = 0; n < sig_len; n++)
+    {
+        out_sig[n] = (mic1_sig[n] + mic2_sig[n]) >> 1;
+    }
+}
 
-static void tap_detect_haar_dwt_l1(const int *inp_sig, int sig_len, int *coeff_cd1, int *cd_len_out)
+void tap_detect_haar_dwt_l1(const int *inp_sig, int sig_len, int *coeff_cd1, int *cd_len_out)
 {
     *cd_len_out = sig_len >> 1;
+    TAP_OPS(TAP_STAGE_DWT, TAP_OP_SHIFT, 1);
+    TAP_OPS(TAP_STAGE_DWT, TAP_OP_STORE, 1);
+    // Branch-free loop: two loads, one subtraction and one store per coefficient
+    TAP_OPS(TAP_STAGE_DWT, TAP_OP_LOAD, 2 * (sig_len >> 1));
+    TAP_OPS(TAP_STAGE_DWT, TAP_OP_ADD, sig_len >> 1);
+    TAP_OPS(TAP_STAGE_DWT, TAP_OP_STORE, sig_len >> 1);
     for (int n = 0; n < *cd_len_out; n++)
     {
         coeff_cd1[n] = inp_sig[(n << 1) + 1] - inp_sig[(n << 1)];
@@ -24,167 +79,450 @@ static void tap_detect_haar_dwt_l1(const int *inp_sig, int sig_len, int *coeff_c
 }
 
 // --- Peak Detection Logic (Simplified for Embedded, Static Memory) ---
-static void tap_detect_find_peaks(int *inp_sig, int sig_len, int min_threshold, int max_threshold, int *num_peaks_out)
+// Counts local maxima of cD1 within [min_threshold, max_threshold]. Coefficients at or above min_threshold are
+// candidates; the ones above max_threshold are rejected before the neighbour comparisons. If peak_pos_out is not NULL
+// it receives the index of every peak (up to MAX_CD1_LEN of them); the detector itself passes NULL.
+void tap_detect_find_peaks(const int *inp_sig, int sig_len, int min_threshold, int max_threshold, int *num_peaks_out,
+                           int *num_candidates_out, int *num_rejected_out, uint8_t *peak_pos_out)
 {
     // n = 0
-    if ((inp_sig[0] >= min_threshold) && (inp_sig[0] <= max_threshold) && (inp_sig[0] > inp_sig[1]))
+    TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_LOAD, 1);
+    if (PEAK_CMP(inp_sig[0] >= min_threshold))
     {
-        *num_peaks_out += 1;
+        TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_ADD, 1);
+        *num_candidates_out += 1;
+        if (!PEAK_CMP(inp_sig[0] <= max_threshold))
+        {
+            TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_ADD, 1);
+            *num_rejected_out += 1;
+        }
+        else if (PEAK_CMP_LOAD(inp_sig[0] > inp_sig[1]))
+        {
+            TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_ADD, 1);
+            if (peak_pos_out)
+            {
+                peak_pos_out[*num_peaks_out] = 0;
+            }
+            *num_peaks_out += 1;
+        }
     }
     for (int n = 1; n < (sig_len - 1); n++)
     {
-        if ((inp_sig[n] >= min_threshold) && (inp_sig[n] <= max_threshold) && (inp_sig[n] > inp_sig[n - 1]) && (inp_sig[n] > inp_sig[n + 1]))
+        TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_LOAD, 1);
+        if (PEAK_CMP(inp_sig[n] >= min_threshold))
         {
-            *num_peaks_out += 1;
+            TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_ADD, 1);
+            *num_candidates_out += 1;
+            if (!PEAK_CMP(inp_sig[n] <= max_threshold))
+            {
+                TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_ADD, 1);
+                *num_rejected_out += 1;
+            }
+            else if (PEAK_CMP_LOAD(inp_sig[n] > inp_sig[n - 1]) && PEAK_CMP_LOAD(inp_sig[n] > inp_sig[n + 1]))
+            {
+                TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_ADD, 1);
+                if (peak_pos_out)
+                {
+                    peak_pos_out[*num_peaks_out] = (uint8_t)n;
+                }
+                *num_peaks_out += 1;
+            }
         }
     }
 
     // n = sig_len - 1
-    if ((inp_sig[(sig_len - 1)] >= min_threshold) && (inp_sig[(sig_len - 1)] <= max_threshold) && (inp_sig[(sig_len - 1)] > inp_sig[(sig_len - 2)]))
+    TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_LOAD, 1);
+    if (PEAK_CMP(inp_sig[(sig_len - 1)] >= min_threshold))
     {
-        *num_peaks_out += 1;
+        TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_ADD, 1);
+        *num_candidates_out += 1;
+        if (!PEAK_CMP(inp_sig[(sig_len - 1)] <= max_threshold))
+        {
+            TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_ADD, 1);
+            *num_rejected_out += 1;
+        }
+        else if (PEAK_CMP_LOAD(inp_sig[(sig_len - 1)] > inp_sig[(sig_len - 2)]))
+        {
+            TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_ADD, 1);
+            if (peak_pos_out)
+            {
+                peak_pos_out[*num_peaks_out] = (uint8_t)(sig_len - 1);
+            }
+            *num_peaks_out += 1;
+        }
     }
 }
 
-static int32_t cooldown_block_cnt = 100;
-static int32_t block_cnt_since_last_tap = 0;
-static int32_t current_block_cnt = 0;
-static int32_t last_tap_detected_block_cnt = 0;
-static tap_detection_state_e current_tap_state = TAP_STATE_IDLE;
-/*tap_detection_result_e tap_detect_status(const int *mic1_sig, const int *mic2_sig, int audio_sig_len)
+void tap_detect_config_default(tap_detect_config_t *cfg)
 {
-    tap_detection_result_e result = TAP_NONE;
-    current_block_cnt++;
-    // weighted average mic signals for analysis
-    for (int n = 0; n < audio_sig_len; n++)
-    {
-        analysis_sig[n] = (mic1_sig[n] + mic2_sig[n]) >> 1; // simple averaging
-        //analysis_sig[n] = (3 * mic1_sig[n] + mic2_sig[n]) >> 2; // weighted averaging: 0.75 * mic1, 0.25 * mic2
-        //analysis_sig[n] = (mic1_sig[n] + (3 * mic2_sig[n])) >> 2; // weighted averaging: 0.25 * mic1, 0.75 * mic2
-    }
-
-    // Wavelet transform - use detail coefficients of level 1. Should cover 12000:24000Hz for mic signals sampled at 48kHz
-    int cd_len = 0;
-    tap_detect_haar_dwt_l1(&analysis_sig[0], audio_sig_len, &coeff_cd1[0], &cd_len);
+    cfg->threshold_min            = TRANSIENT_THRESHOLD_MIN_FXP;
+    cfg->threshold_max            = TRANSIENT_THRESHOLD_MAX_FXP;
+    cfg->cooldown_blocks          = TAP_COOLDOWN_BLOCKS;
+    cfg->double_tap_window_blocks = TAP_DOUBLE_TAP_WINDOW_BLOCKS;
+    cfg->shadow_search            = 0;
+}
 
-    // Check if there are any peaks
-    int num_peaks_detected = 0;
-    if (cooldown_block_cnt == 0)
+void tap_detect_init(tap_detect_ctx_t *ctx, const tap_detect_config_t *cfg)
+{
+    if (cfg)
     {
-        tap_detect_find_peaks(&coeff_cd1[0], cd_len, TRANSIENT_THRESHOLD_MIN_FXP, TRANSIENT_THRESHOLD_MAX_FXP, &num_peaks_detected);
+        ctx->cfg = *cfg;
     }
     else
     {
-        // cooldown, no peak detection
-        cooldown_block_cnt--;
+        tap_detect_config_default(&ctx->cfg);
     }
-
-    if (num_peaks_detected > 0)
+    for (int n = 0; n < MAX_CD1_LEN; n++)
     {
-        cooldown_block_cnt = 60;
-
-        if (block_cnt_since_last_tap <= 130)
-        {
-            result = TAP_DOUBLE;
-        }
-        else
-        {
-            result = TAP_SINGLE;
-        }
-        block_cnt_since_last_tap = 0;
+        ctx->coeff_cd1[n] = 0;
     }
-    block_cnt_since_last_tap++;
-
+    for (int n = 0; n < MAX_SIG_LEN_SIZE; n++)
+    {
+        ctx->analysis_sig[n] = 0;
+    }
+    ctx->cooldown_block_cnt   = TAP_STARTUP_COOLDOWN_BLOCKS;
+    ctx->current_block_cnt    = 0;
+    ctx->first_tap_pending    = false;
+    ctx->first_tap_block_time = 0;
+    ctx->event_origin_block   = 0;
+    ctx->block_sample_ts      = 0;
+    ctx->next_sample_ts       = 0;
+    ctx->sample_ts_valid      = false;
+    ctx->cooldown_after_tap   = false;
+    ctx->cooldown_prev_hit    = false;
+    ctx->metrics = (tap_detect_metrics_t){ 0 };
+    ctx->share = NULL;
+    ctx->trace = NULL;
+    TAP_STAGE_TIMER_RESET(ctx);
+}
 
-    return result;// = (num_peaks_detected > 0) ? (TAP_DOUBLE) : (TAP_NONE);
+// Publishes the metrics of every following block of ctx into share for other threads; NULL stops sharing.
+void tap_detect_attach_share(tap_detect_ctx_t *ctx, struct tap_share *share)
+{
+    ctx->share = share;
 }
-*/
 
-// --- Main Tap Detection Logic ---
-// current_block_number must be supplied by the caller and should increment with each processed block.
-// **MINIMAL CHANGES START HERE:** New static variables to manage tap state
-static bool     first_tap_pending = false; // True if a first tap was detected and we are waiting for a second
-static uint32_t first_tap_block_time = 0;  // Stores the block number when the first tap was detected
+// Records every following block of ctx into trace; NULL stops tracing.
+void tap_detect_attach_trace(tap_detect_ctx_t *ctx, struct tap_trace *trace)
+{
+    ctx->trace = trace;
+}
 
-tap_detection_result_e tap_detect_status(const int *mic1_sig, const int *mic2_sig, int audio_sig_len)
+// --- Tap Sequence State Machine ---
+// Turns the raw peak count of the current block into single/double tap events. Called once per block after
+// the block counter has been advanced.
+tap_detection_result_e tap_detect_update_sequence(tap_detect_ctx_t *ctx, int num_peaks_this_block)
 {
     tap_detection_result_e result = TAP_NONE; // Default result for this block
-    current_block_cnt++;                      // Increment global block counter for time reference
-
-    /* --- Signal Processing --- */
-    for (int n = 0; n < audio_sig_len; n++)
-    {
-        analysis_sig[n] = (mic1_sig[n] + mic2_sig[n]) >> 1;
-    }
-
-    int cd_len = 0;
-    tap_detect_haar_dwt_l1(&analysis_sig[0], audio_sig_len, &coeff_cd1[0], &cd_len);
-
-    /* --- Peak Detection with Cooldown/Debounce --- */
-    int num_peaks_this_block = 0; // Counter for raw peaks in current block
-
-    if (cooldown_block_cnt == 0) // Only look for peaks if not in cooldown
-    {
-        tap_detect_find_peaks(&coeff_cd1[0], cd_len, TRANSIENT_THRESHOLD_MIN_FXP, TRANSIENT_THRESHOLD_MAX_FXP, &num_peaks_this_block);
-    }
-    else
-    {
-        cooldown_block_cnt--; // Decrement cooldown timer
-    }
 
     // Determine if a *new, distinct* tap event has occurred based on peak and cooldown
     bool is_new_distinct_tap = (num_peaks_this_block > 0);
+    TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_CMP, 1);
     if (is_new_distinct_tap)
     {
-        cooldown_block_cnt = 40; // Reset cooldown for next peak detection
+        TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_LOAD, 1);
+        TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_STORE, 1);
+        ctx->cooldown_block_cnt = ctx->cfg.cooldown_blocks; // Reset cooldown for next peak detection
+        ctx->cooldown_after_tap = true;
     }
 
-    /* --- Tap Sequence Logic (Minimal Changes Applied Here) --- */
+    /* --- Tap Sequence Logic --- */
 
     if (is_new_distinct_tap) // Logic when a NEW, DEBOUNCED tap is detected in this block
     {
-        if (first_tap_pending)
+        TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_LOAD, 1);
+        TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_CMP, 1);
+        if (ctx->first_tap_pending)
         {
             // We were waiting for a second tap. This is it!
-            uint32_t blocks_since_first_tap = current_block_cnt - first_tap_block_time;
+            TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_LOAD, 2); // first_tap_block_time, double_tap_window_blocks
+            TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_ADD, 1);
+            TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_STORE, 1);
+            TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_CMP, 1);
+            TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_STORE, 2); // Either outcome updates the pending state
+            TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_LOAD, 1);  // Event counter
+            TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_ADD, 1);
+            TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_STORE, 1);
+            uint32_t blocks_since_first_tap = ctx->current_block_cnt - ctx->first_tap_block_time;
+            ctx->event_origin_block = ctx->first_tap_block_time;
 
-            if (blocks_since_first_tap <= 130)
+            if (blocks_since_first_tap <= (uint32_t)ctx->cfg.double_tap_window_blocks)
             {
                 // It's a **VALID DOUBLE TAP!**
                 result = TAP_DOUBLE;
+                ctx->metrics.doubles++;
                 // Reset state to IDLE for next sequence
-                first_tap_pending = false;
-                first_tap_block_time = 0;
+                ctx->first_tap_pending = false;
+                ctx->first_tap_block_time = 0;
             }
             else
             {
                 // This second tap arrived too late.
                 // The *previous* tap (the one that set first_tap_pending) has now effectively timed out as a single tap.
                 result = TAP_SINGLE; // Report the *previous* tap as a single tap
+                ctx->metrics.singles++;
+                ctx->metrics.late_second_taps++;
                 // Now, this *current* tap becomes the start of a new potential sequence.
-                first_tap_pending = true;
-                first_tap_block_time = current_block_cnt; // Record time for this new first tap
+                ctx->first_tap_pending = true;
+                ctx->first_tap_block_time = ctx->current_block_cnt; // Record time for this new first tap
             }
         }
         else // first_tap_pending is false: This is the very first logical tap in a new sequence
         {
-            first_tap_pending = true;
-            first_tap_block_time = current_block_cnt; // Mark its occurrence time
+            TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_STORE, 2);
+            ctx->first_tap_pending = true;
+            ctx->first_tap_block_time = ctx->current_block_cnt; // Mark its occurrence time
             // No result returned yet, as we are waiting for a potential second tap or a timeout for this one.
         }
     }
     else // No new, distinct tap occurred in this block. Check for single tap timeout.
     {
         // If a first tap is pending AND its time window for a second tap has expired
-        if (first_tap_pending && ((current_block_cnt - first_tap_block_time) > 130))
+        if (SEQ_TEST(1, 0, ctx->first_tap_pending) && SEQ_TEST(2, 1, (ctx->current_block_cnt - ctx->first_tap_block_time) > (uint32_t)ctx->cfg.double_tap_window_blocks))
         {
             // **SINGLE TAP concluded by timeout!**
+            TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_STORE, 3);
+            TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_LOAD, 2); // Event counters
+            TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_ADD, 2);
+            TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_STORE, 2);
             result = TAP_SINGLE;
+            ctx->metrics.singles++;
+            ctx->metrics.window_timeouts++;
+            ctx->event_origin_block = ctx->first_tap_block_time;
             // Reset state to IDLE for next sequence
-            first_tap_pending = false;
-            first_tap_block_time = 0;
+            ctx->first_tap_pending = false;
+            ctx->first_tap_block_time = 0;
+        }
+    }
+
+    return result;
+}
+
+// --- Metrics Publication ---
+// Only contexts with an attached share publish; the others keep plain counters.
+static void publish_metrics(tap_detect_ctx_t *ctx)
+{
+    TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_LOAD, 1);
+    TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_CMP, 1);
+    if (ctx->share)
+    {
+        TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_LOAD, 1 + TAP_DETECT_METRICS_FIELDS); // Sequence and counters
+        TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_ADD, 2);
+        TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_STORE, 2 + TAP_DETECT_METRICS_FIELDS);
+        tap_share_publish(ctx->share, &ctx->metrics);
+    }
+}
+
+// Copy of the counters as of the last completed block, for the thread that runs the detector; other threads read
+// an attached tap_share_t with tap_share_read().
+void tap_detect_metrics_snapshot(const tap_detect_ctx_t *ctx, tap_detect_metrics_t *out)
+{
+    *out = ctx->metrics;
+}
+
+// Field names of tap_detect_metrics_t in declaration order, for reports and dashboards.
+const char *tap_detect_metrics_name(int field)
+{
+    static const char *const names[TAP_DETECT_METRICS_FIELDS] = {
+        "blocks", "candidates", "rejected_max", "cooldown_blocks", "lost_to_cooldown",
+        "window_timeouts", "late_second_taps", "singles", "doubles", "skipped_blocks", "duplicate_blocks",
+        "ts_resyncs"
+    };
+    return (field >= 0 && field < (int)TAP_DETECT_METRICS_FIELDS) ? names[field] : NULL;
+}
+
+// --- Post-Mortem Trace ---
+static void record_trace(tap_detect_ctx_t *ctx, int cd_len, int num_peaks, bool searched, tap_detection_result_e result)
+{
+    tap_trace_record_t record;
+    int32_t max_abs = 0;
+    for (int n = 0; n < cd_len; n++)
+    {
+        int32_t value = ctx->coeff_cd1[n];
+        // |INT32_MIN| saturates to INT32_MAX
+        int32_t abs_value = value < 0 ? (value == INT32_MIN ? INT32_MAX : -value) : value;
+        max_abs = FX_MAX(max_abs, abs_value);
+    }
+    record.block       = ctx->current_block_cnt;
+    record.max_abs_cd1 = max_abs;
+    record.cooldown    = (uint16_t)(ctx->cooldown_block_cnt > UINT16_MAX ? UINT16_MAX : ctx->cooldown_block_cnt);
+    record.num_peaks   = (uint8_t)(num_peaks > UINT8_MAX ? UINT8_MAX : num_peaks);
+    record.state       = (uint8_t)((ctx->first_tap_pending ? TAP_TRACE_PENDING : 0) | (searched ? TAP_TRACE_SEARCHED : 0) |
+                                   (result == TAP_SINGLE ? TAP_TRACE_SINGLE : 0) | (result == TAP_DOUBLE ? TAP_TRACE_DOUBLE : 0));
+    tap_trace_write(ctx->trace, &record);
+}
+
+// --- Main Tap Detection Logic ---
+// Each call processes the next block of the stream; the context keeps the block counter used as time reference.
+tap_detection_result_e tap_detect_process(tap_detect_ctx_t *ctx, const int *mic1_sig, const int *mic2_sig, int audio_sig_len)
+{
+#ifdef TAP_DETECT_OPCOUNT
+    for (int stage = 0; stage < TAP_STAGE_COUNT; stage++)
+    {
+        for (int op = 0; op < TAP_OP_COUNT; op++)
+        {
+            tap_detect_opcount[stage][op] = 0;
+        }
+    }
+#endif
+    TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_LOAD, 1);
+    TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_ADD, 1);
+    TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_STORE, 1);
+    TAP_STAGE_TIMER_START(stage_start);
+    ctx->current_block_cnt++; // Increment block counter for time reference
+
+    /* --- Signal Processing --- */
+    tap_detect_mix_mics(mic1_sig, mic2_sig, &ctx->analysis_sig[0], audio_sig_len);
+    TAP_STAGE_TIMER_LAP(ctx, TAP_STAGE_MIX, stage_start);
+
+    int cd_len = 0;
+    tap_detect_haar_dwt_l1(&ctx->analysis_sig[0], audio_sig_len, &ctx->coeff_cd1[0], &cd_len);
+    TAP_STAGE_TIMER_LAP(ctx, TAP_STAGE_DWT, stage_start);
+
+    /* --- Peak Detection with Cooldown/Debounce --- */
+    int num_peaks_this_block = 0; // Counter for raw peaks in current block
+    int num_candidates = 0;
+    int num_rejected = 0;
+
+    TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_LOAD, 1);
+    TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_CMP, 1);
+    bool searched = (ctx->cooldown_block_cnt == 0);
+    if (searched) // Only look for peaks if not in cooldown
+    {
+        TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_LOAD, 2); // Thresholds
+        tap_detect_find_peaks(&ctx->coeff_cd1[0], cd_len, ctx->cfg.threshold_min, ctx->cfg.threshold_max, &num_peaks_this_block,
+                              &num_candidates, &num_rejected, NULL);
+        TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_LOAD, 2); // Candidate and rejection counters
+        TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_ADD, 2);
+        TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_CMP, 1);
+        TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_STORE, 3);
+        ctx->metrics.candidates += (uint32_t)num_candidates;
+        ctx->metrics.rejected_max += (uint32_t)num_rejected;
+        ctx->cooldown_prev_hit = (num_peaks_this_block > 0);
+    }
+    else
+    {
+        TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_ADD, 1);
+        TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_STORE, 1);
+        ctx->cooldown_block_cnt--; // Decrement cooldown timer
+        ctx->metrics.cooldown_blocks++;
+        TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_LOAD, 2); // Cooldown counter and shadow_search
+        TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_ADD, 1);
+        TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_STORE, 1);
+        TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_CMP, 1);
+        if (ctx->cfg.shadow_search)
+        {
+            TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_LOAD, 1); // Cooldown cause
+            TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_CMP, 1);
+            if (ctx->cooldown_after_tap)
+            {
+                // Shadow search (opt-in, as costly as a searched block): a peak that starts after the tap's own
+                // ringing has died down is a tap the cooldown hides
+                int shadow_peaks = 0;
+                TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_LOAD, 2); // Thresholds
+                tap_detect_find_peaks(&ctx->coeff_cd1[0], cd_len, ctx->cfg.threshold_min, ctx->cfg.threshold_max,
+                                      &shadow_peaks, &num_candidates, &num_rejected, NULL);
+                TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_LOAD, 1);
+                TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_CMP, 2);
+                TAP_OPS(TAP_STAGE_PEAKS, TAP_OP_STORE, 1);
+                if (shadow_peaks > 0 && !ctx->cooldown_prev_hit)
+                {
+                    ctx->metrics.lost_to_cooldown++;
+                }
+                ctx->cooldown_prev_hit = (shadow_peaks > 0);
+            }
         }
     }
+    TAP_STAGE_TIMER_LAP(ctx, TAP_STAGE_PEAKS, stage_start);
+
+    tap_detection_result_e result = tap_detect_update_sequence(ctx, num_peaks_this_block);
+    TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_LOAD, 1);
+    TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_ADD, 1);
+    TAP_OPS(TAP_STAGE_SEQUENCE, TAP_OP_STORE, 1);
+    ctx->metrics.blocks++;
+    publish_metrics(ctx);
+    if (ctx->trace)
+    {
+        record_trace(ctx, cd_len, num_peaks_this_block, searched, result);
+    }
+    TAP_STAGE_TIMER_LAP(ctx, TAP_STAGE_SEQUENCE, stage_start);
+    return result;
+}
 
+// Accounts for blocks the caller had to drop (queue overflow, lost transport packets), so the cooldown and the
+// double-tap window keep counting stream time. Dropped blocks are treated as blocks without a tap; a pending
+// first tap whose window expired during them is reported as a single tap.
+tap_detection_result_e tap_detect_skip_blocks(tap_detect_ctx_t *ctx, uint32_t num_blocks)
+{
+    if (num_blocks == 0)
+    {
+        return TAP_NONE;
+    }
+    ctx->current_block_cnt += num_blocks;
+    ctx->block_sample_ts += num_blocks * MAX_AUDIO_FRAME_SIZE;
+    ctx->next_sample_ts += num_blocks * MAX_AUDIO_FRAME_SIZE;
+    uint32_t cooldown = FX_MIN(num_blocks, (uint32_t)ctx->cooldown_block_cnt);
+    ctx->cooldown_block_cnt -= (int32_t)cooldown;
+    ctx->cooldown_prev_hit = false;
+
+    tap_detection_result_e result = tap_detect_update_sequence(ctx, 0);
+    ctx->metrics.cooldown_blocks += cooldown;
+    ctx->metrics.skipped_blocks += num_blocks;
+    publish_metrics(ctx);
     return result;
 }
+
+// --- Timestamped Blocks ---
+// Variant of tap_detect_process() for sources that can lose or repeat blocks (DMA overruns, network packets).
+// sample_ts is the position of the block's first sample on a free-running 32-bit sample clock; elapsed time is the
+// difference to the end of the previous block modulo 2^32, so the clock may wrap. Missing time is rounded to whole
+// blocks and passed to tap_detect_skip_blocks(); a block starting half a block to TAP_MAX_DUPLICATE_BLOCKS blocks
+// before the expected position repeats samples already processed and is ignored. A block further back means the
+// producer restarted its clock (e.g. a restarted capture process): the context re-anchors on the new clock and
+// carries on as if the block followed the previous one, instead of staying silent until the old position comes round.
+tap_detection_result_e tap_detect_process_ts(tap_detect_ctx_t *ctx, const int *mic1_sig, const int *mic2_sig, int audio_sig_len,
+                                             uint32_t sample_ts)
+{
+    tap_detection_result_e skipped = TAP_NONE;
+    if (ctx->sample_ts_valid)
+    {
+        int64_t offset = (int32_t)(sample_ts - ctx->next_sample_ts);
+        int64_t blocks = (offset + (offset < 0 ? -(MAX_AUDIO_FRAME_SIZE / 2) : MAX_AUDIO_FRAME_SIZE / 2)) / MAX_AUDIO_FRAME_SIZE;
+        if (blocks < -TAP_MAX_DUPLICATE_BLOCKS)
+        {
+            ctx->metrics.ts_resyncs++;
+        }
+        else if (blocks < 0)
+        {
+            ctx->metrics.duplicate_blocks++;
+            publish_metrics(ctx);
+            return TAP_NONE;
+        }
+        else
+        {
+            skipped = tap_detect_skip_blocks(ctx, (uint32_t)blocks);
+        }
+    }
+    tap_detection_result_e result = tap_detect_process(ctx, mic1_sig, mic2_sig, audio_sig_len);
+    ctx->sample_ts_valid = true;
+    ctx->block_sample_ts = sample_ts;
+    ctx->next_sample_ts = sample_ts + (uint32_t)audio_sig_len;
+    // A skipped span can only conclude a pending first tap, after which this block cannot report an event
+    return skipped != TAP_NONE ? skipped : result;
+}
+
+// Sample timestamp of the block holding the first tap of the last reported event, for timestamped streams.
+uint32_t tap_detect_event_origin_ts(const tap_detect_ctx_t *ctx)
+{
+    return ctx->block_sample_ts - (ctx->current_block_cnt - ctx->event_origin_block) * MAX_AUDIO_FRAME_SIZE;
+}
+
+tap_detection_result_e tap_detect_status(const int *mic1_sig, const int *mic2_sig, int audio_sig_len)
+{
+    if (!default_ctx_initialized)
+    {
+        tap_detect_init(&default_ctx, NULL);
+        default_ctx_initialized = true;
+    }
+    return tap_detect_process(&default_ctx, mic1_sig, mic2_sig, audio_sig_len);
+}
@@ -1,6 +1,7 @@
 #ifndef TAP_DETECT_H
 #define TAP_DETECT_H
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 
 // IMPORTANT: This defines the maximum FRAME SIZE (chunk of audio) your system will process at once.
@@ -42,6 +43,9 @@
 // Fixed-point maximum value (new utility macro)
 #define FX_MAX(a, b)    ((a) > (b) ? (a) : (b))
 
+// Fixed-point minimum value
+#define FX_MIN(a, b)    ((a) < (b) ? (a) : (b))
+
 #define TRANSIENT_THRESHOLD_MIN_FLOAT (0.0075f)
 #define TRANSIENT_THRESHOLD_MAX_FLOAT (0.0150f)
 #define TRANSIENT_THRESHOLD_MIN_FXP   (int)(16106127)
@@ -54,6 +58,15 @@
 #define TAP_INTERVAL_SAMPLES      (TAP_INTERVAL_MS * 48) /* 48KHz sampling rate */
 #define TAP_INTERVAL_BLOCKS       ((TAP_INTERVAL_SAMPLES + MAX_AUDIO_FRAME_SIZE - 1)/MAX_AUDIO_FRAME_SIZE)
 
+// Detector algorithm version. Bump whenever a change alters the events reported for the same input and
+// configuration, so stored evaluation results (see result_cache.h) are invalidated.
+#define TAP_DETECT_VERSION            (1)
+
+#define TAP_STARTUP_COOLDOWN_BLOCKS   (100) /* blocks ignored after start-up before peaks are searched. */
+#define TAP_COOLDOWN_BLOCKS           (40)  /* debounce after a detected tap. */
+#define TAP_DOUBLE_TAP_WINDOW_BLOCKS  (130) /* max blocks between the two taps of a double tap. */
+#define TAP_MAX_DUPLICATE_BLOCKS      (4)   /* timestamped blocks further back than this restart the sample clock. */
+
 typedef enum
 {
     TAP_NONE = 0,
@@ -61,7 +74,121 @@ typedef enum
     TAP_DOUBLE = 1 << 16
 } tap_detection_result_e;
 
+// --- Detector Configuration ---
+// Tunable parameters of the detector. tap_detect_config_default() fills in the values the firmware ships with.
+typedef struct
+{
+    int32_t threshold_min;            /* Q2.29 lower bound for a cD1 peak to count as a tap transient. */
+    int32_t threshold_max;            /* Q2.29 upper bound; larger peaks are treated as handling noise. */
+    int32_t cooldown_blocks;          /* blocks without peak search after a detected tap. */
+    int32_t double_tap_window_blocks; /* a second tap within this many blocks makes a double tap. */
+    int32_t shadow_search;            /* nonzero: peak-search post-tap cooldown blocks too, to count lost_to_cooldown. */
+} tap_detect_config_t;
+
+// Individual processing stages, in the order tap_detect_process() runs them.
+typedef enum
+{
+    TAP_STAGE_MIX = 0,  // Averaging of the two microphones
+    TAP_STAGE_DWT,      // Level-1 Haar detail coefficients
+    TAP_STAGE_PEAKS,    // Cooldown gate and peak search
+    TAP_STAGE_SEQUENCE, // Single/double tap state machine
+    TAP_STAGE_COUNT
+} tap_detect_stage_e;
+
+#ifdef TAP_DETECT_STAGE_TIMING
+// Per-stage timer accumulators, present only in builds with -DTAP_DETECT_STAGE_TIMING (see tap_stage_timer.h).
+#define TAP_STAGE_TIMER_BINS (160) /* four histogram bins per power of two of timer ticks. */
+typedef struct
+{
+    uint64_t calls;
+    uint64_t total_ticks;
+    uint64_t max_ticks;
+    uint32_t hist[TAP_STAGE_TIMER_BINS];
+} tap_stage_timing_t;
+#endif
+
+// --- Detector Metrics ---
+// Counters explaining why taps were or were not reported. They accumulate from tap_detect_init() and wrap at
+// 2^32; read them on the detector's thread with tap_detect_metrics_snapshot(), or from other threads through an
+// attached tap_share_t (see tap_share.h).
+typedef struct
+{
+    uint32_t blocks;           /* blocks processed. */
+    uint32_t candidates;       /* cD1 coefficients at or above threshold_min in searched blocks. */
+    uint32_t rejected_max;     /* candidates above threshold_max, discarded as handling noise. */
+    uint32_t cooldown_blocks;  /* blocks without peak search (start-up and post-tap cooldown). */
+    uint32_t lost_to_cooldown; /* onsets of peaks during a post-tap cooldown; only counted with cfg.shadow_search. */
+    uint32_t window_timeouts;  /* single taps concluded by the double-tap window expiring. */
+    uint32_t late_second_taps; /* second taps after the window; the first tap is reported as single. */
+    uint32_t singles;
+    uint32_t doubles;
+    uint32_t skipped_blocks;   /* blocks the caller dropped, or missing between timestamped blocks. */
+    uint32_t duplicate_blocks; /* timestamped blocks ignored because their samples were already processed. */
+    uint32_t ts_resyncs;       /* timestamped blocks too far behind to be repeats; the sample clock was re-anchored. */
+} tap_detect_metrics_t;
+
+#define TAP_DETECT_METRICS_FIELDS (sizeof(tap_detect_metrics_t) / sizeof(uint32_t))
+
+struct tap_trace; // Post-mortem trace ring, see tap_trace.h
+struct tap_share; // Cross-thread copy of the metrics, see tap_share.h
+
+// --- Detector Context ---
+// All state of one detector instance. The firmware uses a single static instance through tap_detect_status();
+// host tools create one context per stream or worker thread so several detectors can run side by side.
+typedef struct
+{
+    tap_detect_config_t cfg;
+    int      coeff_cd1[MAX_CD1_LEN];
+    int      analysis_sig[MAX_SIG_LEN_SIZE];
+    int32_t  cooldown_block_cnt;
+    uint32_t current_block_cnt;    // Blocks of stream time since init, wraps modulo 2^32
+    bool     first_tap_pending;    // True if a first tap was detected and we are waiting for a second
+    bool     cooldown_after_tap;   // The running cooldown was started by a tap, not by start-up
+    bool     cooldown_prev_hit;    // The previous block had peaks (searched or, during cooldown, shadowed)
+    bool     sample_ts_valid;      // A timestamped block has been processed since init
+    uint32_t first_tap_block_time; // Stores the block number when the first tap was detected
+    uint32_t event_origin_block;   // Block of the first tap belonging to the last reported event
+    uint32_t block_sample_ts;      // Sample timestamp of block current_block_cnt (tap_detect_process_ts() only)
+    uint32_t next_sample_ts;       // Timestamp the next block is expected to start at
+    tap_detect_metrics_t metrics;  // Updated by the detector during the block
+    struct tap_share *share;       // Optional copy of metrics for other threads, NULL when not shared
+    struct tap_trace *trace;       // Optional post-mortem trace ring, NULL when not tracing
+#ifdef TAP_DETECT_STAGE_TIMING
+    tap_stage_timing_t timing[TAP_STAGE_COUNT];
+#endif
+} tap_detect_ctx_t;
+
+// --- RAM Budget ---
+// Upper bound on the static RAM of the firmware detector (the tap_detect_status() instance), enforced at compile
+// time in tap_detect.c. Host-only instrumentation (stage timers) is not counted. Override with
+// -DTAP_DETECT_RAM_BUDGET_BYTES=<bytes> to match the SRAM set aside for the detector.
+#ifndef TAP_DETECT_RAM_BUDGET_BYTES
+#define TAP_DETECT_RAM_BUDGET_BYTES (1536)
+#endif
+
+size_t tap_detect_ctx_bytes(void);
+size_t tap_detect_static_bytes(void);
+
+void tap_detect_config_default(tap_detect_config_t *cfg);
+void tap_detect_init(tap_detect_ctx_t *ctx, const tap_detect_config_t *cfg);
+tap_detection_result_e tap_detect_process(tap_detect_ctx_t *ctx, const int *mic1_sig, const int *mic2_sig, int audio_sig_len);
+tap_detection_result_e tap_detect_skip_blocks(tap_detect_ctx_t *ctx, uint32_t num_blocks);
+tap_detection_result_e tap_detect_process_ts(tap_detect_ctx_t *ctx, const int *mic1_sig, const int *mic2_sig, int audio_sig_len,
+                                             uint32_t sample_ts);
+uint32_t tap_detect_event_origin_ts(const tap_detect_ctx_t *ctx);
+
 tap_detection_result_e tap_detect_status(const int *mic1_sig, const int *mic2_sig, int audio_sig_len);
 
+void tap_detect_metrics_snapshot(const tap_detect_ctx_t *ctx, tap_detect_metrics_t *out);
+const char *tap_detect_metrics_name(int field);
+void tap_detect_attach_share(tap_detect_ctx_t *ctx, struct tap_share *share);
+void tap_detect_attach_trace(tap_detect_ctx_t *ctx, struct tap_trace *trace);
+
+void tap_detect_mix_mics(const int *mic1_sig, const int *mic2_sig, int *out_sig, int sig_len);
+void tap_detect_haar_dwt_l1(const int *inp_sig, int sig_len, int *coeff_cd1, int *cd_len_out);
+void tap_detect_find_peaks(const int *inp_sig, int sig_len, int min_threshold, int max_threshold, int *num_peaks_out,
+                           int *num_candidates_out, int *num_rejected_out, uint8_t *peak_pos_out);
+tap_detection_result_e tap_detect_update_sequence(tap_detect_ctx_t *ctx, int num_peaks_this_block);
+
 
 #endif // !TAP_DETECT_H
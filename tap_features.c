@@ -0,0 +1,329 @@
+#include <stdio.h>    // For file I/O and console output
+#include <stdlib.h>   // For realloc, free, atof
+#include <string.h>   // For memcpy, memcmp, memset, strcmp
+
+#include "tap_features.h"
+#include "tap_trace.h"
+#include "tap_clock.h"
+#include "corpus_cache.h"
+
+#define FEATURES_MIN_CAPACITY (4096)
+
+// --- Encoding ---
+
+static void buffer_reserve(tap_features_writer_t* writer, tap_features_buffer_t* buffer, size_t extra) {
+    if (buffer->size + extra <= buffer->capacity) return;
+    size_t capacity = buffer->capacity ? buffer->capacity * 2 : FEATURES_MIN_CAPACITY;
+    while (capacity < buffer->size + extra) capacity *= 2;
+    uint8_t* data = (uint8_t*)realloc(buffer->data, capacity);
+    if (!data) {
+        writer->failed = 1;
+        return;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+}
+
+static void put_byte(tap_features_writer_t* writer, tap_feature_e column, uint8_t value) {
+    tap_features_buffer_t* buffer = &writer->columns[column];
+    buffer_reserve(writer, buffer, 1);
+    if (writer->failed) return;
+    buffer->data[buffer->size++] = value;
+}
+
+static void put_varint(tap_features_writer_t* writer, tap_feature_e column, uint64_t value) {
+    tap_features_buffer_t* buffer = &writer->columns[column];
+    buffer_reserve(writer, buffer, 10);
+    if (writer->failed) return;
+    while (value >= 0x80) {
+        buffer->data[buffer->size++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer->data[buffer->size++] = (uint8_t)value;
+}
+
+// Zigzag maps small negative and positive differences to small unsigned values.
+static void put_delta(tap_features_writer_t* writer, tap_feature_e column, int64_t value, int64_t* prev) {
+    uint64_t delta = (uint64_t)value - (uint64_t)*prev;
+    put_varint(writer, column, (delta << 1) ^ (uint64_t)((int64_t)delta >> 63));
+    *prev = value;
+}
+
+static int get_varint(const uint8_t** pos, const uint8_t* end, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*pos >= end) return -1;
+        uint8_t byte = *(*pos)++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int get_delta(const uint8_t** pos, const uint8_t* end, int64_t* value) {
+    uint64_t zigzag;
+    if (get_varint(pos, end, &zigzag) != 0) return -1;
+    *value = (int64_t)((uint64_t)*value + ((zigzag >> 1) ^ (0 - (zigzag & 1))));
+    return 0;
+}
+
+// --- Writer ---
+
+void tap_features_writer_init(tap_features_writer_t* writer) {
+    memset(writer, 0, sizeof(*writer));
+}
+
+/**
+ * @brief Appends the features of the block tap_detect_process() just processed.
+ * @param frame_len Samples in the block.
+ * @param searched Whether the block was searched for peaks (cooldown_block_cnt was 0 before the call).
+ * @param result The value tap_detect_process() returned.
+ */
+void tap_features_writer_add(tap_features_writer_t* writer, const tap_detect_ctx_t* ctx, int frame_len, bool searched,
+                             tap_detection_result_e result) {
+    int64_t energy = 0;
+    for (int n = 0; n < frame_len; n++) {
+        energy += ((int64_t)ctx->analysis_sig[n] * ctx->analysis_sig[n]) >> Q_BITS;
+    }
+    int cd_len = frame_len >> 1;
+    int32_t max_abs = 0;
+    for (int n = 0; n < cd_len; n++) {
+        int32_t value = ctx->coeff_cd1[n];
+        int32_t abs_value = value < 0 ? (value == INT32_MIN ? INT32_MAX : -value) : value;
+        if (abs_value > max_abs) max_abs = abs_value;
+    }
+
+    // Peak positions from the detector's own peak finder, so they always match the peaks it counted
+    uint8_t positions[MAX_CD1_LEN];
+    int num_peaks = 0;
+    if (searched) {
+        int num_candidates = 0, num_rejected = 0;
+        tap_detect_find_peaks(ctx->coeff_cd1, cd_len, ctx->cfg.threshold_min, ctx->cfg.threshold_max, &num_peaks,
+                              &num_candidates, &num_rejected, positions);
+    }
+
+    uint8_t state = (uint8_t)((ctx->first_tap_pending ? TAP_TRACE_PENDING : 0) | (searched ? TAP_TRACE_SEARCHED : 0) |
+                              (result == TAP_SINGLE ? TAP_TRACE_SINGLE : 0) | (result == TAP_DOUBLE ? TAP_TRACE_DOUBLE : 0));
+    put_delta(writer, TAP_FEATURE_ENERGY, energy, &writer->prev_energy);
+    put_delta(writer, TAP_FEATURE_MAX_CD1, max_abs, &writer->prev_max_cd1);
+    put_delta(writer, TAP_FEATURE_COOLDOWN, ctx->cooldown_block_cnt, &writer->prev_cooldown);
+    put_byte(writer, TAP_FEATURE_STATE, state);
+    put_varint(writer, TAP_FEATURE_NUM_PEAKS, (uint64_t)num_peaks);
+    int prev_pos = 0;
+    for (int i = 0; i < num_peaks; i++) {
+        put_varint(writer, TAP_FEATURE_PEAK_POS, (uint64_t)(positions[i] - prev_pos));
+        prev_pos = positions[i];
+    }
+    writer->num_blocks++;
+    writer->num_peaks += (uint64_t)num_peaks;
+}
+
+/**
+ * @brief Writes the collected columns to a feature trace file.
+ * @return 0 on success, -1 on error.
+ */
+int tap_features_writer_save(const tap_features_writer_t* writer, const char* path, uint32_t samplerate) {
+    if (writer->failed) {
+        fprintf(stderr, "Error: Memory allocation failed while collecting features.\n");
+        return -1;
+    }
+    tap_features_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TAP_FEATURES_MAGIC, sizeof(header.magic));
+    header.version = TAP_FEATURES_VERSION;
+    header.detector_version = TAP_DETECT_VERSION;
+    header.samplerate = samplerate;
+    header.frame_size = MAX_AUDIO_FRAME_SIZE;
+    header.num_blocks = writer->num_blocks;
+    header.num_peaks = writer->num_peaks;
+    header.num_columns = TAP_FEATURE_COUNT;
+
+    tap_features_column_t columns[TAP_FEATURE_COUNT];
+    uint64_t offset = sizeof(header) + sizeof(columns);
+    for (int c = 0; c < TAP_FEATURE_COUNT; c++) {
+        memset(&columns[c], 0, sizeof(columns[c]));
+        columns[c].id = (uint32_t)c;
+        columns[c].offset = offset;
+        columns[c].size = writer->columns[c].size;
+        offset += writer->columns[c].size;
+    }
+
+    FILE* out = fopen(path, "wb");
+    if (!out) {
+        fprintf(stderr, "Error: Cannot create feature trace %s\n", path);
+        return -1;
+    }
+    int status = 0;
+    if (fwrite(&header, sizeof(header), 1, out) != 1 || fwrite(columns, sizeof(columns), 1, out) != 1) status = -1;
+    for (int c = 0; status == 0 && c < TAP_FEATURE_COUNT; c++) {
+        if (writer->columns[c].size > 0 && fwrite(writer->columns[c].data, 1, writer->columns[c].size, out) != writer->columns[c].size) {
+            status = -1;
+        }
+    }
+    if (fclose(out) != 0) status = -1;
+    if (status != 0) fprintf(stderr, "Error: Failed writing feature trace %s\n", path);
+    return status;
+}
+
+void tap_features_writer_free(tap_features_writer_t* writer) {
+    for (int c = 0; c < TAP_FEATURE_COUNT; c++) free(writer->columns[c].data);
+    memset(writer, 0, sizeof(*writer));
+}
+
+// --- Reader ---
+
+/**
+ * @brief Maps a feature trace and validates its header and column table.
+ * @return 0 on success, -1 if the file cannot be mapped or is not a valid trace (reported on stderr).
+ */
+int tap_features_open(tap_features_reader_t* reader, const char* path) {
+    memset(reader, 0, sizeof(*reader));
+    size_t size = 0;
+    const uint8_t* base = (const uint8_t*)corpus_cache_map_readonly(path, &size);
+    if (!base) {
+        fprintf(stderr, "Error: Cannot map feature trace %s\n", path);
+        return -1;
+    }
+    const tap_features_header_t* header = (const tap_features_header_t*)base;
+    int valid = size >= sizeof(*header) && memcmp(header->magic, TAP_FEATURES_MAGIC, sizeof(header->magic)) == 0 &&
+                header->version == TAP_FEATURES_VERSION && header->num_columns >= TAP_FEATURE_COUNT &&
+                header->num_columns <= 64 && size >= sizeof(*header) + header->num_columns * sizeof(tap_features_column_t);
+    for (uint32_t c = 0; valid && c < header->num_columns; c++) {
+        const tap_features_column_t* column = (const tap_features_column_t*)(base + sizeof(*header)) + c;
+        if (column->offset > size || column->size > size - column->offset) {
+            valid = 0;
+        } else if (column->id < TAP_FEATURE_COUNT) {
+            reader->column[column->id] = base + column->offset;
+            reader->column_end[column->id] = base + column->offset + column->size;
+        }
+    }
+    for (int c = 0; valid && c < TAP_FEATURE_COUNT; c++) {
+        if (!reader->column[c]) valid = 0;
+    }
+    if (!valid) {
+        fprintf(stderr, "Error: %s is not a valid feature trace (version %d expected)\n", path, TAP_FEATURES_VERSION);
+        corpus_cache_unmap((void*)base, size);
+        memset(reader, 0, sizeof(*reader));
+        return -1;
+    }
+    reader->base = base;
+    reader->size = size;
+    reader->header = header;
+    return 0;
+}
+
+void tap_features_close(tap_features_reader_t* reader) {
+    if (reader->base) corpus_cache_unmap((void*)reader->base, reader->size);
+    memset(reader, 0, sizeof(*reader));
+}
+
+void tap_features_cursor_init(tap_features_cursor_t* cursor, const tap_features_reader_t* reader) {
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->reader = reader;
+    for (int c = 0; c < TAP_FEATURE_COUNT; c++) cursor->pos[c] = reader->column[c];
+}
+
+/**
+ * @brief Decodes the next block.
+ * @return 1 if a row was decoded, 0 at the end of the trace, -1 if a column is truncated or corrupt.
+ */
+int tap_features_next(tap_features_cursor_t* cursor, tap_features_row_t* row) {
+    const tap_features_reader_t* reader = cursor->reader;
+    if (cursor->next_block >= reader->header->num_blocks) return 0;
+    const uint8_t* const* end = reader->column_end;
+    uint64_t num_peaks;
+    if (get_delta(&cursor->pos[TAP_FEATURE_ENERGY], end[TAP_FEATURE_ENERGY], &cursor->energy) != 0 ||
+        get_delta(&cursor->pos[TAP_FEATURE_MAX_CD1], end[TAP_FEATURE_MAX_CD1], &cursor->max_cd1) != 0 ||
+        get_delta(&cursor->pos[TAP_FEATURE_COOLDOWN], end[TAP_FEATURE_COOLDOWN], &cursor->cooldown) != 0 ||
+        cursor->pos[TAP_FEATURE_STATE] >= end[TAP_FEATURE_STATE] ||
+        get_varint(&cursor->pos[TAP_FEATURE_NUM_PEAKS], end[TAP_FEATURE_NUM_PEAKS], &num_peaks) != 0 || num_peaks > MAX_CD1_LEN) {
+        return -1;
+    }
+    row->block = (uint32_t)(++cursor->next_block);
+    row->energy = cursor->energy;
+    row->max_abs_cd1 = (int32_t)cursor->max_cd1;
+    row->cooldown = (int32_t)cursor->cooldown;
+    row->state = *cursor->pos[TAP_FEATURE_STATE]++;
+    row->num_peaks = (uint32_t)num_peaks;
+    uint64_t pos = 0;
+    for (uint32_t i = 0; i < row->num_peaks; i++) {
+        uint64_t delta;
+        if (get_varint(&cursor->pos[TAP_FEATURE_PEAK_POS], end[TAP_FEATURE_PEAK_POS], &delta) != 0 || pos + delta >= MAX_CD1_LEN) return -1;
+        pos += delta;
+        row->peak_pos[i] = (uint8_t)pos;
+    }
+    return 1;
+}
+
+// --- Scan CLI ---
+
+/**
+ * @brief Entry point for "tap_detection_utility --features-scan <trace>... [--threshold X]". Summarises each
+ *        feature trace and, with --threshold, counts the blocks whose largest |cD1| reaches X (float units).
+ * @return 0 on success, 1 on error.
+ */
+int tap_features_scan_cli(int argc, char* argv[]) {
+    double threshold = -1.0;
+    int num_files = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            num_files++;
+        } else {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+    if (num_files == 0) {
+        fprintf(stderr, "Usage: %s --features-scan <feature_trace>... [--threshold X]\n", argv[0]);
+        return 1;
+    }
+    int32_t threshold_q = threshold >= 0.0 ? (int32_t)(threshold * Q_ONE) : INT32_MAX;
+
+    printf("%-40s | %9s | %7s | %7s | %7s | %10s | %9s\n", "File", "blocks", "peaks", "singles", "doubles", "max|cD1|", ">= thr");
+    uint64_t total_blocks = 0;
+    int status = 0;
+    uint64_t start = tap_clock_now_ns();
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--threshold") == 0) {
+            i++;
+            continue;
+        }
+        tap_features_reader_t reader;
+        if (tap_features_open(&reader, argv[i]) != 0) {
+            status = 1;
+            continue;
+        }
+        tap_features_cursor_t cursor;
+        tap_features_cursor_init(&cursor, &reader);
+        tap_features_row_t row;
+        uint64_t peaks = 0, singles = 0, doubles = 0, over = 0;
+        int32_t max_abs = 0;
+        int rc;
+        while ((rc = tap_features_next(&cursor, &row)) == 1) {
+            peaks += row.num_peaks;
+            singles += (row.state & TAP_TRACE_SINGLE) != 0;
+            doubles += (row.state & TAP_TRACE_DOUBLE) != 0;
+            over += row.max_abs_cd1 >= threshold_q;
+            if (row.max_abs_cd1 > max_abs) max_abs = row.max_abs_cd1;
+        }
+        if (rc < 0) {
+            fprintf(stderr, "Error: %s is corrupt at block %llu\n", argv[i], (unsigned long long)cursor.next_block + 1);
+            status = 1;
+        }
+        printf("%-40s | %9llu | %7llu | %7llu | %7llu | %10.6f | ", argv[i], (unsigned long long)cursor.next_block,
+               (unsigned long long)peaks, (unsigned long long)singles, (unsigned long long)doubles, Q_TO_FLOAT(max_abs));
+        if (threshold >= 0.0) printf("%9llu\n", (unsigned long long)over);
+        else printf("%9s\n", "-");
+        total_blocks += cursor.next_block;
+        tap_features_close(&reader);
+    }
+    double seconds = (double)(tap_clock_now_ns() - start) * 1e-9;
+    printf("Scanned %d file(s), %llu blocks in %.3f s (%.1f Mblocks/s)\n", num_files, (unsigned long long)total_blocks, seconds,
+           seconds > 0.0 ? total_blocks / seconds / 1e6 : 0.0);
+    return status;
+}
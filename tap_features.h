@@ -0,0 +1,115 @@
+#ifndef TAP_FEATURES_H
+#define TAP_FEATURES_H
+#include <stdint.h>
+#include <stddef.h>
+
+#include "tap_detect.h"
+
+// --- Per-Block Feature Trace ---
+// Stores the features the detector computed for every block of a recording (energy of the mixed signal, largest
+// |cD1|, cooldown counter, state bits, peak count and peak positions) so thresholds and sequencing can be
+// re-analysed without decoding audio again.
+//
+// File layout (host byte order): tap_features_header_t, one tap_features_column_t per column, then the column
+// payloads. Each column stores one value per block (peak positions: one per peak, blocks in order). Numeric columns
+// are LEB128 varints of the zigzag-encoded difference to the previous value, so slowly changing features take one
+// or two bytes per block. The reader maps the file and decodes the columns in lockstep.
+
+#define TAP_FEATURES_MAGIC   "TAPFEAT1"
+#define TAP_FEATURES_VERSION (1)
+
+typedef enum
+{
+    TAP_FEATURE_ENERGY = 0, // Sum of squares of the mixed signal, Q2.29; delta varint
+    TAP_FEATURE_MAX_CD1,    // Largest |cD1|, Q2.29; delta varint
+    TAP_FEATURE_COOLDOWN,   // cooldown_block_cnt after the block; delta varint
+    TAP_FEATURE_STATE,      // TAP_TRACE_* state bits; one byte per block
+    TAP_FEATURE_NUM_PEAKS,  // Peaks found by the search; varint
+    TAP_FEATURE_PEAK_POS,   // cD1 index of each peak; delta varint within the block, from 0
+    TAP_FEATURE_COUNT
+} tap_feature_e;
+
+typedef struct
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t detector_version; /* TAP_DETECT_VERSION of the writer. */
+    uint32_t samplerate;
+    uint32_t frame_size;
+    uint64_t num_blocks;
+    uint64_t num_peaks;
+    uint32_t num_columns;
+    uint32_t reserved;
+} tap_features_header_t;
+
+typedef struct
+{
+    uint32_t id;     /* tap_feature_e. */
+    uint32_t reserved;
+    uint64_t offset; /* from the start of the file. */
+    uint64_t size;   /* bytes. */
+} tap_features_column_t;
+
+// --- Writer ---
+typedef struct
+{
+    uint8_t* data;
+    size_t   size;
+    size_t   capacity;
+} tap_features_buffer_t;
+
+typedef struct
+{
+    tap_features_buffer_t columns[TAP_FEATURE_COUNT];
+    uint64_t num_blocks;
+    uint64_t num_peaks;
+    int64_t  prev_energy;
+    int64_t  prev_max_cd1;
+    int64_t  prev_cooldown;
+    int      failed; // An allocation failed; tap_features_writer_save() reports it
+} tap_features_writer_t;
+
+void tap_features_writer_init(tap_features_writer_t* writer);
+void tap_features_writer_add(tap_features_writer_t* writer, const tap_detect_ctx_t* ctx, int frame_len, bool searched,
+                             tap_detection_result_e result);
+int  tap_features_writer_save(const tap_features_writer_t* writer, const char* path, uint32_t samplerate);
+void tap_features_writer_free(tap_features_writer_t* writer);
+
+// --- Reader ---
+typedef struct
+{
+    const uint8_t*               base;
+    size_t                       size;
+    const tap_features_header_t* header;
+    const uint8_t*               column[TAP_FEATURE_COUNT];
+    const uint8_t*               column_end[TAP_FEATURE_COUNT];
+} tap_features_reader_t;
+
+typedef struct
+{
+    uint32_t block;       /* 1-based block number, as current_block_cnt. */
+    int64_t  energy;
+    int32_t  max_abs_cd1;
+    int32_t  cooldown;
+    uint8_t  state;
+    uint32_t num_peaks;
+    uint8_t  peak_pos[MAX_CD1_LEN];
+} tap_features_row_t;
+
+typedef struct
+{
+    const tap_features_reader_t* reader;
+    const uint8_t* pos[TAP_FEATURE_COUNT];
+    uint64_t       next_block;
+    int64_t        energy;
+    int64_t        max_cd1;
+    int64_t        cooldown;
+} tap_features_cursor_t;
+
+int  tap_features_open(tap_features_reader_t* reader, const char* path);
+void tap_features_close(tap_features_reader_t* reader);
+void tap_features_cursor_init(tap_features_cursor_t* cursor, const tap_features_reader_t* reader);
+int  tap_features_next(tap_features_cursor_t* cursor, tap_features_row_t* row);
+int  tap_features_scan_cli(int argc, char* argv[]);
+
+#endif // !TAP_FEATURES_H
@@ -0,0 +1,84 @@
+#include <stdio.h>    // For console output
+#include <stdlib.h>   // For atol
+#include <string.h>   // For strcmp
+
+#include "tap_memory.h"
+#include "tap_detect.h"
+#include "tap_share.h"
+#include "tap_trace.h"
+
+#define CTX_FIELD(field) { #field, offsetof(tap_detect_ctx_t, field), sizeof(((tap_detect_ctx_t*)0)->field) }
+
+typedef struct {
+    const char* name;
+    size_t      offset;
+    size_t      size;
+} memory_field_t;
+
+static const memory_field_t ctx_fields[] = {
+    CTX_FIELD(cfg),
+    CTX_FIELD(coeff_cd1),
+    CTX_FIELD(analysis_sig),
+    CTX_FIELD(cooldown_block_cnt),
+    CTX_FIELD(current_block_cnt),
+    CTX_FIELD(first_tap_pending),
+    CTX_FIELD(cooldown_after_tap),
+    CTX_FIELD(cooldown_prev_hit),
+    CTX_FIELD(sample_ts_valid),
+    CTX_FIELD(first_tap_block_time),
+    CTX_FIELD(event_origin_block),
+    CTX_FIELD(block_sample_ts),
+    CTX_FIELD(next_sample_ts),
+    CTX_FIELD(metrics),
+    CTX_FIELD(share),
+    CTX_FIELD(trace),
+#ifdef TAP_DETECT_STAGE_TIMING
+    CTX_FIELD(timing),
+#endif
+};
+
+/**
+ * @brief Entry point for "tap_detection_utility --memory [--budget BYTES]". Prints the layout of
+ *        tap_detect_ctx_t, the static RAM of the firmware detector and the headroom left in the RAM budget.
+ * @return 0 if the static RAM fits the budget, 2 if it does not, 1 on a usage error.
+ */
+int tap_memory_cli(int argc, char* argv[]) {
+    long budget = TAP_DETECT_RAM_BUDGET_BYTES;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            budget = atol(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s --memory [--budget BYTES]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    size_t ctx_bytes = tap_detect_ctx_bytes();
+    printf("--- tap_detect_ctx_t (%zu bytes, %zu-bit pointers) ---\n", ctx_bytes, sizeof(void*) * 8);
+    printf("%-22s | %6s | %6s\n", "Field", "Offset", "Bytes");
+    size_t end = 0, padding = 0;
+    for (size_t i = 0; i < sizeof(ctx_fields) / sizeof(ctx_fields[0]); i++) {
+        padding += ctx_fields[i].offset - end;
+        printf("%-22s | %6zu | %6zu\n", ctx_fields[i].name, ctx_fields[i].offset, ctx_fields[i].size);
+        end = ctx_fields[i].offset + ctx_fields[i].size;
+    }
+    padding += ctx_bytes - end;
+    printf("%-22s | %6s | %6zu\n", "(padding)", "", padding);
+
+    printf("\n--- Static RAM ---\n");
+    printf("Detector (tap_detect_status instance): %zu bytes\n", tap_detect_static_bytes());
+#ifdef TAP_DETECT_STAGE_TIMING
+    printf("Stage timers (host builds only, not budgeted): %zu bytes per context\n", sizeof(((tap_detect_ctx_t*)0)->timing));
+#endif
+    printf("Post-mortem trace: %zu bytes per traced block, caller-allocated\n", sizeof(tap_trace_record_t));
+    printf("Shared metrics: %zu bytes per shared context, caller-allocated\n", sizeof(tap_share_t));
+
+    long headroom = budget - (long)tap_detect_static_bytes();
+    printf("\nBudget: %ld bytes (TAP_DETECT_RAM_BUDGET_BYTES %s), headroom %ld bytes\n", budget,
+           budget == TAP_DETECT_RAM_BUDGET_BYTES ? "as built" : "overridden", headroom);
+    if (headroom < 0) {
+        fprintf(stderr, "Error: The detector needs %ld bytes more than the budget.\n", -headroom);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,10 @@
+#ifndef TAP_MEMORY_H
+#define TAP_MEMORY_H
+
+// --- Memory Footprint Report ---
+// Layout of the detector context and static RAM of the firmware detector against TAP_DETECT_RAM_BUDGET_BYTES.
+// The Release target prints it after every build; the budget itself is enforced at compile time in tap_detect.c.
+
+int tap_memory_cli(int argc, char* argv[]);
+
+#endif // !TAP_MEMORY_H
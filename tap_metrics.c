@@ -0,0 +1,277 @@
+#include <stdio.h>    // For error messages, vsnprintf
+#include <stdlib.h>   // For malloc, realloc, free
+#include <string.h>   // For strncmp, strstr, strerror
+#include <stdarg.h>   // For va_list
+#include <errno.h>    // For EINTR
+#ifndef _WIN32
+#include <signal.h>   // For blocking SIGINT/SIGTERM in the exporter thread
+#include <pthread.h>  // For the exporter thread
+#include <poll.h>     // For poll
+#include <unistd.h>   // For pipe, read, write, close
+#include <sys/socket.h>
+#include <sys/time.h> // For the scrape timeouts
+#include <netinet/in.h>
+#endif
+
+#include "tap_metrics.h"
+#include "tap_clock.h"
+
+#define METRICS_TICK_NS      (1000000000ull)
+#define METRICS_REQUEST_MAX  (4096)  /* bytes of request line and headers read per scrape. */
+#define METRICS_IO_TIMEOUT_S (2)     /* a scraper that stalls longer is disconnected. */
+
+// Upper bounds of the latency buckets in microseconds; TAP_METRICS_HIST_BUCKETS - 1 of them, then +Inf.
+static const uint32_t bucket_bounds_us[TAP_METRICS_HIST_BUCKETS - 1] = {
+    5, 10, 25, 50, 100, 250, 500, 1000, 2000, 4000, 8000, 16000, 64000
+};
+
+void tap_metrics_hist_init(tap_metrics_hist_t* hist) {
+    for (int b = 0; b < TAP_METRICS_HIST_BUCKETS; b++) atomic_init(&hist->bucket[b], 0);
+    atomic_init(&hist->sum_ns, 0);
+}
+
+void tap_metrics_hist_observe(tap_metrics_hist_t* hist, uint64_t ns) {
+    int b = 0;
+    while (b < TAP_METRICS_HIST_BUCKETS - 1 && ns > (uint64_t)bucket_bounds_us[b] * 1000u) b++;
+    tap_metrics_add(&hist->bucket[b], 1);
+    tap_metrics_add(&hist->sum_ns, ns);
+}
+
+// --- Exposition Format ---
+
+void tap_metrics_printf(tap_metrics_buf_t* buf, const char* format, ...) {
+    if (buf->failed) return;
+    for (;;) {
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buf->data + buf->len, buf->capacity - buf->len, format, args);
+        va_end(args);
+        if (n < 0) {
+            buf->failed = 1;
+            return;
+        }
+        if ((size_t)n < buf->capacity - buf->len) {
+            buf->len += (size_t)n;
+            return;
+        }
+        size_t capacity = buf->capacity * 2 + (size_t)n + 1;
+        char* grown = realloc(buf->data, capacity);
+        if (!grown) {
+            buf->failed = 1;
+            return;
+        }
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+}
+
+void tap_metrics_family(tap_metrics_buf_t* buf, const char* name, const char* type, const char* help) {
+    tap_metrics_printf(buf, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// Buckets are read one by one while the writer keeps going, so _count is taken as the sum of the buckets read,
+// which keeps every scrape internally consistent (+Inf bucket == _count).
+void tap_metrics_write_hist(tap_metrics_buf_t* buf, const char* name, const char* labels, tap_metrics_hist_t* hist) {
+    const char* sep = (labels && labels[0]) ? "," : "";
+    if (!labels) labels = "";
+    uint64_t cumulative = 0;
+    for (int b = 0; b < TAP_METRICS_HIST_BUCKETS; b++) {
+        cumulative += tap_metrics_get(&hist->bucket[b]);
+        if (b < TAP_METRICS_HIST_BUCKETS - 1) {
+            tap_metrics_printf(buf, "%s_bucket{%s%sle=\"%g\"} %llu\n", name, labels, sep, bucket_bounds_us[b] * 1e-6,
+                               (unsigned long long)cumulative);
+        } else {
+            tap_metrics_printf(buf, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, sep, (unsigned long long)cumulative);
+        }
+    }
+    tap_metrics_printf(buf, "%s_sum{%s} %.9f\n", name, labels, tap_metrics_get(&hist->sum_ns) * 1e-9);
+    tap_metrics_printf(buf, "%s_count{%s} %llu\n", name, labels, (unsigned long long)cumulative);
+}
+
+// --- Exporter Thread ---
+#ifndef _WIN32
+
+struct tap_metrics_server_s
+{
+    int                   listen_fd;
+    int                   wake_pipe[2];  // Written by tap_metrics_stop() to end the thread
+    pthread_t             thread;
+    tap_metrics_render_fn render;
+    tap_metrics_tick_fn   tick;
+    void*                 arg;
+    tap_metrics_buf_t     body;          // Reused across scrapes
+};
+
+static int send_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void send_response(int fd, const char* status, const char* content_type, const char* body, size_t body_len) {
+    char header[256];
+    int len = snprintf(header, sizeof(header), "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                       "Connection: close\r\n\r\n", status, content_type, body_len);
+    if (send_all(fd, header, (size_t)len) == 0 && body_len > 0) send_all(fd, body, body_len);
+}
+
+/**
+ * @brief Answers one HTTP request: GET /metrics renders the metrics, anything else gets an error status.
+ *        The connection is closed after the response.
+ */
+static void handle_scrape(tap_metrics_server_t* server, int fd) {
+    struct timeval timeout = { METRICS_IO_TIMEOUT_S, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    char request[METRICS_REQUEST_MAX + 1];
+    size_t have = 0;
+    while (have < METRICS_REQUEST_MAX) {
+        ssize_t n = recv(fd, request + have, METRICS_REQUEST_MAX - have, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        have += (size_t)n;
+        request[have] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
+    }
+    request[have] = '\0';
+
+    static const char not_found[] = "Not found; metrics are at /metrics\n";
+    if (strncmp(request, "GET ", 4) != 0) {
+        send_response(fd, "405 Method Not Allowed", "text/plain", "", 0);
+        return;
+    }
+    const char* path = request + 4;
+    if (strncmp(path, "/metrics", 8) != 0 || (path[8] != ' ' && path[8] != '?')) {
+        send_response(fd, "404 Not Found", "text/plain", not_found, sizeof(not_found) - 1);
+        return;
+    }
+    tap_metrics_buf_t* body = &server->body;
+    body->len = 0;
+    body->failed = 0;
+    if (body->capacity > 0) body->data[0] = '\0';
+    server->render(server->arg, body);
+    if (body->failed) {
+        send_response(fd, "500 Internal Server Error", "text/plain", "", 0);
+        return;
+    }
+    send_response(fd, "200 OK", "text/plain; version=0.0.4; charset=utf-8", body->data, body->len);
+}
+
+static void* exporter_main(void* arg) {
+    tap_metrics_server_t* server = arg;
+    uint64_t next_tick_ns = tap_clock_now_ns();
+    for (;;) {
+        uint64_t now_ns = tap_clock_now_ns();
+        if (now_ns >= next_tick_ns) {
+            if (server->tick) server->tick(server->arg, now_ns);
+            next_tick_ns = now_ns + METRICS_TICK_NS;
+        }
+        struct pollfd fds[2] = { { server->listen_fd, POLLIN, 0 }, { server->wake_pipe[0], POLLIN, 0 } };
+        int timeout_ms = (int)((next_tick_ns - now_ns) / 1000000u) + 1;
+        int ready = poll(fds, 2, timeout_ms);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Error: Metrics endpoint poll failed (%s)\n", strerror(errno));
+            break;
+        }
+        if (fds[1].revents) break;
+        if (fds[0].revents & POLLIN) {
+            int client = accept(server->listen_fd, NULL, NULL);
+            if (client >= 0) {
+                handle_scrape(server, client);
+                close(client);
+            }
+        }
+    }
+    return NULL;
+}
+
+tap_metrics_server_t* tap_metrics_start(int port, tap_metrics_render_fn render, tap_metrics_tick_fn tick, void* arg) {
+    tap_metrics_server_t* server = calloc(1, sizeof(*server));
+    if (!server) {
+        fprintf(stderr, "Error: Memory allocation failed for the metrics endpoint\n");
+        return NULL;
+    }
+    server->render = render;
+    server->tick = tick;
+    server->arg = arg;
+    server->wake_pipe[0] = server->wake_pipe[1] = -1;
+
+    // Loopback only: the endpoint has no authentication
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)port);
+    int one = 1;
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server->listen_fd >= 0) setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (server->listen_fd < 0 || bind(server->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(server->listen_fd, 16) != 0 || pipe(server->wake_pipe) != 0) {
+        fprintf(stderr, "Error: Cannot serve metrics on 127.0.0.1:%d (%s)\n", port, strerror(errno));
+        tap_metrics_stop(server);
+        return NULL;
+    }
+
+    // The stop signals must interrupt the caller's blocking reads, never this thread
+    sigset_t stop_signals, previous;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &previous);
+    int status = pthread_create(&server->thread, NULL, exporter_main, server);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (status != 0) {
+        fprintf(stderr, "Error: Cannot start the metrics exporter thread\n");
+        close(server->wake_pipe[1]);
+        server->wake_pipe[1] = -1;
+        tap_metrics_stop(server);
+        return NULL;
+    }
+    fprintf(stderr, "Serving metrics on http://127.0.0.1:%d/metrics\n", port);
+    return server;
+}
+
+void tap_metrics_stop(tap_metrics_server_t* server) {
+    if (!server) return;
+    if (server->wake_pipe[1] >= 0) {
+        // A running thread sees the pipe become readable and returns
+        while (write(server->wake_pipe[1], "x", 1) < 0 && errno == EINTR) {}
+        pthread_join(server->thread, NULL);
+        close(server->wake_pipe[1]);
+    }
+    if (server->wake_pipe[0] >= 0) close(server->wake_pipe[0]);
+    if (server->listen_fd >= 0) close(server->listen_fd);
+    free(server->body.data);
+    free(server);
+}
+
+#else
+
+struct tap_metrics_server_s
+{
+    int unused;
+};
+
+tap_metrics_server_t* tap_metrics_start(int port, tap_metrics_render_fn render, tap_metrics_tick_fn tick, void* arg) {
+    (void)port;
+    (void)render;
+    (void)tick;
+    (void)arg;
+    fprintf(stderr, "Error: The metrics endpoint is not supported on this platform\n");
+    return NULL;
+}
+
+void tap_metrics_stop(tap_metrics_server_t* server) {
+    (void)server;
+}
+
+#endif
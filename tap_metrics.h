@@ -0,0 +1,62 @@
+#ifndef TAP_METRICS_H
+#define TAP_METRICS_H
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+// --- Prometheus Metrics Endpoint ---
+// Serves metrics of a long-running mode over plain HTTP on 127.0.0.1 in the Prometheus text format (0.0.4), e.g.
+// `curl http://127.0.0.1:9464/metrics`. The threads on the audio path only update counters and histograms they own
+// with relaxed atomic loads and stores (one writer per value, so no locked instructions either); an exporter thread
+// reads them for every scrape and formats the response. Nothing on the audio path ever waits for the exporter, so
+// a slow or stuck scraper cannot stall it. The exporter also calls a tick hook about once a second, from which the
+// owner derives rates such as frames per second.
+
+#define TAP_METRICS_HIST_BUCKETS (14) /* latency buckets of 5 us to 64 ms, plus +Inf. */
+
+// Latency histogram with a single writer thread.
+typedef struct
+{
+    atomic_ullong bucket[TAP_METRICS_HIST_BUCKETS]; /* Non-cumulative counts; the last bucket is +Inf. */
+    atomic_ullong sum_ns;
+} tap_metrics_hist_t;
+
+// Growing response buffer for the render hook.
+typedef struct
+{
+    char*  data;
+    size_t len;
+    size_t capacity;
+    int    failed;   /* An allocation failed; the scrape gets an error response. */
+} tap_metrics_buf_t;
+
+typedef struct tap_metrics_server_s tap_metrics_server_t;
+
+// Called on the exporter thread: for every scrape, and about once a second with tap_clock_now_ns().
+typedef void (*tap_metrics_render_fn)(void* arg, tap_metrics_buf_t* buf);
+typedef void (*tap_metrics_tick_fn)(void* arg, uint64_t now_ns);
+
+// Adds to a counter that only the calling thread writes.
+static inline void tap_metrics_add(atomic_ullong* counter, uint64_t value)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+static inline uint64_t tap_metrics_get(atomic_ullong* counter)
+{
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+void tap_metrics_hist_init(tap_metrics_hist_t* hist);
+void tap_metrics_hist_observe(tap_metrics_hist_t* hist, uint64_t ns);
+
+// Exposition helpers: a family header (# HELP / # TYPE), then its samples.
+void tap_metrics_printf(tap_metrics_buf_t* buf, const char* format, ...);
+void tap_metrics_family(tap_metrics_buf_t* buf, const char* name, const char* type, const char* help);
+void tap_metrics_write_hist(tap_metrics_buf_t* buf, const char* name, const char* labels, tap_metrics_hist_t* hist);
+
+// Binds 127.0.0.1:port and starts the exporter thread with SIGINT/SIGTERM blocked. Returns NULL on error (reported).
+tap_metrics_server_t* tap_metrics_start(int port, tap_metrics_render_fn render, tap_metrics_tick_fn tick, void* arg);
+void tap_metrics_stop(tap_metrics_server_t* server);
+
+#endif // !TAP_METRICS_H
@@ -0,0 +1,242 @@
+#include <stdio.h>    // For console I/O
+#include <stdlib.h>   // For malloc, free, strtod
+#include <string.h>   // For strcmp, strncmp, strcspn, memset
+
+#include "tap_opcount.h"
+#include "wav_io.h"
+
+static const char* const op_names[TAP_OP_COUNT] = { "add", "shift", "cmp", "load", "store" };
+
+/**
+ * @brief Parses "add=1,shift=1,cmp=1,load=2,store=1" into per-operation cycle costs. Unlisted operations keep
+ *        their current cost.
+ * @return 0 on success, -1 on a syntax error (reported on stderr).
+ */
+static int parse_costs(const char* spec, double* costs) {
+    const char* p = spec;
+    while (*p) {
+        size_t name_len = strcspn(p, "=,");
+        int op = -1;
+        for (int i = 0; i < TAP_OP_COUNT; i++) {
+            if (strlen(op_names[i]) == name_len && strncmp(p, op_names[i], name_len) == 0) op = i;
+        }
+        char* end = NULL;
+        double value = (op >= 0 && p[name_len] == '=') ? strtod(p + name_len + 1, &end) : -1.0;
+        if (op < 0 || value < 0.0 || end == p + name_len + 1 || (*end != ',' && *end != '\0')) {
+            fprintf(stderr, "Error: Invalid cost '%.*s' in '%s'\n", (int)strcspn(p, ","), p, spec);
+            return -1;
+        }
+        costs[op] = value;
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return 0;
+}
+
+#ifdef TAP_DETECT_OPCOUNT
+// Per-block operation counts are histogrammed exactly up to this value; larger blocks land in the last bin.
+#define OPCOUNT_HIST_BINS 4096
+#define OPCOUNT_TEXT_BUCKETS 10
+
+static const char* const stage_names[TAP_STAGE_COUNT] = { "mix_mics", "haar_dwt", "find_peaks", "sequence" };
+
+typedef struct {
+    uint64_t total[TAP_OP_COUNT];
+    uint64_t ops_sum;
+    double   cycles_sum;
+    uint32_t ops_min;
+    uint32_t ops_max;
+    uint32_t cycles_max;
+    uint32_t* hist; // OPCOUNT_HIST_BINS counts of operations per block
+} opcount_stage_t;
+
+// Value below which the given fraction of blocks fall.
+static uint32_t hist_percentile(const uint32_t* hist, long blocks, double p) {
+    long rank = (long)(p * (double)(blocks - 1));
+    long seen = 0;
+    for (uint32_t v = 0; v < OPCOUNT_HIST_BINS; v++) {
+        seen += hist[v];
+        if (seen > rank) return v;
+    }
+    return OPCOUNT_HIST_BINS - 1;
+}
+
+static void print_histogram(const char* name, const uint32_t* hist, uint32_t lo, uint32_t hi, long blocks) {
+    printf("\n%s: operations per block\n", name);
+    uint32_t width = (hi - lo) / OPCOUNT_TEXT_BUCKETS + 1;
+    for (uint32_t first = lo; first <= hi; first += width) {
+        uint32_t last = first + width - 1 < hi ? first + width - 1 : hi;
+        long count = 0;
+        for (uint32_t v = first; v <= last; v++) count += hist[v];
+        if (first == last) printf("  %11u  %9ld  %6.2f%%\n", first, count, 100.0 * count / blocks);
+        else printf("  %5u-%-5u  %9ld  %6.2f%%\n", first, last, count, 100.0 * count / blocks);
+    }
+}
+#endif
+
+/**
+ * @brief Entry point for "tap_detection_utility --opcount <wav> [--costs SPEC] [--pj-per-cycle E] [--format text|csv]
+ *        [--shadow-search]". Runs the recording through the detector and reports the operations executed per stage.
+ *        --shadow-search enables the opt-in cooldown shadow search. Requires a build with -DTAP_DETECT_OPCOUNT.
+ * @return 0 on success, 1 on error.
+ */
+int tap_opcount_cli(int argc, char* argv[]) {
+    double costs[TAP_OP_COUNT] = { 1.0, 1.0, 1.0, 1.0, 1.0 };
+    double pj_per_cycle = 0.0;
+    const char* format = "text";
+    const char* input = NULL;
+    tap_detect_config_t cfg;
+    tap_detect_config_default(&cfg);
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--costs") == 0 && i + 1 < argc) {
+            if (parse_costs(argv[++i], costs) != 0) return 1;
+        } else if (strcmp(argv[i], "--pj-per-cycle") == 0 && i + 1 < argc) {
+            pj_per_cycle = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format = argv[++i];
+        } else if (strcmp(argv[i], "--shadow-search") == 0) {
+            cfg.shadow_search = 1;
+        } else if (!input && argv[i][0] != '-') {
+            input = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!input || (strcmp(format, "text") != 0 && strcmp(format, "csv") != 0)) {
+        fprintf(stderr, "Usage: %s --opcount <input_wav> [--costs add=1,shift=1,cmp=1,load=1,store=1] "
+                        "[--pj-per-cycle E] [--format text|csv] [--shadow-search]\n", argv[0]);
+        return 1;
+    }
+
+#ifndef TAP_DETECT_OPCOUNT
+    (void)pj_per_cycle;
+    fprintf(stderr, "Error: This build does not count operations; rebuild with -DTAP_DETECT_OPCOUNT (OpCount target).\n");
+    return 1;
+#else
+    uint32_t samplerate;
+    long num_samples;
+    const fixed_point_t* mic2 = NULL;
+    fixed_point_t* mic1 = read_wav_mics_fx(input, &samplerate, &num_samples, &mic2);
+    if (!mic1) {
+        fprintf(stderr, "Failed to load audio from %s. Exiting.\n", input);
+        return 1;
+    }
+
+    // One entry per stage plus the whole block
+    opcount_stage_t stages[TAP_STAGE_COUNT + 1];
+    memset(stages, 0, sizeof(stages));
+    for (int s = 0; s <= TAP_STAGE_COUNT; s++) {
+        stages[s].ops_min = UINT32_MAX;
+        stages[s].hist = (uint32_t*)calloc(OPCOUNT_HIST_BINS, sizeof(uint32_t));
+        if (!stages[s].hist) {
+            fprintf(stderr, "Error: Memory allocation failed for the operation histograms.\n");
+            for (int t = 0; t <= s; t++) free(stages[t].hist);
+            free(mic1);
+            return 1;
+        }
+    }
+
+    tap_detect_ctx_t ctx;
+    tap_detect_init(&ctx, &cfg);
+    long blocks = 0;
+    // Peak stage operations by path: searched, post-tap cooldown (shadow search, if enabled), other cooldown
+    long path_blocks[3] = { 0, 0, 0 };
+    uint64_t path_ops[3] = { 0, 0, 0 };
+    for (long pos = 0; pos + 2 <= num_samples; pos += MAX_AUDIO_FRAME_SIZE) {
+        int len = num_samples - pos < MAX_AUDIO_FRAME_SIZE ? (int)(num_samples - pos) : MAX_AUDIO_FRAME_SIZE;
+        int path = ctx.cooldown_block_cnt == 0 ? 0 : (ctx.cooldown_after_tap ? 1 : 2);
+        tap_detect_process(&ctx, &mic1[pos], &mic2[pos], len);
+        blocks++;
+        path_blocks[path]++;
+        for (int op = 0; op < TAP_OP_COUNT; op++) path_ops[path] += tap_detect_opcount[TAP_STAGE_PEAKS][op];
+
+        uint32_t block_ops = 0;
+        double block_cycles = 0.0;
+        for (int s = 0; s <= TAP_STAGE_COUNT; s++) {
+            uint32_t ops = 0;
+            double cycles = 0.0;
+            if (s < TAP_STAGE_COUNT) {
+                for (int op = 0; op < TAP_OP_COUNT; op++) {
+                    stages[s].total[op] += tap_detect_opcount[s][op];
+                    ops += tap_detect_opcount[s][op];
+                    cycles += tap_detect_opcount[s][op] * costs[op];
+                }
+                block_ops += ops;
+                block_cycles += cycles;
+            } else {
+                for (int op = 0; op < TAP_OP_COUNT; op++) {
+                    for (int t = 0; t < TAP_STAGE_COUNT; t++) stages[s].total[op] += tap_detect_opcount[t][op];
+                }
+                ops = block_ops;
+                cycles = block_cycles;
+            }
+            opcount_stage_t* st = &stages[s];
+            st->ops_sum += ops;
+            st->cycles_sum += cycles;
+            if (ops < st->ops_min) st->ops_min = ops;
+            if (ops > st->ops_max) st->ops_max = ops;
+            if ((uint32_t)(cycles + 0.5) > st->cycles_max) st->cycles_max = (uint32_t)(cycles + 0.5);
+            st->hist[ops < OPCOUNT_HIST_BINS ? ops : OPCOUNT_HIST_BINS - 1]++;
+        }
+    }
+    free(mic1);
+    if (blocks == 0) {
+        fprintf(stderr, "Error: %s is shorter than one block.\n", input);
+        for (int s = 0; s <= TAP_STAGE_COUNT; s++) free(stages[s].hist);
+        return 1;
+    }
+
+    // Blocks per second of audio turn cycles per block into MCPS and energy per hour
+    double blocks_per_s = (double)samplerate / MAX_AUDIO_FRAME_SIZE;
+    int csv = strcmp(format, "csv") == 0;
+    if (csv) {
+        printf("stage,add,shift,cmp,load,store,ops_mean,ops_min,ops_p50,ops_p99,ops_max,cycles_mean,cycles_max,mcps_mean,mcps_max,mj_per_hour\n");
+    } else {
+        printf("%s: %ld blocks of %d samples at %u Hz\n", input, blocks, MAX_AUDIO_FRAME_SIZE, samplerate);
+        printf("Cycle costs: add=%g shift=%g cmp=%g load=%g store=%g\n\n",
+               costs[TAP_OP_ADD], costs[TAP_OP_SHIFT], costs[TAP_OP_CMP], costs[TAP_OP_LOAD], costs[TAP_OP_STORE]);
+        printf("%-10s | %8s %8s %8s %8s %8s | %8s %6s %6s %6s %6s | %9s %9s", "Stage",
+               "add", "shift", "cmp", "load", "store", "ops/blk", "min", "p50", "p99", "max", "MCPS", "MCPS max");
+        if (pj_per_cycle > 0.0) printf(" | %9s", "mJ/hour");
+        printf("\n");
+    }
+    for (int s = 0; s <= TAP_STAGE_COUNT; s++) {
+        const opcount_stage_t* st = &stages[s];
+        const char* name = s < TAP_STAGE_COUNT ? stage_names[s] : "total";
+        double cycles_mean = st->cycles_sum / blocks;
+        double mcps_mean = cycles_mean * blocks_per_s / 1e6;
+        double mcps_max = st->cycles_max * blocks_per_s / 1e6;
+        double mj_per_hour = cycles_mean * blocks_per_s * 3600.0 * pj_per_cycle * 1e-9;
+        uint32_t p50 = hist_percentile(st->hist, blocks, 0.50);
+        uint32_t p99 = hist_percentile(st->hist, blocks, 0.99);
+        if (csv) {
+            printf("%s", name);
+            for (int op = 0; op < TAP_OP_COUNT; op++) printf(",%.3f", (double)st->total[op] / blocks);
+            printf(",%.3f,%u,%u,%u,%u,%.3f,%u,%.6f,%.6f,%.6f\n", (double)st->ops_sum / blocks, st->ops_min, p50, p99,
+                   st->ops_max, cycles_mean, st->cycles_max, mcps_mean, mcps_max, mj_per_hour);
+        } else {
+            printf("%-10s |", name);
+            for (int op = 0; op < TAP_OP_COUNT; op++) printf(" %8.2f", (double)st->total[op] / blocks);
+            printf(" | %8.2f %6u %6u %6u %6u | %9.4f %9.4f", (double)st->ops_sum / blocks, st->ops_min, p50, p99,
+                   st->ops_max, mcps_mean, mcps_max);
+            if (pj_per_cycle > 0.0) printf(" | %9.4f", mj_per_hour);
+            printf("\n");
+        }
+    }
+    if (!csv) {
+        printf("\nPeak stage by path (ops/blk): %ld searched %.2f, %ld post-tap cooldown %.2f (shadow search %s), "
+               "%ld start-up cooldown %.2f\n", path_blocks[0],
+               path_blocks[0] ? (double)path_ops[0] / path_blocks[0] : 0.0, path_blocks[1],
+               path_blocks[1] ? (double)path_ops[1] / path_blocks[1] : 0.0, cfg.shadow_search ? "on" : "off", path_blocks[2],
+               path_blocks[2] ? (double)path_ops[2] / path_blocks[2] : 0.0);
+        for (int s = 0; s <= TAP_STAGE_COUNT; s++) {
+            const opcount_stage_t* st = &stages[s];
+            uint32_t hi = st->ops_max < OPCOUNT_HIST_BINS ? st->ops_max : OPCOUNT_HIST_BINS - 1;
+            print_histogram(s < TAP_STAGE_COUNT ? stage_names[s] : "total", st->hist, st->ops_min, hi, blocks);
+        }
+    }
+    for (int s = 0; s <= TAP_STAGE_COUNT; s++) free(stages[s].hist);
+    return 0;
+#endif
+}
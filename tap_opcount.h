@@ -0,0 +1,41 @@
+#ifndef TAP_OPCOUNT_H
+#define TAP_OPCOUNT_H
+#include <stdint.h>
+
+#include "tap_detect.h"
+
+// --- Operation Counting Build ---
+// Building with -DTAP_DETECT_OPCOUNT (the OpCount target) makes tap_detect.c count, per stage, the arithmetic
+// operations and memory accesses each block executes. "--opcount" runs a recording through that build and
+// reports per-stage totals and per-block histograms; multiplied by a core's per-operation cycle costs they give
+// an MCPS and energy estimate before a change is ported. In every other build the macros expand to nothing and
+// the detector compiles exactly as before.
+//
+// Counting conventions: only data operations are counted. Loop control and address arithmetic are left out, as
+// DSP targets run them in hardware loops and address generators. Short-circuit comparisons are counted as executed.
+// Reads and writes of detector state count as loads and stores; values kept in registers count once.
+
+typedef enum
+{
+    TAP_OP_ADD = 0, // Additions and subtractions
+    TAP_OP_SHIFT,
+    TAP_OP_CMP,
+    TAP_OP_LOAD,
+    TAP_OP_STORE,
+    TAP_OP_COUNT
+} tap_op_e;
+
+#ifdef TAP_DETECT_OPCOUNT
+// Operations of the current block, reset by every tap_detect_process() call. Single-threaded analysis builds only.
+extern uint32_t tap_detect_opcount[TAP_STAGE_COUNT][TAP_OP_COUNT];
+
+#define TAP_OPS(stage, op, n)           (tap_detect_opcount[(stage)][(op)] += (uint32_t)(n))
+#define TAP_OP_EXPR(stage, op, n, expr) (TAP_OPS(stage, op, n), (expr))
+#else
+#define TAP_OPS(stage, op, n)           ((void)0)
+#define TAP_OP_EXPR(stage, op, n, expr) (expr)
+#endif
+
+int tap_opcount_cli(int argc, char* argv[]);
+
+#endif // !TAP_OPCOUNT_H
@@ -0,0 +1,136 @@
+#include <string.h>   // For memset
+#ifdef __linux__
+#include <errno.h>    // For errno
+#include <stdio.h>    // For the unavailability note
+#include <unistd.h>   // For syscall, read, close
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "tap_perf.h"
+
+static const char* const counter_names[TAP_PERF_COUNT] = {
+    "cycles", "instructions", "branches", "branch_misses", "l1d_misses", "llc_misses"
+};
+
+const char* tap_perf_counter_name(tap_perf_counter_e counter) {
+    return counter_names[counter];
+}
+
+#ifdef __linux__
+static void counter_attr(struct perf_event_attr* attr, tap_perf_counter_e counter) {
+    memset(attr, 0, sizeof(*attr));
+    attr->size = sizeof(*attr);
+    attr->type = PERF_TYPE_HARDWARE;
+    switch (counter) {
+    case TAP_PERF_CYCLES:        attr->config = PERF_COUNT_HW_CPU_CYCLES; break;
+    case TAP_PERF_INSTRUCTIONS:  attr->config = PERF_COUNT_HW_INSTRUCTIONS; break;
+    case TAP_PERF_BRANCHES:      attr->config = PERF_COUNT_HW_BRANCH_INSTRUCTIONS; break;
+    case TAP_PERF_BRANCH_MISSES: attr->config = PERF_COUNT_HW_BRANCH_MISSES; break;
+    case TAP_PERF_L1D_MISSES:
+        attr->type = PERF_TYPE_HW_CACHE;
+        attr->config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    default:                     attr->config = PERF_COUNT_HW_CACHE_MISSES; break;
+    }
+    attr->disabled = 1; // Only the leader's state matters; enabled through the group ioctl
+    attr->read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr->exclude_kernel = 1;
+    attr->exclude_hv = 1;
+}
+#endif
+
+/**
+ * @brief Opens all counters the system allows, as one group.
+ * @return Number of counters opened; 0 if none are available (a note is printed to stderr on Linux).
+ */
+int tap_perf_open(tap_perf_t* perf) {
+    memset(perf, 0, sizeof(*perf));
+    perf->leader = -1;
+    for (int c = 0; c < TAP_PERF_COUNT; c++) perf->fd[c] = -1;
+#ifdef __linux__
+    int first_errno = 0;
+    for (int c = 0; c < TAP_PERF_COUNT; c++) {
+        struct perf_event_attr attr;
+        counter_attr(&attr, (tap_perf_counter_e)c);
+        int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, perf->leader, 0);
+        if (fd < 0) {
+            if (!first_errno) first_errno = errno;
+            continue;
+        }
+        if (perf->leader < 0) perf->leader = fd;
+        perf->fd[c] = fd;
+        perf->num_open++;
+    }
+    if (perf->num_open == 0) {
+        fprintf(stderr, "Note: Hardware performance counters unavailable (%s)%s\n", strerror(first_errno),
+                (first_errno == EACCES || first_errno == EPERM) ? "; check /proc/sys/kernel/perf_event_paranoid" : "");
+    }
+#endif
+    return perf->num_open;
+}
+
+void tap_perf_close(tap_perf_t* perf) {
+#ifdef __linux__
+    // Members first, the leader last
+    for (int c = TAP_PERF_COUNT - 1; c >= 0; c--) {
+        if (perf->fd[c] >= 0 && perf->fd[c] != perf->leader) close(perf->fd[c]);
+    }
+    if (perf->leader >= 0) close(perf->leader);
+#endif
+    memset(perf, 0, sizeof(*perf));
+    perf->leader = -1;
+    for (int c = 0; c < TAP_PERF_COUNT; c++) perf->fd[c] = -1;
+}
+
+// Counting accumulates over start/stop pairs until the next reset.
+void tap_perf_reset(tap_perf_t* perf) {
+#ifdef __linux__
+    if (perf->leader >= 0) ioctl(perf->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+#else
+    (void)perf;
+#endif
+}
+
+void tap_perf_start(tap_perf_t* perf) {
+#ifdef __linux__
+    if (perf->leader >= 0) ioctl(perf->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+    (void)perf;
+#endif
+}
+
+void tap_perf_stop(tap_perf_t* perf) {
+#ifdef __linux__
+    if (perf->leader >= 0) ioctl(perf->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#else
+    (void)perf;
+#endif
+}
+
+/**
+ * @brief Reads the accumulated counts, scaled up to the enabled time if the group was multiplexed. Unavailable
+ *        counters and counters that never ran read as 0 and are no longer reported by tap_perf_available().
+ * @return 0 on success, -1 if no counters are open or a read failed.
+ */
+int tap_perf_read(tap_perf_t* perf, uint64_t values[TAP_PERF_COUNT]) {
+    memset(values, 0, TAP_PERF_COUNT * sizeof(uint64_t));
+    memset(perf->counted, 0, sizeof(perf->counted));
+    if (perf->num_open == 0) return -1;
+#ifdef __linux__
+    for (int c = 0; c < TAP_PERF_COUNT; c++) {
+        if (perf->fd[c] < 0) continue;
+        uint64_t data[3]; // value, time_enabled, time_running
+        if (read(perf->fd[c], data, sizeof(data)) != (ssize_t)sizeof(data)) return -1;
+        if (data[2] == 0) continue;
+        values[c] = data[2] < data[1] ? (uint64_t)((double)data[0] * data[1] / data[2] + 0.5) : data[0];
+        perf->counted[c] = 1;
+    }
+#endif
+    return 0;
+}
+
+int tap_perf_available(const tap_perf_t* perf, tap_perf_counter_e counter) {
+    return perf->fd[counter] >= 0 && perf->counted[counter];
+}
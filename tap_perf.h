@@ -0,0 +1,42 @@
+#ifndef TAP_PERF_H
+#define TAP_PERF_H
+#include <stdint.h>
+
+// --- Hardware Performance Counters ---
+// Thin wrapper around Linux perf_event_open() for the benchmark harness. The counters are opened as one group
+// so they are always scheduled together and cover exactly the same instructions. Counters the CPU, the kernel
+// configuration or perf_event_paranoid do not allow are skipped; on other platforms nothing is available and
+// the benchmarks run with wall-clock timing only. A group the kernel could not keep on the PMU the whole time (e.g.
+// because the NMI watchdog holds a counter) is multiplexed: its counts are scaled up to the enabled time, and a group
+// that never ran reports its counters as unavailable.
+
+typedef enum
+{
+    TAP_PERF_CYCLES = 0,
+    TAP_PERF_INSTRUCTIONS,
+    TAP_PERF_BRANCHES,
+    TAP_PERF_BRANCH_MISSES,
+    TAP_PERF_L1D_MISSES,  // L1 data cache read misses
+    TAP_PERF_LLC_MISSES,  // Last level cache misses
+    TAP_PERF_COUNT
+} tap_perf_counter_e;
+
+typedef struct
+{
+    int fd[TAP_PERF_COUNT]; // -1 if the counter is unavailable
+    int leader;             // Group leader fd, -1 if no counter could be opened
+    int num_open;
+    int counted[TAP_PERF_COUNT]; // The counter ran during the last tap_perf_read() interval
+} tap_perf_t;
+
+int  tap_perf_open(tap_perf_t* perf);
+void tap_perf_close(tap_perf_t* perf);
+void tap_perf_reset(tap_perf_t* perf);
+void tap_perf_start(tap_perf_t* perf);
+void tap_perf_stop(tap_perf_t* perf);
+int  tap_perf_read(tap_perf_t* perf, uint64_t values[TAP_PERF_COUNT]);
+int  tap_perf_available(const tap_perf_t* perf, tap_perf_counter_e counter);
+
+const char* tap_perf_counter_name(tap_perf_counter_e counter);
+
+#endif // !TAP_PERF_H
@@ -0,0 +1,353 @@
+#include <stdio.h>    // For console I/O (fprintf)
+#include <stdlib.h>   // For memory allocation (calloc, free)
+#include <string.h>   // For memset
+#include <errno.h>    // For EAGAIN, EINTR
+#ifdef _WIN32
+#include <io.h>       // For _read
+#else
+#include <unistd.h>   // For read
+#include <fcntl.h>    // For fcntl, O_NONBLOCK
+#endif
+
+#include "tap_pipeline.h"
+#include "tap_clock.h"
+#include "wav_io.h"
+
+#define PIPELINE_CHUNK_BYTES (8192) /* bytes per read; a whole number of mono and stereo frames. */
+#define PIPELINE_CHUNKS      (4)
+#define PIPELINE_BLOCKS      (8)
+#define PIPELINE_RESULTS     (64)
+
+// Source -> decode: raw interleaved 16-bit frames
+typedef struct {
+    long          len;
+    unsigned char bytes[PIPELINE_CHUNK_BYTES];
+} pipeline_chunk_t;
+
+// Decode -> detect: one detector block per mic
+typedef struct {
+    long          len;
+    fixed_point_t mic1[MAX_AUDIO_FRAME_SIZE];
+    fixed_point_t mic2[MAX_AUDIO_FRAME_SIZE];
+} pipeline_block_t;
+
+// Detect -> sink
+typedef struct {
+    long                   len;
+    tap_detection_result_e result;
+} pipeline_result_t;
+
+struct tap_pipeline_s {
+    const char*            input_path;
+    const char*            output_path;
+    FILE*                  log;
+    tap_pipeline_hooks_t   hooks;
+    tap_pipeline_stats_t*  stats;    // The caller's stats, or own_stats
+    tap_pipeline_stats_t   own_stats;
+    int                    status;   // -1 once a stage failed
+    wav_reader_t           reader;
+    wav_writer_t           writer;
+    tap_async_chan_t       chunks;
+    tap_async_chan_t       blocks;
+    tap_async_chan_t       results;
+    tap_async_task_t       source_task;
+    tap_async_task_t       decode_task;
+    tap_async_task_t       detect_task;
+    tap_async_task_t       sink_task;
+    // Source state
+    long                   bytes_left;
+    pipeline_chunk_t*      chunk;          // Chunk being filled
+    // Decode state
+    long                   chunk_offset;   // Bytes of the oldest chunk already decoded
+    pipeline_block_t*      block;          // Block being filled
+    // Detect state
+    tap_detect_ctx_t       ctx;
+    // Sink state
+    long                   frame;
+    uint64_t               write_ns;
+};
+
+#ifdef _WIN32
+static long read_input(int fd, void* buf, size_t len) { return _read(fd, buf, (unsigned int)len); }
+#else
+static long read_input(int fd, void* buf, size_t len) { return (long)read(fd, buf, len); }
+#endif
+
+// --- Stages ---
+
+// Reads the data chunk of the input, yielding after every chunk so other streams on the executor get their turn.
+static tap_async_status_e source_stage(tap_async_task_t* task) {
+    tap_pipeline_t* p = task->arg;
+    TAP_ASYNC_BEGIN(task);
+    while (p->bytes_left > 0) {
+        TAP_ASYNC_AWAIT(task, (p->chunk = tap_async_chan_slot(&p->chunks)) != NULL);
+        p->chunk->len = 0;
+        while (p->chunk->len < PIPELINE_CHUNK_BYTES && p->chunk->len < p->bytes_left) {
+            long want = p->bytes_left < PIPELINE_CHUNK_BYTES ? p->bytes_left : PIPELINE_CHUNK_BYTES;
+            long n = read_input(p->reader.fd, p->chunk->bytes + p->chunk->len, (size_t)(want - p->chunk->len));
+            if (n > 0) {
+                p->chunk->len += n;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && errno == EAGAIN) {
+                TAP_ASYNC_AWAIT_FD(task, p->reader.fd, TAP_ASYNC_IN);
+            } else {
+                // Only pipes and sockets get here: wav_reader_open() rejects truncated regular files
+                long frame_bytes = p->reader.num_channels * (long)sizeof(int16_t);
+                long frames_read = (p->reader.num_samples * frame_bytes - p->bytes_left + p->chunk->len) / frame_bytes;
+                fprintf(stderr, "Error: Could not read sample %ld from WAV file.\n", frames_read);
+                p->status = -1;
+                p->bytes_left = 0;
+                break;
+            }
+        }
+        if (p->status != 0) break;
+        p->bytes_left -= p->chunk->len;
+        tap_async_chan_push(&p->chunks);
+        TAP_ASYNC_YIELD(task);
+    }
+    tap_async_chan_close(&p->chunks);
+    TAP_ASYNC_END(task);
+}
+
+// Returns the block being filled, starting a new one if there is room downstream.
+static pipeline_block_t* open_block(tap_pipeline_t* p) {
+    if (!p->block) {
+        p->block = tap_async_chan_slot(&p->blocks);
+        if (p->block) p->block->len = 0;
+    }
+    return p->block;
+}
+
+// Deinterleaves and converts 16-bit frames to Q2.29 blocks. Mono files feed both detector inputs.
+static tap_async_status_e decode_stage(tap_async_task_t* task) {
+    tap_pipeline_t* p = task->arg;
+    TAP_ASYNC_BEGIN(task);
+    for (;;) {
+        TAP_ASYNC_AWAIT(task, tap_async_chan_peek(&p->chunks) != NULL || tap_async_chan_drained(&p->chunks));
+        if (tap_async_chan_peek(&p->chunks) == NULL) break;
+        while (p->chunk_offset < ((pipeline_chunk_t*)tap_async_chan_peek(&p->chunks))->len) {
+            TAP_ASYNC_AWAIT(task, open_block(p) != NULL);
+            const pipeline_chunk_t* chunk = tap_async_chan_peek(&p->chunks);
+            pipeline_block_t* block = p->block;
+            int channels = p->reader.num_channels;
+            long frame_bytes = channels * (long)sizeof(int16_t);
+            while (block->len < MAX_AUDIO_FRAME_SIZE && p->chunk_offset < chunk->len) {
+                const unsigned char* frame = chunk->bytes + p->chunk_offset;
+                int16_t left = (int16_t)(frame[0] | (frame[1] << 8));
+                int16_t right = channels == 2 ? (int16_t)(frame[2] | (frame[3] << 8)) : left;
+                block->mic1[block->len] = ((fixed_point_t)left << (Q_FORMAT - 15));
+                block->mic2[block->len] = ((fixed_point_t)right << (Q_FORMAT - 15));
+                block->len++;
+                p->chunk_offset += frame_bytes;
+            }
+            if (block->len == MAX_AUDIO_FRAME_SIZE) {
+                tap_async_chan_push(&p->blocks);
+                p->block = NULL;
+            }
+        }
+        tap_async_chan_pop(&p->chunks);
+        p->chunk_offset = 0;
+    }
+    // A last frame needs at least 2 samples for the DWT; a shorter tail is left as silence in the output
+    if (p->block && p->block->len >= 2) tap_async_chan_push(&p->blocks);
+    p->block = NULL;
+    tap_async_chan_close(&p->blocks);
+    TAP_ASYNC_END(task);
+}
+
+static tap_async_status_e detect_stage(tap_async_task_t* task) {
+    tap_pipeline_t* p = task->arg;
+    TAP_ASYNC_BEGIN(task);
+    for (;;) {
+        TAP_ASYNC_AWAIT(task, tap_async_chan_peek(&p->blocks) != NULL || tap_async_chan_drained(&p->blocks));
+        if (tap_async_chan_peek(&p->blocks) == NULL) break;
+        TAP_ASYNC_AWAIT(task, tap_async_chan_slot(&p->results) != NULL);
+        const pipeline_block_t* block = tap_async_chan_peek(&p->blocks);
+        pipeline_result_t* out = tap_async_chan_slot(&p->results);
+        bool searched = (p->ctx.cooldown_block_cnt == 0);
+        out->len = block->len;
+        out->result = tap_detect_process(&p->ctx, block->mic1, block->mic2, (int)block->len);
+        if (p->hooks.features) {
+            tap_features_writer_add(p->hooks.features, &p->ctx, (int)block->len, searched, out->result);
+        }
+        tap_async_chan_push(&p->results);
+        tap_async_chan_pop(&p->blocks);
+    }
+    tap_detect_metrics_snapshot(&p->ctx, &p->stats->metrics);
+    tap_async_chan_close(&p->results);
+    TAP_ASYNC_END(task);
+}
+
+// Q2.29 to 16-bit, clipped to the int16_t range.
+static int16_t to_pcm16(fixed_point_t value) {
+    int32_t temp_val = value >> (Q_FORMAT - 15);
+    if (temp_val > INT16_MAX) return INT16_MAX;
+    if (temp_val < INT16_MIN) return INT16_MIN;
+    return (int16_t)temp_val;
+}
+
+static void write_output(tap_pipeline_t* p, fixed_point_t value, long len) {
+    int16_t pcm[MAX_AUDIO_FRAME_SIZE];
+    uint64_t start = tap_clock_now_ns();
+    for (long i = 0; i < len; i += MAX_AUDIO_FRAME_SIZE) {
+        long n = len - i < MAX_AUDIO_FRAME_SIZE ? len - i : MAX_AUDIO_FRAME_SIZE;
+        for (long k = 0; k < n; k++) pcm[k] = to_pcm16(value);
+        if (p->writer.file) wav_writer_write(&p->writer, pcm, n);
+    }
+    p->write_ns += tap_clock_now_ns() - start;
+}
+
+// Logs one line per frame and writes the binary detection signal as the results arrive.
+static tap_async_status_e sink_stage(tap_async_task_t* task) {
+    tap_pipeline_t* p = task->arg;
+    FILE* log = p->log;
+    TAP_ASYNC_BEGIN(task);
+    fprintf(log, "Processing WAV file: %s (Samplerate: %u Hz, Total Samples: %ld)\n",
+            p->input_path, p->reader.samplerate, p->reader.num_samples);
+    fprintf(log, "--- Tap Detection Log by Frame ---\n");
+    fprintf(log, "Frame Size: %d samples\n", MAX_AUDIO_FRAME_SIZE);
+    fprintf(log, "----------------------------------\n");
+    fprintf(log, "Frame | Start Time (s) | Tap Detected?\n");
+    fprintf(log, "----------------------------------\n");
+    for (;;) {
+        TAP_ASYNC_AWAIT(task, tap_async_chan_peek(&p->results) != NULL || tap_async_chan_drained(&p->results));
+        const pipeline_result_t* r = tap_async_chan_peek(&p->results);
+        if (r == NULL) break;
+        fprintf(log, "%5ld | %14.3f | %d\n",
+                p->frame,
+                (float)(p->frame * MAX_AUDIO_FRAME_SIZE) / p->reader.samplerate,
+                r->result);
+
+        // Binary tap detection output signal: Q_ONE (1.0), Q_ONE/2 (0.5), or 0 based on detection.
+        fixed_point_t mapped_fill_value = 0; // Default to NO_TAP (0)
+        if (r->result == TAP_SINGLE) {
+            mapped_fill_value = 1 << 16; // Represents 0.5 (half full scale)
+            p->stats->events++;
+        } else if (r->result == TAP_DOUBLE) {
+            mapped_fill_value = 1 << 31; // Represents 1.0 (full scale)
+            p->stats->events++;
+        }
+        write_output(p, mapped_fill_value, r->len);
+        p->frame++;
+        tap_async_chan_pop(&p->results);
+    }
+    fprintf(log, "----------------------------------\n");
+    fflush(log);
+    // Samples after the last processed frame stay silent
+    if ((long)p->writer.frames_written < p->reader.num_samples) {
+        write_output(p, 0, p->reader.num_samples - (long)p->writer.frames_written);
+    }
+    TAP_ASYNC_END(task);
+}
+
+// --- Pipeline ---
+
+/**
+ * @brief Opens the input and output of one recording and allocates its stage channels.
+ * @param input_path WAV recording, mono or stereo (left = mic1, right = mic2).
+ * @param output_path Receives the binary detection signal (0.5 full scale for a single tap, full scale for a double tap).
+ * @param log Receives the per-frame detection log.
+ * @param hooks Optional attachments; may be NULL.
+ * @param stats Optional (NULL: kept inside the pipeline); receives the stage times and counts once the pipeline is closed.
+ * @return The pipeline, or NULL on failure (reported on stderr).
+ */
+tap_pipeline_t* tap_pipeline_open(const char* input_path, const char* output_path, FILE* log,
+                                  const tap_pipeline_hooks_t* hooks, tap_pipeline_stats_t* stats) {
+    tap_pipeline_t* p = (tap_pipeline_t*)calloc(1, sizeof(tap_pipeline_t));
+    if (!p) {
+        fprintf(stderr, "Error: Memory allocation failed for the pipeline of %s.\n", input_path);
+        return NULL;
+    }
+    p->input_path = input_path;
+    p->output_path = output_path;
+    p->log = log;
+    if (hooks) p->hooks = *hooks;
+    p->stats = stats ? stats : &p->own_stats;
+    p->reader.fd = -1;
+    if (wav_reader_open(&p->reader, input_path) != 0) {
+        fprintf(stderr, "Failed to load audio from %s. Exiting.\n", input_path);
+        free(p);
+        return NULL;
+    }
+#ifndef _WIN32
+    // Pipes and sockets then suspend the source stage instead of the executor; regular files are unaffected
+    fcntl(p->reader.fd, F_SETFL, fcntl(p->reader.fd, F_GETFL) | O_NONBLOCK);
+#endif
+    if (tap_async_chan_init(&p->chunks, sizeof(pipeline_chunk_t), PIPELINE_CHUNKS) != 0 ||
+        tap_async_chan_init(&p->blocks, sizeof(pipeline_block_t), PIPELINE_BLOCKS) != 0 ||
+        tap_async_chan_init(&p->results, sizeof(pipeline_result_t), PIPELINE_RESULTS) != 0) {
+        fprintf(stderr, "Error: Memory allocation failed for the pipeline of %s.\n", input_path);
+        tap_pipeline_close(p);
+        return NULL;
+    }
+    p->bytes_left = p->reader.num_samples * p->reader.num_channels * (long)sizeof(int16_t);
+    // A failure to create the output is reported, but the log is still produced
+    wav_writer_open(&p->writer, output_path, p->reader.samplerate, 1);
+    memset(p->stats, 0, sizeof(*p->stats));
+    p->stats->samplerate = p->reader.samplerate;
+    p->stats->num_samples = p->reader.num_samples;
+    tap_detect_init(&p->ctx, p->hooks.cfg);
+    tap_detect_attach_trace(&p->ctx, p->hooks.trace);
+    return p;
+}
+
+// Adds the four stages of the pipeline to an executor; several pipelines can share one.
+void tap_pipeline_spawn(tap_pipeline_t* p, tap_async_executor_t* executor) {
+    tap_async_spawn(executor, &p->source_task, source_stage, p);
+    tap_async_spawn(executor, &p->decode_task, decode_stage, p);
+    tap_async_spawn(executor, &p->detect_task, detect_stage, p);
+    tap_async_spawn(executor, &p->sink_task, sink_stage, p);
+    tap_async_chan_connect(&p->chunks, &p->source_task, &p->decode_task);
+    tap_async_chan_connect(&p->blocks, &p->decode_task, &p->detect_task);
+    tap_async_chan_connect(&p->results, &p->detect_task, &p->sink_task);
+}
+
+/**
+ * @brief Finishes the output file, fills in the stats and frees the pipeline.
+ * @return 0 if every stage completed, -1 otherwise (the partial output file is removed).
+ */
+int tap_pipeline_close(tap_pipeline_t* p) {
+    int status = p->status;
+    if (!p->sink_task.done) status = -1;
+    if (p->writer.file) {
+        uint64_t start = tap_clock_now_ns();
+        wav_writer_close(&p->writer);
+        p->write_ns += tap_clock_now_ns() - start;
+        if (status != 0) remove(p->output_path);
+    }
+    tap_pipeline_stats_t* stats = p->stats;
+    stats->frames = p->frame;
+    stats->read_s = (double)(p->source_task.busy_ns + p->decode_task.busy_ns) * 1e-9;
+    stats->detect_s = (double)p->detect_task.busy_ns * 1e-9;
+    stats->write_s = (double)p->write_ns * 1e-9;
+    stats->log_s = (double)(p->sink_task.busy_ns - (p->sink_task.busy_ns < p->write_ns ? p->sink_task.busy_ns : p->write_ns)) * 1e-9;
+    if (status == 0) {
+        fprintf(p->log, "Binary tap detection output saved to: %s\n", p->output_path);
+        fprintf(p->log, "Processing complete.\n");
+    } else {
+        fprintf(stderr, "Failed to load audio from %s. Exiting.\n", p->input_path);
+    }
+    tap_async_chan_free(&p->chunks);
+    tap_async_chan_free(&p->blocks);
+    tap_async_chan_free(&p->results);
+    wav_reader_close(&p->reader);
+    free(p);
+    return status;
+}
+
+/**
+ * @brief Runs the command line path over one recording on its own executor.
+ * @return 0 on success, -1 on failure.
+ */
+int tap_pipeline_run(const char* input_path, const char* output_path, FILE* log, const tap_pipeline_hooks_t* hooks,
+                     tap_pipeline_stats_t* stats) {
+    tap_pipeline_t* p = tap_pipeline_open(input_path, output_path, log, hooks, stats);
+    if (!p) return -1;
+    tap_async_executor_t executor;
+    tap_async_executor_init(&executor);
+    tap_pipeline_spawn(p, &executor);
+    tap_async_run(&executor);
+    tap_async_executor_free(&executor);
+    return tap_pipeline_close(p);
+}
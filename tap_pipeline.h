@@ -0,0 +1,51 @@
+#ifndef TAP_PIPELINE_H
+#define TAP_PIPELINE_H
+#include <stdint.h>
+#include <stdio.h>
+
+#include "tap_detect.h"
+#include "tap_trace.h"
+#include "tap_features.h"
+#include "tap_async.h"
+
+// --- CLI Processing Pipeline ---
+// The default command line path: read a WAV recording, run the detector frame by frame, log one line per frame
+// and write the binary detection signal as a WAV file. It is built from four stages on the cooperative executor
+// (see tap_async.h): source (reads the data chunk in 8 KiB pieces), decode (16-bit frames to Q2.29 blocks),
+// detect and sink (log and output WAV), connected by small bounded channels. Memory use no longer grows with the
+// recording, and several pipelines can be spawned onto one executor and interleave. The stage times in the stats
+// are the executor's per-stage busy times (see tap_bench_e2e.c). The stats are optional (NULL) everywhere.
+
+typedef struct
+{
+    uint32_t samplerate;
+    long     num_samples;
+    long     frames;
+    long     events;   // Frames reporting a single or double tap
+    double   read_s;   // Decoding the input WAV file
+    double   detect_s; // Running the detector over all frames
+    double   log_s;    // Formatting the per-frame log
+    double   write_s;  // Writing the output WAV file
+    tap_detect_metrics_t metrics; // Detector counters at the end of the recording
+} tap_pipeline_stats_t;
+
+// Optional attachments of a run; NULL members are not used.
+typedef struct
+{
+    tap_trace_t*           trace;    // Attached to the detector; holds the last blocks of the recording afterwards
+    tap_features_writer_t* features; // Receives the features of every block
+    const tap_detect_config_t* cfg;  // Detector configuration, copied by tap_pipeline_open(); NULL for the defaults
+} tap_pipeline_hooks_t;
+
+typedef struct tap_pipeline_s tap_pipeline_t;
+
+tap_pipeline_t* tap_pipeline_open(const char* input_path, const char* output_path, FILE* log,
+                                  const tap_pipeline_hooks_t* hooks, tap_pipeline_stats_t* stats);
+void tap_pipeline_spawn(tap_pipeline_t* pipeline, tap_async_executor_t* executor);
+int  tap_pipeline_close(tap_pipeline_t* pipeline);
+
+// Open, spawn on a private executor, run and close.
+int tap_pipeline_run(const char* input_path, const char* output_path, FILE* log, const tap_pipeline_hooks_t* hooks,
+                     tap_pipeline_stats_t* stats);
+
+#endif // !TAP_PIPELINE_H
@@ -0,0 +1,566 @@
+#include <stdio.h>    // For console output
+#include <stdlib.h>   // For memory allocation, qsort, atoi, atof
+
+#include "tap_replay.h"
+
+#ifdef __linux__
+#include <string.h>   // For strcmp, strncmp, memcpy, memset
+#include <errno.h>    // For EAGAIN, EINTR
+#include <signal.h>   // For SIGINT, SIGTERM
+#include <unistd.h>   // For close, sysconf
+#include <fcntl.h>    // For fcntl
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>   // For sockaddr_un
+#include <sys/resource.h> // For getrusage, setrlimit
+#include <netinet/in.h>
+#include <netinet/tcp.h>  // For TCP_NODELAY
+#include <arpa/inet.h>
+
+#include "tap_server.h"
+#include "tap_clock.h"
+#include "tap_synth.h"
+#include "wav_io.h"
+
+#define REPLAY_MAX_RECORDINGS (256)
+#define REPLAY_MAX_EVENTS     (256)
+#define REPLAY_CHANNELS       (2)
+
+typedef struct
+{
+    int16_t* samples;     // Interleaved mic1/mic2
+    long     num_samples; // Per channel
+} replay_recording_t;
+
+typedef struct
+{
+    double   packet_ms_lo;
+    double   packet_ms_hi;
+    double   jitter_ms;   // Each packet leaves up to this much after its last sample was captured
+    double   reorder;     // Probability that a packet is held back and sent after the next one
+    double   loss;        // Probability that a packet is never sent
+    double   speed;       // Playback speed relative to real time
+    double   ramp_s;      // Device start times are spread over this interval
+    uint32_t samplerate;
+} replay_options_t;
+
+typedef struct
+{
+    int       fd;
+    const replay_recording_t* recording;
+    tap_rng_t rng;
+    uint32_t  ts_base;     // sample_ts of the first sample; random, so the 32-bit wrap gets exercised
+    long      pos;         // Next sample to send
+    int       next_len;    // Samples in the next packet
+    uint64_t  start_ns;    // Capture time of sample 0
+    uint64_t  due_ns;      // Send time of the next packet
+    int       heap_index;
+    // Packet held back for reordering
+    uint8_t*  held;
+    size_t    held_len;
+    // Bytes not yet accepted by the socket
+    uint8_t*  out;
+    size_t    out_len;
+    size_t    out_sent;
+    size_t    out_cap;
+    bool      want_out;    // Registered for EPOLLOUT
+    bool      all_queued;  // Every packet has been queued; shut down the write side once out is drained
+    bool      shut;
+    bool      closed;
+    char      line[96];    // Partial event line from the server
+    int       line_len;
+} replay_device_t;
+
+typedef struct
+{
+    long     packets;
+    long     lost;
+    long     reordered;
+    long     singles;
+    long     doubles;
+    size_t   max_backlog;  // Largest number of unsent bytes of one device
+    double*  latency_ms;
+    long     num_latencies;
+    long     cap_latencies;
+} replay_stats_t;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_stop_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+// --- Send Schedule (min-heap of devices by due time) ---
+
+typedef struct
+{
+    replay_device_t** items;
+    int               count;
+} replay_heap_t;
+
+static void heap_swap(replay_heap_t* heap, int a, int b) {
+    replay_device_t* tmp = heap->items[a];
+    heap->items[a] = heap->items[b];
+    heap->items[b] = tmp;
+    heap->items[a]->heap_index = a;
+    heap->items[b]->heap_index = b;
+}
+
+static void heap_sift_up(replay_heap_t* heap, int i) {
+    while (i > 0 && heap->items[(i - 1) / 2]->due_ns > heap->items[i]->due_ns) {
+        heap_swap(heap, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void heap_sift_down(replay_heap_t* heap, int i) {
+    for (;;) {
+        int smallest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < heap->count && heap->items[left]->due_ns < heap->items[smallest]->due_ns) smallest = left;
+        if (right < heap->count && heap->items[right]->due_ns < heap->items[smallest]->due_ns) smallest = right;
+        if (smallest == i) return;
+        heap_swap(heap, i, smallest);
+        i = smallest;
+    }
+}
+
+static void heap_push(replay_heap_t* heap, replay_device_t* device) {
+    device->heap_index = heap->count;
+    heap->items[heap->count++] = device;
+    heap_sift_up(heap, device->heap_index);
+}
+
+static void heap_pop(replay_heap_t* heap) {
+    heap->items[0]->heap_index = -1;
+    if (--heap->count > 0) {
+        heap->items[0] = heap->items[heap->count];
+        heap->items[0]->heap_index = 0;
+        heap_sift_down(heap, 0);
+    }
+}
+
+// --- Device I/O ---
+
+static int append_out(replay_device_t* device, const uint8_t* data, size_t len) {
+    if (device->out_len + len > device->out_cap) {
+        // Compact before growing
+        memmove(device->out, device->out + device->out_sent, device->out_len - device->out_sent);
+        device->out_len -= device->out_sent;
+        device->out_sent = 0;
+        size_t cap = device->out_cap ? device->out_cap : 4096;
+        while (device->out_len + len > cap) cap *= 2;
+        uint8_t* out = realloc(device->out, cap);
+        if (out == NULL) return -1;
+        device->out = out;
+        device->out_cap = cap;
+    }
+    memcpy(device->out + device->out_len, data, len);
+    device->out_len += len;
+    return 0;
+}
+
+static void flush_out(int epoll_fd, replay_device_t* device) {
+    while (device->out_sent < device->out_len) {
+        ssize_t n = send(device->fd, device->out + device->out_sent, device->out_len - device->out_sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        device->out_sent += (size_t)n;
+    }
+    bool pending = device->out_sent < device->out_len;
+    if (pending != device->want_out) {
+        struct epoll_event event = { .events = EPOLLIN | (pending ? EPOLLOUT : 0), .data.ptr = device };
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, device->fd, &event);
+        device->want_out = pending;
+    }
+    if (!pending) {
+        device->out_len = device->out_sent = 0;
+        if (device->all_queued && !device->shut) {
+            shutdown(device->fd, SHUT_WR); // The server processes the last block and closes the connection
+            device->shut = true;
+        }
+    }
+}
+
+// Picks the next packet size and its send time: the capture time of its last sample plus jitter, never earlier
+// than the previous packet (the transport keeps order; reordering is modelled separately).
+static void schedule_next(replay_device_t* device, const replay_options_t* options) {
+    long remaining = device->recording->num_samples - device->pos;
+    double ms = options->packet_ms_lo + (options->packet_ms_hi - options->packet_ms_lo) * tap_rng_uniform(&device->rng);
+    long len = (long)(ms * options->samplerate / 1000.0 + 0.5);
+    if (len < 1) len = 1;
+    if (len > TAP_SERVER_MAX_PACKET_SAMPLES) len = TAP_SERVER_MAX_PACKET_SAMPLES;
+    if (len > remaining) len = remaining;
+    device->next_len = (int)len;
+    double capture_s = (double)(device->pos + len) / options->samplerate / options->speed;
+    uint64_t due_ns = device->start_ns + (uint64_t)(capture_s * 1e9) +
+                      (uint64_t)(options->jitter_ms * 1e6 * tap_rng_uniform(&device->rng));
+    if (due_ns > device->due_ns) device->due_ns = due_ns;
+}
+
+static void send_packet(int epoll_fd, replay_device_t* device, const replay_options_t* options, replay_stats_t* stats) {
+    static uint8_t packet[TAP_SERVER_PACKET_HEADER_BYTES + TAP_SERVER_MAX_PACKET_SAMPLES * REPLAY_CHANNELS * 2];
+    tap_server_packet_header_t header = { device->ts_base + (uint32_t)device->pos, (uint16_t)device->next_len, REPLAY_CHANNELS };
+    tap_server_packet_header_encode(packet, &header);
+    const int16_t* samples = device->recording->samples + device->pos * REPLAY_CHANNELS;
+    for (int n = 0; n < device->next_len * REPLAY_CHANNELS; n++) {
+        packet[TAP_SERVER_PACKET_HEADER_BYTES + 2 * n] = (uint8_t)samples[n];
+        packet[TAP_SERVER_PACKET_HEADER_BYTES + 2 * n + 1] = (uint8_t)((uint16_t)samples[n] >> 8);
+    }
+    size_t len = TAP_SERVER_PACKET_HEADER_BYTES + (size_t)device->next_len * REPLAY_CHANNELS * 2;
+    device->pos += device->next_len;
+    bool last = device->pos >= device->recording->num_samples;
+    stats->packets++;
+
+    if (tap_rng_uniform(&device->rng) < options->loss) {
+        stats->lost++;
+    } else if (device->held) {
+        // The held packet arrives after this one
+        append_out(device, packet, len);
+        append_out(device, device->held, device->held_len);
+        free(device->held);
+        device->held = NULL;
+    } else if (!last && tap_rng_uniform(&device->rng) < options->reorder && (device->held = malloc(len)) != NULL) {
+        memcpy(device->held, packet, len);
+        device->held_len = len;
+        stats->reordered++;
+    } else {
+        append_out(device, packet, len);
+    }
+    if (last) device->all_queued = true;
+    flush_out(epoll_fd, device);
+    size_t backlog = device->out_len - device->out_sent;
+    if (backlog > stats->max_backlog) stats->max_backlog = backlog;
+}
+
+static void add_latency(replay_stats_t* stats, double ms) {
+    if (stats->num_latencies == stats->cap_latencies) {
+        long cap = stats->cap_latencies ? 2 * stats->cap_latencies : 1024;
+        double* grown = realloc(stats->latency_ms, (size_t)cap * sizeof(double));
+        if (grown == NULL) return;
+        stats->latency_ms = grown;
+        stats->cap_latencies = cap;
+    }
+    stats->latency_ms[stats->num_latencies++] = ms;
+}
+
+// Reads event lines; the latency of an event is measured from the capture time of the sample that completed its block.
+static void read_events(replay_device_t* device, const replay_options_t* options, replay_stats_t* stats) {
+    char buffer[4096];
+    ssize_t got;
+    while ((got = recv(device->fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+        uint64_t now_ns = tap_clock_now_ns();
+        for (ssize_t i = 0; i < got; i++) {
+            if (buffer[i] != '\n') {
+                if (device->line_len < (int)sizeof(device->line) - 1) device->line[device->line_len++] = buffer[i];
+                continue;
+            }
+            device->line[device->line_len] = '\0';
+            device->line_len = 0;
+            char kind[16];
+            unsigned end_ts = 0, first_ts = 0;
+            if (sscanf(device->line, "%15s %u %u", kind, &end_ts, &first_ts) != 3) continue;
+            if (strcmp(kind, "double") == 0) stats->doubles++;
+            else stats->singles++;
+            double capture_s = (double)(uint32_t)(end_ts - device->ts_base) / options->samplerate / options->speed;
+            add_latency(stats, ((double)now_ns - (double)device->start_ns) * 1e-6 - capture_s * 1e3);
+        }
+    }
+    if (got == 0 || (got < 0 && errno != EAGAIN && errno != EINTR)) device->closed = true;
+}
+
+// --- Setup ---
+
+static int connect_server(const char* address) {
+    int fd = -1;
+    if (strncmp(address, "unix:", 5) == 0) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(address + 5) >= sizeof(addr.sun_path)) return -1;
+        strcpy(addr.sun_path, address + 5);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else if (strncmp(address, "tcp:", 4) == 0) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)atoi(address + 4));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        // Devices send small packets as they are captured; Nagle's algorithm would batch them
+        if (fd >= 0) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd >= 0) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+static int load_recording(const char* path, replay_recording_t* recording, uint32_t* samplerate) {
+    long num_samples = 0;
+    const fixed_point_t* mic2 = NULL;
+    fixed_point_t* mic1 = read_wav_mics_fx(path, samplerate, &num_samples, &mic2);
+    if (mic1 == NULL) return -1;
+    recording->samples = malloc((size_t)(num_samples > 0 ? num_samples : 1) * REPLAY_CHANNELS * sizeof(int16_t));
+    if (recording->samples == NULL) {
+        free(mic1);
+        return -1;
+    }
+    // Q2.29 back to the 16-bit samples the file held
+    for (long n = 0; n < num_samples; n++) {
+        recording->samples[REPLAY_CHANNELS * n] = (int16_t)(mic1[n] >> (Q_FORMAT - 15));
+        recording->samples[REPLAY_CHANNELS * n + 1] = (int16_t)(mic2[n] >> (Q_FORMAT - 15));
+    }
+    recording->num_samples = num_samples;
+    free(mic1);
+    return 0;
+}
+
+// CPU seconds of another process from /proc, or a negative value if it cannot be read.
+static double process_cpu_seconds(long pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%ld/stat", pid);
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return -1.0;
+    char buffer[1024];
+    size_t len = fread(buffer, 1, sizeof(buffer) - 1, file);
+    fclose(file);
+    buffer[len] = '\0';
+    // Fields after the parenthesised command name, which may itself contain spaces
+    char* rest = strrchr(buffer, ')');
+    unsigned long utime = 0, stime = 0;
+    if (rest == NULL || sscanf(rest + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) return -1.0;
+    return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double* sorted, long count, double p) {
+    if (count == 0) return 0.0;
+    long index = (long)(p * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+// Allows thousands of connections when the hard limit permits it.
+static void raise_fd_limit(void) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s --replay unix:PATH|tcp:PORT rec.wav... [--devices N] [--packet-ms lo:hi] [--jitter-ms J]\n", prog);
+    fprintf(stderr, "           [--reorder P] [--loss P] [--speed X] [--ramp S] [--seed N] [--server-pid PID]\n");
+    fprintf(stderr, "  --devices    simulated devices, recordings assigned round robin (default: one per recording)\n");
+    fprintf(stderr, "  --packet-ms  packet duration range in ms (default: 2:20)\n");
+    fprintf(stderr, "  --jitter-ms  extra send delay per packet, uniform in [0, J] ms (default: 0)\n");
+    fprintf(stderr, "  --reorder    probability of swapping a packet with the next one (default: 0)\n");
+    fprintf(stderr, "  --loss       probability of dropping a packet (default: 0)\n");
+    fprintf(stderr, "  --speed      playback speed relative to real time (default: 1)\n");
+    fprintf(stderr, "  --ramp       spread device start times over S seconds (default: 1)\n");
+    fprintf(stderr, "  --server-pid report the CPU time the server process used during the replay\n");
+}
+
+/**
+ * @brief Entry point for "tap_detection_utility --replay". Replays the recordings against a running --serve
+ *        instance and reports event counts, end-to-end latency percentiles and CPU time.
+ * @return 0 on success, 1 on error.
+ */
+int tap_replay_cli(int argc, char* argv[]) {
+    replay_options_t options = { 2.0, 20.0, 0.0, 0.0, 0.0, 1.0, 1.0, 48000 };
+    const char* address = NULL;
+    const char* paths[REPLAY_MAX_RECORDINGS];
+    int num_paths = 0;
+    long num_devices = 0;
+    uint64_t seed = 1;
+    long server_pid = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--devices") == 0 && i + 1 < argc) {
+            num_devices = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--packet-ms") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%lf:%lf", &options.packet_ms_lo, &options.packet_ms_hi) != 2) options.packet_ms_lo = -1.0;
+        } else if (strcmp(argv[i], "--jitter-ms") == 0 && i + 1 < argc) {
+            options.jitter_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--reorder") == 0 && i + 1 < argc) {
+            options.reorder = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+            options.loss = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            options.speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--ramp") == 0 && i + 1 < argc) {
+            options.ramp_s = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--server-pid") == 0 && i + 1 < argc) {
+            server_pid = atol(argv[++i]);
+        } else if (argv[i][0] != '-' && address == NULL) {
+            address = argv[i];
+        } else if (argv[i][0] != '-' && num_paths < REPLAY_MAX_RECORDINGS) {
+            paths[num_paths++] = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (num_devices == 0) num_devices = num_paths;
+    if (address == NULL || num_paths == 0 || num_devices < 1 || options.packet_ms_lo <= 0.0 ||
+        options.packet_ms_hi < options.packet_ms_lo || options.speed <= 0.0 || options.ramp_s < 0.0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    replay_recording_t recordings[REPLAY_MAX_RECORDINGS];
+    for (int r = 0; r < num_paths; r++) {
+        uint32_t samplerate = 0;
+        if (load_recording(paths[r], &recordings[r], &samplerate) != 0) {
+            for (int k = 0; k < r; k++) free(recordings[k].samples);
+            return 1;
+        }
+        options.samplerate = samplerate;
+    }
+
+    raise_fd_limit();
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_stop_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    int epoll_fd = epoll_create1(0);
+    replay_device_t* devices = calloc((size_t)num_devices, sizeof(replay_device_t));
+    replay_heap_t heap = { calloc((size_t)num_devices, sizeof(replay_device_t*)), 0 };
+    replay_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    int status = 0;
+    long open_devices = 0;
+    if (devices == NULL || heap.items == NULL) status = 1;
+
+    tap_rng_t rng;
+    tap_rng_seed(&rng, seed);
+    uint64_t start_ns = tap_clock_now_ns();
+    for (long d = 0; d < num_devices && status == 0; d++) {
+        replay_device_t* device = &devices[d];
+        device->fd = connect_server(address);
+        if (device->fd < 0) {
+            fprintf(stderr, "Error: Cannot connect device %ld to %s (%s)\n", d, address, strerror(errno));
+            status = 1;
+            break;
+        }
+        device->recording = &recordings[d % num_paths];
+        tap_rng_seed(&device->rng, tap_rng_next(&rng));
+        device->ts_base = (uint32_t)tap_rng_next(&device->rng);
+        device->start_ns = start_ns + (uint64_t)(options.ramp_s * 1e9 * tap_rng_uniform(&rng));
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = device };
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, device->fd, &event);
+        open_devices++;
+        if (device->recording->num_samples > 0) {
+            schedule_next(device, &options);
+            heap_push(&heap, device);
+        } else {
+            device->all_queued = true;
+            flush_out(epoll_fd, device);
+        }
+    }
+    if (status == 0) {
+        fprintf(stderr, "Replaying %d recording(s) as %ld device(s) against %s\n", num_paths, num_devices, address);
+    }
+
+    double server_cpu_start = server_pid ? process_cpu_seconds(server_pid) : -1.0;
+    struct rusage usage_start;
+    getrusage(RUSAGE_SELF, &usage_start);
+    struct epoll_event events[REPLAY_MAX_EVENTS];
+    while (status == 0 && open_devices > 0 && !stop_requested) {
+        uint64_t now_ns = tap_clock_now_ns();
+        while (heap.count > 0 && heap.items[0]->due_ns <= now_ns) {
+            replay_device_t* device = heap.items[0];
+            send_packet(epoll_fd, device, &options, &stats);
+            if (device->pos < device->recording->num_samples) {
+                schedule_next(device, &options);
+                heap_sift_down(&heap, 0);
+            } else {
+                heap_pop(&heap);
+            }
+        }
+        int timeout_ms = 100;
+        if (heap.count > 0) {
+            uint64_t wait_ns = heap.items[0]->due_ns - now_ns;
+            timeout_ms = wait_ns >= 100000000ull ? 100 : (int)((wait_ns + 999999) / 1000000);
+        }
+        int n = epoll_wait(epoll_fd, events, REPLAY_MAX_EVENTS, timeout_ms);
+        for (int i = 0; i < n; i++) {
+            replay_device_t* device = events[i].data.ptr;
+            if (events[i].events & EPOLLOUT) flush_out(epoll_fd, device);
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) read_events(device, &options, &stats);
+            if (device->closed) {
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, device->fd, NULL);
+                close(device->fd);
+                device->fd = -1;
+                if (device->heap_index >= 0 && device->heap_index < heap.count && heap.items[device->heap_index] == device) {
+                    // The server closed the connection early; stop sending
+                    device->due_ns = 0;
+                    heap_sift_up(&heap, device->heap_index);
+                    heap_pop(&heap);
+                }
+                open_devices--;
+            }
+        }
+    }
+    double wall_s = (tap_clock_now_ns() - start_ns) * 1e-9;
+    struct rusage usage_end;
+    getrusage(RUSAGE_SELF, &usage_end);
+    double server_cpu_s = server_cpu_start >= 0.0 ? process_cpu_seconds(server_pid) - server_cpu_start : -1.0;
+
+    if (status == 0) {
+        double own_cpu_s = (usage_end.ru_utime.tv_sec - usage_start.ru_utime.tv_sec) + (usage_end.ru_utime.tv_usec - usage_start.ru_utime.tv_usec) * 1e-6 +
+                           (usage_end.ru_stime.tv_sec - usage_start.ru_stime.tv_sec) + (usage_end.ru_stime.tv_usec - usage_start.ru_stime.tv_usec) * 1e-6;
+        qsort(stats.latency_ms, (size_t)stats.num_latencies, sizeof(double), compare_double);
+        printf("--- Replay Report ---\n");
+        printf("Devices: %ld, wall %.2f s, packets %ld (lost %ld, reordered %ld), max send backlog %zu bytes\n",
+               num_devices, wall_s, stats.packets, stats.lost, stats.reordered, stats.max_backlog);
+        printf("Events: %ld single, %ld double\n", stats.singles, stats.doubles);
+        if (stats.num_latencies > 0) {
+            printf("Event latency (ms): p50 %.2f, p95 %.2f, p99 %.2f, max %.2f\n", percentile(stats.latency_ms, stats.num_latencies, 0.50),
+                   percentile(stats.latency_ms, stats.num_latencies, 0.95), percentile(stats.latency_ms, stats.num_latencies, 0.99),
+                   stats.latency_ms[stats.num_latencies - 1]);
+        }
+        printf("Replay CPU: %.2f s\n", own_cpu_s);
+        if (server_cpu_s >= 0.0 && wall_s > 0.0) {
+            printf("Server CPU: %.2f s, %.1f%% of one core, %.3f%% of one core per stream\n", server_cpu_s,
+                   100.0 * server_cpu_s / wall_s, 100.0 * server_cpu_s / wall_s / num_devices);
+        }
+    }
+
+    for (long d = 0; devices && d < num_devices; d++) {
+        if (devices[d].fd > 0) close(devices[d].fd);
+        free(devices[d].held);
+        free(devices[d].out);
+    }
+    for (int r = 0; r < num_paths; r++) free(recordings[r].samples);
+    free(stats.latency_ms);
+    free(heap.items);
+    free(devices);
+    close(epoll_fd);
+    return status;
+}
+
+#else
+
+int tap_replay_cli(int argc, char* argv[]) {
+    (void)argc;
+    fprintf(stderr, "Error: %s --replay needs epoll and is only available on Linux\n", argv[0]);
+    return 1;
+}
+
+#endif // __linux__
@@ -0,0 +1,17 @@
+#ifndef TAP_REPLAY_H
+#define TAP_REPLAY_H
+
+// --- Device Fleet Replay ---
+// Load generator for the multi-stream server (see tap_server.h), Linux only. Streams N recordings as N simulated
+// devices over separate connections at real-time pace: every packet leaves when its last sample would have been
+// captured, plus random jitter. Packet sizes, jitter, reordering and loss are configurable and seeded, so a run can
+// be repeated. The events the server sends back are matched to the capture time of the sample that completed the
+// reporting block, which gives the end-to-end event latency (transport, queueing and detection). With
+// --server-pid the server's CPU time over the run is reported per stream.
+//
+//   tap_detection_utility --serve tcp:7878 &
+//   tap_detection_utility --replay tcp:7878 --devices 500 rec1.wav rec2.wav --jitter-ms 5 --loss 0.001 --server-pid $!
+
+int tap_replay_cli(int argc, char* argv[]);
+
+#endif // !TAP_REPLAY_H
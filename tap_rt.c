@@ -0,0 +1,140 @@
+#ifdef __linux__
+#define _GNU_SOURCE   // For pthread_setaffinity_np and CPU_SET
+#endif
+#include <stdio.h>    // For warnings
+#include <string.h>   // For strerror
+#include <errno.h>    // For errno
+#ifndef _WIN32
+#include <pthread.h>  // For pthread_setschedparam, pthread_setaffinity_np
+#include <sched.h>    // For SCHED_FIFO, cpu_set_t
+#include <sys/mman.h> // For mlockall
+#endif
+#ifdef TAP_RT_ALLOC_GUARD
+#include <stdlib.h>   // For abort
+#include <unistd.h>   // For write
+#endif
+
+#include "tap_rt.h"
+
+#define TAP_RT_STACK_PREFAULT (64 * 1024)  /* bytes of stack touched up front, so the frame path takes no page faults. */
+
+void tap_rt_options_default(tap_rt_options_t* options) {
+    options->priority = 0;
+    options->cpu = -1;
+    options->lock_memory = false;
+}
+
+int tap_rt_setup_process(const tap_rt_options_t* options) {
+    if (!options->lock_memory) return 0;
+#if defined(_WIN32)
+    fprintf(stderr, "Warning: Memory locking is not supported on this platform\n");
+    return -1;
+#else
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        fprintf(stderr, "Warning: mlockall failed (%s); pages may be swapped out\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+#endif
+}
+
+// Touches the top of the stack so its pages are mapped (and locked, after mlockall) before the first frame.
+static void prefault_stack(void) {
+    volatile unsigned char stack[TAP_RT_STACK_PREFAULT];
+    for (int i = 0; i < TAP_RT_STACK_PREFAULT; i += 256) stack[i] = 0;
+    (void)stack[0];
+}
+
+int tap_rt_setup_thread(const tap_rt_options_t* options) {
+    int status = 0;
+    prefault_stack();
+#if defined(_WIN32)
+    if (options->priority > 0 || options->cpu >= 0) {
+        fprintf(stderr, "Warning: Real-time priority and CPU pinning are not supported on this platform\n");
+        status = -1;
+    }
+#else
+    if (options->cpu >= 0) {
+#ifdef __linux__
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(options->cpu, &cpus);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (err != 0) {
+            fprintf(stderr, "Warning: Cannot pin the detector thread to CPU %d (%s)\n", options->cpu, strerror(err));
+            status = -1;
+        }
+#else
+        fprintf(stderr, "Warning: CPU pinning is not supported on this platform\n");
+        status = -1;
+#endif
+    }
+    if (options->priority > 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = options->priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0) {
+            fprintf(stderr, "Warning: Cannot set SCHED_FIFO priority %d (%s); keeping the default scheduler\n",
+                    options->priority, strerror(err));
+            status = -1;
+        }
+    }
+#endif
+    return status;
+}
+
+#ifdef TAP_RT_ALLOC_GUARD
+// --- Allocation Guard ---
+// Replaces the glibc allocator entry points with forwarders to the glibc implementation that abort while the calling
+// thread is inside a frame. Other libcs are left alone.
+#ifdef __GLIBC__
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void  __libc_free(void* ptr);
+#endif
+
+static _Thread_local int frame_depth = 0;
+
+void tap_rt_frame_enter(void) {
+    frame_depth++;
+}
+
+void tap_rt_frame_leave(void) {
+    frame_depth--;
+}
+
+#ifdef __GLIBC__
+// Only async-signal-safe calls here: the allocator must not be re-entered.
+static void guard_trip(const char* function) {
+    static const char prefix[] = "Fatal: ";
+    static const char suffix[] = " called on the per-frame path\n";
+    frame_depth = 0;
+    (void)!write(2, prefix, sizeof(prefix) - 1);
+    (void)!write(2, function, strlen(function));
+    (void)!write(2, suffix, sizeof(suffix) - 1);
+    abort();
+}
+
+void* malloc(size_t size) {
+    if (frame_depth > 0) guard_trip("malloc");
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    if (frame_depth > 0) guard_trip("calloc");
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (frame_depth > 0) guard_trip("realloc");
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) {
+    if (frame_depth > 0 && ptr != NULL) guard_trip("free");
+    __libc_free(ptr);
+}
+#endif
+#endif
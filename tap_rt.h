@@ -0,0 +1,40 @@
+#ifndef TAP_RT_H
+#define TAP_RT_H
+#include <stdbool.h>
+
+// --- Real-Time Thread Setup ---
+// Optional hardening for the thread that runs the detector on live audio, so its latency stays bounded while the
+// box is busy with batch work: SCHED_FIFO priority, a pinned CPU and locked, pre-faulted memory. Every step falls
+// back with a warning where the platform or the caller's privileges do not allow it (SCHED_FIFO and mlockall need
+// CAP_SYS_NICE / CAP_IPC_LOCK or matching rlimits).
+//
+// Builds with -DTAP_RT_ALLOC_GUARD (the Debug target) also replace malloc and friends with glibc forwarders that
+// abort when called between tap_rt_frame_enter() and tap_rt_frame_leave() on the same thread, which enforces that
+// the per-frame path never allocates.
+
+typedef struct
+{
+    int  priority;    /* SCHED_FIFO priority 1..99, 0 keeps the default scheduler. */
+    int  cpu;         /* CPU to pin the thread to, -1 for any. */
+    bool lock_memory; /* mlockall() current and future pages. */
+} tap_rt_options_t;
+
+void tap_rt_options_default(tap_rt_options_t* options);
+
+// Process-wide part, called before the threads start: locks memory if requested. Returns 0, or -1 if it failed (warned).
+int tap_rt_setup_process(const tap_rt_options_t* options);
+
+// Called by the real-time thread itself: sets its priority and affinity and pre-faults its stack.
+// Returns 0, or -1 if any step fell back (warned).
+int tap_rt_setup_thread(const tap_rt_options_t* options);
+
+// Marks the per-frame path of the calling thread for the allocation guard; no-ops in other builds.
+#ifdef TAP_RT_ALLOC_GUARD
+void tap_rt_frame_enter(void);
+void tap_rt_frame_leave(void);
+#else
+static inline void tap_rt_frame_enter(void) {}
+static inline void tap_rt_frame_leave(void) {}
+#endif
+
+#endif // !TAP_RT_H
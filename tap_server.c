@@ -0,0 +1,568 @@
+#include <stdio.h>    // For console output
+#include <stdlib.h>   // For memory allocation, atoi, atof
+
+#include "tap_server.h"
+
+#ifdef __linux__
+#include <string.h>   // For strcmp, strncmp, memcpy, memset
+#include <errno.h>    // For EINTR, EAGAIN
+#include <signal.h>   // For SIGINT, SIGTERM
+#include <pthread.h>  // For the worker threads
+#include <stdatomic.h>
+#include <unistd.h>   // For read, close, unlink, sysconf
+#include <fcntl.h>    // For fcntl
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h> // For lstat
+#include <sys/un.h>   // For sockaddr_un
+#include <sys/resource.h> // For getrusage, setrlimit
+#include <netinet/in.h>
+#include <netinet/tcp.h>  // For TCP_NODELAY
+#include <arpa/inet.h>
+
+#include "tap_detect.h"
+#include "tap_clock.h"
+#include "wav_io.h"
+
+#define SERVER_MAX_WORKERS   (64)
+#define SERVER_MAX_EVENTS    (64)
+#define SERVER_READ_BYTES    (65536)
+#define SERVER_POLL_MS       (100)
+#define SERVER_BACKLOG       (1024)
+#define SERVER_OUT_BYTES     (1024)  /* event lines held per connection while its socket buffer is full. */
+
+typedef struct server_conn
+{
+    int      fd;
+    long     id;
+    struct server_conn* prev;
+    struct server_conn* next;
+    // Packet reassembly
+    uint8_t  header_bytes[TAP_SERVER_PACKET_HEADER_BYTES];
+    int      header_fill;
+    uint8_t  sample_bytes[TAP_SERVER_MAX_CHANNELS * 2]; // One interleaved sample split across reads
+    int      sample_fill;
+    int      channels;
+    uint32_t remaining;  // Samples per channel left in the current packet
+    uint32_t sample_ts;  // Timestamp of the next sample
+    uint32_t expected_ts;
+    bool     ts_valid;
+    // Block assembly
+    int      mic1[MAX_AUDIO_FRAME_SIZE];
+    int      mic2[MAX_AUDIO_FRAME_SIZE];
+    int      frame_fill;
+    uint32_t frame_ts;   // Timestamp of the first sample of the block being assembled
+    tap_detect_ctx_t ctx;
+    // Event lines not yet accepted by the socket; always ends on a whole line
+    char     out[SERVER_OUT_BYTES];
+    int      out_len;
+    bool     closing;    // The client stopped sending; the connection is closed once out is flushed
+    uint32_t watched;    // Current epoll events: EPOLLIN until closing, EPOLLOUT while out_len > 0
+} server_conn_t;
+
+typedef struct
+{
+    long     streams;
+    uint64_t blocks;
+    uint64_t samples;
+    long     singles;
+    long     doubles;
+    long     ts_gaps;         // Packets whose sample_ts did not continue the previous packet
+    uint64_t discarded;       // Samples of partial blocks cut short by a timestamp gap
+    uint64_t skipped_blocks;  // Blocks of stream time missing between timestamped blocks
+    uint64_t duplicate_blocks;
+    uint64_t ts_resyncs;      // Timestamped blocks far enough back to restart the sample clock
+    long     protocol_errors; // Connections closed for a malformed header
+    long     events_unsent;   // Event lines dropped because the client fell too far behind
+} server_stats_t;
+
+typedef struct
+{
+    pthread_t       thread;
+    int             epoll_fd;
+    int             wake_fd;   // eventfd signalled when connections are handed over
+    pthread_mutex_t lock;
+    server_conn_t*  incoming;  // Handed over by the listener, guarded by lock
+    server_conn_t*  conns;     // Owned by the worker
+    server_stats_t  stats;     // Written by the worker only; read after it has been joined
+} server_worker_t;
+
+typedef struct
+{
+    server_worker_t workers[SERVER_MAX_WORKERS];
+    int             num_workers;
+    atomic_int      open_conns;
+    atomic_bool     stop;
+} server_t;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_stop_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// --- Per-Connection Processing (worker thread) ---
+
+static void watch_conn(server_worker_t* worker, server_conn_t* conn) {
+    uint32_t events = (conn->closing ? 0 : EPOLLIN | EPOLLRDHUP) | (conn->out_len > 0 ? EPOLLOUT : 0);
+    if (events == conn->watched) return;
+    struct epoll_event event = { .events = events, .data.ptr = conn };
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+    conn->watched = events;
+}
+
+// Sends as much of the pending output as the socket takes without blocking; the rest waits for EPOLLOUT.
+static void flush_output(server_worker_t* worker, server_conn_t* conn) {
+    int sent = 0;
+    while (sent < conn->out_len) {
+        ssize_t n = send(conn->fd, conn->out + sent, (size_t)(conn->out_len - sent), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            sent += (int)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            // The client is gone (the read side closes the connection); its pending lines are lost
+            for (int i = sent; i < conn->out_len; i++) {
+                if (conn->out[i] == '\n') worker->stats.events_unsent++;
+            }
+            sent = conn->out_len;
+        }
+    }
+    memmove(conn->out, conn->out + sent, (size_t)(conn->out_len - sent));
+    conn->out_len -= sent;
+    watch_conn(worker, conn);
+}
+
+static void run_block(server_worker_t* worker, server_conn_t* conn) {
+    tap_detection_result_e result = tap_detect_process_ts(&conn->ctx, conn->mic1, conn->mic2, conn->frame_fill, conn->frame_ts);
+    worker->stats.blocks++;
+    worker->stats.samples += (uint64_t)conn->frame_fill;
+    if (result == TAP_SINGLE) worker->stats.singles++;
+    if (result == TAP_DOUBLE) worker->stats.doubles++;
+    if (result != TAP_NONE) {
+        char line[64];
+        int len = snprintf(line, sizeof(line), "%s\t%u\t%u\n", result == TAP_DOUBLE ? "double" : "single",
+                           conn->frame_ts + (uint32_t)conn->frame_fill, tap_detect_event_origin_ts(&conn->ctx));
+        // Never wait for a slow client: lines its socket does not take are queued whole, and an event that does not
+        // fit the queue either is dropped and counted, so the client only ever sees complete lines
+        if (conn->out_len + len > SERVER_OUT_BYTES) {
+            worker->stats.events_unsent++;
+        } else {
+            memcpy(conn->out + conn->out_len, line, (size_t)len);
+            conn->out_len += len;
+            flush_output(worker, conn);
+        }
+    }
+    conn->frame_fill = 0;
+}
+
+static void push_sample(server_worker_t* worker, server_conn_t* conn, const uint8_t* sample) {
+    int second = conn->channels > 1 ? 2 : 0;
+    if (conn->frame_fill == 0) conn->frame_ts = conn->sample_ts;
+    // Q0.15 to Q2.29, as read_wav_mics_fx() does
+    conn->mic1[conn->frame_fill] = (fixed_point_t)(int16_t)(sample[0] | (sample[1] << 8)) << (Q_FORMAT - 15);
+    conn->mic2[conn->frame_fill] = (fixed_point_t)(int16_t)(sample[second] | (sample[second + 1] << 8)) << (Q_FORMAT - 15);
+    conn->sample_ts++;
+    conn->remaining--;
+    if (++conn->frame_fill == MAX_AUDIO_FRAME_SIZE) run_block(worker, conn);
+}
+
+/**
+ * @brief Feeds received bytes through the packet parser; packets may be split or coalesced arbitrarily by the transport.
+ * @return 0 on success, -1 on a malformed packet header.
+ */
+static int consume(server_worker_t* worker, server_conn_t* conn, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        if (conn->header_fill < TAP_SERVER_PACKET_HEADER_BYTES) {
+            size_t take = TAP_SERVER_PACKET_HEADER_BYTES - (size_t)conn->header_fill;
+            if (take > len) take = len;
+            memcpy(conn->header_bytes + conn->header_fill, data, take);
+            conn->header_fill += (int)take;
+            data += take;
+            len -= take;
+            if (conn->header_fill < TAP_SERVER_PACKET_HEADER_BYTES) break;
+
+            tap_server_packet_header_t header;
+            tap_server_packet_header_decode(&header, conn->header_bytes);
+            if (header.channels < 1 || header.channels > TAP_SERVER_MAX_CHANNELS ||
+                header.num_samples > TAP_SERVER_MAX_PACKET_SAMPLES) {
+                return -1;
+            }
+            if (conn->ts_valid && header.sample_ts != conn->expected_ts) {
+                // Lost, repeated or reordered packets: restart the block at the new timestamp and let
+                // tap_detect_process_ts() account for the missing or repeated stream time
+                worker->stats.ts_gaps++;
+                worker->stats.discarded += (uint64_t)conn->frame_fill;
+                conn->frame_fill = 0;
+            }
+            conn->ts_valid = true;
+            conn->expected_ts = header.sample_ts + header.num_samples;
+            conn->sample_ts = header.sample_ts;
+            conn->channels = header.channels;
+            conn->remaining = header.num_samples;
+            if (conn->remaining == 0) conn->header_fill = 0;
+            continue;
+        }
+
+        size_t sample_bytes = (size_t)conn->channels * 2;
+        if (conn->sample_fill > 0 || len < sample_bytes) {
+            // Complete a sample split across reads
+            size_t take = sample_bytes - (size_t)conn->sample_fill;
+            if (take > len) take = len;
+            memcpy(conn->sample_bytes + conn->sample_fill, data, take);
+            conn->sample_fill += (int)take;
+            data += take;
+            len -= take;
+            if ((size_t)conn->sample_fill < sample_bytes) break;
+            conn->sample_fill = 0;
+            push_sample(worker, conn, conn->sample_bytes);
+        } else {
+            while (conn->remaining > 0 && len >= sample_bytes) {
+                push_sample(worker, conn, data);
+                data += sample_bytes;
+                len -= sample_bytes;
+            }
+        }
+        if (conn->remaining == 0) conn->header_fill = 0;
+    }
+    return 0;
+}
+
+static void close_conn(server_t* server, server_worker_t* worker, server_conn_t* conn) {
+    // Trailing partial block, processed like the last frame of a WAV file
+    if (conn->frame_fill >= 2) run_block(worker, conn);
+    for (int i = 0; i < conn->out_len; i++) {
+        if (conn->out[i] == '\n') worker->stats.events_unsent++;
+    }
+    worker->stats.skipped_blocks += conn->ctx.metrics.skipped_blocks;
+    worker->stats.duplicate_blocks += conn->ctx.metrics.duplicate_blocks;
+    worker->stats.ts_resyncs += conn->ctx.metrics.ts_resyncs;
+    if (conn->prev) conn->prev->next = conn->next;
+    else worker->conns = conn->next;
+    if (conn->next) conn->next->prev = conn->prev;
+    close(conn->fd); // Also removes it from the epoll set
+    free(conn);
+    atomic_fetch_sub(&server->open_conns, 1);
+}
+
+// The client stopped sending: closes the connection, or waits until the event lines it has not received yet are flushed.
+static void end_stream(server_t* server, server_worker_t* worker, server_conn_t* conn) {
+    if (conn->frame_fill >= 2) run_block(worker, conn);
+    conn->frame_fill = 0;
+    if (conn->out_len == 0) {
+        close_conn(server, worker, conn);
+        return;
+    }
+    conn->closing = true;
+    watch_conn(worker, conn);
+}
+
+static void adopt_incoming(server_worker_t* worker) {
+    uint64_t count;
+    if (read(worker->wake_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) return;
+    pthread_mutex_lock(&worker->lock);
+    server_conn_t* conn = worker->incoming;
+    worker->incoming = NULL;
+    pthread_mutex_unlock(&worker->lock);
+    while (conn) {
+        server_conn_t* next = conn->next;
+        conn->prev = NULL;
+        conn->next = worker->conns;
+        if (worker->conns) worker->conns->prev = conn;
+        worker->conns = conn;
+        conn->watched = EPOLLIN | EPOLLRDHUP;
+        struct epoll_event event = { .events = conn->watched, .data.ptr = conn };
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, conn->fd, &event);
+        worker->stats.streams++;
+        conn = next;
+    }
+}
+
+typedef struct
+{
+    server_t*        server;
+    server_worker_t* worker;
+} worker_arg_t;
+
+static void* worker_main(void* arg) {
+    server_t* server = ((worker_arg_t*)arg)->server;
+    server_worker_t* worker = ((worker_arg_t*)arg)->worker;
+    uint8_t buffer[SERVER_READ_BYTES];
+    struct epoll_event events[SERVER_MAX_EVENTS];
+
+    while (!atomic_load(&server->stop)) {
+        int n = epoll_wait(worker->epoll_fd, events, SERVER_MAX_EVENTS, SERVER_POLL_MS);
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == NULL) {
+                adopt_incoming(worker);
+                continue;
+            }
+            server_conn_t* conn = events[i].data.ptr;
+            if (events[i].events & EPOLLOUT) flush_output(worker, conn);
+            if (conn->closing) {
+                if (conn->out_len == 0 || (events[i].events & (EPOLLHUP | EPOLLERR))) close_conn(server, worker, conn);
+                continue;
+            }
+            if (!(events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) continue;
+            // One read per readiness event, so a busy stream cannot starve the others on this worker
+            ssize_t got = read(conn->fd, buffer, sizeof(buffer));
+            if (got > 0) {
+                if (consume(worker, conn, buffer, (size_t)got) != 0) {
+                    worker->stats.protocol_errors++;
+                    close_conn(server, worker, conn);
+                }
+            } else if (got == 0 || (errno != EAGAIN && errno != EINTR)) {
+                end_stream(server, worker, conn);
+            }
+        }
+    }
+    adopt_incoming(worker);
+    while (worker->conns) close_conn(server, worker, worker->conns);
+    return NULL;
+}
+
+// --- Listener (main thread) ---
+
+/**
+ * @brief Opens the listening socket for "unix:PATH" or "tcp:PORT" (bound to the loopback interface).
+ * @return The non-blocking socket, or -1 on error.
+ */
+static int open_listener(const char* address) {
+    int fd = -1;
+    if (strncmp(address, "unix:", 5) == 0) {
+        const char* path = address + 5;
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof(addr.sun_path)) {
+            fprintf(stderr, "Error: Socket path %s is too long\n", path);
+            return -1;
+        }
+        strcpy(addr.sun_path, path);
+        // Remove a stale socket left by a previous run, but never any other kind of file
+        struct stat st;
+        if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else if (strncmp(address, "tcp:", 4) == 0) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)atoi(address + 4));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (fd >= 0 && bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        fprintf(stderr, "Error: Expected unix:PATH or tcp:PORT, got %s\n", address);
+        return -1;
+    }
+    if (fd < 0 || listen(fd, SERVER_BACKLOG) != 0 || set_nonblocking(fd) != 0) {
+        fprintf(stderr, "Error: Cannot listen on %s (%s)\n", address, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void hand_over(server_worker_t* worker, server_conn_t* conn) {
+    pthread_mutex_lock(&worker->lock);
+    conn->next = worker->incoming;
+    worker->incoming = conn;
+    pthread_mutex_unlock(&worker->lock);
+    uint64_t one = 1;
+    if (write(worker->wake_fd, &one, sizeof(one)) < 0) perror("eventfd");
+}
+
+static double cpu_seconds(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+}
+
+// Allows thousands of connections when the hard limit permits it.
+static void raise_fd_limit(void) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s --serve unix:PATH|tcp:PORT [--workers N] [--duration S] [--rate HZ]\n", prog);
+    fprintf(stderr, "  --workers    worker threads, 1 to %d (default: online CPUs)\n", SERVER_MAX_WORKERS);
+    fprintf(stderr, "  --duration   stop after S seconds (default: run until SIGINT/SIGTERM)\n");
+    fprintf(stderr, "  --rate       sample rate of the streams, for the throughput report (default: 48000)\n");
+}
+
+/**
+ * @brief Entry point for "tap_detection_utility --serve". Runs until stopped, then prints the throughput report.
+ * @return 0 on success, 1 on error.
+ */
+int tap_server_cli(int argc, char* argv[]) {
+    const char* address = NULL;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int num_workers = cpus > 0 ? (int)cpus : 1;
+    double duration_s = 0.0;
+    double samplerate = 48000.0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            num_workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            duration_s = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            samplerate = atof(argv[++i]);
+        } else if (address == NULL && argv[i][0] != '-') {
+            address = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (address == NULL || samplerate <= 0.0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (num_workers < 1) num_workers = 1;
+    if (num_workers > SERVER_MAX_WORKERS) num_workers = SERVER_MAX_WORKERS;
+
+    raise_fd_limit();
+    int listen_fd = open_listener(address);
+    if (listen_fd < 0) return 1;
+    int listen_epoll = epoll_create1(0);
+    struct epoll_event listen_event = { .events = EPOLLIN, .data.ptr = NULL };
+    epoll_ctl(listen_epoll, EPOLL_CTL_ADD, listen_fd, &listen_event);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_stop_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    server_t* server = calloc(1, sizeof(server_t));
+    if (server == NULL) {
+        close(listen_fd);
+        return 1;
+    }
+    atomic_init(&server->open_conns, 0);
+    atomic_init(&server->stop, false);
+    worker_arg_t args[SERVER_MAX_WORKERS];
+    for (int w = 0; w < num_workers; w++) {
+        server_worker_t* worker = &server->workers[w];
+        worker->epoll_fd = epoll_create1(0);
+        worker->wake_fd = eventfd(0, EFD_NONBLOCK);
+        pthread_mutex_init(&worker->lock, NULL);
+        struct epoll_event wake_event = { .events = EPOLLIN, .data.ptr = NULL };
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->wake_fd, &wake_event);
+        args[w].server = server;
+        args[w].worker = worker;
+        if (pthread_create(&worker->thread, NULL, worker_main, &args[w]) != 0) {
+            close(worker->epoll_fd);
+            close(worker->wake_fd);
+            pthread_mutex_destroy(&worker->lock);
+            break;
+        }
+        server->num_workers++;
+    }
+    fprintf(stderr, "Serving %s with %d worker(s)\n", address, server->num_workers);
+
+    uint64_t start_ns = tap_clock_now_ns();
+    double start_cpu = cpu_seconds();
+    long next_id = 0;
+    int peak_conns = 0;
+    while (!stop_requested && server->num_workers > 0) {
+        if (duration_s > 0.0 && (tap_clock_now_ns() - start_ns) * 1e-9 >= duration_s) break;
+        struct epoll_event event;
+        if (epoll_wait(listen_epoll, &event, 1, SERVER_POLL_MS) <= 0) continue;
+        for (;;) {
+            int fd = accept(listen_fd, NULL, NULL);
+            if (fd < 0) break;
+            server_conn_t* conn = calloc(1, sizeof(server_conn_t));
+            if (conn == NULL || set_nonblocking(fd) != 0) {
+                free(conn);
+                close(fd);
+                continue;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Fails harmlessly on UNIX sockets
+            conn->fd = fd;
+            conn->id = next_id;
+            tap_detect_init(&conn->ctx, NULL);
+            int open_now = atomic_fetch_add(&server->open_conns, 1) + 1;
+            if (open_now > peak_conns) peak_conns = open_now;
+            hand_over(&server->workers[next_id++ % server->num_workers], conn);
+        }
+    }
+
+    double wall_s = (tap_clock_now_ns() - start_ns) * 1e-9;
+    atomic_store(&server->stop, true);
+    server_stats_t total;
+    memset(&total, 0, sizeof(total));
+    for (int w = 0; w < server->num_workers; w++) {
+        server_worker_t* worker = &server->workers[w];
+        pthread_join(worker->thread, NULL);
+        total.streams += worker->stats.streams;
+        total.blocks += worker->stats.blocks;
+        total.samples += worker->stats.samples;
+        total.singles += worker->stats.singles;
+        total.doubles += worker->stats.doubles;
+        total.ts_gaps += worker->stats.ts_gaps;
+        total.discarded += worker->stats.discarded;
+        total.skipped_blocks += worker->stats.skipped_blocks;
+        total.duplicate_blocks += worker->stats.duplicate_blocks;
+        total.ts_resyncs += worker->stats.ts_resyncs;
+        total.protocol_errors += worker->stats.protocol_errors;
+        total.events_unsent += worker->stats.events_unsent;
+        close(worker->epoll_fd);
+        close(worker->wake_fd);
+        pthread_mutex_destroy(&worker->lock);
+    }
+    double cpu_s = cpu_seconds() - start_cpu;
+    close(listen_epoll);
+    close(listen_fd);
+    if (strncmp(address, "unix:", 5) == 0) unlink(address + 5);
+
+    double audio_s = total.samples / samplerate;
+    fprintf(stderr, "\n--- Server Report ---\n");
+    fprintf(stderr, "Streams: %ld served, %d peak concurrent, %d worker(s)\n", total.streams, peak_conns, server->num_workers);
+    fprintf(stderr, "Audio: %.1f s in %llu blocks, %ld single / %ld double taps\n", audio_s,
+            (unsigned long long)total.blocks, total.singles, total.doubles);
+    fprintf(stderr, "Timestamp gaps: %ld (%llu blocks skipped, %llu duplicate blocks, %llu clock resyncs, %llu samples discarded)\n",
+            total.ts_gaps, (unsigned long long)total.skipped_blocks, (unsigned long long)total.duplicate_blocks,
+            (unsigned long long)total.ts_resyncs, (unsigned long long)total.discarded);
+    fprintf(stderr, "Protocol errors: %ld, unsent events: %ld\n", total.protocol_errors, total.events_unsent);
+    fprintf(stderr, "Wall: %.2f s, CPU: %.2f s (%.0f%% of one core)\n", wall_s, cpu_s, wall_s > 0.0 ? 100.0 * cpu_s / wall_s : 0.0);
+    if (cpu_s > 0.0) {
+        fprintf(stderr, "Throughput: %.0f real-time streams per core (audio seconds per CPU second)\n", audio_s / cpu_s);
+    }
+    free(server);
+    return 0;
+}
+
+#else
+
+int tap_server_cli(int argc, char* argv[]) {
+    (void)argc;
+    fprintf(stderr, "Error: %s --serve needs epoll and is only available on Linux\n", argv[0]);
+    return 1;
+}
+
+#endif // __linux__
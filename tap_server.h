@@ -0,0 +1,50 @@
+#ifndef TAP_SERVER_H
+#define TAP_SERVER_H
+#include <stdint.h>
+
+// --- Multi-Stream Detection Server ---
+// Serves many concurrent device streams from one process (Linux, epoll). Every connection on the UNIX or TCP
+// loopback listener gets its own detector context and is owned by one of a fixed set of worker threads, each
+// waiting on its own epoll set. A connection carries packets of interleaved S16_LE PCM of any size; the worker
+// reassembles them into MAX_AUDIO_FRAME_SIZE blocks and writes every event back on the same connection as a line
+//
+//   <single|double>\t<sample_ts after the reporting block>\t<sample_ts of the first tap's block>\n
+//
+// so a client can relate events to its own audio clock. On exit the server reports how many real-time streams
+// one fully used core sustains (audio seconds processed per CPU second).
+//
+//   tap_detection_utility --serve unix:/tmp/tap.sock --workers 4
+//   tap_detection_utility --serve tcp:7878 --duration 60
+
+// Packet header, little-endian on the wire, followed by num_samples * channels 16-bit samples.
+#define TAP_SERVER_PACKET_HEADER_BYTES (8)
+#define TAP_SERVER_MAX_PACKET_SAMPLES  (8192)
+#define TAP_SERVER_MAX_CHANNELS        (8)
+
+typedef struct
+{
+    uint32_t sample_ts;   /* Stream position of the first sample, in samples; wraps around. */
+    uint16_t num_samples; /* Samples per channel in this packet. */
+    uint16_t channels;    /* 1 (mic1 feeds both inputs) or more (first two are mic1 and mic2). */
+} tap_server_packet_header_t;
+
+static inline void tap_server_packet_header_encode(uint8_t* out, const tap_server_packet_header_t* header) {
+    out[0] = (uint8_t)header->sample_ts;
+    out[1] = (uint8_t)(header->sample_ts >> 8);
+    out[2] = (uint8_t)(header->sample_ts >> 16);
+    out[3] = (uint8_t)(header->sample_ts >> 24);
+    out[4] = (uint8_t)header->num_samples;
+    out[5] = (uint8_t)(header->num_samples >> 8);
+    out[6] = (uint8_t)header->channels;
+    out[7] = (uint8_t)(header->channels >> 8);
+}
+
+static inline void tap_server_packet_header_decode(tap_server_packet_header_t* header, const uint8_t* in) {
+    header->sample_ts = (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+    header->num_samples = (uint16_t)(in[4] | (in[5] << 8));
+    header->channels = (uint16_t)(in[6] | (in[7] << 8));
+}
+
+int tap_server_cli(int argc, char* argv[]);
+
+#endif // !TAP_SERVER_H
@@ -0,0 +1,63 @@
+#ifndef TAP_SHARE_H
+#define TAP_SHARE_H
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "tap_detect.h"
+
+// --- Shared Detector Metrics ---
+// Optional lock-free copy of a context's tap_detect_metrics_t for readers on other threads, e.g. the dashboards and
+// metrics endpoints of long-running services. The caller provides the storage, initializes it once with
+// tap_share_init() and attaches it with tap_detect_attach_share() after tap_detect_init(); a context without one
+// (the firmware) keeps plain counters and pays one branch per block. After every block the detector publishes the
+// counters under a sequence lock, and tap_share_read() returns a consistent copy from any thread; neither side
+// blocks. The storage is separate from the context, so readers may keep reading it while the owner re-initializes
+// the context for a new stream and attaches it again.
+
+typedef struct tap_share
+{
+    atomic_uint seq;                                /* odd while a block is being published. */
+    atomic_uint fields[TAP_DETECT_METRICS_FIELDS];  /* tap_detect_metrics_t in declaration order. */
+} tap_share_t;
+
+static inline void tap_share_init(tap_share_t *share)
+{
+    atomic_init(&share->seq, 0);
+    for (unsigned n = 0; n < TAP_DETECT_METRICS_FIELDS; n++)
+    {
+        atomic_init(&share->fields[n], 0);
+    }
+}
+
+// Called by the detector at the end of every block while a share is attached.
+static inline void tap_share_publish(tap_share_t *share, const tap_detect_metrics_t *metrics)
+{
+    const uint32_t *fields = (const uint32_t *)metrics;
+    unsigned seq = atomic_load_explicit(&share->seq, memory_order_relaxed);
+    atomic_store_explicit(&share->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (unsigned n = 0; n < TAP_DETECT_METRICS_FIELDS; n++)
+    {
+        atomic_store_explicit(&share->fields[n], fields[n], memory_order_relaxed);
+    }
+    atomic_store_explicit(&share->seq, seq + 2, memory_order_release);
+}
+
+// Consistent copy of the counters as of the last published block; retries while a block is being published.
+static inline void tap_share_read(tap_share_t *share, tap_detect_metrics_t *out)
+{
+    uint32_t *fields = (uint32_t *)out;
+    unsigned before, after;
+    do
+    {
+        before = atomic_load_explicit(&share->seq, memory_order_acquire);
+        for (unsigned n = 0; n < TAP_DETECT_METRICS_FIELDS; n++)
+        {
+            fields[n] = atomic_load_explicit(&share->fields[n], memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&share->seq, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+#endif // !TAP_SHARE_H
@@ -0,0 +1,336 @@
+#include <stdio.h>    // For console output
+#include <stdlib.h>   // For atoi, free
+#include <string.h>   // For strcmp, memcpy, memset
+
+#include "tap_shm.h"
+
+#ifndef _WIN32
+#include <errno.h>    // For EINTR
+#include <signal.h>   // For SIGINT, SIGTERM
+#include <time.h>     // For nanosleep
+#include <fcntl.h>    // For open
+#include <unistd.h>   // For ftruncate, close
+#include <sys/mman.h> // For mmap
+#include <sys/stat.h> // For fstat
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "tap_clock.h"
+#include "wav_io.h"
+
+#define SHM_DEFAULT_SLOTS (256)  /* blocks, about one second at 48 kHz. */
+#define SHM_MAX_SLOTS     (1u << 20)
+#define SHM_POLL_MS       (100)
+
+static size_t slots_offset(void) {
+    return (sizeof(tap_shm_header_t) + TAP_SHM_CACHE_LINE - 1) / TAP_SHM_CACHE_LINE * TAP_SHM_CACHE_LINE;
+}
+
+// --- Waiting ---
+// Waits until *word differs from expected, for at most wait_ms. Spurious returns are fine: callers re-check.
+static void wait_for_change(atomic_uint* word, unsigned expected, int wait_ms) {
+#ifdef __linux__
+    struct timespec timeout = { wait_ms / 1000, (long)(wait_ms % 1000) * 1000000L };
+    // Not FUTEX_PRIVATE: the word is shared between processes
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT, expected, &timeout, NULL, 0);
+#else
+    struct timespec pause = { 0, 500000L };
+    for (int waited = 0; waited < 2 * wait_ms && atomic_load_explicit(word, memory_order_acquire) == expected; waited++) {
+        nanosleep(&pause, NULL);
+    }
+#endif
+}
+
+static void wake_waiter(atomic_uint* word) {
+#ifdef __linux__
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE, 1, NULL, NULL, 0);
+#else
+    (void)word;
+#endif
+}
+
+// --- Mapping ---
+
+static int map_ring(tap_shm_ring_t* ring, int fd, size_t bytes) {
+    void* base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file referenced
+    if (base == MAP_FAILED) return -1;
+    ring->header = (tap_shm_header_t*)base;
+    ring->slots = (tap_shm_block_t*)((uint8_t*)base + slots_offset());
+    ring->map_bytes = bytes;
+    return 0;
+}
+
+/**
+ * @brief Creates (or truncates) the ring file and maps it. The creator is normally the detector.
+ * @return 0 on success, -1 on error.
+ */
+int tap_shm_create(tap_shm_ring_t* ring, const char* path, uint32_t num_slots, uint32_t samplerate) {
+    if (num_slots == 0 || (num_slots & (num_slots - 1)) != 0) return -1;
+    size_t bytes = slots_offset() + (size_t)num_slots * sizeof(tap_shm_block_t);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) return -1;
+    if (ftruncate(fd, (off_t)bytes) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (map_ring(ring, fd, bytes) != 0) return -1;
+    tap_shm_header_t* header = ring->header;
+    header->version = TAP_SHM_VERSION;
+    header->num_slots = num_slots;
+    header->samplerate = samplerate;
+    header->block_bytes = sizeof(tap_shm_block_t);
+    atomic_init(&header->head, 0);
+    atomic_init(&header->producer_waiting, 0);
+    atomic_init(&header->closed, 0);
+    atomic_init(&header->tail, 0);
+    atomic_init(&header->consumer_waiting, 0);
+    // The magic goes last, so a producer never attaches to a half-initialised ring
+    atomic_thread_fence(memory_order_release);
+    memcpy(header->magic, TAP_SHM_MAGIC, sizeof(header->magic));
+    return 0;
+}
+
+/**
+ * @brief Maps an existing ring created by tap_shm_create().
+ * @return 0 on success, -1 if it does not exist or does not match this build.
+ */
+int tap_shm_open(tap_shm_ring_t* ring, const char* path) {
+    int fd = open(path, O_RDWR);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < slots_offset()) {
+        close(fd);
+        return -1;
+    }
+    if (map_ring(ring, fd, (size_t)st.st_size) != 0) return -1;
+    const tap_shm_header_t* header = ring->header;
+    if (memcmp(header->magic, TAP_SHM_MAGIC, sizeof(header->magic)) != 0 || header->version != TAP_SHM_VERSION ||
+        header->block_bytes != sizeof(tap_shm_block_t) ||
+        slots_offset() + (size_t)header->num_slots * sizeof(tap_shm_block_t) > ring->map_bytes) {
+        tap_shm_unmap(ring);
+        return -1;
+    }
+    return 0;
+}
+
+void tap_shm_unmap(tap_shm_ring_t* ring) {
+    if (ring->header) munmap(ring->header, ring->map_bytes);
+    memset(ring, 0, sizeof(*ring));
+}
+
+// --- Producer ---
+
+tap_shm_block_t* tap_shm_acquire(tap_shm_ring_t* ring, int wait_ms) {
+    tap_shm_header_t* header = ring->header;
+    unsigned head = atomic_load_explicit(&header->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&header->tail, memory_order_acquire);
+    if (head - tail == header->num_slots) {
+        // Announce the wait before the final check, so a release in between either sees the flag or is seen here
+        atomic_store(&header->producer_waiting, 1);
+        tail = atomic_load(&header->tail);
+        if (head - tail == header->num_slots) wait_for_change(&header->tail, tail, wait_ms);
+        atomic_store(&header->producer_waiting, 0);
+        tail = atomic_load_explicit(&header->tail, memory_order_acquire);
+        if (head - tail == header->num_slots) return NULL;
+    }
+    return &ring->slots[head & (header->num_slots - 1)];
+}
+
+// Sequentially consistent increments pair with the waiter-flag stores: either the waiter sees the new counter
+// before sleeping, or this side sees the flag and wakes it.
+void tap_shm_commit(tap_shm_ring_t* ring) {
+    tap_shm_header_t* header = ring->header;
+    atomic_fetch_add(&header->head, 1);
+    if (atomic_load(&header->consumer_waiting)) wake_waiter(&header->head);
+}
+
+void tap_shm_finish(tap_shm_ring_t* ring) {
+    atomic_store(&ring->header->closed, 1);
+    wake_waiter(&ring->header->head);
+}
+
+// --- Consumer ---
+
+const tap_shm_block_t* tap_shm_peek(tap_shm_ring_t* ring, int wait_ms) {
+    tap_shm_header_t* header = ring->header;
+    unsigned tail = atomic_load_explicit(&header->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&header->head, memory_order_acquire);
+    if (head == tail) {
+        atomic_store(&header->consumer_waiting, 1);
+        head = atomic_load(&header->head);
+        if (head == tail && !atomic_load(&header->closed)) wait_for_change(&header->head, head, wait_ms);
+        atomic_store(&header->consumer_waiting, 0);
+        head = atomic_load_explicit(&header->head, memory_order_acquire);
+        if (head == tail) return NULL;
+    }
+    return &ring->slots[tail & (header->num_slots - 1)];
+}
+
+void tap_shm_release(tap_shm_ring_t* ring) {
+    tap_shm_header_t* header = ring->header;
+    atomic_fetch_add(&header->tail, 1);
+    if (atomic_load(&header->producer_waiting)) wake_waiter(&header->tail);
+}
+
+// --- Command Line ---
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_stop_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static int ingest(const char* path, uint32_t num_slots, uint32_t samplerate) {
+    tap_shm_ring_t ring;
+    memset(&ring, 0, sizeof(ring));
+    if (tap_shm_create(&ring, path, num_slots, samplerate) != 0) {
+        fprintf(stderr, "Error: Cannot create a ring of %u slots at %s\n", num_slots, path);
+        return 1;
+    }
+    fprintf(stderr, "Waiting for blocks on %s (%u slots, %zu bytes)\n", path, num_slots, ring.map_bytes);
+    printf("# time_s\tevent\tfirst_tap_s\n");
+    fflush(stdout);
+
+    static tap_detect_ctx_t ctx;
+    tap_detect_init(&ctx, NULL);
+    uint64_t blocks = 0;
+    long singles = 0, doubles = 0;
+    unsigned max_depth = 0;
+    while (!stop_requested) {
+        const tap_shm_block_t* block = tap_shm_peek(&ring, SHM_POLL_MS);
+        if (block == NULL) {
+            if (atomic_load(&ring.header->closed)) break;
+            continue;
+        }
+        unsigned depth = atomic_load(&ring.header->head) - atomic_load(&ring.header->tail);
+        if (depth > max_depth) max_depth = depth;
+        int len = block->len < 2 ? 2 : (block->len > MAX_AUDIO_FRAME_SIZE ? MAX_AUDIO_FRAME_SIZE : block->len);
+        tap_detection_result_e result = tap_detect_process_ts(&ctx, block->mic1, block->mic2, len, block->sample_ts);
+        uint32_t end_ts = block->sample_ts + (uint32_t)len;
+        tap_shm_release(&ring);
+        blocks++;
+        if (result == TAP_NONE) continue;
+        if (result == TAP_SINGLE) singles++;
+        if (result == TAP_DOUBLE) doubles++;
+        printf("%.4f\t%s\t%.4f\n", (double)end_ts / samplerate, result == TAP_DOUBLE ? "double" : "single",
+               (double)tap_detect_event_origin_ts(&ctx) / samplerate);
+        fflush(stdout);
+    }
+
+    tap_detect_metrics_t metrics;
+    tap_detect_metrics_snapshot(&ctx, &metrics);
+    fprintf(stderr, "Processed %llu blocks: %ld single, %ld double taps; %u skipped, %u duplicate blocks, %u clock resyncs, "
+            "max ring depth %u\n", (unsigned long long)blocks, singles, doubles, metrics.skipped_blocks, metrics.duplicate_blocks,
+            metrics.ts_resyncs, max_depth);
+    tap_shm_unmap(&ring);
+    unlink(path);
+    return 0;
+}
+
+static int feed(const char* path, const char* wav_path, int realtime) {
+    tap_shm_ring_t ring;
+    memset(&ring, 0, sizeof(ring));
+    if (tap_shm_open(&ring, path) != 0) {
+        fprintf(stderr, "Error: No ring at %s; start --shm-ingest first\n", path);
+        return 1;
+    }
+    uint32_t samplerate = 0;
+    long num_samples = 0;
+    const fixed_point_t* mic2 = NULL;
+    fixed_point_t* mic1 = read_wav_mics_fx(wav_path, &samplerate, &num_samples, &mic2);
+    if (mic1 == NULL) {
+        tap_shm_unmap(&ring);
+        return 1;
+    }
+    if (samplerate != ring.header->samplerate) {
+        fprintf(stderr, "Warning: %s is %u Hz, the ring expects %u Hz\n", wav_path, samplerate, ring.header->samplerate);
+    }
+
+    uint64_t start_ns = tap_clock_now_ns();
+    long full_waits = 0;
+    for (long pos = 0; pos + 2 <= num_samples && !stop_requested; pos += MAX_AUDIO_FRAME_SIZE) {
+        int len = num_samples - pos < MAX_AUDIO_FRAME_SIZE ? (int)(num_samples - pos) : MAX_AUDIO_FRAME_SIZE;
+        if (realtime) {
+            // Commit each block when its last sample would have been captured
+            uint64_t due_ns = start_ns + (uint64_t)((pos + len) * 1e9 / samplerate);
+            uint64_t now_ns = tap_clock_now_ns();
+            if (due_ns > now_ns) {
+                struct timespec pause = { (time_t)((due_ns - now_ns) / 1000000000ull), (long)((due_ns - now_ns) % 1000000000ull) };
+                while (nanosleep(&pause, &pause) != 0 && errno == EINTR && !stop_requested) {}
+            }
+        }
+        if (atomic_load(&ring.header->head) - atomic_load(&ring.header->tail) == ring.header->num_slots) full_waits++;
+        tap_shm_block_t* block;
+        while ((block = tap_shm_acquire(&ring, SHM_POLL_MS)) == NULL && !stop_requested) {}
+        if (block == NULL) break;
+        block->sample_ts = (uint32_t)pos;
+        block->len = len;
+        memcpy(block->mic1, mic1 + pos, (size_t)len * sizeof(int));
+        memcpy(block->mic2, mic2 + pos, (size_t)len * sizeof(int));
+        tap_shm_commit(&ring);
+    }
+    tap_shm_finish(&ring);
+    fprintf(stderr, "Fed %ld samples of %s in %.3f s (%ld waits on a full ring)\n", num_samples, wav_path,
+            (tap_clock_now_ns() - start_ns) * 1e-9, full_waits);
+    free(mic1);
+    tap_shm_unmap(&ring);
+    return 0;
+}
+
+/**
+ * @brief Entry point for "--shm-ingest PATH [--slots N] [--rate HZ]" (detector side, creates the ring) and
+ *        "--shm-feed PATH input.wav [--realtime]" (reference producer).
+ * @return 0 on success, 1 on error.
+ */
+int tap_shm_cli(int argc, char* argv[]) {
+    int is_feed = strcmp(argv[1], "--shm-feed") == 0;
+    const char* path = NULL;
+    const char* wav_path = NULL;
+    long num_slots = SHM_DEFAULT_SLOTS;
+    long samplerate = 48000;
+    int realtime = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--slots") == 0 && i + 1 < argc) {
+            num_slots = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            samplerate = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--realtime") == 0) {
+            realtime = 1;
+        } else if (argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else if (argv[i][0] != '-' && wav_path == NULL && is_feed) {
+            wav_path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL || (is_feed && wav_path == NULL) || num_slots < 1 || num_slots > (long)SHM_MAX_SLOTS ||
+        (num_slots & (num_slots - 1)) != 0 || samplerate <= 0) {
+        fprintf(stderr, "Usage: %s --shm-ingest RING [--slots N (power of two, default %d)] [--rate HZ]\n", argv[0], SHM_DEFAULT_SLOTS);
+        fprintf(stderr, "       %s --shm-feed RING input.wav [--realtime]\n", argv[0]);
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_stop_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    return is_feed ? feed(path, wav_path, realtime) : ingest(path, (uint32_t)num_slots, (uint32_t)samplerate);
+}
+
+#else
+
+int tap_shm_cli(int argc, char* argv[]) {
+    (void)argc;
+    fprintf(stderr, "Error: %s %s needs POSIX shared mappings and is not available on Windows\n", argv[0], argv[1]);
+    return 1;
+}
+
+#endif // !_WIN32
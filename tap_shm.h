@@ -0,0 +1,71 @@
+#ifndef TAP_SHM_H
+#define TAP_SHM_H
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "tap_detect.h"
+
+// --- Shared-Memory Ingest Ring ---
+// Single-producer, single-consumer ring of detector blocks in a file mapped by both processes (put it on /dev/shm
+// to keep it in memory). The producer writes Q2.29 samples for both mics straight into the next free slot and
+// commits it; the detector reads the slot in place and releases it, so no sample is copied between the processes.
+// Head and tail live on separate cache lines; a side that finds the ring empty (consumer) or full (producer)
+// sleeps on a futex of the counter it waits for, and the other side only makes the wake-up syscall when a waiter
+// flag is set. Without futexes (non-Linux POSIX) the waiting side polls.
+//
+//   tap_detection_utility --shm-ingest /dev/shm/tap.ring [--slots 256]
+//   tap_detection_utility --shm-feed /dev/shm/tap.ring input.wav [--realtime]
+
+#define TAP_SHM_MAGIC      "TAPSHM01"
+#define TAP_SHM_VERSION    (1)
+#define TAP_SHM_CACHE_LINE (64)
+
+typedef struct
+{
+    uint32_t sample_ts;  /* Stream position of mic1[0], in samples; wraps around (see tap_detect_process_ts()). */
+    int32_t  len;        /* Valid samples per mic, 2 to MAX_AUDIO_FRAME_SIZE. */
+    int      mic1[MAX_AUDIO_FRAME_SIZE];
+    int      mic2[MAX_AUDIO_FRAME_SIZE];
+} tap_shm_block_t;
+
+typedef struct
+{
+    // Written once by the creator
+    char     magic[8];
+    uint32_t version;
+    uint32_t num_slots;   /* Power of two. */
+    uint32_t samplerate;
+    uint32_t block_bytes; /* sizeof(tap_shm_block_t) of the creator, checked by both sides. */
+    // Producer side
+    _Alignas(TAP_SHM_CACHE_LINE) atomic_uint head; /* Blocks committed; slot head % num_slots is filled next. */
+    atomic_uint producer_waiting;
+    atomic_uint closed;                            /* The producer finished its stream. */
+    // Consumer side
+    _Alignas(TAP_SHM_CACHE_LINE) atomic_uint tail; /* Blocks released. */
+    atomic_uint consumer_waiting;
+} tap_shm_header_t;
+
+typedef struct
+{
+    tap_shm_header_t* header;
+    tap_shm_block_t*  slots;
+    size_t            map_bytes;
+} tap_shm_ring_t;
+
+int  tap_shm_create(tap_shm_ring_t* ring, const char* path, uint32_t num_slots, uint32_t samplerate);
+int  tap_shm_open(tap_shm_ring_t* ring, const char* path);
+void tap_shm_unmap(tap_shm_ring_t* ring);
+
+// Producer: fill the slot returned by tap_shm_acquire() (NULL if still full after wait_ms), then commit it.
+tap_shm_block_t* tap_shm_acquire(tap_shm_ring_t* ring, int wait_ms);
+void tap_shm_commit(tap_shm_ring_t* ring);
+void tap_shm_finish(tap_shm_ring_t* ring);
+
+// Consumer: process the slot returned by tap_shm_peek() (NULL if still empty after wait_ms) in place, then release it.
+const tap_shm_block_t* tap_shm_peek(tap_shm_ring_t* ring, int wait_ms);
+void tap_shm_release(tap_shm_ring_t* ring);
+
+int tap_shm_cli(int argc, char* argv[]);
+
+#endif // !TAP_SHM_H
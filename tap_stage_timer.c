@@ -0,0 +1,150 @@
+#include <stdio.h>    // For console I/O
+#include <stdlib.h>   // For free
+#include <string.h>   // For strcmp, memset
+
+#include "tap_stage_timer.h"
+#include "tap_clock.h"
+#include "wav_io.h"
+
+#define STAGE_TIMER_CALIBRATION_NS (20000000ull) /* 20 ms against the monotonic clock. */
+
+/**
+ * @brief Measures the rate of the stage timer against the monotonic clock.
+ * @return Timer ticks per nanosecond.
+ */
+double tap_stage_timer_ticks_per_ns(void) {
+#if defined(TAP_DETECT_STAGE_TIMING) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86) || defined(__aarch64__))
+    uint64_t start_ns = tap_clock_now_ns();
+    uint64_t start_ticks = tap_stage_timer_now();
+    uint64_t now_ns;
+    do {
+        now_ns = tap_clock_now_ns();
+    } while (now_ns - start_ns < STAGE_TIMER_CALIBRATION_NS);
+    uint64_t ticks = tap_stage_timer_now() - start_ticks;
+    return (double)ticks / (double)(now_ns - start_ns);
+#else
+    return 1.0; // clock_gettime fallback counts nanoseconds
+#endif
+}
+
+#ifdef TAP_DETECT_STAGE_TIMING
+static const char* const stage_names[TAP_STAGE_COUNT] = { "mix_mics", "haar_dwt", "find_peaks", "sequence" };
+
+// Smallest duration (in ticks) that lands in the given histogram bin.
+static uint64_t bin_lower_bound(int bin) {
+    if (bin < 4) return (uint64_t)bin;
+    int log2 = bin / 4 + 1;
+    return (uint64_t)(4 + bin % 4) << (log2 - 2);
+}
+
+// Upper edge of the bin holding the given fraction of calls; an over-estimate by at most a quarter octave.
+static uint64_t hist_percentile(const tap_stage_timing_t* timing, double p) {
+    uint64_t rank = (uint64_t)(p * (double)(timing->calls - 1));
+    uint64_t seen = 0;
+    for (int bin = 0; bin < TAP_STAGE_TIMER_BINS; bin++) {
+        seen += timing->hist[bin];
+        if (seen > rank) return bin + 1 < TAP_STAGE_TIMER_BINS ? bin_lower_bound(bin + 1) : timing->max_ticks;
+    }
+    return timing->max_ticks;
+}
+
+static void merge_timing(tap_stage_timing_t* into, const tap_stage_timing_t* from) {
+    for (int s = 0; s < TAP_STAGE_COUNT; s++) {
+        into[s].calls += from[s].calls;
+        into[s].total_ticks += from[s].total_ticks;
+        if (from[s].max_ticks > into[s].max_ticks) into[s].max_ticks = from[s].max_ticks;
+        for (int bin = 0; bin < TAP_STAGE_TIMER_BINS; bin++) into[s].hist[bin] += from[s].hist[bin];
+    }
+}
+
+static void print_timing(const char* name, const tap_stage_timing_t* timing, double ticks_per_ns, int csv) {
+    uint64_t block_ticks = 0;
+    for (int s = 0; s < TAP_STAGE_COUNT; s++) block_ticks += timing[s].total_ticks;
+    if (!csv) {
+        printf("%s\n", name);
+        printf("%-10s | %9s | %9s | %9s | %9s | %9s | %6s\n", "Stage", "blocks", "mean ns", "p50 ns", "p99 ns", "max ns", "share");
+    }
+    for (int s = 0; s < TAP_STAGE_COUNT; s++) {
+        const tap_stage_timing_t* t = &timing[s];
+        if (t->calls == 0) continue;
+        double mean = (double)t->total_ticks / (double)t->calls / ticks_per_ns;
+        double p50 = (double)hist_percentile(t, 0.50) / ticks_per_ns;
+        double p99 = (double)hist_percentile(t, 0.99) / ticks_per_ns;
+        double max = (double)t->max_ticks / ticks_per_ns;
+        double share = block_ticks ? 100.0 * (double)t->total_ticks / (double)block_ticks : 0.0;
+        if (csv) {
+            printf("%s,%s,%llu,%.1f,%.1f,%.1f,%.1f,%.2f\n", name, stage_names[s], (unsigned long long)t->calls, mean, p50, p99, max, share);
+        } else {
+            printf("%-10s | %9llu | %9.1f | %9.1f | %9.1f | %9.1f | %5.1f%%\n", stage_names[s], (unsigned long long)t->calls,
+                   mean, p50, p99, max, share);
+        }
+    }
+    if (!csv) printf("\n");
+}
+#endif
+
+/**
+ * @brief Entry point for "--stage-times <wav>... [--format text|csv]" of tap_detection_utility and tap_bench.
+ *        Runs each recording through its own detector context and prints the per-stage time breakdown per file
+ *        and over all files. Requires a build with -DTAP_DETECT_STAGE_TIMING.
+ * @return 0 on success, 1 on error.
+ */
+int tap_stage_timer_cli(int argc, char* argv[]) {
+    const char* format = "text";
+    int num_inputs = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format = argv[++i];
+        } else if (argv[i][0] != '-') {
+            num_inputs++;
+        } else {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+    if (num_inputs == 0 || (strcmp(format, "text") != 0 && strcmp(format, "csv") != 0)) {
+        fprintf(stderr, "Usage: %s --stage-times <input_wav>... [--format text|csv]\n", argv[0]);
+        return 1;
+    }
+
+#ifndef TAP_DETECT_STAGE_TIMING
+    fprintf(stderr, "Error: This build has no stage timers; rebuild with -DTAP_DETECT_STAGE_TIMING (Debug or Bench target).\n");
+    return 1;
+#else
+    int csv = strcmp(format, "csv") == 0;
+    double ticks_per_ns = tap_stage_timer_ticks_per_ns();
+    if (csv) {
+        printf("file,stage,blocks,mean_ns,p50_ns,p99_ns,max_ns,share_pct\n");
+    } else {
+        printf("Timer: %.3f ticks/ns; percentiles are quarter-octave histogram bounds\n\n", ticks_per_ns);
+    }
+
+    static tap_stage_timing_t all[TAP_STAGE_COUNT];
+    memset(all, 0, sizeof(all));
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0) {
+            i++;
+            continue;
+        }
+        uint32_t samplerate;
+        long num_samples;
+        const fixed_point_t* mic2 = NULL;
+        fixed_point_t* mic1 = read_wav_mics_fx(argv[i], &samplerate, &num_samples, &mic2);
+        if (!mic1) {
+            fprintf(stderr, "Failed to load audio from %s. Exiting.\n", argv[i]);
+            return 1;
+        }
+        static tap_detect_ctx_t ctx;
+        tap_detect_init(&ctx, NULL);
+        for (long pos = 0; pos + 2 <= num_samples; pos += MAX_AUDIO_FRAME_SIZE) {
+            int len = num_samples - pos < MAX_AUDIO_FRAME_SIZE ? (int)(num_samples - pos) : MAX_AUDIO_FRAME_SIZE;
+            tap_detect_process(&ctx, &mic1[pos], &mic2[pos], len);
+        }
+        free(mic1);
+        print_timing(argv[i], ctx.timing, ticks_per_ns, csv);
+        merge_timing(all, ctx.timing);
+    }
+    if (num_inputs > 1) print_timing("all", all, ticks_per_ns, csv);
+    return 0;
+#endif
+}
@@ -0,0 +1,93 @@
+#ifndef TAP_STAGE_TIMER_H
+#define TAP_STAGE_TIMER_H
+#include <stdint.h>
+
+#include "tap_detect.h"
+
+// --- Per-Stage Timer Hooks ---
+// Building with -DTAP_DETECT_STAGE_TIMING (the Debug and Bench targets) makes tap_detect_process() time its mix,
+// DWT, peak search and state machine stages into the context's accumulators and log-scale histograms. Timestamps
+// come from the time-stamp counter (rdtsc on x86, cntvct_el0 on AArch64) or clock_gettime elsewhere; the
+// bookkeeping between two stages is not charged to either. "--stage-times" runs real recordings through the
+// detector and reports the breakdown. Without the flag the hooks compile to nothing.
+
+#ifdef TAP_DETECT_STAGE_TIMING
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#elif !defined(__aarch64__)
+#include <time.h>
+#endif
+#include <string.h>
+
+// Current timer value in ticks; see tap_stage_timer_ticks_per_ns() for the conversion to time.
+static inline uint64_t tap_stage_timer_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Histogram bin of a duration: exact below 4 ticks, then four bins per power of two.
+static inline int tap_stage_timer_bin(uint64_t ticks)
+{
+    if (ticks < 4)
+    {
+        return (int)ticks;
+    }
+    int log2 = 63;
+#if defined(__GNUC__)
+    log2 -= __builtin_clzll(ticks);
+#else
+    while (!(ticks >> log2))
+    {
+        log2--;
+    }
+#endif
+    int bin = 4 * (log2 - 1) + (int)((ticks >> (log2 - 2)) & 3);
+    return bin < TAP_STAGE_TIMER_BINS ? bin : TAP_STAGE_TIMER_BINS - 1;
+}
+
+// Records the time since start for one stage and returns a fresh start time for the next stage.
+static inline uint64_t tap_stage_timer_lap(tap_stage_timing_t *timing, uint64_t start)
+{
+    uint64_t ticks = tap_stage_timer_now() - start;
+    timing->calls++;
+    timing->total_ticks += ticks;
+    if (ticks > timing->max_ticks)
+    {
+        timing->max_ticks = ticks;
+    }
+    timing->hist[tap_stage_timer_bin(ticks)]++;
+    return tap_stage_timer_now();
+}
+
+static inline void tap_stage_timer_reset(tap_stage_timing_t *timing)
+{
+    memset(timing, 0, TAP_STAGE_COUNT * sizeof(*timing));
+}
+
+#define TAP_STAGE_TIMER_START(start)             uint64_t start = tap_stage_timer_now()
+#define TAP_STAGE_TIMER_LAP(ctx, stage, start)   (start = tap_stage_timer_lap(&(ctx)->timing[(stage)], start))
+#define TAP_STAGE_TIMER_RESET(ctx)               tap_stage_timer_reset((ctx)->timing)
+#else
+#define TAP_STAGE_TIMER_START(start)
+#define TAP_STAGE_TIMER_LAP(ctx, stage, start)   ((void)0)
+#define TAP_STAGE_TIMER_RESET(ctx)               ((void)0)
+#endif
+
+double tap_stage_timer_ticks_per_ns(void);
+int tap_stage_timer_cli(int argc, char *argv[]);
+
+#endif // !TAP_STAGE_TIMER_H
@@ -0,0 +1,825 @@
+#include <stdio.h>    // For console output
+#include <stdlib.h>   // For atoi, atol
+#include <string.h>   // For strcmp, strncmp, strlen, memset
+#include <errno.h>    // For EINTR
+#include <signal.h>   // For SIGINT, SIGTERM
+#include <time.h>     // For timespec_get
+#include <fcntl.h>    // For open
+#include <sys/stat.h> // For stat, S_ISFIFO
+#include <pthread.h>  // For the detector and event writer threads
+#include <semaphore.h> // For waking the event writer without blocking the detector
+#include <stdatomic.h> // For the event ring
+#ifdef _WIN32
+#include <io.h>       // For _read, _setmode
+#else
+#include <unistd.h>   // For read, close, unlink
+#include <sys/socket.h>
+#include <sys/un.h>   // For sockaddr_un
+#endif
+
+#include "tap_stream.h"
+#include "tap_detect.h"
+#include "tap_clock.h"
+#include "tap_rt.h"
+#include "tap_metrics.h"
+#include "tap_share.h"
+#include "wav_io.h"
+
+#ifndef O_BINARY
+#define O_BINARY (0)
+#endif
+
+#define STREAM_MAX_CHANNELS   (8)
+#define STREAM_BYTES_PER_SAMPLE (2)
+#define STREAM_DEFAULT_QUEUE  (64)   /* blocks, 256 ms at 48 kHz. */
+#define STREAM_MAX_QUEUE      (65536)
+#define STREAM_EVENT_RING     (256)  /* events waiting for the writer thread; a power of two. */
+
+// What the reader does when the detector has fallen behind by a full queue.
+typedef enum
+{
+    STREAM_POLICY_BLOCK = 0,   // Stop reading until a slot frees up; the transport buffers, then the producer stalls
+    STREAM_POLICY_DROP_OLDEST, // Discard the oldest queued block; the detector skips it
+    STREAM_POLICY_ENERGY_GATE, // Block, but once the queue is half full only run the detector on blocks loud enough to hold a tap
+    STREAM_POLICY_COUNT
+} stream_policy_e;
+
+static const char* const policy_names[STREAM_POLICY_COUNT] = { "block", "drop-oldest", "energy-gate" };
+
+typedef struct {
+    int      channels;
+    uint32_t samplerate;
+    int      json;
+    int      queue_blocks;
+    stream_policy_e policy;
+    int32_t  gate_level;   // Q2.29 cD1 level a block must be able to reach to be processed while gating
+    uint64_t deadline_ns;  // Latency budget of a block, from its last sample arriving to its result; 0 for one frame period
+    tap_rt_options_t rt;
+    int      metrics_port; // Serve Prometheus metrics on 127.0.0.1:metrics_port; 0 for none
+} stream_options_t;
+
+// Written by the detector thread; read after it has been joined.
+typedef struct {
+    uint64_t blocks;
+    uint64_t gated;       // Blocks below the gate, skipped while the queue was at least half full
+    uint64_t skipped;     // Blocks reported to tap_detect_skip_blocks(), dropped or gated
+    long     singles;
+    long     doubles;
+    // Per-frame deadline accounting
+    uint64_t deadline_misses;  // Blocks whose result came later than deadline_ns after the block was read
+    uint64_t max_latency_ns;
+    uint64_t max_compute_ns;   // Longest time spent in the detector on one block
+    uint64_t compute_ns;
+    uint64_t events_lost;      // Events dropped because the writer thread fell a full ring behind
+} stream_totals_t;
+
+// One block on its way from the reader to the detector thread.
+typedef struct {
+    long     stream_id;
+    uint64_t seq;          // Block index within the stream; a gap means blocks were dropped
+    uint64_t ready_ns;     // tap_clock_now_ns() when the reader completed the block
+    int      len;
+    int      mic1[MAX_AUDIO_FRAME_SIZE];
+    int      mic2[MAX_AUDIO_FRAME_SIZE];
+} stream_block_t;
+
+// --- Bounded Ingest Queue ---
+typedef struct {
+    stream_block_t* slots;
+    int             capacity;
+    int             head;
+    int             count;
+    bool            closed;   // No more blocks will be pushed
+    pthread_mutex_t lock;
+    pthread_cond_t  not_empty;
+    pthread_cond_t  not_full;
+    // Sizing metrics, guarded by lock
+    int             max_depth;
+    uint64_t        depth_sum;      // Queue depth seen by every pop, for the mean
+    uint64_t        pops;
+    uint64_t        wait_ns;        // Time the reader spent waiting
+    // Also read by the metrics exporter without the lock
+    atomic_int      depth;          // Mirror of count
+    atomic_ullong   producer_waits; // Pushes that found the queue full and waited
+    atomic_ullong   dropped;        // Blocks discarded by the drop-oldest policy
+} stream_queue_t;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_stop_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+// Installs the stop handlers without SA_RESTART, so a blocked read() or accept() returns and the loop can exit.
+static void install_stop_handlers(void) {
+#ifdef _WIN32
+    signal(SIGINT, on_stop_signal);
+    signal(SIGTERM, on_stop_signal);
+#else
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_stop_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+#endif
+}
+
+// Reads whatever is available, up to len bytes. Returns the byte count, 0 at end of stream, -1 on error or stop.
+static long read_some(int fd, unsigned char* buf, size_t len) {
+    for (;;) {
+#ifdef _WIN32
+        long n = _read(fd, buf, (unsigned int)len);
+#else
+        long n = (long)read(fd, buf, len);
+#endif
+        if (n >= 0) return n;
+        if (errno != EINTR || stop_requested) return -1;
+    }
+}
+
+// With inherit_priority the lock boosts the reader while it holds it, so a SCHED_FIFO detector never waits behind a
+// preempted reader.
+static int queue_init(stream_queue_t* queue, int capacity, bool inherit_priority) {
+    memset(queue, 0, sizeof(*queue));
+    queue->slots = malloc((size_t)capacity * sizeof(stream_block_t));
+    if (queue->slots == NULL) return -1;
+    queue->capacity = capacity;
+    atomic_init(&queue->depth, 0);
+    atomic_init(&queue->producer_waits, 0);
+    atomic_init(&queue->dropped, 0);
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+#if defined(_POSIX_THREAD_PRIO_INHERIT) && _POSIX_THREAD_PRIO_INHERIT > 0
+    if (inherit_priority) pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+#else
+    (void)inherit_priority;
+#endif
+    pthread_mutex_init(&queue->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    return 0;
+}
+
+static void queue_free(stream_queue_t* queue) {
+    pthread_cond_destroy(&queue->not_full);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->slots);
+}
+
+static void queue_push(stream_queue_t* queue, const stream_block_t* block, stream_policy_e policy) {
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count == queue->capacity) {
+        if (policy == STREAM_POLICY_DROP_OLDEST) {
+            queue->head = (queue->head + 1) % queue->capacity;
+            queue->count--;
+            tap_metrics_add(&queue->dropped, 1);
+        } else {
+            uint64_t start_ns = tap_clock_now_ns();
+            tap_metrics_add(&queue->producer_waits, 1);
+            while (queue->count == queue->capacity) pthread_cond_wait(&queue->not_full, &queue->lock);
+            queue->wait_ns += tap_clock_now_ns() - start_ns;
+        }
+    }
+    queue->slots[(queue->head + queue->count) % queue->capacity] = *block;
+    queue->count++;
+    atomic_store_explicit(&queue->depth, queue->count, memory_order_relaxed);
+    if (queue->count > queue->max_depth) queue->max_depth = queue->count;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static void queue_close(stream_queue_t* queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = true;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * @brief Takes the oldest block, waiting for one if the queue is empty.
+ * @return false once the queue is closed and empty. *depth_out receives the depth before the pop.
+ */
+static bool queue_pop(stream_queue_t* queue, stream_block_t* block, int* depth_out) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0 && !queue->closed) pthread_cond_wait(&queue->not_empty, &queue->lock);
+    bool ok = queue->count > 0;
+    if (ok) {
+        *block = queue->slots[queue->head];
+        *depth_out = queue->count;
+        queue->depth_sum += (uint64_t)queue->count;
+        queue->pops++;
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        atomic_store_explicit(&queue->depth, queue->count, memory_order_relaxed);
+        pthread_cond_signal(&queue->not_full);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return ok;
+}
+
+static double wall_time_s(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t frame_period_ns(const stream_options_t* options) {
+    return (uint64_t)MAX_AUDIO_FRAME_SIZE * 1000000000ull / options->samplerate;
+}
+
+static uint64_t frame_deadline_ns(const stream_options_t* options) {
+    return options->deadline_ns ? options->deadline_ns : frame_period_ns(options);
+}
+
+// --- Metrics Endpoint ---
+// Served by an exporter thread with --metrics-port (see tap_metrics.h). The detector and writer threads publish their
+// own values with relaxed stores and never wait for a scrape. The detector counters of the current stream come from
+// a tap_share_t attached to the context, so a scrape sees them as of one block; the other series are read one by one.
+typedef enum
+{
+    STREAM_STAGE_QUEUE = 0, // From the reader completing a block to the detector taking it
+    STREAM_STAGE_DETECT,    // Detector time spent on the block
+    STREAM_STAGE_TOTAL,     // From the reader completing a block to its result
+    STREAM_STAGE_OUTPUT,    // From an event being reported to it being written and flushed
+    STREAM_STAGE_COUNT
+} stream_stage_e;
+
+static const char* const stage_names[STREAM_STAGE_COUNT] = { "queue", "detect", "total", "output" };
+
+typedef struct {
+    // Published by the detector thread after every block
+    atomic_long   stream_id;       // Stream of the detector counters, -1 before the first block
+    tap_share_t   detector;        // Detector counters of the current stream, published by the detector itself
+    atomic_ullong blocks;
+    atomic_ullong gated;
+    atomic_ullong skipped;
+    atomic_ullong singles;
+    atomic_ullong doubles;
+    atomic_ullong deadline_misses;
+    atomic_ullong compute_ns;
+    atomic_ullong events_lost;
+    tap_metrics_hist_t stage[STREAM_STAGE_COUNT]; // The output stage is written by the writer thread
+    // Exporter thread only
+    const stream_options_t* options;
+    stream_queue_t* queue;
+    uint64_t last_tick_ns;
+    uint64_t last_frames;
+    uint64_t last_compute_ns;
+    double   frames_per_s;
+    double   real_time_factor;
+} stream_metrics_t;
+
+static void metrics_init(stream_metrics_t* metrics, const stream_options_t* options, stream_queue_t* queue) {
+    memset(metrics, 0, sizeof(*metrics));
+    atomic_init(&metrics->stream_id, -1);
+    atomic_ullong* counters[] = { &metrics->blocks, &metrics->gated, &metrics->skipped, &metrics->singles,
+                                  &metrics->doubles, &metrics->deadline_misses, &metrics->compute_ns, &metrics->events_lost };
+    for (size_t c = 0; c < sizeof(counters) / sizeof(counters[0]); c++) atomic_init(counters[c], 0);
+    tap_share_init(&metrics->detector);
+    for (int s = 0; s < STREAM_STAGE_COUNT; s++) tap_metrics_hist_init(&metrics->stage[s]);
+    metrics->options = options;
+    metrics->queue = queue;
+}
+
+// Exporter thread, once a second: rates over the last second. Gated blocks count as frames the detector kept up with.
+static void tick_metrics(void* arg, uint64_t now_ns) {
+    stream_metrics_t* metrics = arg;
+    uint64_t frames = tap_metrics_get(&metrics->blocks) + tap_metrics_get(&metrics->gated);
+    uint64_t compute_ns = tap_metrics_get(&metrics->compute_ns);
+    if (metrics->last_tick_ns && now_ns > metrics->last_tick_ns) {
+        uint64_t new_frames = frames - metrics->last_frames;
+        double audio_ns = (double)new_frames * (double)frame_period_ns(metrics->options);
+        metrics->frames_per_s = new_frames * 1e9 / (double)(now_ns - metrics->last_tick_ns);
+        metrics->real_time_factor = new_frames ? (double)(compute_ns - metrics->last_compute_ns) / audio_ns : 0.0;
+    }
+    metrics->last_tick_ns = now_ns;
+    metrics->last_frames = frames;
+    metrics->last_compute_ns = compute_ns;
+}
+
+static void write_counter(tap_metrics_buf_t* buf, const char* name, const char* help, atomic_ullong* value) {
+    tap_metrics_family(buf, name, "counter", help);
+    tap_metrics_printf(buf, "%s %llu\n", name, (unsigned long long)tap_metrics_get(value));
+}
+
+// Exporter thread, for every scrape.
+static void render_metrics(void* arg, tap_metrics_buf_t* buf) {
+    stream_metrics_t* metrics = arg;
+    const stream_options_t* options = metrics->options;
+    write_counter(buf, "tap_stream_frames_total", "Blocks run through the detector.", &metrics->blocks);
+    tap_metrics_family(buf, "tap_stream_frames_per_second", "gauge", "Blocks taken from the queue per second, over the last second.");
+    tap_metrics_printf(buf, "tap_stream_frames_per_second %.3f\n", metrics->frames_per_s);
+    tap_metrics_family(buf, "tap_stream_realtime_factor", "gauge",
+                       "Detector time per second of audio over the last second; below 1 keeps up.");
+    tap_metrics_printf(buf, "tap_stream_realtime_factor %.6f\n", metrics->real_time_factor);
+    tap_metrics_family(buf, "tap_stream_events_total", "counter", "Tap events reported, by type.");
+    tap_metrics_printf(buf, "tap_stream_events_total{type=\"single\"} %llu\n", (unsigned long long)tap_metrics_get(&metrics->singles));
+    tap_metrics_printf(buf, "tap_stream_events_total{type=\"double\"} %llu\n", (unsigned long long)tap_metrics_get(&metrics->doubles));
+    write_counter(buf, "tap_stream_events_lost_total", "Events dropped because the writer thread fell a full ring behind.",
+                  &metrics->events_lost);
+    tap_metrics_family(buf, "tap_stream_queue_depth", "gauge", "Blocks waiting for the detector.");
+    tap_metrics_printf(buf, "tap_stream_queue_depth %d\n", atomic_load_explicit(&metrics->queue->depth, memory_order_relaxed));
+    tap_metrics_family(buf, "tap_stream_queue_capacity", "gauge", "Blocks the queue holds (--queue).");
+    tap_metrics_printf(buf, "tap_stream_queue_capacity %d\n", metrics->queue->capacity);
+    write_counter(buf, "tap_stream_frames_dropped_total", "Blocks discarded by the drop-oldest policy.", &metrics->queue->dropped);
+    write_counter(buf, "tap_stream_frames_gated_total", "Blocks below the energy gate, not run through the detector.",
+                  &metrics->gated);
+    write_counter(buf, "tap_stream_frames_skipped_total", "Blocks the detector never saw (dropped or gated).", &metrics->skipped);
+    write_counter(buf, "tap_stream_producer_waits_total", "Blocks the reader had to wait to queue.", &metrics->queue->producer_waits);
+    write_counter(buf, "tap_stream_deadline_misses_total", "Blocks whose result came later than the deadline.",
+                  &metrics->deadline_misses);
+    tap_metrics_family(buf, "tap_stream_deadline_seconds", "gauge", "Latency budget of a block (--deadline-us).");
+    tap_metrics_printf(buf, "tap_stream_deadline_seconds %.6f\n", frame_deadline_ns(options) * 1e-9);
+    tap_metrics_family(buf, "tap_stream_stage_latency_seconds", "histogram",
+                       "Per-block latency of the queue, detector, end-to-end and event output stages.");
+    for (int s = 0; s < STREAM_STAGE_COUNT; s++) {
+        char labels[32];
+        snprintf(labels, sizeof(labels), "stage=\"%s\"", stage_names[s]);
+        tap_metrics_write_hist(buf, "tap_stream_stage_latency_seconds", labels, &metrics->stage[s]);
+    }
+
+    long stream_id = atomic_load_explicit(&metrics->stream_id, memory_order_acquire);
+    if (stream_id < 0) return;
+    tap_metrics_family(buf, "tap_stream_current_stream", "gauge", "Id of the stream being processed.");
+    tap_metrics_printf(buf, "tap_stream_current_stream %ld\n", stream_id);
+    tap_detect_metrics_t counters;
+    tap_share_read(&metrics->detector, &counters);
+    const uint32_t* fields = (const uint32_t*)&counters;
+    for (int n = 0; n < (int)TAP_DETECT_METRICS_FIELDS; n++) {
+        char name[64];
+        snprintf(name, sizeof(name), "tap_detector_%s_total", tap_detect_metrics_name(n));
+        tap_metrics_family(buf, name, "counter", "Detector counter of the current stream (see tap_detect_metrics_t).");
+        tap_metrics_printf(buf, "%s{stream=\"%ld\"} %u\n", name, stream_id, fields[n]);
+    }
+}
+
+// --- Event Output ---
+// The detector thread never formats or writes: it puts events on a single-producer, single-consumer ring and posts a
+// semaphore (a non-blocking wake-up), and the writer thread prints and flushes them.
+typedef struct {
+    long     stream_id;
+    uint64_t frame_start;   // Stream time of the reporting frame, in samples
+    uint32_t origin_block;  // Block of the first tap
+    tap_detection_result_e result;
+    double   wall_time_s;
+    uint64_t reported_ns;   // tap_clock_now_ns() when the detector reported it
+} stream_event_t;
+
+typedef struct {
+    stream_event_t  events[STREAM_EVENT_RING];
+    atomic_uint     head;   // Events pushed by the detector
+    atomic_uint     tail;   // Events printed by the writer
+    atomic_bool     closed;
+    sem_t           ready;
+    const stream_options_t* options;
+    stream_metrics_t* metrics;
+} stream_event_ring_t;
+
+// Detector side; returns false if the ring is full and the event was dropped.
+static bool event_push(stream_event_ring_t* ring, long stream_id, uint64_t frame_start, tap_detection_result_e result,
+                       const tap_detect_ctx_t* ctx) {
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) == STREAM_EVENT_RING) return false;
+    stream_event_t* event = &ring->events[head % STREAM_EVENT_RING];
+    event->stream_id = stream_id;
+    event->frame_start = frame_start;
+    event->origin_block = ctx->event_origin_block;
+    event->result = result;
+    event->wall_time_s = wall_time_s();
+    event->reported_ns = tap_clock_now_ns();
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    sem_post(&ring->ready);
+    return true;
+}
+
+static void event_close(stream_event_ring_t* ring) {
+    atomic_store(&ring->closed, true);
+    sem_post(&ring->ready);
+}
+
+// Prints one event and flushes it, so consumers see it as soon as the frame that produced it has been processed.
+static void print_event(const stream_options_t* options, const stream_event_t* event) {
+    double time_s = (double)event->frame_start / options->samplerate;
+    double first_tap_s = (double)(event->origin_block - 1) * MAX_AUDIO_FRAME_SIZE / options->samplerate;
+    const char* name = event->result == TAP_DOUBLE ? "double" : "single";
+    if (options->json) {
+        printf("{\"stream\": %ld, \"time_s\": %.4f, \"event\": \"%s\", \"first_tap_s\": %.4f, \"wall_time_s\": %.3f}\n",
+               event->stream_id, time_s, name, first_tap_s, event->wall_time_s);
+    } else {
+        printf("%ld\t%.4f\t%s\t%.4f\t%.3f\n", event->stream_id, time_s, name, first_tap_s, event->wall_time_s);
+    }
+    fflush(stdout);
+}
+
+// Writer thread: prints events until the ring is closed and drained.
+static void* writer_main(void* arg) {
+    stream_event_ring_t* ring = arg;
+    for (;;) {
+        while (sem_wait(&ring->ready) != 0 && errno == EINTR) {}
+        bool closed = atomic_load(&ring->closed);
+        unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        for (; tail != head; tail++) {
+            const stream_event_t* event = &ring->events[tail % STREAM_EVENT_RING];
+            print_event(ring->options, event);
+            tap_metrics_hist_observe(&ring->metrics->stage[STREAM_STAGE_OUTPUT], tap_clock_now_ns() - event->reported_ns);
+            atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+        }
+        if (closed) return NULL;
+    }
+}
+
+// Converts interleaved S16_LE samples to the two Q2.29 detector inputs.
+static void convert_block(const stream_options_t* options, const unsigned char* pcm, int len, stream_block_t* block) {
+    int second = options->channels > 1 ? 1 : 0;
+    for (int n = 0; n < len; n++) {
+        const unsigned char* frame = pcm + (size_t)n * options->channels * STREAM_BYTES_PER_SAMPLE;
+        int16_t left = (int16_t)(frame[0] | (frame[1] << 8));
+        int16_t right = (int16_t)(frame[2 * second] | (frame[2 * second + 1] << 8));
+        // Q0.15 to Q2.29, as read_wav_mics_fx() does
+        block->mic1[n] = (fixed_point_t)left << (Q_FORMAT - 15);
+        block->mic2[n] = (fixed_point_t)right << (Q_FORMAT - 15);
+    }
+    block->len = len;
+}
+
+// The mix of the two mics never exceeds the larger input and cD1 is a difference of two mixed samples, so a block
+// whose samples all stay below half the gate level cannot produce a candidate at that level.
+static bool below_gate(const stream_block_t* block, int32_t gate_level) {
+    int32_t peak = 0;
+    for (int n = 0; n < block->len; n++) {
+        peak = FX_MAX(peak, FX_ABS(block->mic1[n]));
+        peak = FX_MAX(peak, FX_ABS(block->mic2[n]));
+    }
+    return 2 * (int64_t)peak < gate_level;
+}
+
+typedef struct {
+    const stream_options_t* options;
+    stream_queue_t*         queue;
+    stream_event_ring_t*    events;
+    stream_metrics_t*       metrics;
+    stream_totals_t         totals;
+} detector_arg_t;
+
+// Counts the result of a detector call in the totals and reports it if it is an event.
+static void count_event(detector_arg_t* detector, long stream_id, uint64_t frame_start, tap_detection_result_e result,
+                        const tap_detect_ctx_t* ctx) {
+    if (result == TAP_NONE) return;
+    if (result == TAP_SINGLE) detector->totals.singles++;
+    if (result == TAP_DOUBLE) detector->totals.doubles++;
+    if (!event_push(detector->events, stream_id, frame_start, result, ctx)) detector->totals.events_lost++;
+}
+
+// Copies the totals for the exporter, after every block; the detector publishes its own counters into the share.
+static void publish_totals(stream_metrics_t* metrics, const stream_totals_t* totals) {
+    atomic_store_explicit(&metrics->blocks, totals->blocks, memory_order_relaxed);
+    atomic_store_explicit(&metrics->gated, totals->gated, memory_order_relaxed);
+    atomic_store_explicit(&metrics->skipped, totals->skipped, memory_order_relaxed);
+    atomic_store_explicit(&metrics->singles, (uint64_t)totals->singles, memory_order_relaxed);
+    atomic_store_explicit(&metrics->doubles, (uint64_t)totals->doubles, memory_order_relaxed);
+    atomic_store_explicit(&metrics->deadline_misses, totals->deadline_misses, memory_order_relaxed);
+    atomic_store_explicit(&metrics->compute_ns, totals->compute_ns, memory_order_relaxed);
+    atomic_store_explicit(&metrics->events_lost, totals->events_lost, memory_order_relaxed);
+}
+
+// Detector thread: runs every queued block through the context of its stream and tells the detector about blocks it never saw.
+// Between queue_pop() calls (the per-frame path) it neither allocates nor makes blocking calls.
+static void* detector_main(void* arg) {
+    detector_arg_t* detector = arg;
+    const stream_options_t* options = detector->options;
+    stream_totals_t* totals = &detector->totals;
+    stream_metrics_t* metrics = detector->metrics;
+    static stream_block_t block;
+    static tap_detect_ctx_t ctx;
+    long stream_id = -1;
+    uint64_t next_seq = 0;
+    int depth = 0;
+    uint64_t deadline_ns = frame_deadline_ns(options);
+    // The metrics endpoint exports lost_to_cooldown, which needs the shadow search
+    tap_detect_config_t cfg;
+    tap_detect_config_default(&cfg);
+    cfg.shadow_search = options->metrics_port > 0;
+
+    tap_rt_setup_thread(&options->rt);
+    while (queue_pop(detector->queue, &block, &depth)) {
+        tap_rt_frame_enter();
+        uint64_t start_ns = tap_clock_now_ns();
+        tap_metrics_hist_observe(&metrics->stage[STREAM_STAGE_QUEUE], start_ns - block.ready_ns);
+        if (block.stream_id != stream_id) {
+            tap_detect_init(&ctx, &cfg);
+            stream_id = block.stream_id;
+            // Publish the zeroed counters before the new stream id, so the id never labels the previous stream's counters
+            tap_detect_attach_share(&ctx, &metrics->detector);
+            tap_share_publish(&metrics->detector, &ctx.metrics);
+            atomic_store_explicit(&metrics->stream_id, stream_id, memory_order_release);
+            next_seq = 0;
+        }
+        uint64_t frame_start = block.seq * MAX_AUDIO_FRAME_SIZE;
+        tap_detection_result_e result = TAP_NONE;
+        if (block.seq > next_seq) {
+            // Blocks dropped from the queue still count as stream time for the cooldown and double-tap window
+            uint64_t missing = block.seq - next_seq;
+            totals->skipped += missing;
+            result = tap_detect_skip_blocks(&ctx, (uint32_t)missing);
+            count_event(detector, stream_id, frame_start, result, &ctx);
+        }
+        next_seq = block.seq + 1;
+
+        if (options->policy == STREAM_POLICY_ENERGY_GATE && 2 * depth >= detector->queue->capacity &&
+            below_gate(&block, options->gate_level)) {
+            totals->gated++;
+            totals->skipped++;
+            result = tap_detect_skip_blocks(&ctx, 1);
+        } else {
+            result = tap_detect_process(&ctx, block.mic1, block.mic2, block.len);
+            totals->blocks++;
+        }
+        count_event(detector, stream_id, frame_start, result, &ctx);
+
+        uint64_t done_ns = tap_clock_now_ns();
+        uint64_t latency_ns = done_ns - block.ready_ns;
+        totals->compute_ns += done_ns - start_ns;
+        totals->max_compute_ns = FX_MAX(totals->max_compute_ns, done_ns - start_ns);
+        totals->max_latency_ns = FX_MAX(totals->max_latency_ns, latency_ns);
+        if (latency_ns > deadline_ns) totals->deadline_misses++;
+        tap_metrics_hist_observe(&metrics->stage[STREAM_STAGE_DETECT], done_ns - start_ns);
+        tap_metrics_hist_observe(&metrics->stage[STREAM_STAGE_TOTAL], latency_ns);
+        publish_totals(metrics, totals);
+        tap_rt_frame_leave();
+    }
+    return NULL;
+}
+
+/**
+ * @brief Reads one stream until it ends and queues its blocks; the detector thread starts a fresh context for it.
+ * @return 0 at end of stream, -1 on a read error or when stopped.
+ */
+static int run_stream(int fd, const stream_options_t* options, stream_queue_t* queue, long stream_id) {
+    static unsigned char pcm[MAX_AUDIO_FRAME_SIZE * STREAM_MAX_CHANNELS * STREAM_BYTES_PER_SAMPLE];
+    static stream_block_t block;
+    size_t sample_bytes = (size_t)options->channels * STREAM_BYTES_PER_SAMPLE;
+    size_t frame_bytes = MAX_AUDIO_FRAME_SIZE * sample_bytes;
+    block.stream_id = stream_id;
+    block.seq = 0;
+
+    size_t have = 0;
+    int status = 0;
+    while (!stop_requested) {
+        long n = read_some(fd, pcm + have, frame_bytes - have);
+        if (n < 0) {
+            if (!stop_requested) fprintf(stderr, "Error: Reading stream %ld failed (%s)\n", stream_id, strerror(errno));
+            status = -1;
+            break;
+        }
+        if (n == 0) break;
+        have += (size_t)n;
+        if (have < frame_bytes) continue;
+        convert_block(options, pcm, MAX_AUDIO_FRAME_SIZE, &block);
+        block.ready_ns = tap_clock_now_ns();
+        queue_push(queue, &block, options->policy);
+        block.seq++;
+        have = 0;
+    }
+    // Trailing partial frame, processed like the last frame of a WAV file
+    int tail = (int)(have / sample_bytes);
+    if (status == 0 && tail >= 2) {
+        convert_block(options, pcm, tail, &block);
+        block.ready_ns = tap_clock_now_ns();
+        queue_push(queue, &block, options->policy);
+    }
+    return status;
+}
+
+#ifndef _WIN32
+// Accepts one connection at a time on a UNIX stream socket; every connection is a new stream.
+static int serve_unix_socket(const char* path, const stream_options_t* options, stream_queue_t* queue, long* num_streams) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: Socket path %s is too long\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    // Remove a stale socket left by a previous run, but never any other kind of file
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0 || bind(server, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(server, 4) != 0) {
+        fprintf(stderr, "Error: Cannot listen on %s (%s)\n", path, strerror(errno));
+        if (server >= 0) close(server);
+        return -1;
+    }
+    fprintf(stderr, "Listening on %s\n", path);
+    while (!stop_requested) {
+        int client = accept(server, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Error: accept failed (%s)\n", strerror(errno));
+            break;
+        }
+        run_stream(client, options, queue, (*num_streams)++);
+        close(client);
+    }
+    close(server);
+    unlink(path);
+    return 0;
+}
+#endif
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s --stream [--input -|PATH|unix:PATH] [--channels N] [--rate HZ] [--json]\n", prog);
+    fprintf(stderr, "  --input      raw S16_LE interleaved PCM: stdin (default), a file or FIFO, or a UNIX socket to listen on\n");
+    fprintf(stderr, "  --channels   interleaved channels, 1 to %d (default: 2); the first two are mic1 and mic2\n", STREAM_MAX_CHANNELS);
+    fprintf(stderr, "  --rate       sample rate for timestamps (default: 48000)\n");
+    fprintf(stderr, "  --json       one JSON object per event instead of tab-separated lines\n");
+    fprintf(stderr, "  --queue      blocks buffered between reader and detector, 1 to %d (default: %d)\n", STREAM_MAX_QUEUE, STREAM_DEFAULT_QUEUE);
+    fprintf(stderr, "  --policy     when the queue is full: block (default), drop-oldest or energy-gate\n");
+    fprintf(stderr, "  --gate-level cD1 level a block must be able to reach while gating (default: the minimum threshold)\n");
+    fprintf(stderr, "  --deadline-us latency budget per block from its arrival to its result (default: one frame period)\n");
+    fprintf(stderr, "  --rt-priority run the detector thread with SCHED_FIFO at this priority, 1 to 99\n");
+    fprintf(stderr, "  --cpu        pin the detector thread to this CPU\n");
+    fprintf(stderr, "  --mlock      lock all memory so the audio path never takes a page fault\n");
+    fprintf(stderr, "  --metrics-port serve Prometheus metrics on http://127.0.0.1:PORT/metrics\n");
+}
+
+// Starts a worker thread with the stop signals blocked, so they always interrupt the reader.
+static int start_thread(pthread_t* thread, void* (*thread_main)(void*), void* arg) {
+#ifdef _WIN32
+    return pthread_create(thread, NULL, thread_main, arg);
+#else
+    sigset_t stop_signals, previous;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &previous);
+    int status = pthread_create(thread, NULL, thread_main, arg);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    return status;
+#endif
+}
+
+/**
+ * @brief Entry point for "tap_detection_utility --stream". Prints one line per event:
+ *        stream id, stream time of the reporting frame, event, time of the first tap and wall-clock time.
+ * @return 0 on success, 1 on error.
+ */
+int tap_stream_cli(int argc, char* argv[]) {
+    tap_detect_config_t cfg;
+    tap_detect_config_default(&cfg);
+    stream_options_t options = { 2, 48000, 0, STREAM_DEFAULT_QUEUE, STREAM_POLICY_BLOCK, cfg.threshold_min, 0, { 0, -1, false }, 0 };
+    tap_rt_options_default(&options.rt);
+    const char* input = "-";
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+            input = argv[++i];
+        } else if (strcmp(argv[i], "--channels") == 0 && i + 1 < argc) {
+            options.channels = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            options.samplerate = (uint32_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0) {
+            options.json = 1;
+        } else if (strcmp(argv[i], "--queue") == 0 && i + 1 < argc) {
+            options.queue_blocks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            options.policy = STREAM_POLICY_COUNT;
+            for (int p = 0; p < STREAM_POLICY_COUNT; p++) {
+                if (strcmp(name, policy_names[p]) == 0) options.policy = (stream_policy_e)p;
+            }
+        } else if (strcmp(argv[i], "--gate-level") == 0 && i + 1 < argc) {
+            options.gate_level = FLOAT_TO_Q(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--deadline-us") == 0 && i + 1 < argc) {
+            options.deadline_ns = (uint64_t)(atof(argv[++i]) * 1000.0);
+        } else if (strcmp(argv[i], "--rt-priority") == 0 && i + 1 < argc) {
+            options.rt.priority = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) {
+            options.rt.cpu = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--mlock") == 0) {
+            options.rt.lock_memory = true;
+        } else if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+            options.metrics_port = atoi(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.channels < 1 || options.channels > STREAM_MAX_CHANNELS || options.samplerate == 0 ||
+        options.queue_blocks < 1 || options.queue_blocks > STREAM_MAX_QUEUE || options.policy == STREAM_POLICY_COUNT ||
+        options.rt.priority < 0 || options.rt.priority > 99 || options.metrics_port < 0 || options.metrics_port > 65535) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    install_stop_handlers();
+    if (!options.json) printf("# stream\ttime_s\tevent\tfirst_tap_s\twall_time_s\n");
+    fflush(stdout);
+
+    stream_queue_t queue;
+    if (queue_init(&queue, options.queue_blocks, options.rt.priority > 0) != 0) {
+        fprintf(stderr, "Error: Cannot allocate a queue of %d blocks\n", options.queue_blocks);
+        return 1;
+    }
+    static stream_event_ring_t events;
+    atomic_init(&events.head, 0);
+    atomic_init(&events.tail, 0);
+    atomic_init(&events.closed, false);
+    static stream_metrics_t metrics;
+    metrics_init(&metrics, &options, &queue);
+    events.options = &options;
+    events.metrics = &metrics;
+    sem_init(&events.ready, 0, 0);
+    detector_arg_t detector;
+    memset(&detector, 0, sizeof(detector));
+    detector.options = &options;
+    detector.queue = &queue;
+    detector.events = &events;
+    detector.metrics = &metrics;
+    tap_metrics_server_t* exporter = NULL;
+    if (options.metrics_port > 0) {
+        exporter = tap_metrics_start(options.metrics_port, render_metrics, tick_metrics, &metrics);
+        if (!exporter) {
+            queue_free(&queue);
+            return 1;
+        }
+    }
+    // Lock after the queue exists, so its slots are resident before the first block
+    tap_rt_setup_process(&options.rt);
+    pthread_t detector_thread, writer_thread;
+    if (start_thread(&writer_thread, writer_main, &events) != 0) {
+        fprintf(stderr, "Error: Cannot start the event writer thread\n");
+        tap_metrics_stop(exporter);
+        queue_free(&queue);
+        return 1;
+    }
+    if (start_thread(&detector_thread, detector_main, &detector) != 0) {
+        fprintf(stderr, "Error: Cannot start the detector thread\n");
+        event_close(&events);
+        pthread_join(writer_thread, NULL);
+        tap_metrics_stop(exporter);
+        queue_free(&queue);
+        return 1;
+    }
+
+    long num_streams = 0;
+    int status = 0;
+    if (strcmp(input, "-") == 0) {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        status = run_stream(0, &options, &queue, num_streams++);
+    } else if (strncmp(input, "unix:", 5) == 0) {
+#ifdef _WIN32
+        fprintf(stderr, "Error: UNIX sockets are not supported on this platform\n");
+        status = -1;
+#else
+        status = serve_unix_socket(input + 5, &options, &queue, &num_streams);
+#endif
+    } else {
+        // A FIFO is reopened whenever its writer goes away, so capture processes can come and go
+        do {
+            int fd = open(input, O_RDONLY | O_BINARY);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                fprintf(stderr, "Error: Cannot open %s (%s)\n", input, strerror(errno));
+                status = -1;
+                break;
+            }
+            struct stat st;
+            int is_fifo = fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+            status = run_stream(fd, &options, &queue, num_streams++);
+            close(fd);
+            if (!is_fifo) break;
+        } while (!stop_requested);
+    }
+
+    queue_close(&queue);
+    pthread_join(detector_thread, NULL);
+    event_close(&events);
+    pthread_join(writer_thread, NULL);
+    tap_metrics_stop(exporter);
+    sem_destroy(&events.ready);
+    const stream_totals_t* totals = &detector.totals;
+    fprintf(stderr, "Processed %ld stream(s), %llu blocks: %ld single, %ld double taps\n", num_streams,
+            (unsigned long long)totals->blocks, totals->singles, totals->doubles);
+    fprintf(stderr, "Queue (%s, %d blocks): max depth %d, mean depth %.1f, %llu producer waits (%.3f s), "
+            "%llu dropped, %llu gated, %llu skipped by the detector\n", policy_names[options.policy], queue.capacity,
+            queue.max_depth, queue.pops ? (double)queue.depth_sum / queue.pops : 0.0,
+            (unsigned long long)tap_metrics_get(&queue.producer_waits), queue.wait_ns * 1e-9,
+            (unsigned long long)tap_metrics_get(&queue.dropped),
+            (unsigned long long)totals->gated, (unsigned long long)totals->skipped);
+    fprintf(stderr, "Frames (deadline %.3f ms): %llu missed, max latency %.3f ms, mean compute %.1f us, max compute %.1f us",
+            frame_deadline_ns(&options) * 1e-6, (unsigned long long)totals->deadline_misses, totals->max_latency_ns * 1e-6,
+            queue.pops ? totals->compute_ns * 1e-3 / queue.pops : 0.0, totals->max_compute_ns * 1e-3);
+    if (totals->events_lost) fprintf(stderr, ", %llu events lost by a stalled writer", (unsigned long long)totals->events_lost);
+    fprintf(stderr, "\n");
+    queue_free(&queue);
+    return (status == 0 || stop_requested) ? 0 : 1;
+}
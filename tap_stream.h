@@ -0,0 +1,17 @@
+#ifndef TAP_STREAM_H
+#define TAP_STREAM_H
+
+// --- Real-Time Streaming Mode ---
+// Runs the detector on raw interleaved signed 16-bit little-endian PCM (the default of arecord and most capture
+// tools) as it arrives on stdin, a named pipe, a file or a UNIX stream socket. Every complete frame is processed
+// immediately and events are written and flushed as they happen, so the added latency is one frame (4 ms at
+// 48 kHz) plus the transport. With two or more channels the first two are mic1 and mic2; mono feeds both.
+//
+//   arecord -f S16_LE -c 2 -r 48000 -t raw | tap_detection_utility --stream
+//   tap_detection_utility --stream --input /tmp/tap.fifo --channels 2
+//   tap_detection_utility --stream --input unix:/tmp/tap.sock --json
+//   tap_detection_utility --stream --metrics-port 9464    (Prometheus metrics on 127.0.0.1)
+
+int tap_stream_cli(int argc, char* argv[]);
+
+#endif // !TAP_STREAM_H
@@ -0,0 +1,525 @@
+#include <stdio.h>    // For console I/O
+#include <stdlib.h>   // For memory allocation, strtoull, atof
+#include <string.h>   // For strcmp, memset
+#include <math.h>     // For expf, sinf, cosf, powf, floorf
+#include <time.h>     // For clock() throughput measurement
+
+#include "tap_synth.h"
+#include "wav_io.h"
+
+#define TWO_PI_F (6.283185307f)
+#define SYNTH_BLOCK_FRAMES (4096)
+
+static const char* const bed_names[TAP_SYNTH_BED_COUNT] = { "silence", "white", "pink", "speech", "music" };
+
+// --- PRNG ---
+
+void tap_rng_seed(tap_rng_t* rng, uint64_t seed) {
+    // splitmix64 spreads low-entropy seeds (0, 1, 2, ...) over the whole state; xorshift must not start at 0
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    rng->state = z ? z : 0x9E3779B97F4A7C15ull;
+}
+
+uint64_t tap_rng_next(tap_rng_t* rng) {
+    uint64_t x = rng->state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    rng->state = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+float tap_rng_uniform(tap_rng_t* rng) {
+    return (float)(tap_rng_next(rng) >> 40) * (1.0f / 16777216.0f);
+}
+
+float tap_rng_gauss(tap_rng_t* rng) {
+    // Irwin-Hall with four 16-bit uniforms from one draw: cheap, deterministic and close enough for noise beds
+    uint64_t r = tap_rng_next(rng);
+    float sum = (float)(r & 0xFFFF) + (float)((r >> 16) & 0xFFFF) + (float)((r >> 32) & 0xFFFF) + (float)(r >> 48);
+    return (sum * (1.0f / 65536.0f) - 2.0f) * 1.7320508f;
+}
+
+static float rng_range(tap_rng_t* rng, float lo, float hi) {
+    return lo + (hi - lo) * tap_rng_uniform(rng);
+}
+
+// --- Background Beds ---
+
+static float table_sine(const tap_synth_t* synth, float phase) {
+    int index = (int)(phase * TAP_SYNTH_SINE_TABLE_SIZE) & (TAP_SYNTH_SINE_TABLE_SIZE - 1);
+    return synth->sine_table[index];
+}
+
+static void speech_next_syllable(tap_synth_t* synth) {
+    float fs = (float)synth->cfg.samplerate;
+    synth->syllable_phase = 0.0f;
+    synth->syllable_step = rng_range(&synth->rng, 3.0f, 6.0f) / fs; // syllables per second
+    synth->syllable_voiced = tap_rng_uniform(&synth->rng) < 0.8f;   // the rest are pauses
+    const float centre[2][2] = { { 300.0f, 900.0f }, { 900.0f, 2500.0f } };
+    const float bandwidth[2] = { 100.0f, 150.0f };
+    for (int f = 0; f < 2; f++) {
+        float freq = rng_range(&synth->rng, centre[f][0], centre[f][1]);
+        float r = expf(-3.14159265f * bandwidth[f] / fs);
+        synth->formant_coef[f][0] = 2.0f * r * cosf(TWO_PI_F * freq / fs);
+        synth->formant_coef[f][1] = -r * r;
+        synth->formant_coef[f][2] = 1.0f - r;
+    }
+}
+
+static void music_next_beat(tap_synth_t* synth) {
+    static const int chord[3] = { 0, 4, 7 }; // major triad
+    float fs = (float)synth->cfg.samplerate;
+    int root = 48 + (int)(tap_rng_uniform(&synth->rng) * 24.0f); // MIDI C3..B4
+    for (int v = 0; v < 3; v++) {
+        float freq = 440.0f * powf(2.0f, (root + chord[v] - 69) / 12.0f);
+        synth->music_step[v] = freq / fs;
+    }
+    synth->music_samples_left = (long)(rng_range(&synth->rng, 0.25f, 0.5f) * fs);
+    synth->music_env = 1.0f;
+    synth->music_env_decay = expf(-1.0f / (0.3f * fs));
+}
+
+// One sample of the shared bed, before normalisation to unit RMS.
+static float bed_sample(tap_synth_t* synth) {
+    switch (synth->cfg.bed) {
+    case TAP_SYNTH_BED_WHITE:
+        return tap_rng_gauss(&synth->rng);
+
+    case TAP_SYNTH_BED_PINK: {
+        // Paul Kellet's economy pink filter
+        float white = tap_rng_gauss(&synth->rng);
+        synth->pink[0] = 0.99765f * synth->pink[0] + white * 0.0990460f;
+        synth->pink[1] = 0.96300f * synth->pink[1] + white * 0.2965164f;
+        synth->pink[2] = 0.57000f * synth->pink[2] + white * 1.0526913f;
+        return synth->pink[0] + synth->pink[1] + synth->pink[2] + white * 0.1848f;
+    }
+
+    case TAP_SYNTH_BED_SPEECH: {
+        if (synth->syllable_phase >= 1.0f) speech_next_syllable(synth);
+        float excitation = tap_rng_gauss(&synth->rng);
+        float out = 0.0f;
+        for (int f = 0; f < 2; f++) {
+            float* y = synth->formant_state[f];
+            const float* c = synth->formant_coef[f];
+            float sample = c[2] * excitation + c[0] * y[0] + c[1] * y[1];
+            y[1] = y[0];
+            y[0] = sample;
+            out += (f == 0) ? sample : 0.5f * sample;
+        }
+        float env = synth->syllable_voiced ? table_sine(synth, 0.5f * synth->syllable_phase) : 0.0f;
+        synth->syllable_phase += synth->syllable_step;
+        return out * env * env + 0.01f * excitation; // a little breath noise in the pauses
+    }
+
+    case TAP_SYNTH_BED_MUSIC: {
+        if (synth->music_samples_left-- <= 0) music_next_beat(synth);
+        float out = 0.0f;
+        for (int v = 0; v < 3; v++) {
+            float phase = synth->music_phase[v];
+            for (int h = 1; h <= 4; h++) {
+                float harmonic = phase * h;
+                out += table_sine(synth, harmonic - floorf(harmonic)) / h;
+            }
+            phase += synth->music_step[v];
+            synth->music_phase[v] = phase - floorf(phase);
+        }
+        synth->music_env *= synth->music_env_decay;
+        return out * (0.3f + 0.7f * synth->music_env);
+    }
+
+    default:
+        return 0.0f;
+    }
+}
+
+// --- Tap Transients ---
+
+static void start_tap(tap_synth_t* synth) {
+    const tap_synth_config_t* cfg = &synth->cfg;
+    float amplitude = cfg->tap_amplitude * (1.0f + cfg->tap_amplitude_jitter * (2.0f * tap_rng_uniform(&synth->rng) - 1.0f));
+    const float gains[2] = { 1.0f, cfg->mic2_gain };
+    const int delays[2] = { 0, cfg->mic2_delay_samples };
+
+    for (int m = 0; m < 2; m++) {
+        tap_synth_osc_t* slot = &synth->osc[m][0];
+        for (int t = 0; t < TAP_SYNTH_MAX_TAPS; t++) {
+            if (!synth->osc[m][t].active) {
+                slot = &synth->osc[m][t];
+                break;
+            }
+        }
+        slot->re = amplitude * gains[m];
+        slot->im = 0.0f;
+        slot->delay = delays[m];
+        slot->active = 1;
+    }
+}
+
+static float tap_sample(tap_synth_t* synth, int mic) {
+    float out = 0.0f;
+    for (int t = 0; t < TAP_SYNTH_MAX_TAPS; t++) {
+        tap_synth_osc_t* osc = &synth->osc[mic][t];
+        if (!osc->active) continue;
+        if (osc->delay > 0) {
+            osc->delay--;
+            continue;
+        }
+        // Start with a positive half-wave (im = amplitude * sin); the phasor rotates and decays every sample
+        out += osc->re * synth->osc_sin + osc->im * synth->osc_cos;
+        float re = synth->osc_decay * (osc->re * synth->osc_cos - osc->im * synth->osc_sin);
+        float im = synth->osc_decay * (osc->re * synth->osc_sin + osc->im * synth->osc_cos);
+        osc->re = re;
+        osc->im = im;
+        if (re * re + im * im < 1e-12f) osc->active = 0;
+    }
+    return out;
+}
+
+static uint64_t seconds_to_samples(const tap_synth_t* synth, float seconds) {
+    return (uint64_t)(seconds * synth->cfg.samplerate + 0.5f);
+}
+
+// Starts due taps and schedules the next sequence. Returns the label of a new sequence, if one started.
+static int schedule_taps(tap_synth_t* synth, tap_label_t* label) {
+    const tap_synth_config_t* cfg = &synth->cfg;
+    int new_sequence = 0;
+
+    if (synth->second_tap_sample != 0 && synth->sample_idx == synth->second_tap_sample) {
+        start_tap(synth);
+        synth->second_tap_sample = 0;
+    }
+    if (synth->sample_idx == synth->next_tap_sample) {
+        start_tap(synth);
+        int is_double = tap_rng_uniform(&synth->rng) < cfg->double_tap_prob;
+        label->time_s = (float)((double)synth->sample_idx / cfg->samplerate);
+        label->type = is_double ? TAP_DOUBLE : TAP_SINGLE;
+        new_sequence = 1;
+
+        uint64_t sequence_end = synth->sample_idx;
+        if (is_double) {
+            synth->second_tap_sample = synth->sample_idx + 1 + seconds_to_samples(synth, rng_range(&synth->rng, cfg->double_gap_min_s, cfg->double_gap_max_s));
+            sequence_end = synth->second_tap_sample;
+        }
+        synth->next_tap_sample = sequence_end + 1 + seconds_to_samples(synth, rng_range(&synth->rng, cfg->interval_min_s, cfg->interval_max_s));
+    }
+    return new_sequence;
+}
+
+// --- Public API ---
+
+void tap_synth_config_default(tap_synth_config_t* cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->seed = 1;
+    cfg->samplerate = 48000;
+    cfg->bed = TAP_SYNTH_BED_PINK;
+    cfg->snr_db = 30.0f;
+    cfg->tap_amplitude = 0.055f; // cD1 peaks of ~0.04, between the default detector thresholds
+    cfg->tap_amplitude_jitter = 0.1f;
+    cfg->tap_center_hz = 16000.0f; // a third of 48 kHz keeps the cD1 peak independent of the onset's sample parity
+    cfg->tap_decay_ms = 0.5f;
+    cfg->interval_min_s = 1.0f;
+    cfg->interval_max_s = 3.0f;
+    cfg->double_tap_prob = 0.5f;
+    cfg->double_gap_min_s = 0.20f; // after the 40-block cooldown, inside the 130-block window
+    cfg->double_gap_max_s = 0.45f;
+    cfg->mic2_gain = 0.8f;
+    cfg->mic2_delay_samples = 2;
+    cfg->mic_correlation = 0.9f;
+}
+
+int tap_synth_bed_from_name(const char* name) {
+    for (int b = 0; b < TAP_SYNTH_BED_COUNT; b++) {
+        if (strcmp(name, bed_names[b]) == 0) return b;
+    }
+    return -1;
+}
+
+/**
+ * @brief Prepares a generator. Identical configurations (including the seed) produce identical output.
+ * @return 0 on success, -1 if the configuration is out of range.
+ */
+int tap_synth_init(tap_synth_t* synth, const tap_synth_config_t* cfg) {
+    if (cfg->samplerate == 0 || cfg->bed < 0 || cfg->bed >= TAP_SYNTH_BED_COUNT ||
+        cfg->mic2_delay_samples < 0 || cfg->mic2_delay_samples > TAP_SYNTH_MAX_DELAY ||
+        cfg->interval_min_s <= 0.0f || cfg->interval_max_s < cfg->interval_min_s ||
+        cfg->double_gap_max_s < cfg->double_gap_min_s || cfg->tap_decay_ms <= 0.0f ||
+        cfg->mic_correlation < 0.0f || cfg->mic_correlation > 1.0f) {
+        fprintf(stderr, "Error: Invalid synthesis configuration.\n");
+        return -1;
+    }
+
+    memset(synth, 0, sizeof(*synth));
+    synth->cfg = *cfg;
+    tap_rng_seed(&synth->rng, cfg->seed);
+    for (int i = 0; i < TAP_SYNTH_SINE_TABLE_SIZE; i++) {
+        synth->sine_table[i] = sinf(TWO_PI_F * i / TAP_SYNTH_SINE_TABLE_SIZE);
+    }
+
+    float omega = TWO_PI_F * cfg->tap_center_hz / cfg->samplerate;
+    synth->osc_cos = cosf(omega);
+    synth->osc_sin = sinf(omega);
+    synth->osc_decay = expf(-1000.0f / (cfg->tap_decay_ms * cfg->samplerate));
+
+    synth->syllable_phase = 1.0f; // start a syllable on the first sample
+    synth->next_tap_sample = seconds_to_samples(synth, cfg->interval_min_s);
+
+    // Calibrate the bed to unit RMS on a scratch copy, so calibration does not consume the stream's random numbers
+    synth->bed_norm = 0.0f;
+    if (cfg->bed != TAP_SYNTH_BED_SILENCE) {
+        tap_synth_t* scratch = (tap_synth_t*)malloc(sizeof(tap_synth_t));
+        if (!scratch) {
+            fprintf(stderr, "Error: Memory allocation failed for synthesis calibration.\n");
+            return -1;
+        }
+        *scratch = *synth;
+        double energy = 0.0;
+        long count = (long)cfg->samplerate * 4;
+        for (long i = 0; i < count; i++) {
+            float sample = bed_sample(scratch);
+            energy += (double)sample * sample;
+        }
+        free(scratch);
+        synth->bed_norm = energy > 0.0 ? (float)(1.0 / sqrt(energy / count)) : 0.0f;
+    }
+    synth->bed_gain = cfg->tap_amplitude / powf(10.0f, cfg->snr_db / 20.0f);
+    return 0;
+}
+
+/**
+ * @brief Renders the next num_frames frames of the stream as interleaved 16-bit (mic1, mic2) pairs.
+ * @param on_label Optional callback, called once per tap sequence with its ground-truth label.
+ */
+void tap_synth_render(tap_synth_t* synth, int16_t* interleaved, long num_frames, tap_synth_label_cb on_label, void* user) {
+    const float shared = synth->cfg.mic_correlation;
+    const float independent = sqrtf(1.0f - shared * shared);
+    const int has_bed = synth->cfg.bed != TAP_SYNTH_BED_SILENCE;
+
+    for (long n = 0; n < num_frames; n++) {
+        tap_label_t label;
+        if (schedule_taps(synth, &label) && on_label) {
+            on_label(user, &label);
+        }
+
+        float bed = has_bed ? bed_sample(synth) * synth->bed_norm : 0.0f;
+        for (int m = 0; m < 2; m++) {
+            float sample = tap_sample(synth, m);
+            if (has_bed) {
+                sample += synth->bed_gain * (shared * bed + independent * tap_rng_gauss(&synth->rng));
+            }
+            float scaled = floorf(sample * 32768.0f + 0.5f);
+            if (scaled > INT16_MAX) scaled = INT16_MAX;
+            if (scaled < INT16_MIN) scaled = INT16_MIN;
+            interleaved[2 * n + m] = (int16_t)scaled;
+        }
+        synth->sample_idx++;
+    }
+}
+
+// --- Command Line Front-End ---
+
+typedef struct {
+    tap_label_t* items;
+    int          count;
+    int          capacity;
+    int          failed;
+} label_list_t;
+
+static void collect_label(void* user, const tap_label_t* label) {
+    label_list_t* list = (label_list_t*)user;
+    if (list->count == list->capacity) {
+        int new_capacity = list->capacity ? list->capacity * 2 : 256;
+        tap_label_t* grown = (tap_label_t*)realloc(list->items, new_capacity * sizeof(tap_label_t));
+        if (!grown) {
+            list->failed = 1;
+            return;
+        }
+        list->items = grown;
+        list->capacity = new_capacity;
+    }
+    list->items[list->count++] = *label;
+}
+
+static int parse_pair(const char* text, float* lo, float* hi) {
+    return (sscanf(text, "%f:%f", lo, hi) == 2 && *hi >= *lo) ? 0 : -1;
+}
+
+static void print_synth_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s --synth <output.wav|-> [options]    (stereo: left = mic1, right = mic2)\n", prog);
+    fprintf(stderr, "       %s --synth --detect [options]          (stream straight into the detector)\n", prog);
+    fprintf(stderr, "  --seed N --duration S --samplerate HZ\n");
+    fprintf(stderr, "  --bed silence|white|pink|speech|music --snr DB\n");
+    fprintf(stderr, "  --amplitude A --jitter J --center-hz F --decay-ms MS\n");
+    fprintf(stderr, "  --interval LO:HI --double-prob P --double-gap LO:HI (seconds)\n");
+    fprintf(stderr, "  --mic2-gain G --mic2-delay SAMPLES --correlation C\n");
+    fprintf(stderr, "  --labels FILE           append a corpus manifest line with the ground truth (not with -)\n");
+}
+
+/**
+ * @brief Entry point of "--synth".
+ */
+int tap_synth_cli(int argc, char* argv[]) {
+    if (argc < 3) {
+        print_synth_usage(argv[0]);
+        return 1;
+    }
+    int detect = strcmp(argv[2], "--detect") == 0;
+    const char* output_path = detect ? NULL : argv[2];
+    const char* labels_path = NULL;
+    double duration_s = 60.0;
+
+    tap_synth_config_t cfg;
+    tap_synth_config_default(&cfg);
+    for (int i = 3; i < argc; i += 2) {
+        const char* opt = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        int ok = 1;
+        if (!value) ok = 0;
+        else if (strcmp(opt, "--seed") == 0) cfg.seed = strtoull(value, NULL, 0);
+        else if (strcmp(opt, "--duration") == 0) duration_s = atof(value);
+        else if (strcmp(opt, "--samplerate") == 0) cfg.samplerate = (uint32_t)atoi(value);
+        else if (strcmp(opt, "--bed") == 0) ok = (int)(cfg.bed = (tap_synth_bed_e)tap_synth_bed_from_name(value)) >= 0;
+        else if (strcmp(opt, "--snr") == 0) cfg.snr_db = (float)atof(value);
+        else if (strcmp(opt, "--amplitude") == 0) cfg.tap_amplitude = (float)atof(value);
+        else if (strcmp(opt, "--jitter") == 0) cfg.tap_amplitude_jitter = (float)atof(value);
+        else if (strcmp(opt, "--center-hz") == 0) cfg.tap_center_hz = (float)atof(value);
+        else if (strcmp(opt, "--decay-ms") == 0) cfg.tap_decay_ms = (float)atof(value);
+        else if (strcmp(opt, "--interval") == 0) ok = parse_pair(value, &cfg.interval_min_s, &cfg.interval_max_s) == 0;
+        else if (strcmp(opt, "--double-prob") == 0) cfg.double_tap_prob = (float)atof(value);
+        else if (strcmp(opt, "--double-gap") == 0) ok = parse_pair(value, &cfg.double_gap_min_s, &cfg.double_gap_max_s) == 0;
+        else if (strcmp(opt, "--mic2-gain") == 0) cfg.mic2_gain = (float)atof(value);
+        else if (strcmp(opt, "--mic2-delay") == 0) cfg.mic2_delay_samples = atoi(value);
+        else if (strcmp(opt, "--correlation") == 0) cfg.mic_correlation = (float)atof(value);
+        else if (strcmp(opt, "--labels") == 0) labels_path = value;
+        else ok = 0;
+        if (!ok) {
+            fprintf(stderr, "Error: Invalid option %s %s\n", opt, value ? value : "");
+            print_synth_usage(argv[0]);
+            return 1;
+        }
+    }
+    // A manifest line needs a recording corpus_load() can open again
+    if (labels_path && output_path && strcmp(output_path, "-") == 0) {
+        fprintf(stderr, "Error: --labels needs an output file, not stdout\n");
+        print_synth_usage(argv[0]);
+        return 1;
+    }
+
+    tap_synth_t* synth = (tap_synth_t*)malloc(sizeof(tap_synth_t));
+    int16_t* block = (int16_t*)malloc(SYNTH_BLOCK_FRAMES * 2 * sizeof(int16_t));
+    if (!synth || !block || tap_synth_init(synth, &cfg) != 0) {
+        free(synth);
+        free(block);
+        return 1;
+    }
+
+    wav_writer_t writer;
+    if (output_path && wav_writer_open(&writer, output_path, cfg.samplerate, 2) != 0) {
+        free(synth);
+        free(block);
+        return 1;
+    }
+
+    // Detector state for --detect: frames are assembled from the rendered blocks
+    tap_detect_ctx_t ctx;
+    tap_detect_init(&ctx, NULL);
+    int mic1[MAX_AUDIO_FRAME_SIZE], mic2[MAX_AUDIO_FRAME_SIZE];
+    int frame_fill = 0;
+    tap_event_t* events = NULL;
+    int num_events = 0, events_capacity = 0;
+    long block_idx = 0;
+
+    label_list_t labels = { NULL, 0, 0, 0 };
+    uint64_t total_frames = (uint64_t)(duration_s * cfg.samplerate);
+    uint64_t done = 0;
+    int status = 0;
+    clock_t start = clock();
+
+    while (status == 0 && done < total_frames) {
+        long frames = (total_frames - done > SYNTH_BLOCK_FRAMES) ? SYNTH_BLOCK_FRAMES : (long)(total_frames - done);
+        tap_synth_render(synth, block, frames, collect_label, &labels);
+        done += (uint64_t)frames;
+        if (labels.failed) status = -1;
+
+        if (output_path) {
+            if (wav_writer_write(&writer, block, frames) != 0) status = -1;
+            continue;
+        }
+
+        for (long n = 0; n < frames && status == 0; n++) {
+            mic1[frame_fill] = (fixed_point_t)block[2 * n] << (Q_FORMAT - 15);
+            mic2[frame_fill] = (fixed_point_t)block[2 * n + 1] << (Q_FORMAT - 15);
+            if (++frame_fill < MAX_AUDIO_FRAME_SIZE) continue;
+            frame_fill = 0;
+
+            tap_detection_result_e result = tap_detect_process(&ctx, mic1, mic2, MAX_AUDIO_FRAME_SIZE);
+            if (result != TAP_NONE) {
+                if (num_events == events_capacity) {
+                    events_capacity = events_capacity ? events_capacity * 2 : 256;
+                    tap_event_t* grown = (tap_event_t*)realloc(events, events_capacity * sizeof(tap_event_t));
+                    if (!grown) {
+                        status = -1;
+                        break;
+                    }
+                    events = grown;
+                }
+                events[num_events].block = block_idx;
+                events[num_events].origin_block = (long)ctx.event_origin_block - 1;
+                events[num_events].type = result;
+                num_events++;
+            }
+            block_idx++;
+        }
+    }
+    double elapsed_s = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    if (output_path && wav_writer_close(&writer) != 0) status = -1;
+    if (status != 0) {
+        fprintf(stderr, "Error: Synthesis failed.\n");
+    }
+
+    // Progress goes to stderr so "-" can stream WAV data on stdout
+    if (status == 0) {
+        fprintf(stderr, "Synthesised %.1f s (%d tap sequences, seed %llu) in %.2f s (%.1fx real time)\n",
+                (double)done / cfg.samplerate, labels.count, (unsigned long long)cfg.seed, elapsed_s,
+                elapsed_s > 0.0 ? ((double)done / cfg.samplerate) / elapsed_s : 0.0);
+    }
+
+    if (status == 0 && detect) {
+        corpus_file_t file;
+        memset(&file, 0, sizeof(file));
+        file.samplerate = cfg.samplerate;
+        file.num_samples = (long)(block_idx * MAX_AUDIO_FRAME_SIZE);
+        file.labels = labels.items;
+        file.num_labels = labels.count;
+        corpus_score_t score;
+        memset(&score, 0, sizeof(score));
+        corpus_score_file(&file, events, num_events, 0, CORPUS_DEFAULT_TOLERANCE_S, &score);
+        printf("Detected %d events for %d labels: recall %.4f, %.2f false positives/hour, F1 %.4f\n",
+               score.detections, score.labels, corpus_score_recall(&score), corpus_score_fp_per_hour(&score), corpus_score_f1(&score));
+    }
+
+    if (status == 0 && labels_path && output_path) {
+        FILE* manifest = fopen(labels_path, "a");
+        if (!manifest) {
+            fprintf(stderr, "Error: Could not open file for writing %s\n", labels_path);
+            status = -1;
+        } else {
+            fprintf(manifest, "%s", output_path);
+            for (int l = 0; l < labels.count; l++) {
+                fprintf(manifest, " %.4f:%c", labels.items[l].time_s, labels.items[l].type == TAP_DOUBLE ? 'D' : 'S');
+            }
+            fprintf(manifest, "\n");
+            fclose(manifest);
+        }
+    }
+
+    free(events);
+    free(labels.items);
+    free(block);
+    free(synth);
+    return status == 0 ? 0 : 1;
+}
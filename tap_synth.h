@@ -0,0 +1,105 @@
+#ifndef TAP_SYNTH_H
+#define TAP_SYNTH_H
+#include <stdint.h>
+
+#include "tap_detect.h"
+#include "corpus.h"
+
+// --- Synthetic Tap Generator ---
+// Deterministically synthesises two-microphone recordings: tap transients (damped resonances with configurable
+// amplitude, centre frequency, decay and inter-tap interval) mixed into a background bed at a chosen SNR.
+// The same seed and configuration always produce the same samples with a given toolchain, so stress and
+// benchmark corpora can be regenerated on demand instead of being stored. Output is rendered block by block
+// with constant memory, so arbitrarily long streams can be written to WAV or fed straight into the detector.
+//
+// SNR is defined as 20*log10(tap peak amplitude / bed RMS).
+
+typedef enum
+{
+    TAP_SYNTH_BED_SILENCE = 0,
+    TAP_SYNTH_BED_WHITE,  // White noise
+    TAP_SYNTH_BED_PINK,   // 1/f noise
+    TAP_SYNTH_BED_SPEECH, // Formant-filtered noise with syllable-rate envelope and pauses
+    TAP_SYNTH_BED_MUSIC,  // Three harmonic voices changing notes on a beat
+    TAP_SYNTH_BED_COUNT
+} tap_synth_bed_e;
+
+typedef struct
+{
+    uint64_t        seed;
+    uint32_t        samplerate;
+    tap_synth_bed_e bed;
+    float           snr_db;
+    float           tap_amplitude;       // Peak amplitude of a tap, fraction of full scale
+    float           tap_amplitude_jitter;// Relative random variation of the amplitude per tap (0..1)
+    float           tap_center_hz;       // Resonance frequency of the transient
+    float           tap_decay_ms;        // Time constant of the exponential decay
+    float           interval_min_s;      // Range of the gap between tap sequences
+    float           interval_max_s;
+    float           double_tap_prob;     // Probability that a sequence is a double tap
+    float           double_gap_min_s;    // Range of the gap between the two taps of a double tap
+    float           double_gap_max_s;
+    float           mic2_gain;           // Tap level at mic2 relative to mic1
+    int             mic2_delay_samples;  // Tap arrival delay at mic2 (0..TAP_SYNTH_MAX_DELAY)
+    float           mic_correlation;     // Fraction of the bed shared by both mics (0..1)
+} tap_synth_config_t;
+
+#define TAP_SYNTH_MAX_TAPS  (8)  /* overlapping transients in flight. */
+#define TAP_SYNTH_MAX_DELAY (64) /* samples. */
+#define TAP_SYNTH_SINE_TABLE_SIZE (1024)
+
+// Fast deterministic PRNG (xorshift64*), seeded through splitmix64.
+typedef struct
+{
+    uint64_t state;
+} tap_rng_t;
+
+typedef struct
+{
+    float re;
+    float im;
+    int   delay; // Samples until the resonator starts (mic2 arrival delay)
+    int   active;
+} tap_synth_osc_t;
+
+typedef struct
+{
+    tap_synth_config_t cfg;
+    tap_rng_t          rng;
+    uint64_t           sample_idx;
+    uint64_t           next_tap_sample;
+    uint64_t           second_tap_sample;  // Pending second tap of a double tap, 0 if none
+    float              bed_norm;           // Scales the bed generator to unit RMS
+    float              bed_gain;           // Bed RMS giving the requested SNR
+    float              osc_cos, osc_sin;   // Per-sample rotation of the tap resonance
+    float              osc_decay;          // Per-sample decay of the tap resonance
+    tap_synth_osc_t    osc[2][TAP_SYNTH_MAX_TAPS];
+    // Bed generator state. The bed is shared by both mics; the uncorrelated part is white sensor noise.
+    float              pink[3];
+    float              formant_state[2][2]; // [formant][y1, y2]
+    float              formant_coef[2][3];  // [formant][a1, a2, input gain]
+    float              syllable_phase;
+    float              syllable_step;
+    int                syllable_voiced;
+    float              music_phase[3];
+    float              music_step[3];
+    float              music_env;
+    float              music_env_decay;
+    long               music_samples_left;
+    float              sine_table[TAP_SYNTH_SINE_TABLE_SIZE];
+} tap_synth_t;
+
+typedef void (*tap_synth_label_cb)(void* user, const tap_label_t* label);
+
+void     tap_rng_seed(tap_rng_t* rng, uint64_t seed);
+uint64_t tap_rng_next(tap_rng_t* rng);
+float    tap_rng_uniform(tap_rng_t* rng);  // [0, 1)
+float    tap_rng_gauss(tap_rng_t* rng);    // Approximately N(0, 1)
+
+void tap_synth_config_default(tap_synth_config_t* cfg);
+int  tap_synth_bed_from_name(const char* name);
+int  tap_synth_init(tap_synth_t* synth, const tap_synth_config_t* cfg);
+void tap_synth_render(tap_synth_t* synth, int16_t* interleaved, long num_frames, tap_synth_label_cb on_label, void* user);
+int  tap_synth_cli(int argc, char* argv[]);
+
+#endif // !TAP_SYNTH_H
@@ -0,0 +1,111 @@
+#include <stdio.h>    // For file I/O and console output
+#include <stdlib.h>   // For malloc, free
+#include <string.h>   // For memcpy, memcmp, memset
+
+#include "tap_trace.h"
+
+/**
+ * @brief Prepares a ring over caller-provided storage.
+ * @param capacity Number of records in storage; must be a power of two.
+ * @return 0 on success, -1 if the capacity is not a power of two.
+ */
+int tap_trace_init(tap_trace_t* trace, tap_trace_record_t* storage, uint32_t capacity) {
+    if (!storage || capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        fprintf(stderr, "Error: Trace capacity %u is not a power of two.\n", capacity);
+        return -1;
+    }
+    trace->records = storage;
+    trace->mask = capacity - 1;
+    atomic_init(&trace->head, 0);
+    return 0;
+}
+
+/**
+ * @brief Writes the most recent records of the ring to a binary file, oldest first.
+ * @param max_records Upper bound on the records written (e.g. seconds * 250 blocks); 0 writes the whole ring.
+ * @return The number of records written, or -1 on error.
+ */
+int tap_trace_dump(tap_trace_t* trace, const char* path, uint32_t max_records) {
+    uint32_t capacity = trace->mask + 1;
+    tap_trace_record_t* copy = (tap_trace_record_t*)malloc(capacity * sizeof(tap_trace_record_t));
+    if (!copy) {
+        fprintf(stderr, "Error: Memory allocation failed for the trace dump.\n");
+        return -1;
+    }
+
+    // Copy without stopping the writer, then drop the oldest records it may have overwritten meanwhile.
+    unsigned head = atomic_load_explicit(&trace->head, memory_order_acquire);
+    uint32_t count = head < capacity ? head : capacity;
+    if (max_records > 0 && count > max_records) count = max_records;
+    unsigned first = head - count;
+    for (uint32_t i = 0; i < count; i++) {
+        copy[i] = trace->records[(first + i) & trace->mask];
+    }
+    atomic_thread_fence(memory_order_acquire);
+    unsigned head_after = atomic_load_explicit(&trace->head, memory_order_relaxed);
+    // Record first + i is intact if no record of a later lap (up to the one in progress) shares its slot
+    int64_t stale = (int64_t)(head_after - head) + count + 1 - capacity;
+    uint32_t skip = stale <= 0 ? 0 : (stale > count ? count : (uint32_t)stale);
+
+    FILE* out = fopen(path, "wb");
+    if (!out) {
+        fprintf(stderr, "Error: Cannot create trace file %s\n", path);
+        free(copy);
+        return -1;
+    }
+    tap_trace_file_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TAP_TRACE_MAGIC, sizeof(header.magic));
+    header.version = TAP_DETECT_VERSION;
+    header.frame_size = MAX_AUDIO_FRAME_SIZE;
+    header.record_size = sizeof(tap_trace_record_t);
+    header.num_records = count - skip;
+    int status = (int)header.num_records;
+    if (fwrite(&header, sizeof(header), 1, out) != 1 ||
+        (header.num_records > 0 && fwrite(copy + skip, sizeof(tap_trace_record_t), header.num_records, out) != header.num_records)) {
+        fprintf(stderr, "Error: Failed writing trace file %s\n", path);
+        status = -1;
+    }
+    if (fclose(out) != 0) status = -1;
+    free(copy);
+    return status;
+}
+
+/**
+ * @brief Entry point for "tap_detection_utility --trace-print <trace.bin>". Prints one line per traced block.
+ * @return 0 on success, 1 on error.
+ */
+int tap_trace_print_cli(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s --trace-print <trace_file>\n", argv[0]);
+        return 1;
+    }
+    FILE* in = fopen(argv[2], "rb");
+    if (!in) {
+        fprintf(stderr, "Error: Cannot open trace file %s\n", argv[2]);
+        return 1;
+    }
+    tap_trace_file_header_t header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, TAP_TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.record_size != sizeof(tap_trace_record_t)) {
+        fprintf(stderr, "Error: %s is not a trace file\n", argv[2]);
+        fclose(in);
+        return 1;
+    }
+    printf("# detector version %u, %u samples per block, %u blocks\n", header.version, header.frame_size, header.num_records);
+    printf("%10s %12s %8s %5s %8s %8s %s\n", "block", "max|cD1|", "cooldown", "peaks", "searched", "pending", "result");
+    tap_trace_record_t record;
+    uint32_t read = 0;
+    while (read < header.num_records && fread(&record, sizeof(record), 1, in) == 1) {
+        const char* result = (record.state & TAP_TRACE_DOUBLE) ? "DOUBLE" : (record.state & TAP_TRACE_SINGLE) ? "SINGLE" : "-";
+        printf("%10u %12.6f %8u %5u %8s %8s %s\n", record.block, Q_TO_FLOAT(record.max_abs_cd1), record.cooldown, record.num_peaks,
+               (record.state & TAP_TRACE_SEARCHED) ? "yes" : "no", (record.state & TAP_TRACE_PENDING) ? "yes" : "no", result);
+        read++;
+    }
+    fclose(in);
+    if (read != header.num_records) {
+        fprintf(stderr, "Error: %s is truncated (%u of %u records)\n", argv[2], read, header.num_records);
+        return 1;
+    }
+    return 0;
+}
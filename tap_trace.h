@@ -0,0 +1,61 @@
+#ifndef TAP_TRACE_H
+#define TAP_TRACE_H
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "tap_detect.h"
+
+// --- Post-Mortem Trace ---
+// Optional ring buffer of the detector's internal state, one record per block, for explaining phantom or missed
+// taps after the fact. The caller provides the record storage (a power-of-two number of records, e.g. 4096 for
+// about 16 s at 48 kHz) and attaches the ring with tap_detect_attach_trace() after tap_detect_init(); a context
+// without a ring pays one branch per block. The detector thread is the only writer and never waits;
+// tap_trace_dump() may run on any thread and keeps only the records that were not overwritten while it copied them.
+
+#define TAP_TRACE_MAGIC "TAPTRCE1"
+
+// Record state bits
+#define TAP_TRACE_PENDING   (1u << 0) /* a first tap is waiting for its second tap. */
+#define TAP_TRACE_SEARCHED  (1u << 1) /* the block was searched for peaks (not in cooldown). */
+#define TAP_TRACE_SINGLE    (1u << 2) /* the block reported a single tap. */
+#define TAP_TRACE_DOUBLE    (1u << 3) /* the block reported a double tap. */
+
+typedef struct
+{
+    uint32_t block;       /* current_block_cnt after the block. */
+    int32_t  max_abs_cd1; /* largest |cD1| of the block, Q2.29. */
+    uint16_t cooldown;    /* cooldown_block_cnt after the block, saturated. */
+    uint8_t  num_peaks;   /* peaks found by the search, saturated. */
+    uint8_t  state;       /* TAP_TRACE_* bits. */
+} tap_trace_record_t;
+
+typedef struct tap_trace
+{
+    tap_trace_record_t *records;
+    uint32_t            mask;  /* capacity - 1. */
+    atomic_uint         head;  /* records written so far; wraps at 2^32. */
+} tap_trace_t;
+
+// Header of a dump file, followed by num_records records oldest first (host byte order).
+typedef struct
+{
+    char     magic[8];
+    uint32_t version;     /* TAP_DETECT_VERSION of the writer. */
+    uint32_t frame_size;  /* samples per block. */
+    uint32_t record_size; /* sizeof(tap_trace_record_t). */
+    uint32_t num_records;
+} tap_trace_file_header_t;
+
+// Appends one record. Called by the detector at the end of every block while a ring is attached.
+static inline void tap_trace_write(tap_trace_t *trace, const tap_trace_record_t *record)
+{
+    unsigned head = atomic_load_explicit(&trace->head, memory_order_relaxed);
+    trace->records[head & trace->mask] = *record;
+    atomic_store_explicit(&trace->head, head + 1, memory_order_release);
+}
+
+int  tap_trace_init(tap_trace_t *trace, tap_trace_record_t *storage, uint32_t capacity);
+int  tap_trace_dump(tap_trace_t *trace, const char *path, uint32_t max_records);
+int  tap_trace_print_cli(int argc, char *argv[]);
+
+#endif // !TAP_TRACE_H
@@ -0,0 +1,442 @@
+#include <stdio.h>    // For console and file I/O
+#include <stdlib.h>   // For memory allocation, qsort, strtod, atoi
+#include <string.h>   // For strcmp, memset
+#include <math.h>     // For floor
+#include <pthread.h>  // For the evaluation worker threads
+#include <stdatomic.h>
+#ifdef _WIN32
+#include <windows.h>  // For GetSystemInfo
+#else
+#include <unistd.h>   // For sysconf
+#endif
+
+#include "tap_tune.h"
+#include "result_cache.h"
+
+#define TAP_TUNE_MAX_THREADS (256)
+
+static const char* const param_names[TAP_TUNE_PARAM_COUNT] = { "min", "max", "cooldown", "window" };
+
+// --- Parameter Access ---
+
+static double param_get(const tap_detect_config_t* cfg, int param) {
+    switch (param) {
+    case TAP_TUNE_PARAM_THRESHOLD_MIN:  return Q_TO_FLOAT(cfg->threshold_min);
+    case TAP_TUNE_PARAM_THRESHOLD_MAX:  return Q_TO_FLOAT(cfg->threshold_max);
+    case TAP_TUNE_PARAM_COOLDOWN_BLOCKS: return cfg->cooldown_blocks;
+    default:                            return cfg->double_tap_window_blocks;
+    }
+}
+
+static void param_set(tap_detect_config_t* cfg, int param, double value) {
+    switch (param) {
+    case TAP_TUNE_PARAM_THRESHOLD_MIN:  cfg->threshold_min = FLOAT_TO_Q(value); break;
+    case TAP_TUNE_PARAM_THRESHOLD_MAX:  cfg->threshold_max = FLOAT_TO_Q(value); break;
+    case TAP_TUNE_PARAM_COOLDOWN_BLOCKS: cfg->cooldown_blocks = (int32_t)floor(value + 0.5); break;
+    default:                            cfg->double_tap_window_blocks = (int32_t)floor(value + 0.5); break;
+    }
+}
+
+static int range_count(const tap_tune_range_t* range) {
+    if (range->step <= 0.0 || range->hi < range->lo) return 1;
+    return (int)floor((range->hi - range->lo) / range->step + 1e-9) + 1;
+}
+
+static double range_value(const tap_tune_range_t* range, int index) {
+    return range->lo + index * range->step;
+}
+
+static int config_valid(const tap_detect_config_t* cfg) {
+    return cfg->threshold_min <= cfg->threshold_max && cfg->cooldown_blocks >= 0 && cfg->double_tap_window_blocks >= 0;
+}
+
+static int config_equal(const tap_detect_config_t* a, const tap_detect_config_t* b) {
+    return a->threshold_min == b->threshold_min && a->threshold_max == b->threshold_max &&
+           a->cooldown_blocks == b->cooldown_blocks && a->double_tap_window_blocks == b->double_tap_window_blocks;
+}
+
+static int online_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+// --- Parallel Evaluation ---
+// Workers pull the next unevaluated point from a shared atomic index until the batch is exhausted.
+
+typedef struct {
+    const corpus_t*   corpus;
+    tap_tune_point_t* points;
+    int               num_points;
+    float             tolerance_s;
+    result_cache_t*   results;
+    atomic_int        next;
+    atomic_int        failed;
+} eval_batch_t;
+
+static void* eval_worker(void* arg) {
+    eval_batch_t* batch = (eval_batch_t*)arg;
+    for (;;) {
+        int i = atomic_fetch_add(&batch->next, 1);
+        if (i >= batch->num_points) break;
+        if (corpus_evaluate(batch->corpus, &batch->points[i].cfg, NULL, batch->tolerance_s, batch->results, &batch->points[i].score) != 0) {
+            atomic_store(&batch->failed, 1);
+        }
+    }
+    return NULL;
+}
+
+static int evaluate_points(const corpus_t* corpus, tap_tune_point_t* points, int num_points, int num_threads, const tap_tune_options_t* options) {
+    eval_batch_t batch;
+    batch.corpus = corpus;
+    batch.points = points;
+    batch.num_points = num_points;
+    batch.tolerance_s = options->tolerance_s;
+    batch.results = options->results;
+    atomic_init(&batch.next, 0);
+    atomic_init(&batch.failed, 0);
+
+    if (num_threads > num_points) num_threads = num_points;
+    if (num_threads <= 1) {
+        eval_worker(&batch);
+        return atomic_load(&batch.failed) ? -1 : 0;
+    }
+
+    pthread_t threads[TAP_TUNE_MAX_THREADS];
+    int started = 0;
+    for (; started < num_threads; started++) {
+        if (pthread_create(&threads[started], NULL, eval_worker, &batch) != 0) break;
+    }
+    if (started == 0) {
+        eval_worker(&batch); // Could not spawn any thread: evaluate on the caller's thread
+    }
+    for (int t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    return atomic_load(&batch.failed) ? -1 : 0;
+}
+
+// Growable list of evaluated points.
+typedef struct {
+    tap_tune_point_t* items;
+    int               count;
+    int               capacity;
+} point_list_t;
+
+static tap_tune_point_t* point_list_add(point_list_t* list, const tap_detect_config_t* cfg) {
+    if (list->count == list->capacity) {
+        int new_capacity = list->capacity ? list->capacity * 2 : 64;
+        tap_tune_point_t* grown = (tap_tune_point_t*)realloc(list->items, new_capacity * sizeof(tap_tune_point_t));
+        if (!grown) {
+            fprintf(stderr, "Error: Memory allocation failed for tuning points.\n");
+            return NULL;
+        }
+        list->items = grown;
+        list->capacity = new_capacity;
+    }
+    tap_tune_point_t* point = &list->items[list->count++];
+    memset(point, 0, sizeof(*point));
+    point->cfg = *cfg;
+    return point;
+}
+
+static int point_list_find(const point_list_t* list, const tap_detect_config_t* cfg) {
+    for (int i = 0; i < list->count; i++) {
+        if (config_equal(&list->items[i].cfg, cfg)) return i;
+    }
+    return -1;
+}
+
+// Higher F1 wins; ties go to fewer false positives, then higher recall.
+static int point_better(const tap_tune_point_t* a, const tap_tune_point_t* b) {
+    double f1_a = corpus_score_f1(&a->score), f1_b = corpus_score_f1(&b->score);
+    if (f1_a != f1_b) return f1_a > f1_b;
+    double fp_a = corpus_score_fp_per_hour(&a->score), fp_b = corpus_score_fp_per_hour(&b->score);
+    if (fp_a != fp_b) return fp_a < fp_b;
+    return corpus_score_recall(&a->score) > corpus_score_recall(&b->score);
+}
+
+static int run_grid(const corpus_t* corpus, const tap_tune_options_t* options, int num_threads, point_list_t* list) {
+    int counts[TAP_TUNE_PARAM_COUNT];
+    long total = 1;
+    for (int p = 0; p < TAP_TUNE_PARAM_COUNT; p++) {
+        counts[p] = range_count(&options->range[p]);
+        total *= counts[p];
+    }
+
+    tap_detect_config_t cfg;
+    tap_detect_config_default(&cfg);
+    for (long index = 0; index < total; index++) {
+        long rest = index;
+        for (int p = 0; p < TAP_TUNE_PARAM_COUNT; p++) {
+            param_set(&cfg, p, range_value(&options->range[p], (int)(rest % counts[p])));
+            rest /= counts[p];
+        }
+        if (config_valid(&cfg) && !point_list_add(list, &cfg)) return -1;
+    }
+
+    printf("Grid search: %d valid points (%ld in grid) on %d threads\n", list->count, total, num_threads);
+    return evaluate_points(corpus, list->items, list->count, num_threads, options);
+}
+
+static int run_descent(const corpus_t* corpus, const tap_tune_options_t* options, int num_threads, point_list_t* list) {
+    tap_detect_config_t best_cfg;
+    tap_detect_config_default(&best_cfg);
+    if (!point_list_add(list, &best_cfg)) return -1;
+    if (evaluate_points(corpus, list->items, 1, 1, options) != 0) return -1;
+    int best = 0;
+
+    for (int round = 0; round < options->max_rounds; round++) {
+        int improved = 0;
+        for (int p = 0; p < TAP_TUNE_PARAM_COUNT; p++) {
+            // Evaluate every value of this parameter that has not been seen yet, in parallel
+            int first_new = list->count;
+            int count = range_count(&options->range[p]);
+            for (int i = 0; i < count; i++) {
+                tap_detect_config_t cfg = list->items[best].cfg;
+                param_set(&cfg, p, range_value(&options->range[p], i));
+                if (config_valid(&cfg) && point_list_find(list, &cfg) < 0 && !point_list_add(list, &cfg)) return -1;
+            }
+            if (evaluate_points(corpus, &list->items[first_new], list->count - first_new, num_threads, options) != 0) return -1;
+
+            // Move along this coordinate to the best point on the line through the current optimum
+            for (int i = 0; i < list->count; i++) {
+                int on_line = 1;
+                for (int q = 0; q < TAP_TUNE_PARAM_COUNT; q++) {
+                    if (q != p && param_get(&list->items[i].cfg, q) != param_get(&list->items[best].cfg, q)) on_line = 0;
+                }
+                if (on_line && point_better(&list->items[i], &list->items[best])) {
+                    best = i;
+                    improved = 1;
+                }
+            }
+        }
+        printf("Descent round %d: %d points evaluated, best F1 %.4f\n", round + 1, list->count, corpus_score_f1(&list->items[best].score));
+        if (!improved) break;
+    }
+    return 0;
+}
+
+/**
+ * @brief Runs the configured search over the corpus.
+ * @param points_out Receives a newly allocated array of every evaluated point. The caller frees it.
+ * @return 0 on success, -1 on failure.
+ */
+int tap_tune_run(const corpus_t* corpus, const tap_tune_options_t* options, tap_tune_point_t** points_out, int* num_points_out) {
+    int num_threads = options->num_threads > 0 ? options->num_threads : online_cpu_count();
+    if (num_threads > TAP_TUNE_MAX_THREADS) num_threads = TAP_TUNE_MAX_THREADS;
+
+    point_list_t list = { NULL, 0, 0 };
+    int status = (options->mode == TAP_TUNE_MODE_GRID) ? run_grid(corpus, options, num_threads, &list)
+                                                       : run_descent(corpus, options, num_threads, &list);
+    if (status != 0) {
+        free(list.items);
+        return -1;
+    }
+    *points_out = list.items;
+    *num_points_out = list.count;
+    return 0;
+}
+
+static int compare_fp_then_recall(const void* a, const void* b) {
+    const tap_tune_point_t* pa = (const tap_tune_point_t*)a;
+    const tap_tune_point_t* pb = (const tap_tune_point_t*)b;
+    double fp_a = corpus_score_fp_per_hour(&pa->score), fp_b = corpus_score_fp_per_hour(&pb->score);
+    if (fp_a != fp_b) return fp_a < fp_b ? -1 : 1;
+    double recall_a = corpus_score_recall(&pa->score), recall_b = corpus_score_recall(&pb->score);
+    if (recall_a != recall_b) return recall_a > recall_b ? -1 : 1;
+    return 0;
+}
+
+/**
+ * @brief Sorts the points by false-positive rate and flags the ones no other point dominates
+ * (lower or equal false positives with strictly higher recall).
+ * @return The number of points on the front.
+ */
+int tap_tune_mark_pareto_front(tap_tune_point_t* points, int num_points) {
+    qsort(points, num_points, sizeof(tap_tune_point_t), compare_fp_then_recall);
+    int on_front = 0;
+    double best_recall = -1.0;
+    for (int i = 0; i < num_points; i++) {
+        double recall = corpus_score_recall(&points[i].score);
+        points[i].on_pareto_front = recall > best_recall;
+        if (points[i].on_pareto_front) {
+            best_recall = recall;
+            on_front++;
+        }
+    }
+    return on_front;
+}
+
+// --- Command Line Front-End ---
+
+void tap_tune_options_default(tap_tune_options_t* options) {
+    memset(options, 0, sizeof(*options));
+    options->mode = TAP_TUNE_MODE_DESCENT;
+    options->range[TAP_TUNE_PARAM_THRESHOLD_MIN]  = (tap_tune_range_t){ 0.0150, 0.0450, 0.0025 };
+    options->range[TAP_TUNE_PARAM_THRESHOLD_MAX]  = (tap_tune_range_t){ 0.0300, 0.0900, 0.0075 };
+    options->range[TAP_TUNE_PARAM_COOLDOWN_BLOCKS] = (tap_tune_range_t){ 20, 60, 5 };
+    options->range[TAP_TUNE_PARAM_WINDOW_BLOCKS]  = (tap_tune_range_t){ 90, 170, 10 };
+    options->num_threads = 0;
+    options->max_rounds = 8;
+    options->tolerance_s = CORPUS_DEFAULT_TOLERANCE_S;
+}
+
+static int parse_range(const char* text, tap_tune_range_t* range) {
+    if (sscanf(text, "%lf:%lf:%lf", &range->lo, &range->hi, &range->step) == 3 && range->step > 0.0 && range->hi >= range->lo) {
+        return 0;
+    }
+    if (sscanf(text, "%lf", &range->lo) == 1) {
+        range->hi = range->lo; // Single value: parameter is fixed
+        range->step = 1.0;
+        return 0;
+    }
+    return -1;
+}
+
+static void print_tune_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s --tune <corpus_manifest> [options]\n", prog);
+    fprintf(stderr, "  --mode grid|descent     search strategy (default: descent)\n");
+    fprintf(stderr, "  --min lo:hi:step        threshold min range in Q2.29 float units (or a single fixed value)\n");
+    fprintf(stderr, "  --max lo:hi:step        threshold max range in Q2.29 float units\n");
+    fprintf(stderr, "  --cooldown lo:hi:step   cooldown range in blocks\n");
+    fprintf(stderr, "  --window lo:hi:step     double-tap window range in blocks\n");
+    fprintf(stderr, "  --threads N             worker threads (default: online CPUs)\n");
+    fprintf(stderr, "  --rounds N              max coordinate descent rounds (default: 8)\n");
+    fprintf(stderr, "  --tolerance S           label matching tolerance in seconds (default: %.3f)\n", CORPUS_DEFAULT_TOLERANCE_S);
+    fprintf(stderr, "  --csv FILE              write every evaluated point to FILE\n");
+    fprintf(stderr, "  --result-cache FILE     reuse and extend stored per-file results\n");
+}
+
+static void print_point(const tap_tune_point_t* point) {
+    printf("%9.5f | %9.5f | %8d | %6d | %6.4f | %9.2f | %6.4f\n",
+           Q_TO_FLOAT(point->cfg.threshold_min), Q_TO_FLOAT(point->cfg.threshold_max),
+           point->cfg.cooldown_blocks, point->cfg.double_tap_window_blocks,
+           corpus_score_recall(&point->score), corpus_score_fp_per_hour(&point->score), corpus_score_f1(&point->score));
+}
+
+static int write_csv(const char* filepath, const tap_tune_point_t* points, int num_points) {
+    FILE* file = fopen(filepath, "w");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open file for writing %s\n", filepath);
+        return -1;
+    }
+    fprintf(file, "threshold_min,threshold_max,cooldown_blocks,window_blocks,labels,detections,matched,recall,fp_per_hour,f1,pareto\n");
+    for (int i = 0; i < num_points; i++) {
+        const tap_tune_point_t* p = &points[i];
+        fprintf(file, "%.6f,%.6f,%d,%d,%d,%d,%d,%.6f,%.4f,%.6f,%d\n",
+                Q_TO_FLOAT(p->cfg.threshold_min), Q_TO_FLOAT(p->cfg.threshold_max), p->cfg.cooldown_blocks,
+                p->cfg.double_tap_window_blocks, p->score.labels, p->score.detections, p->score.matched,
+                corpus_score_recall(&p->score), corpus_score_fp_per_hour(&p->score), corpus_score_f1(&p->score),
+                p->on_pareto_front);
+    }
+    fclose(file);
+    return 0;
+}
+
+/**
+ * @brief Entry point of "--tune". argv[0] is the program name, argv[1] the option itself.
+ */
+int tap_tune_cli(int argc, char* argv[]) {
+    if (argc < 3) {
+        print_tune_usage(argv[0]);
+        return 1;
+    }
+    const char* manifest_path = argv[2];
+    const char* csv_path = NULL;
+    const char* result_cache_path = NULL;
+
+    tap_tune_options_t options;
+    tap_tune_options_default(&options);
+
+    for (int i = 3; i < argc; i++) {
+        const char* opt = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        int param = -1;
+        for (int p = 0; p < TAP_TUNE_PARAM_COUNT; p++) {
+            if (opt[0] == '-' && opt[1] == '-' && strcmp(opt + 2, param_names[p]) == 0) param = p;
+        }
+        if (!value) {
+            fprintf(stderr, "Error: Missing value for %s\n", opt);
+            print_tune_usage(argv[0]);
+            return 1;
+        }
+        if (param >= 0) {
+            if (parse_range(value, &options.range[param]) != 0) {
+                fprintf(stderr, "Error: Invalid range '%s' for %s\n", value, opt);
+                return 1;
+            }
+        } else if (strcmp(opt, "--mode") == 0) {
+            if (strcmp(value, "grid") == 0) options.mode = TAP_TUNE_MODE_GRID;
+            else if (strcmp(value, "descent") == 0) options.mode = TAP_TUNE_MODE_DESCENT;
+            else {
+                fprintf(stderr, "Error: Unknown mode '%s'\n", value);
+                return 1;
+            }
+        } else if (strcmp(opt, "--threads") == 0) {
+            options.num_threads = atoi(value);
+        } else if (strcmp(opt, "--rounds") == 0) {
+            options.max_rounds = atoi(value);
+        } else if (strcmp(opt, "--tolerance") == 0) {
+            options.tolerance_s = (float)atof(value);
+        } else if (strcmp(opt, "--csv") == 0) {
+            csv_path = value;
+        } else if (strcmp(opt, "--result-cache") == 0) {
+            result_cache_path = value;
+        } else {
+            fprintf(stderr, "Error: Unknown option %s\n", opt);
+            print_tune_usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    corpus_t corpus;
+    if (corpus_load(&corpus, manifest_path) != 0) {
+        fprintf(stderr, "Failed to load corpus from %s. Exiting.\n", manifest_path);
+        return 1;
+    }
+    printf("Corpus: %d recordings, %d labelled taps, %.1f s of audio\n",
+           corpus.num_files, corpus.total_labels, corpus.total_duration_s);
+    if (result_cache_path && !(options.results = result_cache_open(result_cache_path))) {
+        corpus_free(&corpus);
+        return 1;
+    }
+
+    tap_tune_point_t* points = NULL;
+    int num_points = 0;
+    if (tap_tune_run(&corpus, &options, &points, &num_points) != 0) {
+        fprintf(stderr, "Error: Parameter search failed.\n");
+        result_cache_close(options.results);
+        corpus_free(&corpus);
+        return 1;
+    }
+
+    int on_front = tap_tune_mark_pareto_front(points, num_points);
+    printf("--- Pareto Front: %d of %d points (false positives/hour vs recall) ---\n", on_front, num_points);
+    printf("  thr_min |   thr_max | cooldown | window | recall |    fp/h   |   F1\n");
+    for (int i = 0; i < num_points; i++) {
+        if (points[i].on_pareto_front) print_point(&points[i]);
+    }
+
+    int status = 0;
+    if (csv_path) {
+        status = write_csv(csv_path, points, num_points) == 0 ? 0 : 1;
+        if (status == 0) printf("All evaluated points saved to: %s\n", csv_path);
+    }
+
+    if (options.results) {
+        long hits, misses, entries;
+        result_cache_stats(options.results, &hits, &misses, &entries);
+        printf("Result cache: %ld reused, %ld evaluated, %ld stored\n", hits, misses, entries);
+        result_cache_close(options.results);
+    }
+    free(points);
+    corpus_free(&corpus);
+    return status;
+}
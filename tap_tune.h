@@ -0,0 +1,56 @@
+#ifndef TAP_TUNE_H
+#define TAP_TUNE_H
+
+#include "tap_detect.h"
+#include "corpus.h"
+
+// --- Detector Parameter Auto-Tuner ---
+// Explores threshold min/max, cooldown and the double-tap window over a labelled corpus and reports the
+// Pareto front of false positives per hour versus recall. Every parameter point is evaluated on its own
+// worker thread; the corpus is decoded once up front and shared read-only by all workers.
+
+typedef enum
+{
+    TAP_TUNE_PARAM_THRESHOLD_MIN = 0, // Q2.29 value, given in float units on the command line
+    TAP_TUNE_PARAM_THRESHOLD_MAX,
+    TAP_TUNE_PARAM_COOLDOWN_BLOCKS,
+    TAP_TUNE_PARAM_WINDOW_BLOCKS,
+    TAP_TUNE_PARAM_COUNT
+} tap_tune_param_e;
+
+typedef enum
+{
+    TAP_TUNE_MODE_GRID = 0, // Exhaustive search over the cartesian product of all ranges
+    TAP_TUNE_MODE_DESCENT   // Coordinate descent on F1, starting from the default configuration
+} tap_tune_mode_e;
+
+typedef struct
+{
+    double lo;
+    double hi;
+    double step;
+} tap_tune_range_t;
+
+typedef struct
+{
+    tap_tune_mode_e  mode;
+    tap_tune_range_t range[TAP_TUNE_PARAM_COUNT];
+    int              num_threads; // 0 selects the number of online CPUs
+    int              max_rounds;  // Coordinate descent only
+    float            tolerance_s;
+    result_cache_t*  results;     // Optional result cache shared by all workers
+} tap_tune_options_t;
+
+typedef struct
+{
+    tap_detect_config_t cfg;
+    corpus_score_t      score;
+    int                 on_pareto_front;
+} tap_tune_point_t;
+
+void tap_tune_options_default(tap_tune_options_t* options);
+int  tap_tune_run(const corpus_t* corpus, const tap_tune_options_t* options, tap_tune_point_t** points_out, int* num_points_out);
+int  tap_tune_mark_pareto_front(tap_tune_point_t* points, int num_points);
+int  tap_tune_cli(int argc, char* argv[]);
+
+#endif // !TAP_TUNE_H
@@ -0,0 +1,313 @@
+#include <stdio.h>    // For file I/O (fopen, fread, fwrite)
+#include <stdlib.h>   // For memory allocation (malloc, free)
+#include <string.h>   // For strncmp, strcmp, memcpy
+#include <fcntl.h>    // For open, _O_BINARY
+#include <sys/stat.h> // For fstat
+#ifdef _WIN32
+#include <io.h>       // For _setmode, _fileno, _read, _close
+#else
+#include <unistd.h>   // For read, close
+#endif
+
+#include "wav_io.h"
+
+#ifndef O_BINARY
+#define O_BINARY (0)
+#endif
+
+// --- WAV Header Structure ---
+// Defines the standard RIFF WAV file header for 16-bit PCM mono audio.
+typedef struct {
+    char     riff[4];        // "RIFF" chunk ID
+    uint32_t overall_size;   // Size of the entire file in bytes minus 8 bytes
+    char     wave[4];        // "WAVE" format
+    char     fmt_chunk_marker[4]; // "fmt " subchunk 1 ID
+    uint32_t fmt_chunk_size; // Size of the fmt subchunk (16 for PCM)
+    uint16_t audio_format;   // Audio format (1 for PCM)
+    uint16_t num_channels;   // Number of channels (1 for mono, 2 for stereo)
+    uint32_t sample_rate;    // Sample rate in Hz
+    uint32_t byte_rate;      // Byte rate = sample_rate * num_channels * bits_per_sample/8
+    uint16_t block_align;    // Block align = num_channels * bits_per_sample/8
+    uint16_t bits_per_sample;// Bits per sample (16 for 16-bit PCM)
+    char     data_chunk_marker[4]; // "data" subchunk 2 ID
+    uint32_t data_size;      // Size of the data section in bytes
+} WavHeader;
+
+// Accepts the 16-bit PCM mono and stereo headers the microphone readers support; reports anything else.
+static int check_mics_header(const WavHeader* header, const char* filepath) {
+    if (strncmp(header->riff, "RIFF", 4) != 0 || strncmp(header->wave, "WAVE", 4) != 0 ||
+        strncmp(header->fmt_chunk_marker, "fmt ", 4) != 0 || strncmp(header->data_chunk_marker, "data", 4) != 0 ||
+        header->audio_format != 1 || (header->num_channels != 1 && header->num_channels != 2) || header->bits_per_sample != 16) {
+        fprintf(stderr, "Error: Unsupported WAV format. Requires 16-bit PCM mono or stereo. %s\n", filepath);
+        return -1;
+    }
+    return 0;
+}
+
+// Converts interleaved 16-bit frames to Q2.29; mic2 is only written for stereo.
+static void deinterleave_mics(const int16_t* frames_in, long frames, int channels, fixed_point_t* mic1, fixed_point_t* mic2) {
+    for (long f = 0; f < frames; f++) {
+        mic1[f] = ((fixed_point_t)frames_in[f * channels] << (Q_FORMAT - 15));
+        if (channels == 2) {
+            mic2[f] = ((fixed_point_t)frames_in[f * 2 + 1] << (Q_FORMAT - 15));
+        }
+    }
+}
+
+/**
+ * @brief Reads a 16-bit PCM WAV file holding one or two microphones into Q2.29 fixed-point.
+ * @param filepath The path to the input WAV file.
+ * @param samplerate_out Pointer to a uint32_t to store the sample rate read from the header.
+ * @param num_samples_out Pointer to a long to store the number of samples per microphone.
+ * @param mic2_out Receives the second microphone's samples. For mono files it points at the first microphone.
+ * @return A pointer to a newly allocated array holding mic1 (followed by mic2 for stereo files),
+ * or NULL if an error occurs. The caller frees only this pointer.
+ * Assumptions: Input WAV is 16-bit PCM, mono or stereo (left = mic1, right = mic2).
+ */
+fixed_point_t* read_wav_mics_fx(const char* filepath, uint32_t* samplerate_out, long* num_samples_out, const fixed_point_t** mic2_out) {
+    FILE* file = fopen(filepath, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open WAV file %s\n", filepath);
+        return NULL;
+    }
+
+    WavHeader header;
+    if (fread(&header, 1, sizeof(WavHeader), file) != sizeof(WavHeader)) {
+        fprintf(stderr, "Error: Could not read full WAV header from %s\n", filepath);
+        fclose(file);
+        return NULL;
+    }
+
+    if (check_mics_header(&header, filepath) != 0) {
+        fclose(file);
+        return NULL;
+    }
+
+    int channels = header.num_channels;
+    long num_samples = (long)(header.data_size / (sizeof(int16_t) * channels));
+    fixed_point_t* audio_data_fx = (fixed_point_t*)malloc((size_t)num_samples * channels * sizeof(fixed_point_t) + 1);
+    if (!audio_data_fx) {
+        fprintf(stderr, "Error: Memory allocation failed for fixed-point audio data.\n");
+        fclose(file);
+        return NULL;
+    }
+    fixed_point_t* mic2 = audio_data_fx + (channels == 2 ? num_samples : 0);
+
+    // Read in blocks and deinterleave; one fread per sample dominates run time on long recordings
+    int16_t block[4096];
+    long frames_per_block = (long)(sizeof(block) / sizeof(block[0])) / channels;
+    for (long i = 0; i < num_samples; i += frames_per_block) {
+        long frames = (num_samples - i < frames_per_block) ? (num_samples - i) : frames_per_block;
+        if (fread(block, sizeof(int16_t) * channels, (size_t)frames, file) != (size_t)frames) {
+            fprintf(stderr, "Error: Could not read sample %ld from WAV file.\n", i);
+            free(audio_data_fx);
+            fclose(file);
+            return NULL;
+        }
+        deinterleave_mics(block, frames, channels, audio_data_fx + i, mic2 + i);
+    }
+
+    fclose(file);
+    *samplerate_out = header.sample_rate;
+    *num_samples_out = num_samples;
+    *mic2_out = mic2;
+    return audio_data_fx;
+}
+
+/**
+ * @brief Decodes a WAV file already read into memory, with the results and error messages of read_wav_mics_fx().
+ * @param bytes The file contents (or a prefix of them: a short buffer fails like a truncated file).
+ * @param len Number of bytes available.
+ * @param filepath Only used in error messages.
+ * @return The decoded buffer as read_wav_mics_fx() returns it, or NULL on error.
+ */
+fixed_point_t* decode_wav_mics_fx(const void* bytes, size_t len, const char* filepath, uint32_t* samplerate_out,
+                                  long* num_samples_out, const fixed_point_t** mic2_out) {
+    WavHeader header;
+    if (len < sizeof(WavHeader)) {
+        fprintf(stderr, "Error: Could not read full WAV header from %s\n", filepath);
+        return NULL;
+    }
+    memcpy(&header, bytes, sizeof(WavHeader));
+    if (check_mics_header(&header, filepath) != 0) return NULL;
+
+    int channels = header.num_channels;
+    long num_samples = (long)(header.data_size / (sizeof(int16_t) * channels));
+    long available = (long)((len - sizeof(WavHeader)) / (sizeof(int16_t) * channels));
+    if (available < num_samples) {
+        // Same sample index read_wav_mics_fx() reports: the start of its 4096-sample read that comes up short
+        long frames_per_block = 4096 / channels;
+        fprintf(stderr, "Error: Could not read sample %ld from WAV file.\n", available / frames_per_block * frames_per_block);
+        return NULL;
+    }
+    fixed_point_t* audio_data_fx = (fixed_point_t*)malloc((size_t)num_samples * channels * sizeof(fixed_point_t) + 1);
+    if (!audio_data_fx) {
+        fprintf(stderr, "Error: Memory allocation failed for fixed-point audio data.\n");
+        return NULL;
+    }
+    fixed_point_t* mic2 = audio_data_fx + (channels == 2 ? num_samples : 0);
+    // The samples start at byte 44 of the buffer, so they are 2-byte aligned if the buffer is
+    deinterleave_mics((const int16_t*)((const unsigned char*)bytes + sizeof(WavHeader)), num_samples, channels, audio_data_fx, mic2);
+
+    *samplerate_out = header.sample_rate;
+    *num_samples_out = num_samples;
+    *mic2_out = mic2;
+    return audio_data_fx;
+}
+
+// --- Incremental WAV Reader ---
+
+// Reads exactly len bytes unless the file ends first. Returns the byte count, -1 on error.
+static long read_full(int fd, void* buf, size_t len) {
+    size_t have = 0;
+    while (have < len) {
+#ifdef _WIN32
+        long n = _read(fd, (char*)buf + have, (unsigned int)(len - have));
+#else
+        long n = (long)read(fd, (char*)buf + have, len - have);
+#endif
+        if (n <= 0) return n == 0 ? (long)have : -1;
+        have += (size_t)n;
+    }
+    return (long)have;
+}
+
+/**
+ * @brief Opens a 16-bit PCM mono or stereo WAV file, reads its header and checks that a regular file holds all
+ *        the samples the header announces.
+ * @return 0 on success with reader->fd positioned at the samples, -1 on failure (reported on stderr).
+ */
+int wav_reader_open(wav_reader_t* reader, const char* filepath) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = open(filepath, O_RDONLY | O_BINARY);
+    if (reader->fd < 0) {
+        fprintf(stderr, "Error: Could not open WAV file %s\n", filepath);
+        return -1;
+    }
+
+    WavHeader header;
+    if (read_full(reader->fd, &header, sizeof(WavHeader)) != (long)sizeof(WavHeader)) {
+        fprintf(stderr, "Error: Could not read full WAV header from %s\n", filepath);
+        wav_reader_close(reader);
+        return -1;
+    }
+    if (check_mics_header(&header, filepath) != 0) {
+        wav_reader_close(reader);
+        return -1;
+    }
+    reader->samplerate = header.sample_rate;
+    reader->num_channels = header.num_channels;
+    reader->num_samples = (long)(header.data_size / (sizeof(int16_t) * header.num_channels));
+
+    // A truncated regular file fails here, before the caller produced any output, with the index of the first
+    // missing sample; pipes and sockets can only be checked as they are read
+    struct stat st;
+    if (fstat(reader->fd, &st) == 0 && (st.st_mode & S_IFMT) == S_IFREG) {
+        long frame_bytes = (long)sizeof(int16_t) * reader->num_channels;
+        long available = (long)((st.st_size - (long)sizeof(WavHeader)) / frame_bytes);
+        if (available < reader->num_samples) {
+            fprintf(stderr, "Error: Could not read sample %ld from WAV file.\n", available);
+            wav_reader_close(reader);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void wav_reader_close(wav_reader_t* reader) {
+    if (reader->fd >= 0) {
+#ifdef _WIN32
+        _close(reader->fd);
+#else
+        close(reader->fd);
+#endif
+    }
+    reader->fd = -1;
+}
+
+// --- Streaming WAV Writer ---
+
+static void fill_pcm16_header(WavHeader* header, uint32_t samplerate, int num_channels, uint32_t data_size) {
+    memcpy(header->riff, "RIFF", 4);
+    memcpy(header->wave, "WAVE", 4);
+    memcpy(header->fmt_chunk_marker, "fmt ", 4);
+    memcpy(header->data_chunk_marker, "data", 4);
+    header->audio_format = 1;
+    header->num_channels = (uint16_t)num_channels;
+    header->sample_rate = samplerate;
+    header->bits_per_sample = 16;
+    header->byte_rate = samplerate * num_channels * 2;
+    header->block_align = (uint16_t)(num_channels * 2);
+    header->fmt_chunk_size = 16;
+    header->data_size = data_size;
+    header->overall_size = (data_size > UINT32_MAX - 36) ? UINT32_MAX : data_size + 36;
+}
+
+/**
+ * @brief Opens a 16-bit PCM WAV file for incremental writing. "-" writes to stdout; since the header cannot be
+ * patched there, its sizes are set to the streaming placeholder 0xFFFFFFFF.
+ * @return 0 on success, -1 on failure.
+ */
+int wav_writer_open(wav_writer_t* writer, const char* filepath, uint32_t samplerate, int num_channels) {
+    memset(writer, 0, sizeof(*writer));
+    writer->is_stdout = (strcmp(filepath, "-") == 0);
+    if (writer->is_stdout) {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        writer->file = stdout;
+    } else {
+        writer->file = fopen(filepath, "wb");
+    }
+    if (!writer->file) {
+        fprintf(stderr, "Error: Could not open file for writing %s\n", filepath);
+        return -1;
+    }
+    writer->samplerate = samplerate;
+    writer->num_channels = num_channels;
+
+    WavHeader header;
+    fill_pcm16_header(&header, samplerate, num_channels, writer->is_stdout ? UINT32_MAX : 0);
+    if (fwrite(&header, 1, sizeof(WavHeader), writer->file) != sizeof(WavHeader)) {
+        fprintf(stderr, "Error: Could not write WAV header to %s\n", filepath);
+        if (!writer->is_stdout) fclose(writer->file);
+        writer->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Writes interleaved 16-bit frames.
+int wav_writer_write(wav_writer_t* writer, const int16_t* interleaved, long num_frames) {
+    size_t count = (size_t)num_frames * writer->num_channels;
+    if (fwrite(interleaved, sizeof(int16_t), count, writer->file) != count) {
+        fprintf(stderr, "Error: Could not write WAV data.\n");
+        return -1;
+    }
+    writer->frames_written += (uint64_t)num_frames;
+    return 0;
+}
+
+// Patches the header sizes and closes the file. Data beyond 4 GiB is kept, but the sizes saturate.
+int wav_writer_close(wav_writer_t* writer) {
+    if (!writer->file) return -1;
+    int status = 0;
+    if (writer->is_stdout) {
+        status = fflush(writer->file) == 0 ? 0 : -1;
+    } else {
+        uint64_t data_size = writer->frames_written * writer->num_channels * sizeof(int16_t);
+        if (data_size > UINT32_MAX) {
+            fprintf(stderr, "Warning: WAV data exceeds 4 GiB; header sizes are saturated.\n");
+            data_size = UINT32_MAX;
+        }
+        WavHeader header;
+        fill_pcm16_header(&header, writer->samplerate, writer->num_channels, (uint32_t)data_size);
+        if (fseek(writer->file, 0, SEEK_SET) != 0 || fwrite(&header, 1, sizeof(WavHeader), writer->file) != sizeof(WavHeader)) {
+            status = -1;
+        }
+        if (fclose(writer->file) != 0) status = -1;
+    }
+    writer->file = NULL;
+    if (status != 0) fprintf(stderr, "Error: Could not finalize WAV file.\n");
+    return status;
+}
@@ -0,0 +1,49 @@
+#ifndef WAV_IO_H
+#define WAV_IO_H
+#include <stdint.h>
+#include <stdio.h>
+
+#include "tap_detect.h"
+
+// --- Fixed-Point Configuration ---
+// We'll use Q2.29 fixed-point format for 32-bit processing.
+// This means: 1 sign bit, 2 integer bits, 29 fractional bits.
+// The value range for a Q2.29 fixed_point_t (int32_t) is approximately -4.0 to +3.999...
+// This provides sufficient headroom for audio processing (audio typically normalized to -1.0 to 1.0).
+#define Q_FORMAT Q_BITS // Using Q_BITS from tap_detect.h for consistency (29)
+#define FIXED_POINT_ONE Q_ONE // Using Q_ONE from tap_detect.h for consistency (1 << 29)
+
+// Define the fixed_point_t type as a signed 32-bit integer for processing
+typedef int32_t fixed_point_t;
+
+fixed_point_t* read_wav_mics_fx(const char* filepath, uint32_t* samplerate_out, long* num_samples_out, const fixed_point_t** mic2_out);
+fixed_point_t* decode_wav_mics_fx(const void* bytes, size_t len, const char* filepath, uint32_t* samplerate_out,
+                                  long* num_samples_out, const fixed_point_t** mic2_out);
+
+// Incremental reader: opens a 16-bit PCM mono or stereo WAV file, validates its header like read_wav_mics_fx(), rejects
+// a regular file shorter than its data chunk and leaves fd at the first interleaved sample, for callers that read the
+// samples themselves (see tap_pipeline.c).
+typedef struct {
+    int      fd;
+    uint32_t samplerate;
+    int      num_channels;
+    long     num_samples;   // Frames in the data chunk
+} wav_reader_t;
+
+int  wav_reader_open(wav_reader_t* reader, const char* filepath);
+void wav_reader_close(wav_reader_t* reader);
+
+// Streaming 16-bit PCM writer for outputs too large to hold in memory (e.g., synthetic benchmark corpora).
+typedef struct {
+    FILE*    file;
+    uint32_t samplerate;
+    int      num_channels;
+    int      is_stdout;
+    uint64_t frames_written;
+} wav_writer_t;
+
+int wav_writer_open(wav_writer_t* writer, const char* filepath, uint32_t samplerate, int num_channels);
+int wav_writer_write(wav_writer_t* writer, const int16_t* interleaved, long num_frames);
+int wav_writer_close(wav_writer_t* writer);
+
+#endif // !WAV_IO_H